@@ -59,8 +59,37 @@ void Error_Handler(void);
 /* DAC fault burst control (implemented in Core/Src/freertos.c) */
 bool DAC_FaultBurst_Trigger(uint32_t fault_id_0_5, uint32_t duration_s);
 void DAC_FaultBurst_Stop(void);
+/* ready_mask: waves loaded from the QSPI directory at boot get their bit once the background
+ * payload check passes, up to about a second after the output started. */
 void DAC_FaultBurst_GetUiState(uint32_t *ready_mask, uint8_t *active_fault_id_0_5, uint32_t *remaining_s);
+/* Playlist step: partition 0 = normal, 1..6 = fault id + 1, 7.. = other QSPI directory waves
+ * (boot log "directory wave: source=N"); duration_ms 0 = hold (last step). */
+typedef struct {
+  uint8_t partition;
+  uint32_t duration_ms;
+  uint16_t repeat;
+} DAC_FaultPlaylistStep_t;
+bool DAC_FaultPlaylist_Start(const DAC_FaultPlaylistStep_t *steps, uint32_t count);
+/* Command producers: each has its own lock-free queue to the DAC dispatcher (Main_Task),
+ * so each source must be posted from one task only. The DAC_FaultBurst_* / DAC_FaultPlaylist_Start
+ * calls above post as DAC_CMD_SRC_UI. */
+typedef enum {
+  DAC_CMD_SRC_UI = 0,
+  DAC_CMD_SRC_NET,
+  DAC_CMD_SRC_SCRIPT,
+  DAC_CMD_SRC_COUNT
+} DAC_CmdSource_t;
+/* Return the command's sequence number on src, 0 when rejected up front or the queue is full. */
+uint32_t DAC_Cmd_FaultTrigger(DAC_CmdSource_t src, uint32_t fault_id_0_5, uint32_t duration_s);
+uint32_t DAC_Cmd_FaultStop(DAC_CmdSource_t src);
+uint32_t DAC_Cmd_Playlist(DAC_CmdSource_t src, const DAC_FaultPlaylistStep_t *steps, uint32_t count);
+/* 0 pending, 1 applied, 2 rejected by the dispatcher, 3 unknown / too old (DAC8568_CmdStatus_t). */
+uint8_t DAC_Cmd_GetStatus(DAC_CmdSource_t src, uint32_t seq);
 bool DAC_Wave_IsBootReady(void);
+/* Re-sync the named waves from SD without stopping the output (see DAC_WAVE_STAGE_CACHE_ADDR);
+ * runs in Main_Task, faults / playlists are rejected until it is done. */
+bool DAC_Wave_StagedUpdate(void);
+bool DAC_Wave_IsUpdating(void);
 
 /* USER CODE END EFP */
 
@@ -134,12 +163,42 @@ bool DAC_Wave_IsBootReady(void);
 
 /*
  * Boot-time SD->W25Q256 full sync switch:
- * 1: every boot sync all 7 partitions from SD.
+ * 1: every boot sync all 7 partitions from SD (incremental: unchanged files are
+ *    skipped after a header check, changed ones only rewrite the 64KB blocks that differ).
  * 0: skip SD sync on boot, only load existing wave metadata from QSPI.
  */
 #ifndef DAC_WAVE_BOOT_FULL_SYNC
 #define DAC_WAVE_BOOT_FULL_SYNC 0
 #endif
+
+/*
+ * 1: 不加载 SD/QSPI 波形分区，七路波形全部由 dac8568_synth.c 按
+ *    tools/gen_dac_fault_suite.py 的模型在片上实时合成（无 28MB 闪存占用、无 SD 同步），
+ *    参数可用 DAC8568_DMA_LoadSynth() 在线修改；0: 播放 QSPI 分区。
+ */
+#ifndef DAC_WAVE_SYNTH
+#define DAC_WAVE_SYNTH 0
+#endif
+#ifndef DAC_WAVE_SYNTH_SAMPLE_RATE
+#define DAC_WAVE_SYNTH_SAMPLE_RATE 102400u
+#endif
+/* Loop length of every synthesized wave; 524280 = code16 partition sample_count. */
+#ifndef DAC_WAVE_SYNTH_LOOP_SAMPLES
+#define DAC_WAVE_SYNTH_LOOP_SAMPLES 524280u
+#endif
+
+/*
+ * Live wave update (DAC_Wave_StagedUpdate): the baseline payload is copied to
+ * this SDRAM window and played from there while QSPI is out of memory-mapped
+ * mode for programming, then the stream swaps back to the verified partitions.
+ * Upper 8MB of the 16MB SDRAM; the LTDC framebuffer sits at 0xC0000000.
+ */
+#ifndef DAC_WAVE_STAGE_CACHE_ADDR
+#define DAC_WAVE_STAGE_CACHE_ADDR 0xC0800000u
+#endif
+#ifndef DAC_WAVE_STAGE_CACHE_BYTES
+#define DAC_WAVE_STAGE_CACHE_BYTES 0x00800000u
+#endif
 /* USER CODE END Private defines */
 
 #ifdef __cplusplus
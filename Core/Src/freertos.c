@@ -34,7 +34,12 @@
 // Demo 已移除，使用自定义 EdgeWind UI
 #include "EdgeWind_UI/edgewind_ui.h"
 #include "DAC8568/dac8568_dma.h"
+#include "DAC8568/dac8568_adc.h"
+#include "DAC8568/dac8568_cmd.h"
 #include "sd_waveform.h"
+#include "crc32_fast.h"
+#include "sd_read_pipe.h"
+#include "qspi_w25q256.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -273,27 +278,69 @@ static int8_t W25Q256_SelfTest_CrossPageAndSector(void)
 /* Private variables ---------------------------------------------------------*/
 /* USER CODE BEGIN Variables */
 
-/* === DAC waveform partitions: 4MB reserved + 7 x 4MB waves === */
+/* === DAC waves from the QSPI wave directory: sources 0..6 = the named waves synced from SD,
+ * 7.. = any other directory entries (long recordings, custom faults) in directory order === */
 #define DAC_WAVE_PART_COUNT SD_DAC_QSPI_PARTITION_COUNT
+#define DAC_WAVE_SOURCE_COUNT DAC8568_QSPI_SOURCE_MAX
+#if (DAC_WAVE_SOURCE_COUNT > 32u)
+#error "DAC_WAVE_SOURCE_COUNT exceeds the 32-bit ready masks"
+#endif
 #define DAC_FAULT_COUNT 6u
-#define DAC_FAULT_CMD_NONE    0u
-#define DAC_FAULT_CMD_TRIGGER 1u
-#define DAC_FAULT_CMD_STOP    2u
+/* Fault onset/offset blend; DAC8568_TRANSITION_HARD restores the plain cut. */
+#ifndef DAC_FAULT_TRANSITION_MODE
+#define DAC_FAULT_TRANSITION_MODE DAC8568_TRANSITION_RAISED_COSINE
+#endif
+#ifndef DAC_FAULT_TRANSITION_US
+#define DAC_FAULT_TRANSITION_US 1000u
+#endif
+/* One slot is kept for the automatic return-to-normal hold step. */
+#define DAC_FAULT_PLAYLIST_MAX (DAC8568_PLAYLIST_MAX - 1u)
+#if (DAC_FAULT_PLAYLIST_MAX > DAC8568_CMD_STEPS_MAX)
+#error "DAC8568_CMD_STEPS_MAX must hold a full fault playlist"
+#endif
+/* Staged update: longest wait for the refill to stop reading QSPI (switch + transition + MDMA). */
+#define DAC_WAVE_STAGE_IDLE_MS 2000u
+/* Background payload check: bytes hashed per Main_Task pass (5 ms), about 1 s for a full 28MB region. */
+#define DAC_WAVE_VERIFY_BUDGET 0x40000u
+/* 1: after the boot load, time CRC32 (bitwise / slice-by-8 / CRC unit fed by CPU / by MDMA) over the mapped baseline payload. */
+#ifndef DAC_WAVE_CRC_BENCH
+#define DAC_WAVE_CRC_BENCH 0
+#endif
+/* Output check (DAC8568_VERIFY_ENABLE=1): ADC1 inputs wired to the divided op-amp outputs. */
+#ifndef DAC_VERIFY_PROBE0_DAC
+#define DAC_VERIFY_PROBE0_DAC DAC8568_CHANNEL_A
+#endif
+#ifndef DAC_VERIFY_PROBE0_ADC
+#define DAC_VERIFY_PROBE0_ADC 4u /* PC4 = ADC12_INP4 */
+#endif
+#ifndef DAC_VERIFY_PROBE1_DAC
+#define DAC_VERIFY_PROBE1_DAC DAC8568_CHANNEL_C
+#endif
+#ifndef DAC_VERIFY_PROBE1_ADC
+#define DAC_VERIFY_PROBE1_ADC 5u /* PB1 = ADC12_INP5 */
+#endif
 
-static SD_DacWaveInfo_t s_dac_wave_info[DAC_WAVE_PART_COUNT];
-static uint32_t s_dac_wave_ready_mask = 0u;    /* bit i => partition i header ok */
-static uint32_t s_dac_wave_sd_sync_mask = 0u;  /* bit i => partition i synced from SD this boot */
+static SD_DacWaveInfo_t s_dac_wave_info[DAC_WAVE_SOURCE_COUNT];
+static uint32_t s_dac_wave_ready_mask = 0u;    /* bit i => source i ready */
+static uint32_t s_dac_wave_sd_sync_mask = 0u;  /* bit i => named wave i synced from SD this boot */
+static uint32_t s_dac_wave_verify_mask = 0u;   /* bit i => source i taken from the directory, payload check pending */
+#if (DAC_WAVE_SYNTH == 0)
+static uint32_t s_dac_wave_verify_t0 = 0u;
+#endif
 static volatile uint8_t s_dac_wave_boot_sync_done = 0u;
 static volatile uint8_t s_dac_stream_started = 0u;
+static volatile uint8_t s_dac_wave_update_pending = 0u; /* DAC_Wave_StagedUpdate -> Main_Task */
 
 /* Fault burst runtime state (read by UI via DAC_FaultBurst_GetUiState). */
 static volatile uint8_t s_fault_active_id_0_5 = 0xFFu; /* 0xFF => normal */
 static volatile TickType_t s_fault_end_tick = 0;
+/* Burst length; s_fault_end_tick is re-anchored to the output onset from the switch event. */
+static TickType_t s_fault_duration_ticks = 0;
+static uint8_t s_fault_onset_pending = 0u;
 static volatile uint32_t s_fault_remaining_s = 0u;
-static volatile uint8_t s_fault_cmd_pending = 0u;
-static volatile uint8_t s_fault_cmd_type = DAC_FAULT_CMD_NONE;
-static volatile uint8_t s_fault_cmd_id_0_5 = 0xFFu;
-static volatile uint32_t s_fault_cmd_duration_s = 0u;
+/* Control commands: one lock-free ring per producer (DAC_CmdSource_t), drained by dac_cmd_dispatch(). */
+static DAC8568_CmdRing_t s_dac_cmd_ring[DAC_CMD_SRC_COUNT];
+static volatile uint8_t s_fault_playlist_running = 0u;
 
 static const char * const s_dac_wave_sd_paths[DAC_WAVE_PART_COUNT] = {
   DAC_WAVE_SD_PATH_NORMAL,
@@ -339,10 +386,22 @@ const osThreadAttr_t ESP8266_attributes = {
 /* USER CODE BEGIN FunctionPrototypes */
 extern const osMutexAttr_t Thread_Mutex_attr;
 
+static void dac_cmd_dispatch(void);
 static void dac_fault_burst_service(void);
+static void dac_switch_event_service(void);
 static bool dac_fault_apply_trigger(uint32_t fault_id_0_5, uint32_t duration_s);
 static void dac_fault_apply_stop(void);
-static void dac_fault_post_command(uint8_t cmd_type, uint8_t fault_id_0_5, uint32_t duration_s);
+static bool dac_fault_apply_playlist(const DAC8568_CmdStep_t *steps, uint32_t count);
+static void dac_wave_load_directory_extras(SD_DacWaveInfo_t *info_out, uint32_t *loaded_mask);
+static bool dac_wave_qspi_live(void);
+#if (DAC_WAVE_SYNTH == 0)
+static void dac_wave_staged_update(void);
+static void dac_wave_verify_service(void);
+#endif
+#if (DAC8568_VERIFY_ENABLE != 0)
+static void dac_verify_enable(void);
+static void dac_verify_report(void);
+#endif
 
 /* USER CODE END FunctionPrototypes */
 
@@ -503,21 +562,38 @@ void Main_Task(void *argument)
   /* USER CODE BEGIN Main_Task */
   uint8_t stream_enabled = 0u;
   uint32_t started_sps = 0u;
-  const uint8_t do_boot_sync = (DAC_WAVE_BOOT_FULL_SYNC != 0u) ? 1u : 0u;
+  const uint8_t do_boot_sync = (DAC_WAVE_BOOT_FULL_SYNC != 0u && DAC_WAVE_SYNTH == 0) ? 1u : 0u;
 
   memset(s_dac_wave_info, 0, sizeof(s_dac_wave_info));
   s_dac_wave_ready_mask = 0u;
   s_dac_wave_sd_sync_mask = 0u;
+  s_dac_wave_verify_mask = 0u;
   s_dac_wave_boot_sync_done = 0u;
   s_dac_stream_started = 0u;
   s_fault_active_id_0_5 = 0xFFu;
   s_fault_end_tick = 0;
   s_fault_remaining_s = 0u;
-  s_fault_cmd_pending = 0u;
-  s_fault_cmd_type = DAC_FAULT_CMD_NONE;
-  s_fault_cmd_id_0_5 = 0xFFu;
-  s_fault_cmd_duration_s = 0u;
+  s_dac_wave_update_pending = 0u;
+  const uint32_t sync_t0 = osKernelGetTickCount();
 
+#if (DAC_WAVE_SYNTH != 0)
+  printf("[DAC] init ok, waves synthesized on-device: sps=%lu loop=%lu\r\n",
+         (unsigned long)DAC_WAVE_SYNTH_SAMPLE_RATE, (unsigned long)DAC_WAVE_SYNTH_LOOP_SAMPLES);
+  for (uint32_t i = 0u; i < DAC_WAVE_PART_COUNT; i++) {
+    DAC8568_SynthParams_t params;
+    DAC8568_Synth_DefaultParams(&params, (DAC8568_SynthKind_t)i, DAC_WAVE_SYNTH_SAMPLE_RATE,
+                                DAC_WAVE_SYNTH_LOOP_SAMPLES);
+    if (DAC8568_DMA_LoadSynth((uint8_t)i, &params) != 0) {
+      printf("[DAC WAVE] synth load failed: part=%s\r\n", SD_Wave_GetPartitionName((SD_DacWavePartition_t)i));
+      continue;
+    }
+    s_dac_wave_ready_mask |= (1u << i);
+    s_dac_wave_info[i].sample_rate_hz = DAC_WAVE_SYNTH_SAMPLE_RATE;
+    s_dac_wave_info[i].sample_count = DAC_WAVE_SYNTH_LOOP_SAMPLES;
+    s_dac_wave_info[i].partition_id = i;
+    s_dac_wave_info[i].format = DAC8568_WAVE_FORMAT_SYNTH;
+  }
+#else
   /* NOTE: FatFs SD driver (FATFS/Target/sd_diskio.c) gates SD_initialize() on
    * osKernelRunning(), so SD mount/sync must happen after scheduler start. */
   if (do_boot_sync != 0u) {
@@ -527,6 +603,9 @@ void Main_Task(void *argument)
     printf("[DAC] init ok, boot full sync disabled\r\n");
     printf("[DAC WAVE] boot load begin(from QSPI): partitions=%lu\r\n",
            (unsigned long)DAC_WAVE_PART_COUNT);
+    if (!SD_Wave_DirLoad()) {
+      printf("[DAC WAVE] wave directory not readable\r\n");
+    }
   }
 
   for (uint32_t i = 0u; i < DAC_WAVE_PART_COUNT; i++) {
@@ -556,11 +635,19 @@ void Main_Task(void *argument)
              SD_Wave_GetPartitionName(part));
     }
 
+    /*
+     * Directory only: the fault becomes ready once the background check has
+     * hashed its payload. The baseline starts at once; its check only reports.
+     */
     if (SD_Wave_LoadDacInfoFromQspiPartition(part, &info)) {
-      s_dac_wave_ready_mask |= (1u << i);
+      s_dac_wave_verify_mask |= (1u << i);
+      if (i == 0u) {
+        s_dac_wave_ready_mask |= 1u;
+      }
       s_dac_wave_info[i] = info;
-      printf("[DAC WAVE] load from QSPI ok: part=%s sps=%lu count=%lu addr=0x%08lX\r\n",
+      printf("[DAC WAVE] load from QSPI ok: part=%s fmt=%lu sps=%lu count=%lu addr=0x%08lX\r\n",
              SD_Wave_GetPartitionName(part),
+             (unsigned long)info.format,
              (unsigned long)info.sample_rate_hz,
              (unsigned long)info.sample_count,
              (unsigned long)info.qspi_mmap_addr);
@@ -569,17 +656,40 @@ void Main_Task(void *argument)
 
     printf("[DAC WAVE] partition not ready: part=%s\r\n", SD_Wave_GetPartitionName(part));
   }
+  dac_wave_load_directory_extras(s_dac_wave_info, &s_dac_wave_verify_mask);
+  s_dac_wave_verify_t0 = osKernelGetTickCount();
+#endif
+
+  /* v2 headers carry loop markers; v1 / synthesized partitions loop whole. */
+  for (uint32_t i = 0u; i < DAC_WAVE_SOURCE_COUNT; i++) {
+    if (((s_dac_wave_ready_mask | s_dac_wave_verify_mask) & (1u << i)) != 0u &&
+        DAC8568_DMA_SetSourceLoop((uint8_t)i, s_dac_wave_info[i].loop_start, s_dac_wave_info[i].loop_end,
+                                  (uint8_t)s_dac_wave_info[i].loop_flags) != 0) {
+      printf("[DAC WAVE] loop markers ignored: source=%lu\r\n", (unsigned long)i);
+    }
+  }
 
   s_dac_wave_boot_sync_done = 1u;
   if (do_boot_sync != 0u) {
-    printf("[DAC WAVE] full sync done: ready_mask=0x%02lX sd_sync_mask=0x%02lX\r\n",
+    /* Total suite time: compare SD_READ_PIPE_ASYNC 1 (read-ahead task) vs 0 (serial read / program). */
+    printf("[DAC WAVE] full sync done: ready_mask=0x%02lX sd_sync_mask=0x%02lX, %lu ms (sd read-ahead %s)\r\n",
            (unsigned long)s_dac_wave_ready_mask,
-           (unsigned long)s_dac_wave_sd_sync_mask);
+           (unsigned long)s_dac_wave_sd_sync_mask,
+           (unsigned long)(osKernelGetTickCount() - sync_t0),
+           (SD_READ_PIPE_ASYNC != 0u) ? "on" : "off");
   } else {
-    printf("[DAC WAVE] boot load done: ready_mask=0x%02lX\r\n",
-           (unsigned long)s_dac_wave_ready_mask);
+    printf("[DAC WAVE] boot load done: ready_mask=0x%02lX check_pending=0x%02lX, %lu ms\r\n",
+           (unsigned long)s_dac_wave_ready_mask,
+           (unsigned long)s_dac_wave_verify_mask,
+           (unsigned long)(osKernelGetTickCount() - sync_t0));
   }
 
+#if (DAC_WAVE_CRC_BENCH != 0)
+  if ((s_dac_wave_ready_mask & 0x1u) != 0u && s_dac_wave_info[0].format != DAC8568_WAVE_FORMAT_SYNTH) {
+    (void)CRC32_Fast_Bench((const void *)s_dac_wave_info[0].qspi_mmap_addr, s_dac_wave_info[0].data_bytes);
+  }
+#endif
+
   if ((s_dac_wave_ready_mask & 0x1u) == 0u) {
     printf("[DAC WAVE] baseline not ready, no output\r\n");
   } else {
@@ -590,8 +700,11 @@ void Main_Task(void *argument)
 #endif
     {
       SD_DacWaveInfo_t *base = &s_dac_wave_info[0];
-      if (DAC8568_DMA_UseQspiWave(base->qspi_mmap_addr, base->sample_count, base->sample_rate_hz) == 0) {
-        printf("[DAC WAVE] baseline source=QSPI sps=%lu count=%lu addr=0x%08lX\r\n",
+      if (DAC8568_DMA_UseQspiWave(base->qspi_mmap_addr, base->sample_count, (uint8_t)base->format,
+                                  base->sample_rate_hz) == 0) {
+        printf("[DAC WAVE] baseline source=%s fmt=%lu sps=%lu count=%lu addr=0x%08lX\r\n",
+               (base->format == DAC8568_WAVE_FORMAT_SYNTH) ? "synth" : "QSPI",
+               (unsigned long)base->format,
                (unsigned long)base->sample_rate_hz,
                (unsigned long)base->sample_count,
                (unsigned long)base->qspi_mmap_addr);
@@ -604,9 +717,16 @@ void Main_Task(void *argument)
   }
 
   if (stream_enabled != 0u) {
+    DAC8568_DMA_SetTransition(DAC_FAULT_TRANSITION_MODE, DAC_FAULT_TRANSITION_US);
+#if (DAC8568_VERIFY_ENABLE != 0)
+    dac_verify_enable();
+#endif
     DAC8568_DMA_Start();
     s_dac_stream_started = 1u;
-    printf("[DAC] start sps=%lu\r\n", (unsigned long)started_sps);
+    /* The first sample leaves one TIM12 period after Start. */
+    printf("[DAC] start sps=%lu, time to first sample %lu ms after reset (%lu ms in Main_Task)\r\n",
+           (unsigned long)started_sps, (unsigned long)HAL_GetTick(),
+           (unsigned long)(osKernelGetTickCount() - sync_t0));
   } else {
     DAC8568_OutputFixedVoltage(0.0f);
     printf("[DAC] stream disabled (no waveform output)\r\n");
@@ -616,8 +736,19 @@ void Main_Task(void *argument)
   /* Infinite loop */
   for(;;)
   {
+#if (DAC_WAVE_SYNTH == 0)
+    if (s_dac_wave_update_pending != 0u) {
+      dac_wave_staged_update();
+      s_dac_wave_update_pending = 0u;
+    }
+#endif
+    dac_cmd_dispatch();
     dac_fault_burst_service();
     DAC8568_DMA_Service();
+    dac_switch_event_service();
+#if (DAC_WAVE_SYNTH == 0)
+    dac_wave_verify_service();
+#endif
 
     TickType_t now = xTaskGetTickCount();
     if ((now - last_log) >= pdMS_TO_TICKS(1000)) {
@@ -641,6 +772,43 @@ void Main_Task(void *argument)
              (unsigned long)ref_rearm,
              (unsigned long)ref_refresh,
              (unsigned long)stagnant);
+
+      DAC8568_RefillStats_t refill;
+      DAC8568_DMA_GetRefillStats(&refill);
+      if (refill.sample_rate_hz != 0u) {
+        printf("[DAC] refill n=%lu mdma=%lu err=%lu late=%lu sw_late=%lu last=%luus max=%luus headroom_min=%luus\r\n",
+               (unsigned long)refill.refills,
+               (unsigned long)refill.mdma_refills,
+               (unsigned long)refill.mdma_errors,
+               (unsigned long)refill.late,
+               (unsigned long)refill.switch_late,
+               (unsigned long)((uint64_t)refill.last_samples * 1000000u / refill.sample_rate_hz),
+               (unsigned long)((uint64_t)refill.max_samples * 1000000u / refill.sample_rate_hz),
+               (unsigned long)((uint64_t)refill.min_headroom_samples * 1000000u / refill.sample_rate_hz));
+
+        DAC8568_RefillTiming_t timing;
+        DAC8568_DMA_GetTiming(&timing);
+        const uint32_t cyc_per_us = (timing.cpu_hz >= 1000000u) ? (timing.cpu_hz / 1000000u) : 1u;
+        char hist[DAC8568_TIMING_HIST_BINS * 11u];
+        int hist_len = 0;
+        for (uint32_t bin = 0u; bin < DAC8568_TIMING_HIST_BINS; bin++) {
+          hist_len += snprintf(&hist[hist_len], sizeof(hist) - (size_t)hist_len, "%s%lu",
+                               (bin == 0u) ? "" : "/", (unsigned long)timing.hist[bin]);
+        }
+        printf("[DAC] timing n=%lu min=%luus mean=%luus max=%luus margin=%luus margin_min=%luus ndtr=%lu underrun=%lu hist=%s\r\n",
+               (unsigned long)timing.refills,
+               (unsigned long)(timing.min_cycles / cyc_per_us),
+               (unsigned long)(timing.mean_cycles / cyc_per_us),
+               (unsigned long)(timing.max_cycles / cyc_per_us),
+               (unsigned long)((uint64_t)timing.last_margin_samples * 1000000u / refill.sample_rate_hz),
+               (unsigned long)((uint64_t)timing.min_margin_samples * 1000000u / refill.sample_rate_hz),
+               (unsigned long)timing.last_ndtr_words,
+               (unsigned long)timing.underruns,
+               hist);
+      }
+#if (DAC8568_VERIFY_ENABLE != 0)
+      dac_verify_report();
+#endif
       last_log = now;
     }
 
@@ -681,20 +849,65 @@ static uint32_t dac_fault_clamp_duration_s(uint32_t duration_s)
   return duration_s;
 }
 
+/*
+ * Directory entries other than the named waves take source ids DAC_WAVE_PART_COUNT.. in order;
+ * their bits go to `loaded_mask` (the payload check queue).
+ */
+static void dac_wave_load_directory_extras(SD_DacWaveInfo_t *info_out, uint32_t *loaded_mask)
+{
+  uint32_t source = DAC_WAVE_PART_COUNT;
+  const uint32_t count = SD_Wave_DirCount();
+
+  for (uint32_t e = 0u; e < count && source < DAC_WAVE_SOURCE_COUNT; e++) {
+    SD_DacWaveInfo_t info = {0};
+    const char *name = NULL;
+    bool named = false;
+
+    if (!SD_Wave_DirEntryInfo(e, &info, &name)) {
+      continue;
+    }
+    for (uint32_t i = 0u; i < DAC_WAVE_PART_COUNT && !named; i++) {
+      named = (strcmp(name, SD_Wave_GetPartitionName((SD_DacWavePartition_t)i)) == 0);
+    }
+    if (named) {
+      continue;
+    }
+    info_out[source] = info;
+    *loaded_mask |= (1u << source);
+    printf("[DAC WAVE] directory wave: source=%lu name=%s fmt=%lu sps=%lu count=%lu addr=0x%08lX\r\n",
+           (unsigned long)source,
+           name,
+           (unsigned long)info.format,
+           (unsigned long)info.sample_rate_hz,
+           (unsigned long)info.sample_count,
+           (unsigned long)info.qspi_mmap_addr);
+    source++;
+  }
+}
+
 static bool dac_wave_partition_ready(uint8_t partition)
 {
-  if (partition >= DAC_WAVE_PART_COUNT) {
+  if (partition >= DAC_WAVE_SOURCE_COUNT) {
     return false;
   }
   if ((s_dac_wave_ready_mask & (1u << partition)) == 0u) {
     return false;
   }
-  if (s_dac_wave_info[partition].qspi_mmap_addr == 0u || s_dac_wave_info[partition].sample_count == 0u) {
+  /* Synthesized partitions have no QSPI image. */
+  if ((s_dac_wave_info[partition].qspi_mmap_addr == 0u &&
+       s_dac_wave_info[partition].format != DAC8568_WAVE_FORMAT_SYNTH) ||
+      s_dac_wave_info[partition].sample_count == 0u) {
     return false;
   }
   return true;
 }
 
+/* Faults / playlists play from mapped QSPI: not while a staged update is queued or running. */
+static bool dac_wave_qspi_live(void)
+{
+  return (s_dac_wave_update_pending == 0u) && !DAC8568_DMA_IsQspiDetached();
+}
+
 bool DAC_Wave_IsBootReady(void)
 {
   return (s_dac_wave_boot_sync_done != 0u) &&
@@ -702,17 +915,174 @@ bool DAC_Wave_IsBootReady(void)
          dac_wave_partition_ready(0u);
 }
 
-static void dac_fault_post_command(uint8_t cmd_type, uint8_t fault_id_0_5, uint32_t duration_s)
+#if (DAC_WAVE_SYNTH == 0)
+/*
+ * Staged update (Main_Task): play the baseline from an SDRAM copy, sync the
+ * named waves with QSPI in indirect mode, then switch the stream and the wave
+ * table to the verified partitions in one step. Waves whose sync fails keep
+ * what the directory still holds (like the boot sync). Without a baseline the
+ * SDRAM copy keeps playing, faults stay off and the next update retries.
+ * LVGL reads fonts / icons from mapped QSPI, so the UI holds still meanwhile.
+ */
+static void dac_wave_staged_update(void)
+{
+  static SD_DacWaveInfo_t next[DAC_WAVE_SOURCE_COUNT]; /* keeps 1.3KB off the task stack */
+  uint32_t next_ready = 0u;
+  uint32_t next_sd = 0u;
+  uint32_t next_verify = 0u;
+  const uint32_t t0 = osKernelGetTickCount();
+
+  if (!DAC8568_DMA_IsQspiDetached()) {
+    const SD_DacWaveInfo_t *base = &s_dac_wave_info[0];
+    uint32_t waited = 0u;
+
+    if (s_dac_stream_started == 0u || !dac_wave_partition_ready(0u) ||
+        base->format == DAC8568_WAVE_FORMAT_SYNTH) {
+      printf("[DAC WAVE] staged update needs a running QSPI baseline\r\n");
+      return;
+    }
+    if (base->data_bytes == 0u || base->data_bytes > DAC_WAVE_STAGE_CACHE_BYTES) {
+      printf("[DAC WAVE] staged update: baseline %luKB does not fit the %luKB SDRAM cache\r\n",
+             (unsigned long)(base->data_bytes / 1024u), (unsigned long)(DAC_WAVE_STAGE_CACHE_BYTES / 1024u));
+      return;
+    }
+
+    memcpy((void *)DAC_WAVE_STAGE_CACHE_ADDR, (const void *)base->qspi_mmap_addr, base->data_bytes);
+    s_fault_playlist_running = 0u;
+    s_fault_active_id_0_5 = 0xFFu;
+    s_fault_end_tick = 0;
+    s_fault_remaining_s = 0u;
+    if (DAC8568_DMA_DetachQspi((const void *)DAC_WAVE_STAGE_CACHE_ADDR, base->data_bytes, base->sample_count,
+                               (uint8_t)base->format) != 0) {
+      printf("[DAC WAVE] staged update: baseline cache switch failed\r\n");
+      return;
+    }
+    while (!DAC8568_DMA_IsQspiIdle()) {
+      if (++waited > DAC_WAVE_STAGE_IDLE_MS) {
+        (void)DAC8568_DMA_AttachQspi(base->qspi_mmap_addr, base->sample_count, (uint8_t)base->format);
+        printf("[DAC WAVE] staged update: refill still on QSPI after %lu ms, aborted\r\n",
+               (unsigned long)DAC_WAVE_STAGE_IDLE_MS);
+        return;
+      }
+      osDelay(1);
+    }
+    printf("[DAC WAVE] staged update: baseline on SDRAM cache (%luKB), QSPI detached after %lu ms\r\n",
+           (unsigned long)(base->data_bytes / 1024u), (unsigned long)waited);
+  }
+
+  memset(next, 0, sizeof(next));
+  osMutexAcquire(mutex_id, osWaitForever);
+  for (uint32_t i = 0u; i < DAC_WAVE_PART_COUNT; i++) {
+    SD_DacWavePartition_t part = (SD_DacWavePartition_t)i;
+    SD_DacWaveInfo_t info = {0};
+
+    if (SD_Wave_SyncDacToQspiPartition(s_dac_wave_sd_paths[i], part, &info)) {
+      next_ready |= (1u << i);
+      next_sd |= (1u << i);
+      next[i] = info;
+      continue;
+    }
+    printf("[DAC WAVE] SD sync failed: part=%s\r\n", SD_Wave_GetPartitionName(part));
+    if (SD_Wave_LoadDacInfoFromQspiPartition(part, &info)) {
+      next_verify |= (1u << i);
+      next_ready |= (i == 0u) ? 1u : 0u;
+      next[i] = info;
+    }
+  }
+  /* A failed sync returns in indirect mode. */
+  (void)QSPI_W25Qxx_EnterMemoryMapped();
+  osMutexRelease(mutex_id);
+  dac_wave_load_directory_extras(next, &next_verify);
+
+  if ((next_ready & 0x1u) == 0u || (DAC_WAVE_REQUIRE_SD_SYNC != 0 && (next_sd & 0x1u) == 0u) ||
+      DAC8568_DMA_AttachQspi(next[0].qspi_mmap_addr, next[0].sample_count, (uint8_t)next[0].format) != 0) {
+    printf("[DAC WAVE] staged update: new baseline not ready, SDRAM copy keeps playing\r\n");
+    return;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memcpy(s_dac_wave_info, next, sizeof(s_dac_wave_info));
+  s_dac_wave_ready_mask = next_ready;
+  s_dac_wave_sd_sync_mask = next_sd;
+  s_dac_wave_verify_mask = next_verify;
+  if (primask == 0u) {
+    __enable_irq();
+  }
+
+  s_dac_wave_verify_t0 = osKernelGetTickCount();
+  for (uint32_t i = 0u; i < DAC_WAVE_SOURCE_COUNT; i++) {
+    if (((next_ready | next_verify) & (1u << i)) != 0u) {
+      (void)DAC8568_DMA_SetSourceLoop((uint8_t)i, next[i].loop_start, next[i].loop_end, (uint8_t)next[i].loop_flags);
+    }
+  }
+  if (next[0].sample_rate_hz != DAC8568_DMA_GetSampleRate() && DAC8568_DMA_Retime(next[0].sample_rate_hz) != 0) {
+    printf("[DAC WAVE] staged update: retime to %lu sps rejected\r\n", (unsigned long)next[0].sample_rate_hz);
+  }
+  printf("[DAC WAVE] staged update done: ready_mask=0x%02lX sd_sync_mask=0x%02lX, %lu ms, output never stopped\r\n",
+         (unsigned long)next_ready, (unsigned long)next_sd, (unsigned long)(osKernelGetTickCount() - t0));
+}
+
+/*
+ * Background payload check (Main_Task, between its other services): hashes
+ * DAC_WAVE_VERIFY_BUDGET bytes of the lowest pending source per pass and
+ * flips its ready bit when the checksum matches. Entries unchanged since they
+ * last passed (e.g. after a staged update) come back at once. Paused while
+ * QSPI is detached; a failed fault stays off.
+ */
+static void dac_wave_verify_service(void)
 {
+  const uint32_t pending = s_dac_wave_verify_mask;
+  uint32_t i = 0u;
+  SD_WaveVerify_t result;
+
+  if (pending == 0u || !dac_wave_qspi_live()) {
+    return;
+  }
+  while ((pending & (1u << i)) == 0u) {
+    i++;
+  }
+  result = SD_Wave_VerifyStep(s_dac_wave_info[i].partition_id, DAC_WAVE_VERIFY_BUDGET);
+  if (result == SD_WAVE_VERIFY_BUSY) {
+    return;
+  }
+
   uint32_t primask = __get_PRIMASK();
   __disable_irq();
-  s_fault_cmd_type = cmd_type;
-  s_fault_cmd_id_0_5 = fault_id_0_5;
-  s_fault_cmd_duration_s = duration_s;
-  s_fault_cmd_pending = 1u;
+  s_dac_wave_verify_mask &= ~(1u << i);
+  if (result == SD_WAVE_VERIFY_OK) {
+    s_dac_wave_ready_mask |= (1u << i);
+  }
   if (primask == 0u) {
     __enable_irq();
   }
+  if (result != SD_WAVE_VERIFY_OK) {
+    printf("[DAC WAVE] payload check failed: source=%lu%s\r\n", (unsigned long)i,
+           (i == 0u) ? " (baseline keeps playing)" : ", not ready");
+  }
+  if (s_dac_wave_verify_mask == 0u) {
+    printf("[DAC WAVE] payload check done: ready_mask=0x%02lX, %lu ms\r\n", (unsigned long)s_dac_wave_ready_mask,
+           (unsigned long)(osKernelGetTickCount() - s_dac_wave_verify_t0));
+  }
+}
+#endif
+
+bool DAC_Wave_StagedUpdate(void)
+{
+#if (DAC_WAVE_SYNTH != 0)
+  return false;
+#else
+  if (s_dac_wave_boot_sync_done == 0u || s_dac_stream_started == 0u || s_dac_wave_update_pending != 0u) {
+    return false;
+  }
+  s_dac_wave_update_pending = 1u;
+  return true;
+#endif
+}
+
+bool DAC_Wave_IsUpdating(void)
+{
+  return !dac_wave_qspi_live();
 }
 
 static bool dac_fault_apply_trigger(uint32_t fault_id_0_5, uint32_t duration_s)
@@ -725,22 +1095,27 @@ static bool dac_fault_apply_trigger(uint32_t fault_id_0_5, uint32_t duration_s)
   if (fault_id_0_5 >= DAC_FAULT_COUNT) {
     return false;
   }
-  if (s_dac_wave_boot_sync_done == 0u || s_dac_stream_started == 0u) {
+  if (s_dac_wave_boot_sync_done == 0u || s_dac_stream_started == 0u || !dac_wave_qspi_live()) {
     return false;
   }
   if (!dac_wave_partition_ready(0u) || !dac_wave_partition_ready(partition)) {
     return false;
   }
 
+  DAC8568_DMA_StopPlaylist();
+  s_fault_playlist_running = 0u;
   if (DAC8568_DMA_RequestQspiWave(partition,
                                   s_dac_wave_info[partition].qspi_mmap_addr,
                                   s_dac_wave_info[partition].sample_count,
+                                  (uint8_t)s_dac_wave_info[partition].format,
                                   true) != 0) {
     return false;
   }
 
   s_fault_active_id_0_5 = (uint8_t)fault_id_0_5;
   s_fault_end_tick = now + delta;
+  s_fault_duration_ticks = delta;
+  s_fault_onset_pending = 1u;
   s_fault_remaining_s = dur_s;
   return true;
 }
@@ -754,42 +1129,186 @@ static void dac_fault_apply_stop(void)
     return;
   }
 
-  (void)DAC8568_DMA_RequestQspiWave(0u,
-                                    s_dac_wave_info[0].qspi_mmap_addr,
-                                    s_dac_wave_info[0].sample_count,
-                                    false);
+  DAC8568_DMA_StopPlaylist();
+  s_fault_playlist_running = 0u;
+  /*
+   * A fault with a release tail (v2 loop_end < sample_count) leaves its loop at
+   * the next loop_end, plays the tail and returns to normal by itself.
+   */
+  const uint8_t partition = (s_fault_active_id_0_5 < DAC_FAULT_COUNT) ? (uint8_t)(s_fault_active_id_0_5 + 1u) : 0u;
+  const SD_DacWaveInfo_t *fault = &s_dac_wave_info[partition];
+  if (partition == 0u || fault->loop_end == 0u || fault->loop_end >= fault->sample_count ||
+      DAC8568_DMA_ReleaseQspiWave() != 0) {
+    (void)DAC8568_DMA_RequestQspiWave(0u,
+                                      s_dac_wave_info[0].qspi_mmap_addr,
+                                      s_dac_wave_info[0].sample_count,
+                                      (uint8_t)s_dac_wave_info[0].format,
+                                      false);
+  }
 
   s_fault_active_id_0_5 = 0xFFu;
   s_fault_end_tick = 0;
   s_fault_remaining_s = 0u;
 }
 
-bool DAC_FaultBurst_Trigger(uint32_t fault_id_0_5, uint32_t duration_s)
+static const char *dac_cmd_source_name(uint32_t src)
+{
+  static const char *const names[DAC_CMD_SRC_COUNT] = {"ui", "net", "script"};
+  return (src < DAC_CMD_SRC_COUNT) ? names[src] : "?";
+}
+
+/* Producer side: the command goes on src's own ring; 0 when src is invalid or its ring is full. */
+static uint32_t dac_cmd_post(DAC_CmdSource_t src, const DAC8568_Cmd_t *cmd)
+{
+  if ((uint32_t)src >= DAC_CMD_SRC_COUNT) {
+    return 0u;
+  }
+  const uint32_t seq = DAC8568_CmdRing_Post(&s_dac_cmd_ring[src], cmd);
+  if (seq == 0u) {
+    printf("[DAC CMD] %s queue full, command dropped\r\n", dac_cmd_source_name((uint32_t)src));
+  }
+  return seq;
+}
+
+uint32_t DAC_Cmd_FaultTrigger(DAC_CmdSource_t src, uint32_t fault_id_0_5, uint32_t duration_s)
 {
   const uint8_t partition = (uint8_t)(fault_id_0_5 + 1u);
+  DAC8568_Cmd_t cmd = {0};
 
   if (fault_id_0_5 >= DAC_FAULT_COUNT) {
-    return false;
+    return 0u;
   }
-  if (s_dac_wave_boot_sync_done == 0u || s_dac_stream_started == 0u) {
-    return false;
+  if (s_dac_wave_boot_sync_done == 0u || s_dac_stream_started == 0u || !dac_wave_qspi_live()) {
+    return 0u;
   }
   if (!dac_wave_partition_ready(0u) || !dac_wave_partition_ready(partition)) {
-    return false;
+    return 0u;
   }
-  dac_fault_post_command(DAC_FAULT_CMD_TRIGGER, (uint8_t)fault_id_0_5, duration_s);
-  return true;
+  cmd.type = DAC8568_CMD_FAULT_TRIGGER;
+  cmd.id = (uint8_t)fault_id_0_5;
+  cmd.arg = duration_s;
+  return dac_cmd_post(src, &cmd);
 }
 
-void DAC_FaultBurst_Stop(void)
+uint32_t DAC_Cmd_FaultStop(DAC_CmdSource_t src)
 {
+  DAC8568_Cmd_t cmd = {0};
+
   if (s_dac_wave_boot_sync_done == 0u || s_dac_stream_started == 0u) {
-    return;
+    return 0u;
   }
   if (!dac_wave_partition_ready(0u)) {
-    return;
+    return 0u;
+  }
+  cmd.type = DAC8568_CMD_FAULT_STOP;
+  cmd.id = 0xFFu;
+  return dac_cmd_post(src, &cmd);
+}
+
+uint32_t DAC_Cmd_Playlist(DAC_CmdSource_t src, const DAC_FaultPlaylistStep_t *steps, uint32_t count)
+{
+  DAC8568_Cmd_t cmd = {0};
+
+  if (steps == NULL || count == 0u || count > DAC_FAULT_PLAYLIST_MAX) {
+    return 0u;
+  }
+  if (s_dac_wave_boot_sync_done == 0u || s_dac_stream_started == 0u || !dac_wave_qspi_live()) {
+    return 0u;
+  }
+  for (uint32_t i = 0u; i < count; i++) {
+    if (!dac_wave_partition_ready(steps[i].partition)) {
+      return 0u;
+    }
+    cmd.steps[i].partition = steps[i].partition;
+    cmd.steps[i].repeat = steps[i].repeat;
+    cmd.steps[i].duration_ms = steps[i].duration_ms;
+  }
+  cmd.type = DAC8568_CMD_PLAYLIST;
+  cmd.id = 0xFFu;
+  cmd.count = (uint16_t)count;
+  return dac_cmd_post(src, &cmd);
+}
+
+uint8_t DAC_Cmd_GetStatus(DAC_CmdSource_t src, uint32_t seq)
+{
+  if ((uint32_t)src >= DAC_CMD_SRC_COUNT) {
+    return (uint8_t)DAC8568_CMD_STATUS_EXPIRED;
+  }
+  return (uint8_t)DAC8568_CmdRing_Status(&s_dac_cmd_ring[src], seq);
+}
+
+bool DAC_FaultBurst_Trigger(uint32_t fault_id_0_5, uint32_t duration_s)
+{
+  return DAC_Cmd_FaultTrigger(DAC_CMD_SRC_UI, fault_id_0_5, duration_s) != 0u;
+}
+
+/*
+ * Sample-accurate fault sequence, e.g.
+ *   { {0, 2000, 1}, {2, 150, 3}, {3, 3000, 1}, {0, 0, 1} }
+ * = normal 2 s -> bus_ground 150 ms x3 -> insulation 3 s -> normal.
+ * partition: 0 = normal, 1..6 = fault id + 1, 7.. = other directory waves;
+ * duration_ms = 0 holds (last step).
+ * If the list does not end on a hold, normal is held afterwards.
+ */
+static bool dac_fault_apply_playlist(const DAC8568_CmdStep_t *steps, uint32_t count)
+{
+  DAC8568_PlaylistStep_t plan[DAC8568_PLAYLIST_MAX];
+  uint32_t n = 0u;
+  int32_t rc;
+
+  if (s_dac_wave_boot_sync_done == 0u || s_dac_stream_started == 0u || !dac_wave_qspi_live()) {
+    return false;
+  }
+  if (count == 0u || count > DAC_FAULT_PLAYLIST_MAX || !dac_wave_partition_ready(0u)) {
+    return false;
+  }
+
+  for (uint32_t i = 0u; i < count; i++) {
+    const uint8_t partition = steps[i].partition;
+    if (!dac_wave_partition_ready(partition)) {
+      return false;
+    }
+    plan[n].source_id = partition;
+    plan[n].format = (uint8_t)s_dac_wave_info[partition].format;
+    /* Baseline keeps its phase (like dac_fault_apply_stop); faults restart on every repeat. */
+    plan[n].reset_index = (partition != 0u);
+    plan[n].repeat = steps[i].repeat;
+    plan[n].qspi_mmap_addr = s_dac_wave_info[partition].qspi_mmap_addr;
+    plan[n].sample_count = s_dac_wave_info[partition].sample_count;
+    plan[n].duration_ms = steps[i].duration_ms;
+    n++;
+  }
+  if (plan[n - 1u].duration_ms != 0u) {
+    plan[n] = plan[n - 1u];
+    plan[n].source_id = 0u;
+    plan[n].format = (uint8_t)s_dac_wave_info[0].format;
+    plan[n].reset_index = false;
+    plan[n].repeat = 1u;
+    plan[n].qspi_mmap_addr = s_dac_wave_info[0].qspi_mmap_addr;
+    plan[n].sample_count = s_dac_wave_info[0].sample_count;
+    plan[n].duration_ms = 0u;
+    n++;
   }
-  dac_fault_post_command(DAC_FAULT_CMD_STOP, 0xFFu, 0u);
+
+  rc = DAC8568_DMA_StartPlaylist(plan, n);
+  if (rc != 0) {
+    printf("[DAC BURST] playlist rejected rc=%ld\r\n", (long)rc);
+    return false;
+  }
+  s_fault_end_tick = 0;
+  s_fault_remaining_s = 0u;
+  s_fault_playlist_running = 1u;
+  return true;
+}
+
+bool DAC_FaultPlaylist_Start(const DAC_FaultPlaylistStep_t *steps, uint32_t count)
+{
+  return DAC_Cmd_Playlist(DAC_CMD_SRC_UI, steps, count) != 0u;
+}
+
+void DAC_FaultBurst_Stop(void)
+{
+  (void)DAC_Cmd_FaultStop(DAC_CMD_SRC_UI);
 }
 
 void DAC_FaultBurst_GetUiState(uint32_t *ready_mask, uint8_t *active_fault_id_0_5, uint32_t *remaining_s)
@@ -805,40 +1324,59 @@ void DAC_FaultBurst_GetUiState(uint32_t *ready_mask, uint8_t *active_fault_id_0_
   }
 }
 
-static void dac_fault_burst_service(void)
+static bool dac_cmd_apply(const DAC8568_Cmd_t *cmd, uint32_t src)
 {
-  if (s_fault_cmd_pending != 0u) {
-    uint8_t cmd = DAC_FAULT_CMD_NONE;
-    uint8_t fault_id = 0xFFu;
-    uint32_t dur_s = 0u;
-    uint32_t primask = __get_PRIMASK();
-
-    __disable_irq();
-    if (s_fault_cmd_pending != 0u) {
-      cmd = s_fault_cmd_type;
-      fault_id = s_fault_cmd_id_0_5;
-      dur_s = s_fault_cmd_duration_s;
-      s_fault_cmd_pending = 0u;
-      s_fault_cmd_type = DAC_FAULT_CMD_NONE;
-    }
-    if (primask == 0u) {
-      __enable_irq();
+  const char *name = dac_cmd_source_name(src);
+  bool ok = false;
+
+  if (cmd->type == DAC8568_CMD_FAULT_TRIGGER) {
+    ok = dac_fault_apply_trigger((uint32_t)cmd->id, cmd->arg);
+    printf("[DAC BURST] %s#%lu trigger %s: id=%lu dur=%lus\r\n",
+           name, (unsigned long)cmd->seq, ok ? "ok" : "rejected",
+           (unsigned long)cmd->id,
+           (unsigned long)(ok ? dac_fault_clamp_duration_s(cmd->arg) : cmd->arg));
+  } else if (cmd->type == DAC8568_CMD_FAULT_STOP) {
+    dac_fault_apply_stop();
+    ok = true;
+    printf("[DAC BURST] %s#%lu stop\r\n", name, (unsigned long)cmd->seq);
+  } else if (cmd->type == DAC8568_CMD_PLAYLIST) {
+    ok = dac_fault_apply_playlist(cmd->steps, cmd->count);
+    printf("[DAC BURST] %s#%lu playlist %s: steps=%lu\r\n",
+           name, (unsigned long)cmd->seq, ok ? "ok" : "rejected", (unsigned long)cmd->count);
+  }
+  return ok;
+}
+
+/*
+ * DAC control dispatcher (Main_Task): drains every producer ring in a fixed
+ * order (UI, network, script) and applies the commands one by one, so
+ * back-to-back commands all run in the order they were posted. Only this task
+ * touches the DAC engine's switch queue and playlist.
+ */
+static void dac_cmd_dispatch(void)
+{
+  DAC8568_Cmd_t cmd;
+
+  for (uint32_t src = 0u; src < DAC_CMD_SRC_COUNT; src++) {
+    DAC8568_CmdRing_t *ring = &s_dac_cmd_ring[src];
+    while (DAC8568_CmdRing_Pop(ring, &cmd) != 0) {
+      const bool ok = dac_cmd_apply(&cmd, src);
+      DAC8568_CmdRing_Complete(ring, cmd.seq, ok ? DAC8568_CMD_STATUS_OK : DAC8568_CMD_STATUS_REJECTED);
     }
+  }
+}
 
-    if (cmd == DAC_FAULT_CMD_TRIGGER) {
-      if (!dac_fault_apply_trigger((uint32_t)fault_id, dur_s)) {
-        printf("[DAC BURST] trigger rejected: id=%lu dur=%lus\r\n",
-               (unsigned long)fault_id,
-               (unsigned long)dur_s);
-      } else {
-        printf("[DAC BURST] trigger ok: id=%lu dur=%lus\r\n",
-               (unsigned long)fault_id,
-               (unsigned long)dac_fault_clamp_duration_s(dur_s));
-      }
-    } else if (cmd == DAC_FAULT_CMD_STOP) {
-      dac_fault_apply_stop();
-      printf("[DAC BURST] stop\r\n");
+static void dac_fault_burst_service(void)
+{
+  if (s_fault_playlist_running != 0u) {
+    /* Segments switch inside the refill; only mirror the current one for the UI. */
+    uint8_t source = DAC8568_DMA_GetActiveQspiSource();
+    s_fault_active_id_0_5 = (source != 0u) ? (uint8_t)(source - 1u) : 0xFFu;
+    if (!DAC8568_DMA_IsPlaylistActive()) {
+      s_fault_playlist_running = 0u;
+      s_fault_active_id_0_5 = 0xFFu;
     }
+    return;
   }
 
   if (s_fault_active_id_0_5 == 0xFFu) {
@@ -863,5 +1401,94 @@ static void dac_fault_burst_service(void)
   }
 }
 
+/*
+ * Drain the DAC switch events: log each one with its output sample index and
+ * time, and start a timed burst's countdown at the sample where the fault
+ * actually reaches the DAC instead of at the request.
+ */
+static void dac_switch_event_service(void)
+{
+  static uint32_t last_seq = 0u;
+  DAC8568_SwitchEvent_t ev;
+
+  while (DAC8568_DMA_PollSwitchEvent(&ev)) {
+    if (ev.seq != last_seq + 1u) {
+      printf("[DAC] switch events dropped: %lu\r\n", (unsigned long)(ev.seq - last_seq - 1u));
+    }
+    last_seq = ev.seq;
+    printf("[DAC] switch #%lu %u->%u%s sample=%lu t=%lu.%06lus\r\n",
+           (unsigned long)ev.seq,
+           (unsigned)ev.from_source,
+           (unsigned)ev.to_source,
+           ((ev.flags & DAC8568_SWITCH_EVENT_RETURN) != 0u) ? " (return)" : "",
+           (unsigned long)ev.sample,
+           (unsigned long)(ev.time_us / 1000000u),
+           (unsigned long)(ev.time_us % 1000000u));
+
+    if (s_fault_onset_pending != 0u && s_fault_end_tick != 0 &&
+        (ev.flags & DAC8568_SWITCH_EVENT_RETURN) == 0u &&
+        s_fault_active_id_0_5 < DAC_FAULT_COUNT && ev.to_source == (uint8_t)(s_fault_active_id_0_5 + 1u)) {
+      const int64_t onset_in_us = (int64_t)(ev.time_us - DAC8568_DMA_GetTimeUs());
+      const TickType_t onset = xTaskGetTickCount() + (TickType_t)(int32_t)(onset_in_us / 1000 / (int64_t)portTICK_PERIOD_MS);
+      s_fault_end_tick = onset + s_fault_duration_ticks;
+      s_fault_onset_pending = 0u;
+    }
+  }
+}
+
+#if (DAC8568_VERIFY_ENABLE != 0)
+/* Two probes with an unknown divider: start by fitting the model on the (known good) baseline. */
+static void dac_verify_enable(void)
+{
+  DAC8568_VerifyConfig_t cfg;
+  DAC8568_Verify_DefaultConfig(&cfg);
+  cfg.probes = 2u;
+  cfg.probe[0].dac_channel = DAC_VERIFY_PROBE0_DAC;
+  cfg.probe[0].adc_channel = DAC_VERIFY_PROBE0_ADC;
+  cfg.probe[1].dac_channel = DAC_VERIFY_PROBE1_DAC;
+  cfg.probe[1].adc_channel = DAC_VERIFY_PROBE1_ADC;
+  cfg.probe[1].gain_q16 = 0x10000;
+
+  const int32_t rc = DAC8568_DMA_EnableVerify(&cfg);
+  if (rc != 0) {
+    printf("[DAC] verify off (rc=%ld)\r\n", (long)rc);
+    return;
+  }
+  DAC8568_DMA_VerifyCalibrate();
+  printf("[DAC] verify on: ch%u->INP%u ch%u->INP%u decim=%lu, calibrating\r\n",
+         (unsigned)cfg.probe[0].dac_channel, (unsigned)cfg.probe[0].adc_channel,
+         (unsigned)cfg.probe[1].dac_channel, (unsigned)cfg.probe[1].adc_channel,
+         (unsigned long)cfg.decim);
+}
+
+static void dac_verify_report(void)
+{
+  DAC8568_VerifyStats_t st;
+  DAC8568_VerifyConfig_t cfg;
+  if (!DAC8568_DMA_GetVerify(&st, &cfg)) {
+    return;
+  }
+  printf("[DAC] verify n=%lu no_exp=%lu lost=%lu mismatch=%lu drift=%lu/%02X stuck=%lu/%02X ref_missed=%lu/%u "
+         "err=%ld/%ld max=%ld/%ld%s\r\n",
+         (unsigned long)st.conversions,
+         (unsigned long)st.no_expect,
+         (unsigned long)st.lost,
+         (unsigned long)st.mismatches,
+         (unsigned long)st.drift_events, (unsigned)st.drift_mask,
+         (unsigned long)st.stuck_events, (unsigned)st.stuck_mask,
+         (unsigned long)st.ref_missed_events, (unsigned)st.ref_missed,
+         (long)st.mean_error[0], (long)st.mean_error[1],
+         (long)st.max_error[0], (long)st.max_error[1],
+         (st.calibrating != 0u) ? " (calibrating)" : "");
+  static uint8_t model_logged = 0u;
+  if (st.calibrating == 0u && model_logged == 0u) {
+    printf("[DAC] verify model gain_q16/offset %ld/%ld %ld/%ld\r\n",
+           (long)cfg.probe[0].gain_q16, (long)cfg.probe[0].offset,
+           (long)cfg.probe[1].gain_q16, (long)cfg.probe[1].offset);
+    model_logged = 1u;
+  }
+}
+#endif
+
 /* USER CODE END Application */
 
@@ -22,6 +22,10 @@
 #include "stm32h7xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "DAC8568/dac8568_dma.h"
+#include "DAC8568/dac8568_adc.h"
+#include "DAC8568/dac8568_mdma.h"
+#include "crc32_fast.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -366,7 +370,7 @@ void QUADSPI_IRQHandler(void)
 void TIM17_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM17_IRQn 0 */
-
+  DAC8568_DMA_MarkerIRQHandler();
   /* USER CODE END TIM17_IRQn 0 */
   HAL_TIM_IRQHandler(&htim17);
   /* USER CODE BEGIN TIM17_IRQn 1 */
@@ -385,10 +389,28 @@ void MDMA_IRQHandler(void)
   HAL_MDMA_IRQHandler(&hmdma_mdma_channel0_sdmmc1_end_data_0);
   HAL_MDMA_IRQHandler(&hmdma_quadspi_fifo_th);
   /* USER CODE BEGIN MDMA_IRQn 1 */
+  DAC8568_MDMA_IRQHandler();
+  CRC32_Fast_MDMA_IRQHandler();
 
   /* USER CODE END MDMA_IRQn 1 */
 }
 
 /* USER CODE BEGIN 1 */
+/**
+  * @brief TIM7: slot refill service of the DAC8568 TX ring (dac8568_dma.c).
+  */
+void TIM7_IRQHandler(void)
+{
+  DAC8568_DMA_RingIRQHandler();
+}
 
+#if (DAC8568_VERIFY_ENABLE != 0)
+/**
+  * @brief DMA1 stream5: ADC1 scans of the DAC output check (dac8568_adc.c).
+  */
+void DMA1_Stream5_IRQHandler(void)
+{
+  DAC8568_ADC_IRQHandler();
+}
+#endif
 /* USER CODE END 1 */
@@ -207,7 +207,16 @@ DRESULT QSPI_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
       return RES_ERROR;
     }
 
-    if (QSPI_W25Qxx_WriteBuffer_Slow(qspi_block_buf, block_addr, QSPI_ERASE_BLOCK_SIZE) != QSPI_W25Qxx_OK) {
+    /* Quad program + memory-mapped verify; a page the 1-1-1 rewrite cannot repair costs one more erase. */
+    int8_t wret = QSPI_W25Qxx_WriteBuffer_Verify(qspi_block_buf, block_addr, QSPI_ERASE_BLOCK_SIZE);
+    if (wret == W25Qxx_ERROR_Verify) {
+      printf("[QSPI_DISK] quad verify fail @0x%08lX, rewrite 1-1-1\r\n", (unsigned long)block_addr);
+      wret = QSPI_W25Qxx_SectorErase(block_addr);
+      if (wret == QSPI_W25Qxx_OK) {
+        wret = QSPI_W25Qxx_WriteBuffer_Slow(qspi_block_buf, block_addr, QSPI_ERASE_BLOCK_SIZE);
+      }
+    }
+    if (wret != QSPI_W25Qxx_OK) {
       printf("[QSPI_DISK] write 4K fail @0x%08lX\r\n", (unsigned long)block_addr);
       (void)QSPI_W25Qxx_EnterMemoryMapped();
       return RES_ERROR;
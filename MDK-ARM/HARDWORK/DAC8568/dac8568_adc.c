@@ -0,0 +1,306 @@
+#include "dac8568_adc.h"
+
+#include "main.h"
+
+#include <stddef.h>
+
+#if (DAC8568_VERIFY_ENABLE != 0)
+
+#define DAC8568_ADC_BUF_WORDS (DAC8568_ADC_BUF_SCANS * DAC8568_VERIFY_PROBES_MAX)
+/* ADC12 external trigger 5 = tim4_oc4. */
+#define DAC8568_ADC_EXTSEL_TIM4_CC4 5u
+#define DAC8568_ADC_TIMEOUT_MS 10u
+/* Reader this close to being lapped by the DMA: drop what is pending instead of racing it. */
+#define DAC8568_ADC_GUARD_SCANS (DAC8568_ADC_BUF_SCANS / 4u)
+
+#if ((DAC8568_ADC_BUF_WORDS * 2u) % 32u) != 0u
+#error "DAC8568_ADC_BUF_SCANS must keep the ADC buffer a whole number of cache lines"
+#endif
+
+/* Sampling time per ADC_SMPRx code and conversion time at 16 bits, in half ADC clock cycles. */
+static const uint16_t k_adc_smp_half_cycles[8] = {3u, 5u, 17u, 33u, 65u, 129u, 775u, 1621u};
+#define DAC8568_ADC_CONV_HALF_CYCLES 17u
+static const uint16_t k_adc_presc_div[12] = {1u, 2u, 4u, 6u, 8u, 10u, 12u, 16u, 32u, 64u, 128u, 256u};
+
+__attribute__((section(".ram_d2"), aligned(32))) static uint16_t g_adc_buf[DAC8568_ADC_BUF_WORDS];
+static DMA_HandleTypeDef g_adc_dma;
+static uint8_t g_adc_ready = 0u;
+static volatile uint8_t g_adc_running = 0u;
+static uint32_t g_adc_probes = 1u;
+static uint32_t g_adc_words = 0u;    /* words in the circular transfer (whole scans) */
+static volatile uint32_t g_adc_cycles = 0u; /* buffer wraps (DMA TC) */
+static uint32_t g_adc_read_cycles = 0u;
+static uint32_t g_adc_read_pos = 0u;
+
+static void dac8568_adc_dma_cplt(DMA_HandleTypeDef *hdma) {
+  (void)hdma;
+  g_adc_cycles++;
+}
+
+static int32_t dac8568_adc_wait(volatile uint32_t *reg, uint32_t mask, uint32_t value) {
+  const uint32_t t0 = HAL_GetTick();
+  while ((*reg & mask) != value) {
+    if ((HAL_GetTick() - t0) > DAC8568_ADC_TIMEOUT_MS) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* ADC clock after the common prescaler (rev V divides the asynchronous clock by 2 again). */
+static uint32_t dac8568_adc_clock_hz(void) {
+  uint32_t hz = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_ADC) / k_adc_presc_div[DAC8568_ADC_PRESC];
+  if (HAL_GetREVID() > REV_ID_Y) {
+    hz /= 2u;
+  }
+  return hz;
+}
+
+static void dac8568_adc_boost(uint32_t adc_hz) {
+  uint32_t boost = 0u;
+  if (HAL_GetREVID() <= REV_ID_Y) {
+    boost = (adc_hz > 20000000u) ? ADC_CR_BOOST_0 : 0u;
+  } else if (adc_hz > 25000000u) {
+    boost = ADC_CR_BOOST_1 | ADC_CR_BOOST_0;
+  } else if (adc_hz > 12500000u) {
+    boost = ADC_CR_BOOST_1;
+  } else if (adc_hz > 6250000u) {
+    boost = ADC_CR_BOOST_0;
+  }
+  MODIFY_REG(ADC1->CR, ADC_CR_BOOST, boost);
+}
+
+static void dac8568_adc_invalidate(const void *addr, size_t bytes) {
+  uintptr_t start = (uintptr_t)addr & ~(uintptr_t)31u;
+  uintptr_t end = ((uintptr_t)addr + bytes + 31u) & ~(uintptr_t)31u;
+  SCB_InvalidateDCache_by_Addr((uint32_t *)start, (int32_t)(end - start));
+}
+
+int32_t DAC8568_ADC_Init(void) {
+  if (g_adc_ready != 0u) {
+    return 0;
+  }
+
+  __HAL_RCC_ADC_CONFIG(RCC_ADCCLKSOURCE_CLKP);
+  __HAL_RCC_ADC12_CLK_ENABLE();
+  __HAL_RCC_TIM4_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* Asynchronous kernel clock, /PRESC. */
+  MODIFY_REG(ADC12_COMMON->CCR, ADC_CCR_CKMODE | ADC_CCR_PRESC, DAC8568_ADC_PRESC << ADC_CCR_PRESC_Pos);
+
+  /* Leave deep power-down, start the regulator, calibrate offset + linearity (single-ended). */
+  CLEAR_BIT(ADC1->CR, ADC_CR_DEEPPWD);
+  SET_BIT(ADC1->CR, ADC_CR_ADVREGEN);
+  HAL_Delay(1);
+  dac8568_adc_boost(dac8568_adc_clock_hz());
+  CLEAR_BIT(ADC1->CR, ADC_CR_ADCALDIF);
+  SET_BIT(ADC1->CR, ADC_CR_ADCALLIN);
+  SET_BIT(ADC1->CR, ADC_CR_ADCAL);
+  if (dac8568_adc_wait(&ADC1->CR, ADC_CR_ADCAL, 0u) != 0) {
+    return -1;
+  }
+
+  WRITE_REG(ADC1->ISR, ADC_ISR_ADRDY);
+  SET_BIT(ADC1->CR, ADC_CR_ADEN);
+  if (dac8568_adc_wait(&ADC1->ISR, ADC_ISR_ADRDY, ADC_ISR_ADRDY) != 0) {
+    return -1;
+  }
+
+  g_adc_dma.Instance = DMA1_Stream5;
+  g_adc_dma.Init.Request = DMA_REQUEST_ADC1;
+  g_adc_dma.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  g_adc_dma.Init.PeriphInc = DMA_PINC_DISABLE;
+  g_adc_dma.Init.MemInc = DMA_MINC_ENABLE;
+  g_adc_dma.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  g_adc_dma.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  g_adc_dma.Init.Mode = DMA_CIRCULAR;
+  g_adc_dma.Init.Priority = DMA_PRIORITY_LOW;
+  g_adc_dma.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&g_adc_dma) != HAL_OK) {
+    return -1;
+  }
+  HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+
+  g_adc_ready = 1u;
+  return 0;
+}
+
+int32_t DAC8568_ADC_Start(const DAC8568_VerifyConfig_t *cfg, uint32_t timclk_hz, uint32_t psc12, uint32_t arr12) {
+  if (g_adc_ready == 0u || cfg == NULL || cfg->probes == 0u || cfg->probes > DAC8568_VERIFY_PROBES_MAX) {
+    return -1;
+  }
+  DAC8568_ADC_Stop();
+
+  const uint64_t psc4 = (uint64_t)(psc12 + 1u) * cfg->decim;
+  if (psc4 > 65536u || timclk_hz == 0u) {
+    return -2;
+  }
+  /* Scan plus settle must end before the next trigger (OVRMOD keeps the DMA going, but the scan would be torn). */
+  const uint64_t period_ns = psc4 * (arr12 + 1u) * 1000000000ull / timclk_hz;
+  const uint64_t scan_ns = (uint64_t)cfg->probes *
+                           (k_adc_smp_half_cycles[DAC8568_ADC_SMP] + DAC8568_ADC_CONV_HALF_CYCLES) *
+                           500000000ull / dac8568_adc_clock_hz();
+  if (scan_ns + cfg->settle_ns >= period_ns) {
+    return -2;
+  }
+
+  /* Sampling point: settle_ns after the TIM12 update, at most one sample period later. */
+  const uint64_t tick_ns = psc4 * 1000000000ull / timclk_hz;
+  uint32_t ccr = (uint32_t)((cfg->settle_ns + tick_ns - 1u) / ((tick_ns != 0u) ? tick_ns : 1u));
+  const uint32_t sample_ticks = (arr12 + 1u) / cfg->decim;
+  if (ccr >= sample_ticks) {
+    ccr = (sample_ticks > 1u) ? sample_ticks - 1u : 1u;
+  }
+  if (ccr == 0u) {
+    ccr = 1u;
+  }
+
+  /* 16-bit, one scan per tim4_oc4 rising edge, circular DMA, overwrite on overrun. */
+  uint32_t sqr1 = (uint32_t)(cfg->probes - 1u) << ADC_SQR1_L_Pos;
+  uint32_t pcsel = 0u;
+  uint32_t smpr1 = ADC1->SMPR1;
+  uint32_t smpr2 = ADC1->SMPR2;
+  for (uint32_t p = 0u; p < cfg->probes; p++) {
+    const uint32_t ch = cfg->probe[p].adc_channel & 0x1Fu;
+    sqr1 |= ch << (ADC_SQR1_SQ1_Pos + 6u * p);
+    pcsel |= 1u << ch;
+    if (ch < 10u) {
+      smpr1 = (smpr1 & ~(7u << (3u * ch))) | (DAC8568_ADC_SMP << (3u * ch));
+    } else {
+      smpr2 = (smpr2 & ~(7u << (3u * (ch - 10u)))) | (DAC8568_ADC_SMP << (3u * (ch - 10u)));
+    }
+  }
+  ADC1->CFGR = (DAC8568_ADC_EXTSEL_TIM4_CC4 << ADC_CFGR_EXTSEL_Pos) | ADC_CFGR_EXTEN_0 | ADC_CFGR_DMNGT |
+               ADC_CFGR_OVRMOD;
+  ADC1->CFGR2 = 0u;
+  ADC1->SMPR1 = smpr1;
+  ADC1->SMPR2 = smpr2;
+  ADC1->PCSEL = pcsel;
+  ADC1->SQR1 = sqr1;
+  WRITE_REG(ADC1->ISR, ADC_ISR_OVR | ADC_ISR_EOS | ADC_ISR_EOC);
+
+  g_adc_probes = cfg->probes;
+  g_adc_words = DAC8568_ADC_BUF_SCANS * cfg->probes;
+  g_adc_cycles = 0u;
+  g_adc_read_cycles = 0u;
+  g_adc_read_pos = 0u;
+  g_adc_dma.XferCpltCallback = dac8568_adc_dma_cplt;
+  if (HAL_DMA_Start_IT(&g_adc_dma, (uint32_t)&ADC1->DR, (uint32_t)g_adc_buf, g_adc_words) != HAL_OK) {
+    return -1;
+  }
+  SET_BIT(ADC1->CR, ADC_CR_ADSTART);
+
+  /* TIM4: PWM mode 2 on CC4 (rising edge at CCR4), TRGO = counter enable. */
+  TIM4->CR1 = 0u;
+  TIM4->SMCR = 0u;
+  TIM4->CR2 = TIM_CR2_MMS_0;
+  TIM4->PSC = (uint32_t)(psc4 - 1u);
+  TIM4->ARR = arr12;
+  TIM4->CCR4 = ccr;
+  TIM4->CCMR2 = TIM_CCMR2_OC4M_2 | TIM_CCMR2_OC4M_1 | TIM_CCMR2_OC4M_0;
+  TIM4->CCER = TIM_CCER_CC4E;
+  TIM4->CNT = 0u;
+  TIM4->EGR = TIM_EGR_UG; /* load PSC; TRGO follows CEN only */
+  TIM4->SR = 0u;
+
+  g_adc_running = 1u;
+  TIM4->CR1 = TIM_CR1_CEN;
+  return 0;
+}
+
+void DAC8568_ADC_Stop(void) {
+  if (g_adc_ready == 0u) {
+    return;
+  }
+  g_adc_running = 0u;
+  TIM4->CR1 = 0u;
+  if ((ADC1->CR & ADC_CR_ADSTART) != 0u) {
+    SET_BIT(ADC1->CR, ADC_CR_ADSTP);
+    (void)dac8568_adc_wait(&ADC1->CR, ADC_CR_ADSTART, 0u);
+  }
+  (void)HAL_DMA_Abort(&g_adc_dma);
+}
+
+uint8_t DAC8568_ADC_IsRunning(void) {
+  return g_adc_running;
+}
+
+void DAC8568_ADC_Poll(DAC8568_Verify_t *v) {
+  if (g_adc_running == 0u || v == NULL) {
+    return;
+  }
+
+  const uint32_t words = g_adc_words;
+  uint32_t cycles = g_adc_cycles;
+  uint32_t left = __HAL_DMA_GET_COUNTER(&g_adc_dma);
+  if (g_adc_cycles != cycles) {
+    cycles = g_adc_cycles;
+    left = __HAL_DMA_GET_COUNTER(&g_adc_dma);
+  }
+  uint32_t pos = words - ((left < words) ? left : words);
+  if (pos == words) {
+    pos = 0u;
+    cycles++;
+  }
+  pos -= pos % g_adc_probes; /* whole scans only */
+
+  const uint32_t pending = (cycles - g_adc_read_cycles) * words + pos - g_adc_read_pos;
+  if (pending > words - DAC8568_ADC_GUARD_SCANS * g_adc_probes) {
+    DAC8568_Verify_Skip(v, pending / g_adc_probes);
+    g_adc_read_cycles = cycles;
+    g_adc_read_pos = pos;
+    return;
+  }
+
+  while (g_adc_read_cycles != cycles || g_adc_read_pos != pos) {
+    const uint32_t end = (g_adc_read_cycles == cycles) ? pos : words;
+    const uint16_t *src = &g_adc_buf[g_adc_read_pos];
+    const uint32_t n = end - g_adc_read_pos;
+
+    dac8568_adc_invalidate(src, n * sizeof(uint16_t));
+    DAC8568_Verify_Measure(v, src, n / g_adc_probes);
+    g_adc_read_pos = end;
+    if (end == words) {
+      g_adc_read_pos = 0u;
+      g_adc_read_cycles++;
+    }
+  }
+}
+
+void DAC8568_ADC_IRQHandler(void) {
+  if (g_adc_ready != 0u) {
+    HAL_DMA_IRQHandler(&g_adc_dma);
+  }
+}
+
+#else
+
+int32_t DAC8568_ADC_Init(void) {
+  return -1;
+}
+
+int32_t DAC8568_ADC_Start(const DAC8568_VerifyConfig_t *cfg, uint32_t timclk_hz, uint32_t psc12, uint32_t arr12) {
+  (void)cfg;
+  (void)timclk_hz;
+  (void)psc12;
+  (void)arr12;
+  return -1;
+}
+
+void DAC8568_ADC_Stop(void) {
+}
+
+uint8_t DAC8568_ADC_IsRunning(void) {
+  return 0u;
+}
+
+void DAC8568_ADC_Poll(DAC8568_Verify_t *v) {
+  (void)v;
+}
+
+void DAC8568_ADC_IRQHandler(void) {
+}
+
+#endif
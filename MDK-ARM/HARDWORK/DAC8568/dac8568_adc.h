@@ -0,0 +1,63 @@
+#ifndef DAC8568_ADC_H
+#define DAC8568_ADC_H
+
+#include <stdint.h>
+
+#include "dac8568_verify.h"
+
+/*
+ * ADC1 front end of the closed-loop output check (dac8568_verify.h).
+ *
+ * The ADC cannot be triggered by TIM12 on the H7, so TIM4 is locked to it:
+ * TIM4 runs at 1/decim of the sample rate (PSC4 + 1 = (PSC12 + 1) * decim,
+ * ARR4 = ARR12) and starts TIM12 through its TRGO (TIM12 in trigger mode on
+ * ITR0), so both count from the same clock edge. TIM4 CC4 fires settle_ns
+ * after every decim-th TIM12 update and triggers one scan of the probe inputs;
+ * DMA1_Stream5 moves the 16-bit results into a circular buffer in D2 SRAM.
+ * The task side hands whole scans to the checker from DAC8568_DMA_Service().
+ *
+ * No HAL ADC driver in this project: ADC1 and TIM4 are set up at register
+ * level (kernel clock per_ck = HSI, /DAC8568_ADC_PRESC). The probe pins stay
+ * in their reset (analog) mode. Enabled with DAC8568_VERIFY_ENABLE.
+ */
+#ifndef DAC8568_VERIFY_ENABLE
+#define DAC8568_VERIFY_ENABLE 0
+#endif
+
+/* Scans held by the circular DMA buffer (the task must read them within this many conversions). */
+#ifndef DAC8568_ADC_BUF_SCANS
+#define DAC8568_ADC_BUF_SCANS 512u
+#endif
+/* ADC_CCR.PRESC code (1 = kernel clock / 2). */
+#ifndef DAC8568_ADC_PRESC
+#define DAC8568_ADC_PRESC 1u
+#endif
+/* ADC_SMPRx code for every probe (3 = 16.5 ADC clock cycles). */
+#ifndef DAC8568_ADC_SMP
+#define DAC8568_ADC_SMP 3u
+#endif
+
+/*
+ * Power-up, linearity calibration and DMA setup; once, before the first
+ * Start. Returns 0, or -1 on a HAL error or an ADC that does not come ready.
+ */
+int32_t DAC8568_ADC_Init(void);
+/*
+ * Arms the ADC for cfg and starts TIM4, which starts TIM12: the caller has
+ * already put TIM12 in trigger mode (ITR0) with its final PSC / ARR. Returns 0,
+ * or -1 if not initialised, -2 when TIM4 cannot hold (PSC12 + 1) * decim or a
+ * scan does not fit the conversion period (TIM12 left stopped).
+ */
+int32_t DAC8568_ADC_Start(const DAC8568_VerifyConfig_t *cfg, uint32_t timclk_hz, uint32_t psc12, uint32_t arr12);
+/* Stops TIM4, the conversions and the DMA; TIM12 is not touched. */
+void DAC8568_ADC_Stop(void);
+uint8_t DAC8568_ADC_IsRunning(void);
+/*
+ * Task side: feeds the scans written since the last call to DAC8568_Verify_Measure(),
+ * or DAC8568_Verify_Skip() when the DMA came close to lapping the reader.
+ */
+void DAC8568_ADC_Poll(DAC8568_Verify_t *v);
+/* DMA1_Stream5_IRQHandler. */
+void DAC8568_ADC_IRQHandler(void);
+
+#endif
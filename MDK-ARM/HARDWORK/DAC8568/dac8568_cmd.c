@@ -0,0 +1,91 @@
+#include "dac8568_cmd.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "dac8568_stream.h"
+
+#define DAC8568_CMD_MASK (DAC8568_CMD_QUEUE - 1u)
+
+void DAC8568_CmdRing_Init(DAC8568_CmdRing_t *r) {
+  if (r == NULL) {
+    return;
+  }
+  memset(r, 0, sizeof(*r));
+  r->next_seq = 1u;
+}
+
+uint32_t DAC8568_CmdRing_Post(DAC8568_CmdRing_t *r, const DAC8568_Cmd_t *cmd) {
+  if (r == NULL || cmd == NULL) {
+    return 0u;
+  }
+  const uint8_t head = r->head;
+  if ((uint8_t)(head - r->tail) >= DAC8568_CMD_QUEUE) {
+    r->full++;
+    return 0u;
+  }
+
+  const uint32_t seq = (r->next_seq != 0u) ? r->next_seq : 1u;
+  DAC8568_Cmd_t *e = &r->slot[head & DAC8568_CMD_MASK];
+  *e = *cmd;
+  e->seq = seq;
+  r->next_seq = (seq + 1u != 0u) ? seq + 1u : 1u;
+  DAC8568_PUBLISH();
+  r->head = (uint8_t)(head + 1u);
+  return seq;
+}
+
+int32_t DAC8568_CmdRing_Pop(DAC8568_CmdRing_t *r, DAC8568_Cmd_t *out) {
+  if (r == NULL || out == NULL) {
+    return 0;
+  }
+  const uint8_t tail = r->tail;
+  if (tail == r->head) {
+    return 0;
+  }
+  DAC8568_PUBLISH();
+  *out = r->slot[tail & DAC8568_CMD_MASK];
+  DAC8568_PUBLISH();
+  r->tail = (uint8_t)(tail + 1u);
+  return 1;
+}
+
+void DAC8568_CmdRing_Complete(DAC8568_CmdRing_t *r, uint32_t seq, DAC8568_CmdStatus_t status) {
+  if (r == NULL || seq == 0u) {
+    return;
+  }
+  const uint32_t i = seq & DAC8568_CMD_MASK;
+  /* Retire the older record in this slot first, so a reader never pairs it with the new status. */
+  r->done_seq[i] = 0u;
+  DAC8568_PUBLISH();
+  r->done_status[i] = (uint8_t)status;
+  DAC8568_PUBLISH();
+  r->done_seq[i] = seq;
+  DAC8568_PUBLISH();
+  r->completed = seq;
+}
+
+DAC8568_CmdStatus_t DAC8568_CmdRing_Status(const DAC8568_CmdRing_t *r, uint32_t seq) {
+  if (r == NULL || seq == 0u) {
+    return DAC8568_CMD_STATUS_EXPIRED;
+  }
+  const uint32_t i = seq & DAC8568_CMD_MASK;
+  if (r->done_seq[i] == seq) {
+    DAC8568_PUBLISH();
+    const uint8_t status = r->done_status[i];
+    DAC8568_PUBLISH();
+    return (r->done_seq[i] == seq) ? (DAC8568_CmdStatus_t)status : DAC8568_CMD_STATUS_EXPIRED;
+  }
+  /* Not completed yet if it was posted (before next_seq) and after the last completed one. */
+  if ((int32_t)(seq - r->completed) > 0 && (int32_t)(seq - r->next_seq) < 0) {
+    return DAC8568_CMD_STATUS_PENDING;
+  }
+  return DAC8568_CMD_STATUS_EXPIRED;
+}
+
+uint32_t DAC8568_CmdRing_Pending(const DAC8568_CmdRing_t *r) {
+  if (r == NULL) {
+    return 0u;
+  }
+  return (uint8_t)(r->head - r->tail);
+}
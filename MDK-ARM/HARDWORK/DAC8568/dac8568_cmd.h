@@ -0,0 +1,86 @@
+#ifndef DAC8568_CMD_H
+#define DAC8568_CMD_H
+
+/*
+ * Control commands for the DAC engine: one single-producer / single-consumer
+ * ring per producing task (UI, network, script), drained by one dispatcher
+ * task. No critical sections: the producer owns head and the command slots
+ * ahead of it, the consumer owns tail and the completion records.
+ *
+ * Post() stamps each command with a per-ring sequence number (never 0) and
+ * returns it; the dispatcher pops commands in order and records the result
+ * with Complete(), which any task can read back with Status() until
+ * DAC8568_CMD_QUEUE newer commands of the same ring have completed. A full
+ * ring rejects the new command (Post returns 0) instead of overwriting one
+ * still pending. HAL-free, built on the host by tools/dac8568_sim.
+ */
+
+#include <stdint.h>
+
+/* Commands per ring (power of two, at most 255). */
+#ifndef DAC8568_CMD_QUEUE
+#define DAC8568_CMD_QUEUE 8u
+#endif
+/* Steps carried by one DAC8568_CMD_PLAYLIST command. */
+#ifndef DAC8568_CMD_STEPS_MAX
+#define DAC8568_CMD_STEPS_MAX 15u
+#endif
+
+#if ((DAC8568_CMD_QUEUE & (DAC8568_CMD_QUEUE - 1u)) != 0u) || (DAC8568_CMD_QUEUE > 255u)
+#error "DAC8568_CMD_QUEUE must be a power of two <= 255"
+#endif
+
+typedef enum {
+  DAC8568_CMD_NONE = 0,
+  DAC8568_CMD_FAULT_TRIGGER, /* id = fault 0.., arg = duration in s */
+  DAC8568_CMD_FAULT_STOP,
+  DAC8568_CMD_PLAYLIST,      /* steps[0..count-1] */
+} DAC8568_CmdType_t;
+
+typedef enum {
+  DAC8568_CMD_STATUS_PENDING = 0, /* queued or being applied */
+  DAC8568_CMD_STATUS_OK,
+  DAC8568_CMD_STATUS_REJECTED,    /* dispatcher refused it (not ready, bad id, ...) */
+  DAC8568_CMD_STATUS_EXPIRED,     /* result no longer held, or never posted */
+} DAC8568_CmdStatus_t;
+
+typedef struct {
+  uint8_t partition;
+  uint16_t repeat;
+  uint32_t duration_ms;
+} DAC8568_CmdStep_t;
+
+typedef struct {
+  uint32_t seq; /* set by Post() */
+  uint8_t type; /* DAC8568_CmdType_t */
+  uint8_t id;
+  uint16_t count;
+  uint32_t arg;
+  DAC8568_CmdStep_t steps[DAC8568_CMD_STEPS_MAX];
+} DAC8568_Cmd_t;
+
+typedef struct {
+  DAC8568_Cmd_t slot[DAC8568_CMD_QUEUE];
+  volatile uint8_t head;  /* written by the producer only */
+  volatile uint8_t tail;  /* written by the dispatcher only */
+  volatile uint32_t next_seq; /* written by the producer only */
+  volatile uint32_t full; /* posts rejected because the ring was full (producer) */
+  /* Completion records by seq % DAC8568_CMD_QUEUE (dispatcher). */
+  volatile uint32_t done_seq[DAC8568_CMD_QUEUE];
+  volatile uint8_t done_status[DAC8568_CMD_QUEUE];
+  volatile uint32_t completed; /* seq of the last completed command, 0: none */
+} DAC8568_CmdRing_t;
+
+/* Before either side runs; a zero-initialised ring is already empty and usable. */
+void DAC8568_CmdRing_Init(DAC8568_CmdRing_t *r);
+/* Producer: copies cmd, returns its sequence number, or 0 when the ring is full. */
+uint32_t DAC8568_CmdRing_Post(DAC8568_CmdRing_t *r, const DAC8568_Cmd_t *cmd);
+/* Dispatcher: oldest command into out; returns 0 when empty. Complete() it before the next Pop(). */
+int32_t DAC8568_CmdRing_Pop(DAC8568_CmdRing_t *r, DAC8568_Cmd_t *out);
+/* Dispatcher: result of the command last popped (status = OK or REJECTED). */
+void DAC8568_CmdRing_Complete(DAC8568_CmdRing_t *r, uint32_t seq, DAC8568_CmdStatus_t status);
+/* Any task. */
+DAC8568_CmdStatus_t DAC8568_CmdRing_Status(const DAC8568_CmdRing_t *r, uint32_t seq);
+uint32_t DAC8568_CmdRing_Pending(const DAC8568_CmdRing_t *r);
+
+#endif
@@ -1,4 +1,7 @@
 #include "dac8568_dma.h"
+#include "dac8568_adc.h"
+#include "dac8568_mdma.h"
+#include "dac8568_ring.h"
 
 #include "gpio.h"
 #include "main.h"
@@ -6,61 +9,31 @@
 #include "tim.h"
 #include "stm32h7xx_hal_dma_ex.h"
 
-#include <math.h>
 #include <stddef.h>
-
-#define DAC8568_CMD_WRITE_INPUT 0x00u
-#define DAC8568_CMD_UPDATE_DAC 0x01u
-#define DAC8568_CMD_WRITE_UPDATE_ALL 0x02u
-#define DAC8568_CMD_WRITE_UPDATE_DAC 0x03u
-#define DAC8568_CMD_CLEAR_CODE 0x05u
-#define DAC8568_CMD_SOFTWARE_RESET 0x07u
-#define DAC8568_CMD_INTERNAL_REF 0x08u
-#define DAC8568_CMD_FLEXIBLE_REF 0x09u
-
-#define DAC8568_CHANNEL_A 0x00u
-#define DAC8568_CHANNEL_B 0x01u
-#define DAC8568_CHANNEL_C 0x02u
-#define DAC8568_CHANNEL_D 0x03u
-
-/*
- * DAC8568IDPW(0~5V) + 运放移位放大：
- * Vout = 4 * (Vi - 2.5V)
- * 这里按“对外输出 ±5V”生成波形。
- */
-#define DAC8568_MAX_VOLTAGE 5.0f
-#define DAC8568_MIN_VOLTAGE -5.0f
-#define DAC8568_VREF_MV 2500.0f
-
-#define LUT_BITS 10u
-#define LUT_SIZE (1u << LUT_BITS)
-#define LUT_PHASE_SHIFT (32u - LUT_BITS)
-
-#define WAVE_FREQ_A_HZ 12000.0
-#define WAVE_FREQ_B_HZ 6000.0
-#define WAVE_FREQ_C_HZ 3000.0
-#define WAVE_FREQ_D_HZ 1000.0
-
-#define DAC8568_WORDS_PER_SAMPLE 4u
-#define DAC8568_SAMPLES_PER_HALF 8191u
-#define DAC8568_TX_BUF_WORDS (DAC8568_SAMPLES_PER_HALF * DAC8568_WORDS_PER_SAMPLE * 2u)
-#define DAC8568_TX_HALF_WORDS (DAC8568_TX_BUF_WORDS / 2u)
+#include <string.h>
 
 #if (DAC8568_TX_BUF_WORDS > 65535u)
 #error "DAC8568_TX_BUF_WORDS exceeds HAL_SPI_Transmit_DMA(uint16_t Size) limit; reduce DAC8568_SAMPLES_PER_HALF."
 #endif
 
-/*
- * DAC8568 (TI) 32-bit frame (MSB-first):
- *   [ 4'b0000 | CMD(4) | ADDR(4) | DATA(16) | 4'b0000 ]
- * This is consistent with the original project implementation under
- * `DAC8568_H750_Hardware_SPI_10V/.../User/dac8568`.
- */
-#define DAC8568_FRAME_PREFIX(cmd, channel) (((uint32_t)(cmd) << 24) | ((uint32_t)(channel) << 20))
-#define DAC8568_FRAME_A_PREFIX DAC8568_FRAME_PREFIX(DAC8568_CMD_WRITE_INPUT, DAC8568_CHANNEL_A)
-#define DAC8568_FRAME_B_PREFIX DAC8568_FRAME_PREFIX(DAC8568_CMD_WRITE_INPUT, DAC8568_CHANNEL_B)
-#define DAC8568_FRAME_C_PREFIX DAC8568_FRAME_PREFIX(DAC8568_CMD_WRITE_INPUT, DAC8568_CHANNEL_C)
-#define DAC8568_FRAME_D_PREFIX DAC8568_FRAME_PREFIX(DAC8568_CMD_WRITE_UPDATE_ALL, DAC8568_CHANNEL_D)
+#if ((DAC8568_SWITCH_EVENT_QUEUE & (DAC8568_SWITCH_EVENT_QUEUE - 1u)) != 0u)
+#error "DAC8568_SWITCH_EVENT_QUEUE must be a power of two"
+#endif
+
+#if (DAC8568_MARKER_ENABLE != 0u) && !defined(DAC8568_MARKER_Pin)
+#error "DAC8568_MARKER_ENABLE needs DAC8568_MARKER_GPIO_Port / DAC8568_MARKER_Pin (main.h)"
+#endif
+#if (DAC8568_MARKER_ENABLE != 0u) && (DAC8568_MARKER_LEAD_US < 5u || DAC8568_MARKER_LEAD_US > 500u)
+#error "DAC8568_MARKER_LEAD_US must be 5..500 (the compare is re-aimed within one timebase period)"
+#endif
+
+/* HAL timebase (stm32h7xx_hal_timebase_tim.c): 1 MHz count, 1 ms period. */
+#define DAC8568_TIMEBASE TIM17
+/* Slot ring service: TIM7 (APB1 like TIM12, no CubeMX handle) at the SPI TX DMA IRQ priority. */
+#define DAC8568_RING_TIM TIM7
+#define DAC8568_RING_TIM_IRQn TIM7_IRQn
+#define DAC8568_SPI_DMA_IRQn DMA1_Stream4_IRQn /* hdma_spi1_tx (Core/Src/dma.c) */
+
 #define DAC8568_SOFT_RESET_FRAME (((uint32_t)DAC8568_CMD_SOFTWARE_RESET) << 24)
 
 #define DAC8568_CLR_IGNORE_FRAME ((((uint32_t)DAC8568_CMD_CLEAR_CODE) << 24) | 0x03u)
@@ -76,6 +49,9 @@
  * and tiny guards can still hit bus/cached prefetch corner cases near 0x92000000.
  */
 #define DAC8568_QSPI_GUARD_BYTES (64u * 1024u)
+/* SDRAM (FMC bank 1): RAM copies played while QSPI is detached (DAC8568_DMA_DetachQspi). */
+#define DAC8568_RAM_SOURCE_BASE 0xC0000000u
+#define DAC8568_RAM_SOURCE_LIMIT 0xC1000000u
 
 #define DAC8568_RECOVER_REASON_NONE 0u
 #define DAC8568_RECOVER_REASON_SPI_ERROR 1u
@@ -83,23 +59,21 @@
 #define DAC8568_RECOVER_REASON_MANUAL 4u
 
 static uint32_t g_sample_rate_hz = 120000u;
-
-static uint32_t g_phase_a = 0u;
-static uint32_t g_phase_b = 0u;
-static uint32_t g_phase_c = 0u;
-static uint32_t g_phase_d = 0u;
-
-static uint32_t g_phase_inc_a = 0u;
-static uint32_t g_phase_inc_b = 0u;
-static uint32_t g_phase_inc_c = 0u;
-static uint32_t g_phase_inc_d = 0u;
-
-static uint16_t g_lut_sine[LUT_SIZE];
-static uint16_t g_lut_triangle[LUT_SIZE];
-static uint16_t g_lut_saw[LUT_SIZE];
-static uint16_t g_lut_square[LUT_SIZE];
+static DAC8568_Stream_t g_stream;
+static DAC8568_Playlist_t g_playlist;
+static DAC8568_Transition_t g_transition_mode = DAC8568_TRANSITION_HARD;
+static uint32_t g_transition_us = 0u;
+static DAC8568_Ring_t g_ring;
+/* Procedural sources (DAC8568_WAVE_FORMAT_SYNTH), one per source id. */
+static DAC8568_Synth_t g_synth[DAC8568_SYNTH_SOURCE_MAX];
+static uint32_t g_ring_slots_cfg = DAC8568_RING_SLOTS;
+static uint32_t g_ring_lead_cfg = DAC8568_RING_LEAD;
 
 __attribute__((section(".ram_d2"), aligned(32))) static uint32_t g_tx_buf[DAC8568_TX_BUF_WORDS];
+#if (DAC8568_REFILL_MDMA != 0)
+/* CODE16x4 codes of the refill in flight, copied by the MDMA and packed into g_tx_buf by the CPU. */
+__attribute__((section(".ram_d1"), aligned(32))) static uint16_t g_stage_buf[DAC8568_SAMPLES_PER_HALF * DAC8568_WORDS_PER_SAMPLE];
+#endif
 
 static volatile uint32_t g_tx_ok = 0u;
 static volatile uint32_t g_tx_fail = 0u;
@@ -115,34 +89,50 @@ static volatile uint32_t g_ref_refresh_count = 0u;
 static volatile uint8_t g_manual_recover_pending = 0u;
 static volatile uint32_t g_manual_recover_count = 0u;
 static volatile uint32_t g_stagnant_count = 0u;
+static volatile uint8_t g_qspi_detached = 0u;
+
+static DAC8568_RefillStats_t g_refill_stats;
+static volatile uint32_t g_refill_start_samples = 0u;
+/* DWT timing of the refill in flight on the MDMA (see dac8568_refill_account()). */
+static volatile uint32_t g_refill_start_cycles = 0u;
+static volatile uint32_t g_refill_deadline = 0u;
+static volatile uint32_t g_refill_samples = 0u;
+static uint32_t *volatile g_refill_dst = NULL;
+static volatile uint8_t g_refill_staged = 0u;
+/* Set from MDMA start until its completion has packed and accounted the block. */
+static volatile uint8_t g_refill_inflight = 0u;
+static DAC8568_RefillTiming_t g_refill_timing;
+static uint64_t g_refill_total_cycles = 0u;
+
+/* Switch events: written by the refill (stream switch hook), read by one task. */
+static DAC8568_SwitchEvent_t g_switch_events[DAC8568_SWITCH_EVENT_QUEUE];
+static volatile uint32_t g_switch_event_head = 0u;
+static volatile uint32_t g_switch_event_tail = 0u;
+static uint32_t g_switch_event_seq = 0u;
+/* Stream position of TX sample counter 0 (first prefilled sample), set by Start(). */
+static uint32_t g_stream_base = 0u;
+#if (DAC8568_MARKER_ENABLE != 0u)
+/* 0 idle, 1 waiting for the wake-up compare, 2 output compare aimed at the switch sample. */
+static volatile uint8_t g_marker_armed = 0u;
+static uint32_t g_marker_sample = 0u;
+static uint32_t g_marker_ms = 0u;
+#endif
+
+#if (DAC8568_VERIFY_ENABLE != 0)
+/* Closed-loop output check: codes recorded by the refill, ADC scans read by DAC8568_DMA_Service(). */
+static DAC8568_Verify_t g_verify;
+static volatile uint8_t g_verify_on = 0u;   /* configured, used from the next Start() */
+static volatile uint8_t g_verify_live = 0u; /* ADC locked to the running stream */
+static volatile uint8_t g_verify_cal_pending = 0u;
+#endif
 
 static uint32_t g_service_last_tick = 0u;
 static uint32_t g_service_last_samples = 0u;
 static uint32_t g_service_last_fail = 0u;
-static volatile DAC8568_SourceMode_t g_source_mode = DAC8568_SOURCE_LUT;
-static const uint16_t *g_qspi_wave_data[DAC8568_QSPI_SOURCE_MAX] = {0};
-static uint32_t g_qspi_wave_samples[DAC8568_QSPI_SOURCE_MAX] = {0};
-static uint32_t g_qspi_wave_index[DAC8568_QSPI_SOURCE_MAX] = {0};
-static volatile uint8_t g_qspi_active_source = 0u;
-
-typedef struct {
-  volatile uint8_t pending;
-  uint8_t source_id;
-  uint8_t reset_index;
-  uint8_t reserved;
-  const uint16_t *data;
-  uint32_t samples;
-} dac8568_qspi_switch_t;
-
-static dac8568_qspi_switch_t g_qspi_switch = {0};
-
-static uint32_t dac8568_get_tx_sample_counter(void) {
-  /* Derived from DMA progress for sub-buffer resolution (avoids 8191-sample quantization). */
-  if (g_stream_running == 0u) {
-    return g_sample_count;
-  }
 
-  const uint32_t samples_per_buf = DAC8568_SAMPLES_PER_HALF * 2u;
+/* Ring wraps completed and sample offset inside the ring, from DMA progress. */
+static void dac8568_get_read_position(uint32_t *cycles, uint32_t *samples_in_ring) {
+  const uint32_t ring_words = g_ring.ring_samples * DAC8568_WORDS_PER_SAMPLE;
 
   uint32_t cycles_a = g_dma_buf_cycles;
   uint32_t remaining_words = __HAL_DMA_GET_COUNTER(&hdma_spi1_tx);
@@ -152,20 +142,187 @@ static uint32_t dac8568_get_tx_sample_counter(void) {
     remaining_words = __HAL_DMA_GET_COUNTER(&hdma_spi1_tx);
   }
 
-  if (remaining_words > DAC8568_TX_BUF_WORDS) {
-    remaining_words = DAC8568_TX_BUF_WORDS;
+  if (remaining_words > ring_words) {
+    remaining_words = ring_words;
   }
 
-  uint32_t words_done = DAC8568_TX_BUF_WORDS - remaining_words;
+  uint32_t words_done = ring_words - remaining_words;
   uint32_t samples_in_buf = words_done / DAC8568_WORDS_PER_SAMPLE;
-  if (samples_in_buf > samples_per_buf) {
-    samples_in_buf = samples_per_buf;
+  if (samples_in_buf > g_ring.ring_samples) {
+    samples_in_buf = g_ring.ring_samples;
   }
 
-  return cycles_a * samples_per_buf + samples_in_buf;
+  *cycles = cycles_a;
+  *samples_in_ring = samples_in_buf;
+}
+
+/* DWT cycle counter, enabled on first use (a half refill is tens of us, HAL_GetTick is 1 ms). */
+static uint32_t dac8568_cycles(void) {
+  if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0u) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = 0xC5ACCE55u; /* Cortex-M7: unlock before enabling */
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  return DWT->CYCCNT;
+}
+
+static uint32_t dac8568_get_tx_sample_counter(void) {
+  /* Derived from DMA progress for sub-buffer resolution (avoids 8191-sample quantization). */
+  if (g_stream_running == 0u) {
+    return g_sample_count;
+  }
+
+  uint32_t cycles = 0u;
+  uint32_t samples_in_buf = 0u;
+  dac8568_get_read_position(&cycles, &samples_in_buf);
+  return cycles * g_ring.ring_samples + samples_in_buf;
+}
+
+static uint64_t dac8568_time_us(void) {
+  uint32_t ms;
+  uint32_t cnt;
+  do {
+    ms = HAL_GetTick();
+    cnt = DAC8568_TIMEBASE->CNT;
+  } while (ms != HAL_GetTick());
+  /* Counter wrapped but the update IRQ has not run yet (caller preempts it). */
+  if ((DAC8568_TIMEBASE->SR & TIM_SR_UIF) != 0u && cnt < 500u) {
+    ms++;
+  }
+  return (uint64_t)ms * 1000u + cnt;
+}
+
+#if (DAC8568_MARKER_ENABLE != 0u)
+/*
+ * Marker pin as TIM17_CH1, output forced low. CC1 stays an interrupt-only
+ * compare until the IRQ aims it at a switch sample.
+ */
+static void dac8568_marker_init(void) {
+  GPIO_InitTypeDef gpio = {0};
+
+  gpio.Pin = DAC8568_MARKER_Pin;
+  gpio.Mode = GPIO_MODE_AF_PP;
+  gpio.Pull = GPIO_NOPULL;
+  gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  gpio.Alternate = DAC8568_MARKER_AF;
+  HAL_GPIO_Init(DAC8568_MARKER_GPIO_Port, &gpio);
+
+  DAC8568_TIMEBASE->CCMR1 = (DAC8568_TIMEBASE->CCMR1 & ~(TIM_CCMR1_OC1M | TIM_CCMR1_OC1PE | TIM_CCMR1_CC1S)) |
+                            TIM_OCMODE_FORCED_INACTIVE;
+  DAC8568_TIMEBASE->CCER = (DAC8568_TIMEBASE->CCER & ~TIM_CCER_CC1P) | TIM_CCER_CC1E;
+  DAC8568_TIMEBASE->BDTR |= TIM_BDTR_MOE;
+}
+
+/* Wake the timebase CC1 IRQ shortly before `time_us`; false while a marker is pending. */
+static bool dac8568_marker_arm(uint32_t sample, uint64_t time_us, uint64_t now_us) {
+  if (g_marker_armed != 0u) {
+    return false;
+  }
+  uint64_t wake = time_us - DAC8568_MARKER_LEAD_US;
+  if ((int64_t)(wake - now_us) < 2) {
+    wake = now_us + 2u;
+  }
+  g_marker_sample = sample;
+  g_marker_ms = (uint32_t)(wake / 1000u);
+  g_marker_armed = 1u;
+  DAC8568_TIMEBASE->CCR1 = (uint32_t)(wake % 1000u);
+  DAC8568_TIMEBASE->SR = ~TIM_SR_CC1IF;
+  DAC8568_TIMEBASE->DIER |= TIM_DIER_CC1IE;
+  return true;
+}
+#endif
+
+/*
+ * Stream switch hook (refill context): stamp the switch with its TX sample
+ * index and the time the DMA gets there, and queue it for the task side.
+ */
+static void dac8568_on_switch(uint8_t from_source, uint8_t to_source, uint32_t position, uint8_t returned) {
+  const uint32_t sample = position - g_stream_base;
+  /* Prefill (stream not running yet): the DMA starts right after it. */
+  const uint32_t now_sample = (g_stream_running != 0u) ? dac8568_get_tx_sample_counter() : 0u;
+  const uint64_t now_us = dac8568_time_us();
+  const int64_t ahead_us = (int64_t)(int32_t)(sample - now_sample) * 1000000 / (int64_t)g_sample_rate_hz;
+  uint8_t flags = (returned != 0u) ? DAC8568_SWITCH_EVENT_RETURN : 0u;
+
+#if (DAC8568_MARKER_ENABLE != 0u)
+  if (dac8568_marker_arm(sample, now_us + (uint64_t)ahead_us, now_us)) {
+    flags |= DAC8568_SWITCH_EVENT_MARKER;
+  }
+#endif
+
+  const uint32_t seq = ++g_switch_event_seq;
+  const uint32_t head = g_switch_event_head;
+  if ((head - g_switch_event_tail) >= DAC8568_SWITCH_EVENT_QUEUE) {
+    return; /* full: the consumer sees the gap in seq */
+  }
+  DAC8568_SwitchEvent_t *e = &g_switch_events[head & (DAC8568_SWITCH_EVENT_QUEUE - 1u)];
+  e->seq = seq;
+  e->from_source = from_source;
+  e->to_source = to_source;
+  e->flags = flags;
+  e->sample = sample;
+  e->time_us = now_us + (uint64_t)ahead_us;
+  __COMPILER_BARRIER();
+  g_switch_event_head = head + 1u;
+}
+
+/*
+ * Slot ring service timer: one update per slot. It counts the TIM12 period in
+ * the same kernel clock ((PSC+1) * (ARR+1) per sample), exactly when that fits
+ * the prescaler, otherwise rounded down so the service never falls behind the
+ * DMA. Started right after TIM12, it wakes just past the slot boundaries.
+ */
+static void dac8568_ring_tim_period(uint32_t prescaler, uint32_t arr) {
+  const uint64_t sample_ticks = (uint64_t)(prescaler + 1u) * (arr + 1u);
+  uint64_t psc_plus1 = sample_ticks;
+  uint64_t arr_plus1 = g_ring.slot_samples;
+
+  if (sample_ticks > 65536u) {
+    const uint64_t ticks = sample_ticks * g_ring.slot_samples;
+    psc_plus1 = (ticks + 65535u) / 65536u;
+    if (psc_plus1 > 65536u) {
+      psc_plus1 = 65536u;
+    }
+    arr_plus1 = ticks / psc_plus1;
+    if (arr_plus1 > 65536u) {
+      arr_plus1 = 65536u;
+    }
+  }
+  if (arr_plus1 == 0u) {
+    arr_plus1 = 1u;
+  }
+  DAC8568_RING_TIM->PSC = (uint32_t)(psc_plus1 - 1u);
+  DAC8568_RING_TIM->ARR = (uint32_t)(arr_plus1 - 1u);
+}
+
+static void dac8568_ring_tim_start(void) {
+  TIM_TypeDef *tim = DAC8568_RING_TIM;
+
+  tim->CR1 = 0u;
+  dac8568_ring_tim_period(htim12.Instance->PSC, htim12.Instance->ARR);
+  tim->CNT = 0u;
+  tim->EGR = TIM_EGR_UG; /* load PSC / ARR */
+  tim->SR = 0u;
+  tim->DIER = TIM_DIER_UIE;
+  /* Same priority as the half/full callbacks: refills never nest and the tick / task code cannot delay them. */
+  NVIC_SetPriority(DAC8568_RING_TIM_IRQn, NVIC_GetPriority(DAC8568_SPI_DMA_IRQn));
+  NVIC_ClearPendingIRQ(DAC8568_RING_TIM_IRQn);
+  NVIC_EnableIRQ(DAC8568_RING_TIM_IRQn);
+  tim->CR1 = TIM_CR1_ARPE | TIM_CR1_CEN;
+}
+
+static void dac8568_ring_tim_stop(void) {
+  DAC8568_RING_TIM->CR1 = 0u;
+  DAC8568_RING_TIM->DIER = 0u;
 }
 
 static void dac8568_tim12_stop(void) {
+#if (DAC8568_VERIFY_ENABLE != 0)
+  g_verify_live = 0u;
+  DAC8568_ADC_Stop();
+#endif
+  /* The slot service is paced from TIM12's period: stop it with the sample clock. */
+  dac8568_ring_tim_stop();
   (void)HAL_TIM_Base_Stop(&htim12);
 }
 
@@ -182,7 +339,7 @@ static uint32_t dac8568_tim12_get_timclk_hz(void) {
   return pclk1;
 }
 
-static void dac8568_tim12_apply_sample_rate(uint32_t sample_rate_hz) {
+static void dac8568_tim12_calc(uint32_t sample_rate_hz, uint32_t *psc, uint32_t *arr) {
   if (sample_rate_hz == 0u) {
     sample_rate_hz = 1u;
   }
@@ -223,10 +380,78 @@ static void dac8568_tim12_apply_sample_rate(uint32_t sample_rate_hz) {
     arr_plus1 = 65536u;
   }
 
+  *psc = prescaler;
+  *arr = arr_plus1 - 1u;
+}
+
+static void dac8568_tim12_apply_sample_rate(uint32_t sample_rate_hz) {
+  uint32_t prescaler = 0u;
+  uint32_t arr = 0u;
+  dac8568_tim12_calc(sample_rate_hz, &prescaler, &arr);
   __HAL_TIM_SET_PRESCALER(&htim12, prescaler);
-  __HAL_TIM_SET_AUTORELOAD(&htim12, arr_plus1 - 1u);
+  __HAL_TIM_SET_AUTORELOAD(&htim12, arr);
+}
+
+/*
+ * Live retime: PSC is always buffered and ARR is buffered with ARPE, so both
+ * shadow registers load together at the next update event and the sample in
+ * progress finishes with the old period. The two writes must not straddle an
+ * update event (one period would get the new PSC with the old ARR): wait, with
+ * IRQs on, until the counter is in the first half of its period, then write
+ * both with IRQs off if it still is (an interrupt in between may have pushed
+ * it past; try again in the next period).
+ */
+static void dac8568_tim12_retime(uint32_t prescaler, uint32_t arr) {
+  TIM_TypeDef *tim = htim12.Instance;
+
+  for (;;) {
+    const uint32_t half = (tim->ARR + 1u) / 2u;
+    uint32_t spin = 0u;
+    while ((tim->CR1 & TIM_CR1_CEN) != 0u && tim->CNT >= half && spin < 0x10000u) {
+      spin++;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    /* Timer stopped or never leaving the second half: nothing to straddle / give up waiting. */
+    const uint8_t safe = ((tim->CR1 & TIM_CR1_CEN) == 0u || tim->CNT < half || spin >= 0x10000u) ? 1u : 0u;
+    if (safe != 0u) {
+      tim->PSC = prescaler;
+      tim->ARR = arr;
+    }
+    if (primask == 0u) {
+      __enable_irq();
+    }
+    if (safe != 0u) {
+      return;
+    }
+  }
 }
 
+#if (DAC8568_VERIFY_ENABLE != 0)
+/*
+ * TIM12 in trigger mode on ITR0 (TIM4 TRGO): DAC8568_ADC_Start() starts TIM4
+ * and TIM12 on the same edge, so ADC conversion k samples TX sample k * decim.
+ * UG still sends sample 0 right away. Without the ADC, TIM12 runs on its own.
+ */
+static HAL_StatusTypeDef dac8568_tim12_start_locked(void) {
+  TIM_TypeDef *tim = htim12.Instance;
+
+  MODIFY_REG(tim->SMCR, TIM_SMCR_TS | TIM_SMCR_SMS, TIM_TS_ITR0 | TIM_SLAVEMODE_TRIGGER);
+  if (HAL_TIM_Base_Start(&htim12) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  SET_BIT(tim->EGR, TIM_EGR_UG);
+  if (DAC8568_ADC_Start(&g_verify.cfg, dac8568_tim12_get_timclk_hz(), tim->PSC, tim->ARR) == 0) {
+    g_verify_live = 1u;
+    return HAL_OK;
+  }
+  CLEAR_BIT(tim->SMCR, TIM_SMCR_TS | TIM_SMCR_SMS);
+  __HAL_TIM_ENABLE(&htim12);
+  return HAL_OK;
+}
+#endif
+
 static HAL_StatusTypeDef dac8568_tim12_start(void) {
   /*
    * TIM12 is configured by CubeMX with TRGO = Update Event.
@@ -235,8 +460,15 @@ static HAL_StatusTypeDef dac8568_tim12_start(void) {
    */
   MX_TIM12_Init();
   dac8568_tim12_apply_sample_rate(g_sample_rate_hz);
+  /* ARR preload so DAC8568_DMA_Retime() can change the period without a glitch. */
+  SET_BIT(htim12.Instance->CR1, TIM_CR1_ARPE);
   __HAL_TIM_SET_COUNTER(&htim12, 0u);
   __HAL_TIM_CLEAR_FLAG(&htim12, TIM_FLAG_UPDATE);
+#if (DAC8568_VERIFY_ENABLE != 0)
+  if (g_verify_on != 0u) {
+    return dac8568_tim12_start_locked();
+  }
+#endif
   if (HAL_TIM_Base_Start(&htim12) != HAL_OK) {
     return HAL_ERROR;
   }
@@ -244,26 +476,6 @@ static HAL_StatusTypeDef dac8568_tim12_start(void) {
   return HAL_OK;
 }
 
-static uint16_t dac8568_voltage_to_code(float voltage) {
-  float clamped = voltage;
-  if (clamped > DAC8568_MAX_VOLTAGE) {
-    clamped = DAC8568_MAX_VOLTAGE;
-  } else if (clamped < DAC8568_MIN_VOLTAGE) {
-    clamped = DAC8568_MIN_VOLTAGE;
-  }
-
-  /* Vi = Vout/4 + 2.5V（运放前 DAC 输出电压） */
-  float real_voltage = clamped / 4.0f + 2.5f;
-  float scaled = (real_voltage / 2.0f) * 1000.0f / DAC8568_VREF_MV;
-  int32_t code = (int32_t)(scaled * 65535.0f + 0.5f);
-  if (code < 0) {
-    code = 0;
-  } else if (code > 65535) {
-    code = 65535;
-  }
-  return (uint16_t)code;
-}
-
 __STATIC_FORCEINLINE uint32_t dac8568_build_frame32(uint8_t cmd, uint8_t channel, uint16_t code) {
   return ((uint32_t)(cmd & 0x0Fu) << 24) | ((uint32_t)(channel & 0x0Fu) << 20) | ((uint32_t)code << 4);
 }
@@ -307,54 +519,42 @@ static HAL_StatusTypeDef dac8568_soft_reset_and_rearm(void) {
   return ((st_reset == HAL_OK) && (st_clr == HAL_OK) && (st_ref == HAL_OK)) ? HAL_OK : HAL_ERROR;
 }
 
-static void dac8568_prepare_lut(void) {
-  for (uint32_t i = 0u; i < LUT_SIZE; ++i) {
-    float phase = (2.0f * 3.1415926535f * (float)i) / (float)LUT_SIZE;
-
-    /* Sine */
-    float v_sine = DAC8568_MAX_VOLTAGE * sinf(phase);
-    g_lut_sine[i] = dac8568_voltage_to_code(v_sine);
-
-    /* Triangle: -1..+1 */
-    float x = (float)i / (float)LUT_SIZE; /* 0..1 */
-    float tri = (x < 0.5f) ? (4.0f * x - 1.0f) : (3.0f - 4.0f * x);
-    g_lut_triangle[i] = dac8568_voltage_to_code(DAC8568_MAX_VOLTAGE * tri);
-
-    /* Saw: -1..+1 */
-    float saw = 2.0f * x - 1.0f;
-    g_lut_saw[i] = dac8568_voltage_to_code(DAC8568_MAX_VOLTAGE * saw);
-
-    /* Square: -1 / +1 */
-    float sq = (x < 0.5f) ? 1.0f : -1.0f;
-    g_lut_square[i] = dac8568_voltage_to_code(DAC8568_MAX_VOLTAGE * sq);
-  }
-}
-
-static void dac8568_update_phase_inc(uint32_t sample_rate_hz) {
-  g_phase_inc_a = (uint32_t)((WAVE_FREQ_A_HZ * 4294967296.0) / (double)sample_rate_hz);
-  g_phase_inc_b = (uint32_t)((WAVE_FREQ_B_HZ * 4294967296.0) / (double)sample_rate_hz);
-  g_phase_inc_c = (uint32_t)((WAVE_FREQ_C_HZ * 4294967296.0) / (double)sample_rate_hz);
-  g_phase_inc_d = (uint32_t)((WAVE_FREQ_D_HZ * 4294967296.0) / (double)sample_rate_hz);
-}
-
 static void dac8568_dcache_clean(void *addr, size_t bytes) {
   uintptr_t start = (uintptr_t)addr & ~(uintptr_t)31u;
   uintptr_t end = ((uintptr_t)addr + bytes + 31u) & ~(uintptr_t)31u;
   SCB_CleanDCache_by_Addr((uint32_t *)start, (int32_t)(end - start));
 }
 
-static uint32_t dac8568_qspi_safe_samples(uint32_t qspi_mmap_addr, uint32_t requested_samples) {
-  const uint32_t bytes_per_sample = DAC8568_WORDS_PER_SAMPLE * (uint32_t)sizeof(uint16_t);
+static uint8_t dac8568_addr_in_qspi(uintptr_t addr) {
+  return (addr >= DAC8568_QSPI_MMAP_BASE && addr < DAC8568_QSPI_MMAP_LIMIT) ? 1u : 0u;
+}
+
+static uint8_t dac8568_addr_in_ram(uintptr_t addr) {
+  return (addr >= DAC8568_RAM_SOURCE_BASE && addr < DAC8568_RAM_SOURCE_LIMIT) ? 1u : 0u;
+}
+
+static uint32_t dac8568_source_safe_samples(uint32_t source_addr, uint32_t requested_samples,
+                                            uint8_t format) {
+  const uint32_t bytes_per_sample = DAC8568_Stream_BytesPerSample(format);
+  uint32_t max_bytes;
 
-  if ((qspi_mmap_addr < DAC8568_QSPI_MMAP_BASE) || (qspi_mmap_addr >= DAC8568_QSPI_MMAP_LIMIT)) {
+  if (dac8568_addr_in_qspi(source_addr) != 0u) {
+    max_bytes = DAC8568_QSPI_MMAP_LIMIT - source_addr;
+    if (max_bytes <= DAC8568_QSPI_GUARD_BYTES) {
+      return 0u;
+    }
+    max_bytes -= DAC8568_QSPI_GUARD_BYTES;
+  } else if (dac8568_addr_in_ram(source_addr) != 0u) {
+    max_bytes = DAC8568_RAM_SOURCE_LIMIT - source_addr;
+  } else {
     return 0u;
   }
 
-  uint32_t max_bytes = DAC8568_QSPI_MMAP_LIMIT - qspi_mmap_addr;
-  if (max_bytes <= DAC8568_QSPI_GUARD_BYTES) {
-    return 0u;
+  if (format == DAC8568_WAVE_FORMAT_ZCODE16x4) {
+    /* 压缩源只能整体接受：块偏移表必须落在映射区内（块内容由同步时的 CRC32 保证）。 */
+    const uint32_t table_bytes = DAC8568_ZCode_BlockCount(requested_samples) * (uint32_t)sizeof(uint32_t);
+    return (table_bytes <= max_bytes) ? requested_samples : 0u;
   }
-  max_bytes -= DAC8568_QSPI_GUARD_BYTES;
 
   uint32_t max_samples = max_bytes / bytes_per_sample;
   if (max_samples == 0u) {
@@ -367,130 +567,340 @@ static uint32_t dac8568_qspi_safe_samples(uint32_t qspi_mmap_addr, uint32_t requ
   return requested_samples;
 }
 
-static void dac8568_fill_samples(uint32_t *dst, uint32_t sample_count) {
-  uint32_t *dst_base = dst;
-  uint32_t phase_a = g_phase_a;
-  uint32_t phase_b = g_phase_b;
-  uint32_t phase_c = g_phase_c;
-  uint32_t phase_d = g_phase_d;
-  uint8_t active_source = g_qspi_active_source;
-  uint32_t qspi_index = 0u;
-
-  if (g_qspi_switch.pending != 0u) {
-    uint8_t new_source = g_qspi_switch.source_id;
-    const uint16_t *new_data = g_qspi_switch.data;
-    uint32_t new_samples = g_qspi_switch.samples;
-    uint8_t reset_idx = g_qspi_switch.reset_index;
-    g_qspi_switch.pending = 0u;
-
-    if (new_source < DAC8568_QSPI_SOURCE_MAX && new_data != NULL && new_samples > 0u) {
-      g_qspi_wave_data[new_source] = new_data;
-      g_qspi_wave_samples[new_source] = new_samples;
-      if (reset_idx != 0u) {
-        g_qspi_wave_index[new_source] = 0u;
-      }
-      g_qspi_active_source = new_source;
-      active_source = new_source;
+/*
+ * Validate one source request and resolve what the stream plays: the QSPI
+ * window (clamped to the safe mapped range), an SDRAM copy, or, for
+ * DAC8568_WAVE_FORMAT_SYNTH, the synth loaded for that source id.
+ * Error codes are RequestQspiWave's.
+ */
+static int32_t dac8568_resolve_source(uint8_t source_id, uint32_t qspi_mmap_addr, uint32_t sample_count,
+                                      uint8_t format, const void **data, uint32_t *samples) {
+  if (format == DAC8568_WAVE_FORMAT_SYNTH) {
+    if (source_id >= DAC8568_SYNTH_SOURCE_MAX || source_id >= DAC8568_QSPI_SOURCE_MAX) {
+      return -3;
     }
+    *data = &g_synth[source_id];
+    *samples = DAC8568_Synth_LoopSamples(&g_synth[source_id]);
+    return (*samples != 0u) ? 0 : -4;
+  }
+  if (dac8568_addr_in_qspi(qspi_mmap_addr) == 0u && dac8568_addr_in_ram(qspi_mmap_addr) == 0u) {
+    return -1;
+  }
+  if (dac8568_addr_in_qspi(qspi_mmap_addr) != 0u && g_qspi_detached != 0u) {
+    return -8;
+  }
+  if (sample_count == 0u) {
+    return -2;
   }
+  if (source_id >= DAC8568_QSPI_SOURCE_MAX) {
+    return -3;
+  }
+  if (format != DAC8568_WAVE_FORMAT_FRAME32 && format != DAC8568_WAVE_FORMAT_CODE16x4 &&
+      format != DAC8568_WAVE_FORMAT_ZCODE16x4) {
+    return -5;
+  }
+  *samples = dac8568_source_safe_samples(qspi_mmap_addr, sample_count, format);
+  if (*samples == 0u) {
+    return -4;
+  }
+  *data = (const void *)(uintptr_t)qspi_mmap_addr;
+  return 0;
+}
 
-  const uint32_t inc_a = g_phase_inc_a;
-  const uint32_t inc_b = g_phase_inc_b;
-  const uint32_t inc_c = g_phase_inc_c;
-  const uint32_t inc_d = g_phase_inc_d;
-  const uint8_t use_qspi = (g_source_mode == DAC8568_SOURCE_QSPI) &&
-                           (active_source < DAC8568_QSPI_SOURCE_MAX) &&
-                           (g_qspi_wave_data[active_source] != NULL) &&
-                           (g_qspi_wave_samples[active_source] > 0u);
+/* Transition length follows the sample rate; the refill reads it when a switch lands. */
+static void dac8568_apply_transition(void) {
+  uint64_t samples = ((uint64_t)g_transition_us * g_sample_rate_hz + 500000u) / 1000000u;
+  if (g_transition_us != 0u && samples == 0u) {
+    samples = 1u;
+  }
+  if (samples > DAC8568_TRANSITION_MAX_SAMPLES) {
+    samples = DAC8568_TRANSITION_MAX_SAMPLES;
+  }
 
-  if (use_qspi != 0u) {
-    qspi_index = g_qspi_wave_index[active_source];
-    if (qspi_index >= g_qspi_wave_samples[active_source]) {
-      qspi_index = 0u;
-    }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  DAC8568_Stream_SetTransition(&g_stream, g_transition_mode, (uint32_t)samples);
+  if (primask == 0u) {
+    __enable_irq();
   }
+}
 
-  for (uint32_t i = 0u; i < sample_count; i++) {
-    uint16_t code_a;
-    uint16_t code_b;
-    uint16_t code_c;
-    uint16_t code_d;
-
-    if (use_qspi != 0u) {
-      const uint16_t *sample = &g_qspi_wave_data[active_source][qspi_index * DAC8568_WORDS_PER_SAMPLE];
-      code_a = sample[0];
-      code_b = sample[1];
-      code_c = sample[2];
-      code_d = sample[3];
-      qspi_index++;
-      if (qspi_index >= g_qspi_wave_samples[active_source]) {
-        qspi_index = 0u;
-      }
+static void dac8568_fill_samples(uint32_t *dst, uint32_t sample_count) {
+  DAC8568_Stream_Fill(&g_stream, dst, sample_count);
+
+  g_tick_count += sample_count;
+  g_sample_count += sample_count;
+}
+
+/* DAC8568_RefillTiming_t update at the end of a refill (ISR context); returns 1 on an underrun. */
+static uint8_t dac8568_refill_timing(uint32_t start_cycles, uint32_t deadline, uint32_t end_samples) {
+  const uint32_t cycles = dac8568_cycles() - start_cycles;
+  DAC8568_RefillTiming_t *t = &g_refill_timing;
+
+  t->refills++;
+  t->last_cycles = cycles;
+  if (cycles < t->min_cycles || t->refills == 1u) {
+    t->min_cycles = cycles;
+  }
+  if (cycles > t->max_cycles) {
+    t->max_cycles = cycles;
+  }
+  g_refill_total_cycles += cycles;
+
+  const uint32_t v = cycles >> DAC8568_TIMING_HIST_SHIFT;
+  uint32_t bin = (v == 0u) ? 0u : (32u - __CLZ(v));
+  if (bin >= DAC8568_TIMING_HIST_BINS) {
+    bin = DAC8568_TIMING_HIST_BINS - 1u;
+  }
+  t->hist[bin]++;
+
+  t->last_ndtr_words = __HAL_DMA_GET_COUNTER(&hdma_spi1_tx);
+  const uint8_t underrun = ((int32_t)(deadline - end_samples) < 0) ? 1u : 0u;
+  if (underrun != 0u) {
+    /* The DMA fetched the first frame of the block before it was written. */
+    t->underruns++;
+    t->last_margin_samples = 0u;
+  } else {
+    t->last_margin_samples = deadline - end_samples;
+  }
+  if (t->last_margin_samples < t->min_margin_samples) {
+    t->min_margin_samples = t->last_margin_samples;
+  }
+  return underrun;
+}
+
+/*
+ * Sample count at which the DMA reaches the block at dst, i.e. the TX index of
+ * its first sample, from one NDTR read position; a DMA already inside the
+ * block (distance wraps past the rest of the ring) gives start_samples.
+ */
+static uint32_t dac8568_refill_deadline(const uint32_t *dst, uint32_t samples, uint32_t start_samples) {
+  const uint32_t ring = g_ring.ring_samples;
+  const uint32_t first = (uint32_t)(dst - g_tx_buf) / DAC8568_WORDS_PER_SAMPLE;
+  uint32_t cycles = 0u;
+  uint32_t pos = 0u;
+  dac8568_get_read_position(&cycles, &pos);
+  const uint32_t dist = (first + ring - pos % ring) % ring;
+
+  return (dist > ring - samples) ? start_samples : cycles * ring + pos + dist;
+}
+
+/*
+ * Output check: record the codes of a refilled block under its TX index. A
+ * block the DMA is already reading has no reliable index and is left out
+ * (its conversions count as no_expect).
+ */
+static void dac8568_verify_expect(uint32_t start, uint32_t deadline, const uint32_t *frames, uint32_t samples) {
+#if (DAC8568_VERIFY_ENABLE != 0)
+  if (g_verify_live != 0u && (int32_t)(deadline - start) > 0) {
+    DAC8568_Verify_Expect(&g_verify, deadline, frames, samples);
+  }
+#else
+  (void)start;
+  (void)deadline;
+  (void)frames;
+  (void)samples;
+#endif
+}
+
+/*
+ * Refill headroom: the DMA re-enters the half being refilled SAMPLES_PER_HALF
+ * samples after the half/full callback fired (slot ring: about `lead` slots
+ * after the service picked the slot). Measure how many samples it consumed
+ * while the refill ran (NDTR based), the rest is the headroom. The block's
+ * ok_samples count as sent (tx_ok) only if it was written before the DMA got there.
+ */
+static void dac8568_refill_account(uint32_t start_samples, uint32_t start_cycles, uint32_t deadline,
+                                   uint32_t ok_samples) {
+  const uint32_t budget = g_ring.slot_samples * g_ring.lead;
+  const uint32_t end_samples = dac8568_get_tx_sample_counter();
+  uint32_t used = end_samples - start_samples;
+
+  if (dac8568_refill_timing(start_cycles, deadline, end_samples) == 0u) {
+    g_tx_ok += ok_samples;
+  }
+
+  g_refill_stats.refills++;
+  g_refill_stats.last_samples = used;
+  if (used > g_refill_stats.max_samples) {
+    g_refill_stats.max_samples = used;
+  }
+  if (used >= budget) {
+    g_refill_stats.late++;
+    g_refill_stats.min_headroom_samples = 0u;
+  } else if ((budget - used) < g_refill_stats.min_headroom_samples) {
+    g_refill_stats.min_headroom_samples = budget - used;
+  }
+}
+
+#if (DAC8568_REFILL_MDMA != 0)
+/* CPU copy of planned spans into dst: frames as they are, staged codes packed. */
+static void dac8568_copy_spans(uint32_t *dst, const DAC8568_StreamSpan_t *spans, uint32_t span_count,
+                               uint8_t staged) {
+  uint32_t *out = dst;
+  for (uint32_t i = 0u; i < span_count; i++) {
+    if (staged != 0u) {
+      DAC8568_Stream_PackCodes(out, (const uint16_t *)spans[i].src, spans[i].samples);
     } else {
-      code_a = g_lut_sine[phase_a >> LUT_PHASE_SHIFT];
-      phase_a += inc_a;
-      code_b = g_lut_triangle[phase_b >> LUT_PHASE_SHIFT];
-      phase_b += inc_b;
-      code_c = g_lut_saw[phase_c >> LUT_PHASE_SHIFT];
-      phase_c += inc_c;
-      code_d = g_lut_square[phase_d >> LUT_PHASE_SHIFT];
-      phase_d += inc_d;
+      memcpy(out, spans[i].src, (size_t)spans[i].samples * DAC8568_WORDS_PER_SAMPLE * sizeof(uint32_t));
     }
-
-    *dst++ = DAC8568_FRAME_A_PREFIX | ((uint32_t)code_a << 4);
-    *dst++ = DAC8568_FRAME_B_PREFIX | ((uint32_t)code_b << 4);
-    *dst++ = DAC8568_FRAME_C_PREFIX | ((uint32_t)code_c << 4);
-    *dst++ = DAC8568_FRAME_D_PREFIX | ((uint32_t)code_d << 4);
+    out += spans[i].samples * DAC8568_WORDS_PER_SAMPLE;
   }
+}
 
-  if (use_qspi != 0u) {
-    g_qspi_wave_index[active_source] = qspi_index;
+/*
+ * MDMA completion (MDMA IRQ). A staged CODE16x4 refill is packed from SRAM
+ * here; on an error the block keeps its old frames and is counted in tx_fail.
+ */
+static void dac8568_mdma_on_done(uint8_t error) {
+  const uint32_t samples = g_refill_samples;
 
-    /* Baseline phase should continue even during fault playback. */
-    if (active_source != 0u &&
-        g_qspi_wave_data[0] != NULL &&
-        g_qspi_wave_samples[0] > 0u &&
-        sample_count > 0u) {
-      uint32_t base_index = g_qspi_wave_index[0];
-      base_index += sample_count;
-      if (base_index >= g_qspi_wave_samples[0]) {
-        base_index %= g_qspi_wave_samples[0];
+  if (error != 0u) {
+    g_refill_stats.mdma_errors++;
+    g_tx_fail++;
+  } else if (g_refill_staged != 0u) {
+    uint32_t *dst = g_refill_dst;
+    const size_t code_bytes = (size_t)samples * DAC8568_WORDS_PER_SAMPLE * sizeof(uint16_t);
+    /* Lines speculatively refetched while the MDMA was writing would shadow the codes. */
+    SCB_InvalidateDCache_by_Addr((uint32_t *)(uintptr_t)g_stage_buf, (int32_t)((code_bytes + 31u) & ~(size_t)31u));
+    DAC8568_Stream_PackCodes(dst, g_stage_buf, samples);
+    dac8568_verify_expect(g_refill_start_samples, g_refill_deadline, dst, samples);
+    dac8568_dcache_clean(dst, (size_t)samples * DAC8568_WORDS_PER_SAMPLE * sizeof(uint32_t));
+  }
+  dac8568_refill_account(g_refill_start_samples, g_refill_start_cycles, g_refill_deadline,
+                         (error != 0u) ? 0u : samples);
+  g_refill_inflight = 0u;
+}
+#endif
+
+static void dac8568_refill_block(uint32_t *dst, uint32_t samples) {
+  const uint32_t start_cycles = dac8568_cycles();
+  const uint32_t start = dac8568_get_tx_sample_counter();
+  const uint32_t deadline = dac8568_refill_deadline(dst, samples, start);
+  const size_t bytes = (size_t)samples * DAC8568_WORDS_PER_SAMPLE * sizeof(uint32_t);
+
+#if (DAC8568_REFILL_MDMA != 0)
+  uint8_t use_mdma = 1u;
+  if (g_refill_inflight != 0u) {
+    if (g_ring.slots == 2u && DAC8568_MDMA_IsBusy() != 0u) {
+      /* Previous half still copying a full half-period later: it already missed its deadline. */
+      DAC8568_MDMA_Abort();
+      g_refill_inflight = 0u;
+      g_refill_stats.late++;
+      g_refill_timing.underruns++;
+    } else {
+      /*
+       * Previous slot still copying (on time), or its completion is packing the
+       * staging buffer under this interrupt: copy this one with the CPU.
+       */
+      use_mdma = 0u;
+    }
+  }
+
+  DAC8568_StreamSpan_t spans[DAC8568_STREAM_MAX_SPANS];
+  uint32_t span_count = 0u;
+  uint8_t staged = 0u;
+  if (use_mdma != 0u) {
+    span_count = DAC8568_Stream_PlanCopy(&g_stream, samples, spans, DAC8568_STREAM_MAX_SPANS);
+    if (span_count == 0u) {
+      span_count = DAC8568_Stream_PlanStage(&g_stream, samples, spans, DAC8568_STREAM_MAX_SPANS);
+      staged = (span_count != 0u) ? 1u : 0u;
+    }
+  }
+  if (span_count != 0u) {
+    g_tick_count += samples;
+    g_sample_count += samples;
+
+    /* Aborted as late (above) this copy is never accounted, so it never reaches tx_ok. */
+    g_refill_start_samples = start;
+    g_refill_samples = samples;
+    g_refill_start_cycles = start_cycles;
+    g_refill_deadline = deadline;
+    g_refill_dst = dst;
+    g_refill_staged = staged;
+    if (staged == 0u) {
+      /* Codes straight from the source frames: the MDMA has not written dst yet. */
+      uint32_t tx = deadline;
+      for (uint32_t i = 0u; i < span_count; i++) {
+        dac8568_verify_expect(start, tx, (const uint32_t *)spans[i].src, spans[i].samples);
+        tx += spans[i].samples;
       }
-      g_qspi_wave_index[0] = base_index;
     }
-  } else {
-    g_phase_a = phase_a;
-    g_phase_b = phase_b;
-    g_phase_c = phase_c;
-    g_phase_d = phase_d;
+    const uint8_t format = (staged != 0u) ? DAC8568_WAVE_FORMAT_CODE16x4 : DAC8568_WAVE_FORMAT_FRAME32;
+    g_refill_inflight = 1u;
+    if (DAC8568_MDMA_StartCopy((staged != 0u) ? (void *)g_stage_buf : (void *)dst, spans, span_count,
+                               DAC8568_Stream_BytesPerSample(format)) == 0) {
+      g_refill_stats.mdma_refills++;
+      return;
+    }
+    g_refill_inflight = 0u;
+
+    /* Stream already advanced by the plan: finish the same copy with the CPU. */
+    g_refill_stats.mdma_errors++;
+    dac8568_copy_spans(dst, spans, span_count, staged);
+    if (staged != 0u) {
+      dac8568_verify_expect(start, deadline, dst, samples);
+    }
+    dac8568_dcache_clean(dst, bytes);
+    dac8568_refill_account(start, start_cycles, deadline, samples);
+    return;
   }
+#endif
 
-  g_tick_count += sample_count;
-  g_sample_count += sample_count;
-  g_tx_ok += sample_count;
+  dac8568_fill_samples(dst, samples);
+  dac8568_verify_expect(start, deadline, dst, samples);
+  dac8568_dcache_clean(dst, bytes);
+  dac8568_refill_account(start, start_cycles, deadline, samples);
 }
 
 static void dac8568_dma_on_half(void) {
-  dac8568_fill_samples(&g_tx_buf[0], DAC8568_SAMPLES_PER_HALF);
-  dac8568_dcache_clean(&g_tx_buf[0], (size_t)DAC8568_TX_HALF_WORDS * sizeof(uint32_t));
+  if (g_ring.slots == 2u) {
+    dac8568_refill_block(&g_tx_buf[0], g_ring.slot_samples);
+  }
 }
 
 static void dac8568_dma_on_full(void) {
-  dac8568_fill_samples(&g_tx_buf[DAC8568_TX_HALF_WORDS], DAC8568_SAMPLES_PER_HALF);
-  dac8568_dcache_clean(&g_tx_buf[DAC8568_TX_HALF_WORDS], (size_t)DAC8568_TX_HALF_WORDS * sizeof(uint32_t));
+  if (g_ring.slots == 2u) {
+    dac8568_refill_block(&g_tx_buf[DAC8568_TX_HALF_WORDS], g_ring.slot_samples);
+  }
+}
+
+/*
+ * 多槽环形刷新：按 DMA 读指针所在槽，把其后 lead 个槽补满。
+ * 槽之间 32 字节对齐，MDMA 写入与 CPU 回写不会共享 cache line。
+ */
+static void dac8568_ring_service(void) {
+  uint32_t cycles = 0u;
+  uint32_t samples_in_ring = 0u;
+  dac8568_get_read_position(&cycles, &samples_in_ring);
+
+  uint32_t read_slot = cycles * g_ring.slots + samples_in_ring / g_ring.slot_samples;
+  if (samples_in_ring >= g_ring.ring_samples) {
+    read_slot = (cycles + 1u) * g_ring.slots; /* TC not serviced yet */
+  }
+
+  const uint32_t late_before = g_ring.late;
+  for (uint32_t n = 0u; n <= g_ring.lead; n++) {
+    int32_t idx = DAC8568_Ring_NextDue(&g_ring, read_slot);
+    if (idx < 0) {
+      break;
+    }
+    dac8568_refill_block(&g_tx_buf[(uint32_t)idx * g_ring.slot_samples * DAC8568_WORDS_PER_SAMPLE],
+                         g_ring.slot_samples);
+    DAC8568_Ring_Commit(&g_ring);
+  }
+  if (g_ring.late != late_before) {
+    g_refill_stats.late += g_ring.late - late_before;
+  }
 }
 
 void DAC8568_DMA_Init(uint32_t sample_rate_hz) {
   g_sample_rate_hz = (sample_rate_hz == 0u) ? 48000u : sample_rate_hz;
-  g_phase_a = g_phase_b = g_phase_c = g_phase_d = 0u;
-  for (uint32_t i = 0u; i < DAC8568_QSPI_SOURCE_MAX; i++) {
-    g_qspi_wave_data[i] = NULL;
-    g_qspi_wave_samples[i] = 0u;
-    g_qspi_wave_index[i] = 0u;
-  }
-  g_qspi_active_source = 0u;
-  g_qspi_switch.pending = 0u;
-  dac8568_update_phase_inc(g_sample_rate_hz);
+  DAC8568_Stream_Init(&g_stream, g_sample_rate_hz);
+  DAC8568_Stream_SetSwitchHook(&g_stream, dac8568_on_switch);
+  DAC8568_Playlist_Init(&g_playlist);
+  (void)DAC8568_Ring_Configure(&g_ring, 2u, 1u, DAC8568_SAMPLES_PER_HALF * 2u);
+  dac8568_apply_transition();
 
   /*
    * Power-up pins:
@@ -502,7 +912,15 @@ void DAC8568_DMA_Init(uint32_t sample_rate_hz) {
   HAL_GPIO_WritePin(DAC8568_LDAC_GPIO_Port, DAC8568_LDAC_Pin, GPIO_PIN_RESET);
   HAL_Delay(20);
 
-  dac8568_prepare_lut();
+  DAC8568_Stream_PrepareLut();
+  (void)dac8568_cycles();
+#if (DAC8568_MARKER_ENABLE != 0u)
+  dac8568_marker_init();
+#endif
+#if (DAC8568_REFILL_MDMA != 0)
+  DAC8568_MDMA_Init(dac8568_mdma_on_done);
+#endif
+  __HAL_RCC_TIM7_CLK_ENABLE();
 
   /* Startup robustness: reset + internal ref enable (retry). */
   (void)dac8568_soft_reset_and_rearm();
@@ -514,6 +932,11 @@ void DAC8568_DMA_Start(void) {
   dac8568_tim12_stop();
 
   (void)HAL_SPI_Abort(&hspi1);
+#if (DAC8568_REFILL_MDMA != 0)
+  /* A refill still in flight would land on top of the prefill below. */
+  DAC8568_MDMA_Abort();
+  g_refill_inflight = 0u;
+#endif
 
   /* Ensure LDAC allows continuous updates during streaming. */
   HAL_GPIO_WritePin(DAC8568_LDAC_GPIO_Port, DAC8568_LDAC_Pin, GPIO_PIN_RESET);
@@ -524,10 +947,40 @@ void DAC8568_DMA_Start(void) {
   g_tick_count = 0u;
   g_sample_count = 0u;
 
-  /* Prefill both halves before starting the circular DMA stream. */
-  dac8568_fill_samples(&g_tx_buf[0], DAC8568_SAMPLES_PER_HALF);
-  dac8568_fill_samples(&g_tx_buf[DAC8568_TX_HALF_WORDS], DAC8568_SAMPLES_PER_HALF);
+  if (DAC8568_Ring_Configure(&g_ring, g_ring_slots_cfg, g_ring_lead_cfg, DAC8568_SAMPLES_PER_HALF * 2u) != 0 ||
+      DAC8568_Ring_FitsRate(&g_ring, g_sample_rate_hz) == 0u) {
+    /* 槽太短（采样率提高后）时退回半缓冲刷新，宁可延迟大也不能欠载。 */
+    (void)DAC8568_Ring_Configure(&g_ring, 2u, 1u, DAC8568_SAMPLES_PER_HALF * 2u);
+  }
+
+  g_stream_base = DAC8568_Stream_GetPosition(&g_stream);
+  if (g_ring.slots == 2u) {
+    /* Prefill both halves before starting the circular DMA stream. */
+    dac8568_fill_samples(&g_tx_buf[0], DAC8568_SAMPLES_PER_HALF);
+    dac8568_fill_samples(&g_tx_buf[DAC8568_TX_HALF_WORDS], DAC8568_SAMPLES_PER_HALF);
+    DAC8568_Ring_Reset(&g_ring, 2u);
+  } else {
+    /*
+     * Slot ring: only slots 0..lead carry stream data; the rest repeats the
+     * last prefilled sample so a missed service holds the output instead of
+     * replaying stale frames.
+     */
+    const uint32_t prefill = (g_ring.lead + 1u) * g_ring.slot_samples;
+    dac8568_fill_samples(&g_tx_buf[0], prefill);
+    const uint32_t *last = &g_tx_buf[(prefill - 1u) * DAC8568_WORDS_PER_SAMPLE];
+    for (uint32_t i = prefill; i < g_ring.ring_samples; i++) {
+      memcpy(&g_tx_buf[i * DAC8568_WORDS_PER_SAMPLE], last, DAC8568_WORDS_PER_SAMPLE * sizeof(uint32_t));
+    }
+    DAC8568_Ring_Reset(&g_ring, g_ring.lead + 1u);
+  }
   dac8568_dcache_clean(g_tx_buf, sizeof(g_tx_buf));
+#if (DAC8568_VERIFY_ENABLE != 0)
+  if (g_verify_on != 0u) {
+    /* TX sample counter restarts at 0 on the first prefilled sample. */
+    DAC8568_Verify_Reset(&g_verify);
+    DAC8568_Verify_Expect(&g_verify, 0u, g_tx_buf, g_ring.ring_samples);
+  }
+#endif
 
   /* Reset stats after prefill (phase keeps advancing correctly). */
   g_tx_ok = 0u;
@@ -535,13 +988,19 @@ void DAC8568_DMA_Start(void) {
   g_sample_count = 0u;
   g_dma_buf_cycles = 0u;
   g_stagnant_count = 0u;
+  memset(&g_refill_stats, 0, sizeof(g_refill_stats));
+  g_refill_stats.min_headroom_samples = g_ring.slot_samples * g_ring.lead;
+  memset(&g_refill_timing, 0, sizeof(g_refill_timing));
+  g_refill_timing.min_margin_samples = g_ring.ring_samples;
+  g_refill_total_cycles = 0u;
 
   /*
    * TIM-paced streaming without 240 kHz IRQ:
    *
    * Use SPI1 TX DMA request (backpressure by TX FIFO space), and gate it by DMAMUX
-   * synchronization on TIM12_TRGO. Each timer event authorizes 4 DMA requests
-   * (A/B/C/D words), achieving the target sample rate while avoiding CPU load.
+   * synchronization on TIM12_TRGO. Each timer event authorizes one DMA request
+   * per channel (A..D or A..H words), achieving the target sample rate while
+   * avoiding CPU load.
    *
    * Note: DMAMUX sync signal supports TIM12_TRGO on STM32H7; TIM2_TRGO is not
    * available as a DMAMUX sync source in this HAL/MCU.
@@ -557,7 +1016,8 @@ void DAC8568_DMA_Start(void) {
     return;
   }
 
-  if (HAL_SPI_Transmit_DMA(&hspi1, (uint8_t *)g_tx_buf, (uint16_t)DAC8568_TX_BUF_WORDS) != HAL_OK) {
+  if (HAL_SPI_Transmit_DMA(&hspi1, (uint8_t *)g_tx_buf,
+                           (uint16_t)(g_ring.ring_samples * DAC8568_WORDS_PER_SAMPLE)) != HAL_OK) {
     g_tx_fail++;
     return;
   }
@@ -566,6 +1026,9 @@ void DAC8568_DMA_Start(void) {
     g_tx_fail++;
     return;
   }
+  if (g_ring.slots > 2u) {
+    dac8568_ring_tim_start();
+  }
 
   g_stream_running = 1u;
   g_service_last_samples = dac8568_get_tx_sample_counter();
@@ -585,7 +1048,7 @@ void DAC8568_DMA_OnTxComplete(void) {
 
 void DAC8568_DMA_GetStats(uint32_t *tx_ok, uint32_t *tx_fail, uint32_t *tick_skip) {
   if (tx_ok != NULL) {
-    *tx_ok = dac8568_get_tx_sample_counter();
+    *tx_ok = g_tx_ok;
   }
   if (tx_fail != NULL) {
     *tx_fail = g_tx_fail;
@@ -600,7 +1063,97 @@ void DAC8568_DMA_UpdateSampleRate(uint32_t sample_rate_hz) {
     return;
   }
   g_sample_rate_hz = sample_rate_hz;
-  dac8568_update_phase_inc(g_sample_rate_hz);
+  DAC8568_Stream_SetSampleRate(&g_stream, g_sample_rate_hz);
+  dac8568_apply_transition();
+}
+
+int32_t DAC8568_DMA_Retime(uint32_t sample_rate_hz) {
+  uint32_t prescaler = 0u;
+  uint32_t arr = 0u;
+
+  if (sample_rate_hz < DAC8568_SAMPLE_RATE_MIN_HZ || sample_rate_hz > DAC8568_SAMPLE_RATE_MAX_HZ) {
+    return -1;
+  }
+  if (g_stream_running != 0u && DAC8568_Ring_FitsRate(&g_ring, sample_rate_hz) == 0u) {
+    return -2;
+  }
+  dac8568_tim12_calc(sample_rate_hz, &prescaler, &arr);
+
+  /*
+   * Stream indices and LUT phases are left untouched: QSPI sources continue at
+   * the next sample, built-in waves keep their phase with new increments.
+   */
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  g_sample_rate_hz = sample_rate_hz;
+  DAC8568_Stream_SetSampleRate(&g_stream, sample_rate_hz);
+  if (primask == 0u) {
+    __enable_irq();
+  }
+  if (g_stream_running != 0u) {
+    dac8568_tim12_retime(prescaler, arr);
+    if (g_ring.slots > 2u) {
+      /* Buffered (PSC, ARPE): the service period follows from its next update. */
+      dac8568_ring_tim_period(prescaler, arr);
+    }
+  }
+
+#if (DAC8568_VERIFY_ENABLE != 0)
+  /* TIM4 no longer divides the new period: pause the output check until the next Start(). */
+  if (g_verify_live != 0u) {
+    g_verify_live = 0u;
+    DAC8568_ADC_Stop();
+  }
+#endif
+
+  dac8568_apply_transition();
+  return 0;
+}
+
+int32_t DAC8568_DMA_SetChannelMap(const DAC8568_ChannelMap_t *map) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  int32_t rc = DAC8568_Stream_SetChannelMap(&g_stream, map);
+  if (primask == 0u) {
+    __enable_irq();
+  }
+  return rc;
+}
+
+void DAC8568_DMA_GetChannelMap(DAC8568_ChannelMap_t *map) {
+  if (map == NULL) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *map = g_stream.map;
+  if (primask == 0u) {
+    __enable_irq();
+  }
+}
+
+uint32_t DAC8568_DMA_GetSampleRate(void) {
+  return g_sample_rate_hz;
+}
+
+int32_t DAC8568_DMA_SetSourceSpeed(uint8_t source_id, uint32_t speed_q16, DAC8568_Interp_t interp) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  int32_t rc = DAC8568_Stream_SetSpeed(&g_stream, source_id, speed_q16, interp);
+  if (primask == 0u) {
+    __enable_irq();
+  }
+  return rc;
+}
+
+int32_t DAC8568_DMA_SetSourceLoop(uint8_t source_id, uint32_t loop_start, uint32_t loop_end, uint8_t flags) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  int32_t rc = DAC8568_Stream_SetLoop(&g_stream, source_id, loop_start, loop_end, flags);
+  if (primask == 0u) {
+    __enable_irq();
+  }
+  return rc;
 }
 
 void DAC8568_DMA_GetTickCounter(uint32_t *tick_count) {
@@ -616,6 +1169,8 @@ void DAC8568_DMA_GetSampleCounter(uint32_t *sample_count) {
 }
 
 void DAC8568_DMA_Service(void) {
+  (void)DAC8568_Playlist_Pump(&g_playlist, &g_stream);
+
   uint8_t manual = g_manual_recover_pending;
   if (manual != 0u) {
     g_manual_recover_pending = 0u;
@@ -631,6 +1186,16 @@ void DAC8568_DMA_Service(void) {
     return;
   }
 
+#if (DAC8568_VERIFY_ENABLE != 0)
+  if (g_verify_cal_pending != 0u) {
+    g_verify_cal_pending = 0u;
+    DAC8568_Verify_Calibrate(&g_verify);
+  }
+  if (g_verify_live != 0u) {
+    DAC8568_ADC_Poll(&g_verify);
+  }
+#endif
+
   uint32_t now = HAL_GetTick();
   uint32_t samples = dac8568_get_tx_sample_counter();
   uint32_t fails = g_tx_fail;
@@ -706,19 +1271,14 @@ void DAC8568_DMA_GetHealth(uint32_t *recover_count, uint32_t *recover_reason,
 }
 
 int32_t DAC8568_DMA_UseQspiWave(uint32_t qspi_mmap_addr, uint32_t sample_count,
-                                uint32_t sample_rate_hz) {
+                                uint8_t format, uint32_t sample_rate_hz) {
   uint8_t restart_stream = 0u;
   uint32_t safe_samples = 0u;
+  const void *data = NULL;
 
-  if ((qspi_mmap_addr < DAC8568_QSPI_MMAP_BASE) || (qspi_mmap_addr >= DAC8568_QSPI_MMAP_LIMIT)) {
-    return -1;
-  }
-  if (sample_count == 0u) {
-    return -2;
-  }
-  safe_samples = dac8568_qspi_safe_samples(qspi_mmap_addr, sample_count);
-  if (safe_samples == 0u) {
-    return -4;
+  int32_t rc = dac8568_resolve_source(0u, qspi_mmap_addr, sample_count, format, &data, &safe_samples);
+  if (rc != 0) {
+    return rc;
   }
 
   if (g_stream_running != 0u) {
@@ -728,15 +1288,12 @@ int32_t DAC8568_DMA_UseQspiWave(uint32_t qspi_mmap_addr, uint32_t sample_count,
     (void)HAL_SPI_Abort(&hspi1);
   }
 
-  g_qspi_wave_data[0] = (const uint16_t *)(uintptr_t)qspi_mmap_addr;
-  g_qspi_wave_samples[0] = safe_samples;
-  g_qspi_wave_index[0] = 0u;
-  g_qspi_active_source = 0u;
-  g_source_mode = DAC8568_SOURCE_QSPI;
+  DAC8568_Stream_SetSource(&g_stream, 0u, data, safe_samples, format, 1u);
 
   if (sample_rate_hz != 0u) {
     g_sample_rate_hz = sample_rate_hz;
-    dac8568_update_phase_inc(g_sample_rate_hz);
+    DAC8568_Stream_SetSampleRate(&g_stream, g_sample_rate_hz);
+    dac8568_apply_transition();
   }
 
   if (restart_stream != 0u) {
@@ -746,54 +1303,393 @@ int32_t DAC8568_DMA_UseQspiWave(uint32_t qspi_mmap_addr, uint32_t sample_count,
 }
 
 int32_t DAC8568_DMA_RequestQspiWave(uint8_t source_id, uint32_t qspi_mmap_addr,
-                                   uint32_t sample_count, bool reset_index) {
+                                   uint32_t sample_count, uint8_t format, bool reset_index) {
   uint32_t safe_samples = 0u;
+  const void *data = NULL;
+
+  int32_t resolve_rc = dac8568_resolve_source(source_id, qspi_mmap_addr, sample_count, format, &data,
+                                              &safe_samples);
+  if (resolve_rc != 0) {
+    return resolve_rc;
+  }
+
+  /* If stream isn't running, apply immediately (safe, no IRQ racing). */
+  if (g_stream_running == 0u) {
+    DAC8568_Stream_SetSource(&g_stream, source_id, data, safe_samples, format, reset_index ? 1u : 0u);
+    return 0;
+  }
 
-  if ((qspi_mmap_addr < DAC8568_QSPI_MMAP_BASE) || (qspi_mmap_addr >= DAC8568_QSPI_MMAP_LIMIT)) {
+  /*
+   * Defer switch to next half/full refill boundary to avoid glitches. The
+   * switch queue is single-producer / single-consumer: Main_Task (command
+   * dispatcher, playlist pump, staged update) posts, the refill pops, so no
+   * critical section is needed.
+   */
+  const int32_t rc = DAC8568_Stream_PostSwitch(&g_stream, source_id, data, safe_samples, format,
+                                               reset_index ? 1u : 0u);
+  return (rc == 0) ? 0 : -6;
+}
+
+int32_t DAC8568_DMA_ReleaseQspiWave(void) {
+  /* Same single producer as RequestQspiWave. */
+  return (DAC8568_Stream_PostRelease(&g_stream) == 0) ? 0 : -6;
+}
+
+/*
+ * Re-point source 0 (the fallback of every release / playlist end) without a
+ * restart: queued while streaming (configured transition, same index so an
+ * identical copy splices seamlessly), set directly when stopped, and only
+ * recorded under LUT output.
+ */
+static int32_t dac8568_rebase_source0(const void *data, uint32_t samples, uint8_t format, uint8_t reset_index) {
+  int32_t rc = 0;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (g_stream.mode != DAC8568_SOURCE_QSPI) {
+    DAC8568_StreamSource_t *src = &g_stream.qspi[0];
+    src->data = data;
+    src->samples = samples;
+    src->format = format;
+    if (reset_index != 0u) {
+      src->index = 0u;
+      src->frac = 0u;
+    }
+  } else if (g_stream_running == 0u) {
+    DAC8568_Stream_SetSource(&g_stream, 0u, data, samples, format, reset_index);
+  } else {
+    rc = DAC8568_Stream_PostSwitch(&g_stream, 0u, data, samples, format, reset_index);
+  }
+  if (primask == 0u) {
+    __enable_irq();
+  }
+  return (rc == 0) ? 0 : -6;
+}
+
+int32_t DAC8568_DMA_DetachQspi(const void *ram_copy, uint32_t bytes, uint32_t sample_count, uint8_t format) {
+  const uintptr_t addr = (uintptr_t)ram_copy;
+  uint32_t safe_samples = 0u;
+  const void *data = NULL;
+
+  if (dac8568_addr_in_ram(addr) == 0u || bytes == 0u || bytes > DAC8568_RAM_SOURCE_LIMIT - addr) {
     return -1;
   }
-  if (sample_count == 0u) {
-    return -2;
+  int32_t rc = dac8568_resolve_source(0u, (uint32_t)addr, sample_count, format, &data, &safe_samples);
+  if (rc != 0) {
+    return rc;
   }
-  if (source_id >= DAC8568_QSPI_SOURCE_MAX) {
+  dac8568_dcache_clean((void *)addr, bytes);
+
+  g_qspi_detached = 1u;
+  /* Drops the playlist and every queued QSPI switch; the refill honours the flush first. */
+  DAC8568_Playlist_Stop(&g_playlist, &g_stream);
+  rc = dac8568_rebase_source0(data, safe_samples, format, 0u);
+  if (rc != 0) {
+    g_qspi_detached = 0u;
+  }
+  return rc;
+}
+
+bool DAC8568_DMA_IsQspiIdle(void) {
+  const DAC8568_Stream_t *s = &g_stream;
+  uint8_t busy;
+
+  if (g_qspi_detached == 0u) {
+    return false;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  busy = dac8568_addr_in_qspi((uintptr_t)s->qspi[0].data);
+  if (s->mode == DAC8568_SOURCE_QSPI) {
+    busy |= dac8568_addr_in_qspi((uintptr_t)s->qspi[s->active_source].data);
+    if (s->fade_len != 0u) {
+      busy |= dac8568_addr_in_qspi((uintptr_t)s->fade_from.data);
+    }
+  }
+#if (DAC8568_REFILL_MDMA != 0)
+  /* A slot planned before the switch may still be copying from QSPI. */
+  busy |= DAC8568_MDMA_IsBusy();
+#endif
+  if (primask == 0u) {
+    __enable_irq();
+  }
+  return busy == 0u;
+}
+
+int32_t DAC8568_DMA_AttachQspi(uint32_t qspi_mmap_addr, uint32_t sample_count, uint8_t format) {
+  uint32_t safe_samples = 0u;
+  const void *data = NULL;
+
+  g_qspi_detached = 0u;
+  int32_t rc = dac8568_resolve_source(0u, qspi_mmap_addr, sample_count, format, &data, &safe_samples);
+  if (rc == 0) {
+    /* Same length: keep the phase; a resized baseline restarts (blended by the transition). */
+    rc = dac8568_rebase_source0(data, safe_samples, format,
+                                (g_stream.qspi[0].samples != safe_samples) ? 1u : 0u);
+  }
+  if (rc != 0) {
+    g_qspi_detached = 1u;
+  }
+  return rc;
+}
+
+bool DAC8568_DMA_IsQspiDetached(void) {
+  return g_qspi_detached != 0u;
+}
+
+int32_t DAC8568_DMA_LoadSynth(uint8_t source_id, const DAC8568_SynthParams_t *params) {
+  static DAC8568_Synth_t next; /* Main_Task only; keeps the state off the task stack */
+
+  if (source_id >= DAC8568_SYNTH_SOURCE_MAX) {
     return -3;
   }
-  safe_samples = dac8568_qspi_safe_samples(qspi_mmap_addr, sample_count);
-  if (safe_samples == 0u) {
-    return -4;
+  if (DAC8568_Synth_Configure(&next, params) != 0) {
+    return -7;
   }
 
-  const uint16_t *data = (const uint16_t *)(uintptr_t)qspi_mmap_addr;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  g_synth[source_id] = next;
+  /* 已装入流的合成源继续播放：只需同步循环长度，下次渲染自行定位到当前索引。 */
+  DAC8568_StreamSource_t *src = &g_stream.qspi[source_id];
+  if (src->data == (const void *)&g_synth[source_id]) {
+    src->samples = next.loop;
+    if (src->index >= next.loop) {
+      src->index %= next.loop;
+    }
+  }
+  if (primask == 0u) {
+    __enable_irq();
+  }
+  return 0;
+}
 
-  /* If stream isn't running, apply immediately (safe, no IRQ racing). */
-  if (g_stream_running == 0u) {
-    g_qspi_wave_data[source_id] = data;
-    g_qspi_wave_samples[source_id] = safe_samples;
-    if (reset_index) {
-      g_qspi_wave_index[source_id] = 0u;
+int32_t DAC8568_DMA_StartPlaylist(const DAC8568_PlaylistStep_t *steps, uint32_t count) {
+  DAC8568_PlaylistSegment_t segments[DAC8568_PLAYLIST_MAX];
+
+  if (steps == NULL || count == 0u || count > DAC8568_PLAYLIST_MAX) {
+    return -6;
+  }
+  for (uint32_t i = 0u; i < count; i++) {
+    const DAC8568_PlaylistStep_t *step = &steps[i];
+    uint32_t safe_samples = 0u;
+    const void *data = NULL;
+
+    int32_t rc = dac8568_resolve_source(step->source_id, step->qspi_mmap_addr, step->sample_count,
+                                        step->format, &data, &safe_samples);
+    if (rc != 0) {
+      return rc;
     }
-    g_qspi_active_source = source_id;
-    g_source_mode = DAC8568_SOURCE_QSPI;
-    return 0;
+
+    uint64_t duration = ((uint64_t)step->duration_ms * g_sample_rate_hz + 500u) / 1000u;
+    if (step->duration_ms != 0u && duration == 0u) {
+      duration = 1u;
+    }
+    if (duration > DAC8568_PLAYLIST_DURATION_MAX) {
+      return -6;
+    }
+    segments[i].source_id = step->source_id;
+    segments[i].format = step->format;
+    segments[i].reset_index = step->reset_index ? 1u : 0u;
+    segments[i].repeat = step->repeat;
+    segments[i].data = data;
+    segments[i].samples = safe_samples;
+    segments[i].duration_samples = (uint32_t)duration;
+  }
+
+  if (DAC8568_Playlist_Load(&g_playlist, segments, count) != 0) {
+    return -6;
+  }
+  return (DAC8568_Playlist_Start(&g_playlist, &g_stream) == 0) ? 0 : -6;
+}
+
+int32_t DAC8568_DMA_ConfigureRing(uint32_t slots, uint32_t lead) {
+  DAC8568_Ring_t probe;
+  uint8_t restart_stream = 0u;
+
+  if (DAC8568_Ring_Configure(&probe, slots, lead, DAC8568_SAMPLES_PER_HALF * 2u) != 0) {
+    return -1;
+  }
+  if (DAC8568_Ring_FitsRate(&probe, g_sample_rate_hz) == 0u) {
+    return -2;
   }
 
-  /* Defer switch to next half/full refill boundary to avoid glitches. */
+  if (g_stream_running != 0u) {
+    restart_stream = 1u;
+    g_stream_running = 0u;
+    dac8568_tim12_stop();
+    (void)HAL_SPI_Abort(&hspi1);
+  }
+
+  g_ring_slots_cfg = slots;
+  g_ring_lead_cfg = lead;
+  if (restart_stream != 0u) {
+    DAC8568_DMA_Start();
+  }
+  return 0;
+}
+
+void DAC8568_DMA_RingIRQHandler(void) {
+  if ((DAC8568_RING_TIM->SR & TIM_SR_UIF) == 0u) {
+    return;
+  }
+  DAC8568_RING_TIM->SR = ~TIM_SR_UIF;
+  if (g_stream_running != 0u && g_ring.slots > 2u) {
+    dac8568_ring_service();
+  }
+}
+
+void DAC8568_DMA_SetTransition(DAC8568_Transition_t mode, uint32_t duration_us) {
+  g_transition_mode = mode;
+  g_transition_us = duration_us;
+  dac8568_apply_transition();
+}
+
+void DAC8568_DMA_StopPlaylist(void) {
+  DAC8568_Playlist_Stop(&g_playlist, &g_stream);
+}
+
+bool DAC8568_DMA_IsPlaylistActive(void) {
+  return DAC8568_Playlist_IsActive(&g_playlist, &g_stream) != 0u;
+}
+
+void DAC8568_DMA_GetRefillStats(DAC8568_RefillStats_t *stats) {
+  if (stats == NULL) {
+    return;
+  }
   uint32_t primask = __get_PRIMASK();
   __disable_irq();
-  g_qspi_switch.source_id = source_id;
-  g_qspi_switch.data = data;
-  g_qspi_switch.samples = safe_samples;
-  g_qspi_switch.reset_index = reset_index ? 1u : 0u;
-  g_qspi_switch.pending = 1u;
+  *stats = g_refill_stats;
   if (primask == 0u) {
     __enable_irq();
   }
-  g_source_mode = DAC8568_SOURCE_QSPI;
+  stats->switch_late = g_stream.switch_late;
+  stats->ring_slots = g_ring.slots;
+  stats->ring_lead = g_ring.lead;
+  stats->ring_slot_samples = g_ring.slot_samples;
+  stats->sample_rate_hz = g_sample_rate_hz;
+}
+
+void DAC8568_DMA_GetTiming(DAC8568_RefillTiming_t *timing) {
+  if (timing == NULL) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *timing = g_refill_timing;
+  const uint64_t total = g_refill_total_cycles;
+  if (primask == 0u) {
+    __enable_irq();
+  }
+  timing->mean_cycles = (timing->refills != 0u) ? (uint32_t)(total / timing->refills) : 0u;
+  timing->cpu_hz = SystemCoreClock;
+}
+
+int32_t DAC8568_DMA_EnableVerify(const DAC8568_VerifyConfig_t *cfg) {
+#if (DAC8568_VERIFY_ENABLE != 0)
+  g_verify_on = 0u;
+  g_verify_live = 0u;
+  DAC8568_ADC_Stop();
+  if (cfg == NULL) {
+    return 0;
+  }
+  if (DAC8568_Verify_Configure(&g_verify, cfg, DAC8568_SAMPLES_PER_HALF * 2u) != 0) {
+    return -1;
+  }
+  if (DAC8568_ADC_Init() != 0) {
+    return -2;
+  }
+  g_verify_on = 1u;
   return 0;
+#else
+  (void)cfg;
+  return -3;
+#endif
+}
+
+void DAC8568_DMA_VerifyCalibrate(void) {
+#if (DAC8568_VERIFY_ENABLE != 0)
+  g_verify_cal_pending = 1u;
+#endif
+}
+
+bool DAC8568_DMA_GetVerify(DAC8568_VerifyStats_t *stats, DAC8568_VerifyConfig_t *cfg) {
+#if (DAC8568_VERIFY_ENABLE != 0)
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (stats != NULL) {
+    DAC8568_Verify_GetStats(&g_verify, stats);
+  }
+  if (cfg != NULL) {
+    *cfg = g_verify.cfg;
+  }
+  if (primask == 0u) {
+    __enable_irq();
+  }
+  return g_verify_live != 0u;
+#else
+  (void)stats;
+  (void)cfg;
+  return false;
+#endif
+}
+
+bool DAC8568_DMA_PollSwitchEvent(DAC8568_SwitchEvent_t *event) {
+  const uint32_t tail = g_switch_event_tail;
+
+  if (event == NULL || tail == g_switch_event_head) {
+    return false;
+  }
+  __COMPILER_BARRIER();
+  *event = g_switch_events[tail & (DAC8568_SWITCH_EVENT_QUEUE - 1u)];
+  __COMPILER_BARRIER();
+  g_switch_event_tail = tail + 1u;
+  return true;
+}
+
+uint64_t DAC8568_DMA_GetTimeUs(void) {
+  return dac8568_time_us();
+}
+
+void DAC8568_DMA_MarkerIRQHandler(void) {
+#if (DAC8568_MARKER_ENABLE != 0u)
+  if ((DAC8568_TIMEBASE->DIER & TIM_DIER_CC1IE) == 0u || (DAC8568_TIMEBASE->SR & TIM_SR_CC1IF) == 0u) {
+    return;
+  }
+  DAC8568_TIMEBASE->SR = ~TIM_SR_CC1IF;
+
+  if (g_marker_armed == 2u) {
+    /* The compare just drove the pin high at the switch sample; end the pulse. */
+    DAC8568_TIMEBASE->CCMR1 = (DAC8568_TIMEBASE->CCMR1 & ~TIM_CCMR1_OC1M) | TIM_OCMODE_FORCED_INACTIVE;
+    DAC8568_TIMEBASE->DIER &= ~TIM_DIER_CC1IE;
+    g_marker_armed = 0u;
+    return;
+  }
+  /* CCR1 matches once per millisecond; wait for the armed one. */
+  const uint64_t now_us = dac8568_time_us();
+  if ((int32_t)((uint32_t)(now_us / 1000u) - g_marker_ms) < 0) {
+    return;
+  }
+
+  /* Re-aim at the switch sample from the DMA position read now (< LEAD_US + latency ahead). */
+  const int32_t ahead = (int32_t)(g_marker_sample - dac8568_get_tx_sample_counter());
+  if (g_stream_running == 0u || ahead < 0) {
+    DAC8568_TIMEBASE->DIER &= ~TIM_DIER_CC1IE;
+    g_marker_armed = 0u;
+    return;
+  }
+  uint64_t at_us = now_us + ((uint64_t)(uint32_t)ahead * 1000000u + g_sample_rate_hz / 2u) / g_sample_rate_hz;
+  if (at_us < now_us + 2u) {
+    at_us = now_us + 2u; /* CNT must not pass CCR1 before the write lands */
+  }
+  DAC8568_TIMEBASE->CCR1 = (uint32_t)(at_us % 1000u);
+  DAC8568_TIMEBASE->CCMR1 = (DAC8568_TIMEBASE->CCMR1 & ~TIM_CCMR1_OC1M) | TIM_OCMODE_ACTIVE;
+  DAC8568_TIMEBASE->SR = ~TIM_SR_CC1IF;
+  g_marker_armed = 2u;
+#endif
 }
 
 uint8_t DAC8568_DMA_GetActiveQspiSource(void) {
-  return g_qspi_active_source;
+  return g_stream.active_source;
 }
 
 void DAC8568_DMA_UseBuiltInWave(void) {
@@ -806,14 +1702,9 @@ void DAC8568_DMA_UseBuiltInWave(void) {
     (void)HAL_SPI_Abort(&hspi1);
   }
 
-  g_source_mode = DAC8568_SOURCE_LUT;
-  for (uint32_t i = 0u; i < DAC8568_QSPI_SOURCE_MAX; i++) {
-    g_qspi_wave_data[i] = NULL;
-    g_qspi_wave_samples[i] = 0u;
-    g_qspi_wave_index[i] = 0u;
-  }
-  g_qspi_active_source = 0u;
-  g_qspi_switch.pending = 0u;
+  g_stream.mode = DAC8568_SOURCE_LUT;
+  DAC8568_Playlist_Stop(&g_playlist, NULL);
+  DAC8568_Stream_ClearSources(&g_stream);
 
   if (restart_stream != 0u) {
     DAC8568_DMA_Start();
@@ -821,7 +1712,7 @@ void DAC8568_DMA_UseBuiltInWave(void) {
 }
 
 DAC8568_SourceMode_t DAC8568_DMA_GetSourceMode(void) {
-  return g_source_mode;
+  return g_stream.mode;
 }
 
 void DAC8568_OutputFixedVoltage(float voltage) {
@@ -829,16 +1720,11 @@ void DAC8568_OutputFixedVoltage(float voltage) {
     return;
   }
 
-  uint16_t code = dac8568_voltage_to_code(voltage);
-  uint32_t a = dac8568_build_frame32(DAC8568_CMD_WRITE_INPUT, DAC8568_CHANNEL_A, code);
-  uint32_t b = dac8568_build_frame32(DAC8568_CMD_WRITE_INPUT, DAC8568_CHANNEL_B, code);
-  uint32_t c = dac8568_build_frame32(DAC8568_CMD_WRITE_INPUT, DAC8568_CHANNEL_C, code);
-  uint32_t d = dac8568_build_frame32(DAC8568_CMD_WRITE_UPDATE_ALL, DAC8568_CHANNEL_D, code);
-
-  (void)dac8568_spi_tx_word32_blocking(a);
-  (void)dac8568_spi_tx_word32_blocking(b);
-  (void)dac8568_spi_tx_word32_blocking(c);
-  (void)dac8568_spi_tx_word32_blocking(d);
+  uint16_t code = DAC8568_Stream_VoltageToCode(voltage);
+  for (uint32_t ch = 0u; ch < DAC8568_CHANNELS; ch++) {
+    const uint8_t cmd = (ch == DAC8568_CHANNELS - 1u) ? DAC8568_CMD_WRITE_UPDATE_ALL : DAC8568_CMD_WRITE_INPUT;
+    (void)dac8568_spi_tx_word32_blocking(dac8568_build_frame32(cmd, (uint8_t)ch, code));
+  }
 
   /*
    * Some boards wire LDAC and expect a pulse to latch, even if UPDATE commands
@@ -4,24 +4,177 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-typedef enum {
-  DAC8568_SOURCE_LUT = 0,
-  DAC8568_SOURCE_QSPI = 1
-} DAC8568_SourceMode_t;
+#include "dac8568_playlist.h"
+#include "dac8568_stream.h"
+#include "dac8568_verify.h"
 
-/* QSPI waveform partitions: 0=normal, 1..6=faults */
-#ifndef DAC8568_QSPI_SOURCE_MAX
-#define DAC8568_QSPI_SOURCE_MAX 7u
+/* Live retime range; the upper bound is the SPI1 frame throughput (960k frames/s) per sample. */
+#ifndef DAC8568_SAMPLE_RATE_MIN_HZ
+#define DAC8568_SAMPLE_RATE_MIN_HZ 1000u
 #endif
+#ifndef DAC8568_SAMPLE_RATE_MAX_HZ
+#define DAC8568_SAMPLE_RATE_MAX_HZ (960000u / DAC8568_WORDS_PER_SAMPLE)
+#endif
+
+/* Source ids that can hold a procedural (SYNTH) wave: the seven built-in kinds. */
+#ifndef DAC8568_SYNTH_SOURCE_MAX
+#define DAC8568_SYNTH_SOURCE_MAX 7u
+#endif
+
+typedef struct {
+  uint32_t refills;
+  uint32_t mdma_refills;         /* refills handed to the MDMA (FRAME32 sources) */
+  uint32_t mdma_errors;          /* MDMA start/transfer errors (CPU copy used instead) */
+  uint32_t late;                 /* refill finished after the DMA re-entered the half */
+  uint32_t last_samples;         /* samples the DMA consumed while the last refill ran */
+  uint32_t max_samples;
+  uint32_t min_headroom_samples; /* smallest margin left before the DMA wrapped */
+  uint32_t switch_late;          /* timed (playlist) switches applied after their sample */
+  uint32_t ring_slots;           /* 2 = half/full refills */
+  uint32_t ring_lead;
+  uint32_t ring_slot_samples;
+  uint32_t sample_rate_hz;
+} DAC8568_RefillStats_t;
+
+/*
+ * Refill duration histogram: bin 0 counts refills under 2^SHIFT CPU cycles,
+ * bin i the range [2^(SHIFT+i-1), 2^(SHIFT+i)), the last bin everything above
+ * (1024 cycles is about 2 us at 480 MHz, the last bin starts near 1 ms).
+ */
+#ifndef DAC8568_TIMING_HIST_BINS
+#define DAC8568_TIMING_HIST_BINS 12u
+#endif
+#ifndef DAC8568_TIMING_HIST_SHIFT
+#define DAC8568_TIMING_HIST_SHIFT 10u
+#endif
+
+/*
+ * Refill timing from the DWT cycle counter, from the half/full (or slot)
+ * callback until the block is in the TX ring (MDMA refills: until the MDMA
+ * completion IRQ). margin is how many samples the SPI TX DMA still had to play
+ * (from NDTR) before reaching the refilled block when it was done; an underrun
+ * is a refill the DMA had already started reading, i.e. at least one stale
+ * frame went out. Reset by DAC8568_DMA_Start().
+ */
+typedef struct {
+  uint32_t refills;
+  uint32_t min_cycles;
+  uint32_t max_cycles;
+  uint32_t mean_cycles;
+  uint32_t last_cycles;
+  uint32_t hist[DAC8568_TIMING_HIST_BINS];
+  uint32_t last_ndtr_words;      /* NDTR when the last refill completed */
+  uint32_t last_margin_samples;
+  uint32_t min_margin_samples;
+  uint32_t underruns;
+  uint32_t cpu_hz;               /* SystemCoreClock, to convert the cycle counts */
+} DAC8568_RefillTiming_t;
+
+/*
+ * Source switch event, published by the refill each time a source is armed.
+ * `sample` is on the DAC8568_DMA_GetSampleCounter() scale: the SPI TX DMA
+ * fetches the first frame of `to_source` when the counter reaches it.
+ * `time_us` is that instant on the DAC8568_DMA_GetTimeUs() clock, predicted
+ * from the counter at publish time (exact to about one sample unless the
+ * rate is changed by DAC8568_DMA_Retime() in between). A gap in `seq` means
+ * events were dropped because the ring was full.
+ */
+#define DAC8568_SWITCH_EVENT_RETURN 0x01u /* release tail ended, back to source 0 */
+#define DAC8568_SWITCH_EVENT_MARKER 0x02u /* a DAC8568_MARKER pulse was scheduled for it */
+
+#ifndef DAC8568_SWITCH_EVENT_QUEUE
+#define DAC8568_SWITCH_EVENT_QUEUE 32u
+#endif
+
+typedef struct {
+  uint32_t seq;
+  uint8_t from_source;
+  uint8_t to_source;
+  uint8_t flags;
+  uint32_t sample;
+  uint64_t time_us;
+} DAC8568_SwitchEvent_t;
+
+/*
+ * Optional scope marker: a pulse on DAC8568_MARKER_GPIO_Port / DAC8568_MARKER_Pin
+ * whose rising edge is the TX DMA reaching the first sample of each switch.
+ * The pin must be a TIM17_CH1 pin (PB9 or PF7, e.g. CubeMX user label
+ * DAC8568_MARKER); Init() switches it to that alternate function. TIM17 (HAL
+ * timebase) CC1 wakes DAC8568_MARKER_LEAD_US early, the IRQ re-aims CC1 at
+ * the switch sample from the DMA position and the output compare sets the
+ * pin (1 us resolution); the next CC1 IRQ clears it. No waiting in the IRQ;
+ * one marker is pending at a time.
+ */
+#ifndef DAC8568_MARKER_ENABLE
+#define DAC8568_MARKER_ENABLE 0u
+#endif
+#ifndef DAC8568_MARKER_LEAD_US
+#define DAC8568_MARKER_LEAD_US 20u
+#endif
+#ifndef DAC8568_MARKER_AF
+#define DAC8568_MARKER_AF GPIO_AF1_TIM17
+#endif
+
+/* One playlist step on a QSPI partition; duration_ms = 0 holds it (last step only). */
+typedef struct {
+  uint8_t source_id;
+  uint8_t format;
+  bool reset_index;
+  uint16_t repeat;
+  uint32_t qspi_mmap_addr;
+  uint32_t sample_count;
+  uint32_t duration_ms;
+} DAC8568_PlaylistStep_t;
 
 void DAC8568_DMA_Init(uint32_t sample_rate_hz);
 void DAC8568_DMA_Start(void);
 void DAC8568_DMA_OnTimerTick(void);
 void DAC8568_DMA_OnTxComplete(void);
+/*
+ * tx_ok: refilled samples written before the DMA reached them; a block that
+ * underran (DAC8568_RefillTiming_t.underruns) is not counted. The stream
+ * position itself is DAC8568_DMA_GetSampleCounter().
+ */
 void DAC8568_DMA_GetStats(uint32_t *tx_ok, uint32_t *tx_fail,
                            uint32_t *tick_skip);
 void DAC8568_OutputFixedVoltage(float voltage);
+/* Rate used by the next DAC8568_DMA_Start(); TIM12 is not touched. */
 void DAC8568_DMA_UpdateSampleRate(uint32_t sample_rate_hz);
+/*
+ * Change the playback rate of a running stream without stopping the DMA or
+ * touching the DAC: TIM12 PSC/ARR switch at the next update event and every
+ * source continues from its current sample (LUT phases stay continuous).
+ * Samples already in the TX ring (up to one half, or `lead` slots) play at
+ * the new rate, and queued playlist durations keep their sample counts.
+ * Returns 0, -1 outside DAC8568_SAMPLE_RATE_MIN_HZ..MAX_HZ, -2 when the slot
+ * ring is too fine for the new rate (see DAC8568_DMA_ConfigureRing()).
+ */
+int32_t DAC8568_DMA_Retime(uint32_t sample_rate_hz);
+uint32_t DAC8568_DMA_GetSampleRate(void);
+/*
+ * Time-stretch one QSPI source (id < DAC8568_QSPI_SOURCE_MAX) by a Q16.16 ratio,
+ * e.g. 0x8000 = 0.5x, 0x15EB8 = 1.37x; DAC8568_STREAM_SPEED_ONE restores the
+ * plain (MDMA-eligible) copy. To play a partition at its recorded rate on a
+ * different TIM12 rate use recorded_hz * 65536 / DAC8568_DMA_GetSampleRate().
+ * Takes effect at the next refill; returns 0 or -1 for a bad id / speed.
+ */
+int32_t DAC8568_DMA_SetSourceSpeed(uint8_t source_id, uint32_t speed_q16, DAC8568_Interp_t interp);
+/*
+ * Loop markers of one source from its wave header v2 (SD_DacWaveInfo_t
+ * loop_start / loop_end / loop_flags, see DAC8568_LOOP_ONE_SHOT); loop_end = 0
+ * loops the whole partition. Kept across switches, used from the next switch
+ * to the source. Returns 0 or -1 for a bad id / loop_start >= loop_end.
+ */
+int32_t DAC8568_DMA_SetSourceLoop(uint8_t source_id, uint32_t loop_start, uint32_t loop_end, uint8_t flags);
+/*
+ * Output channel map (gain about 0 V / offset / mute / routing, see
+ * DAC8568_ChannelMap_t), e.g. gain_q15 = 0x6000 plays one partition at 75 %
+ * severity. NULL restores the identity map. Takes effect at the next refill;
+ * a non-identity map moves FRAME32 refills from the MDMA to the CPU.
+ * Returns 0 or -1 for an out-of-range field.
+ */
+int32_t DAC8568_DMA_SetChannelMap(const DAC8568_ChannelMap_t *map);
+void DAC8568_DMA_GetChannelMap(DAC8568_ChannelMap_t *map);
 void DAC8568_DMA_GetTickCounter(uint32_t *tick_count);
 void DAC8568_DMA_GetSampleCounter(uint32_t *sample_count);
 void DAC8568_DMA_Service(void);
@@ -30,10 +183,103 @@ uint32_t DAC8568_DMA_GetManualRecoverCount(void);
 void DAC8568_DMA_GetHealth(uint32_t *recover_count, uint32_t *recover_reason,
                            uint32_t *ref_rearm_count, uint32_t *ref_refresh_count,
                            uint32_t *stagnant_count);
+/*
+ * format: DAC8568_WAVE_FORMAT_CODE16x4 ("D8CW"), DAC8568_WAVE_FORMAT_FRAME32 ("DACW"),
+ * DAC8568_WAVE_FORMAT_ZCODE16x4 ("D8CZ", address of the block table, never clamped:
+ * -4 when the table does not fit the mapped window)
+ * or DAC8568_WAVE_FORMAT_SYNTH: play the synth loaded for the source id with
+ * DAC8568_DMA_LoadSynth() (address / count ignored, -4 when none is loaded).
+ * The address may also be an SDRAM copy; -8 for QSPI while it is detached.
+ */
 int32_t DAC8568_DMA_UseQspiWave(uint32_t qspi_mmap_addr, uint32_t sample_count,
-                                uint32_t sample_rate_hz);
+                                uint8_t format, uint32_t sample_rate_hz);
+/*
+ * Queue a switch to source_id for the next refill. Switches are posted
+ * lock-free, so every call that queues one (Request / Release, playlists,
+ * Detach / Attach) must come from the same task (Main_Task). Returns 0,
+ * -1..-5 / -8 for the source (see DAC8568_DMA_StartPlaylist), -6 queue full.
+ */
 int32_t DAC8568_DMA_RequestQspiWave(uint8_t source_id, uint32_t qspi_mmap_addr,
-                                   uint32_t sample_count, bool reset_index);
+                                   uint32_t sample_count, uint8_t format, bool reset_index);
+/*
+ * End the sustain loop of the playing fault: it runs to its next loop_end,
+ * plays the release tail and returns to source 0 by itself (baseline phase
+ * kept, configured transition). Ordered with RequestQspiWave(); returns 0 or
+ * -6 when the switch queue is full.
+ */
+int32_t DAC8568_DMA_ReleaseQspiWave(void);
+/*
+ * Staged wave update: keep streaming while QSPI leaves memory-mapped mode.
+ * DetachQspi() plays source 0 from a RAM copy of its payload (SDRAM,
+ * 0xC0000000..0xC1000000, written by the caller; the D-cache is cleaned here),
+ * stops the playlist and drops queued switches; from then on every request
+ * for a QSPI address returns -8. Wait for IsQspiIdle() (switch landed, no
+ * transition or MDMA copy still reading QSPI) before leaving memory-mapped
+ * mode. AttachQspi() re-enables QSPI sources and moves source 0 to its
+ * (re-synced) partition; the index is kept when the length is unchanged.
+ * Both return 0, the RequestQspiWave codes, or -6 when the queue is full.
+ */
+int32_t DAC8568_DMA_DetachQspi(const void *ram_copy, uint32_t bytes, uint32_t sample_count, uint8_t format);
+bool DAC8568_DMA_IsQspiIdle(void);
+int32_t DAC8568_DMA_AttachQspi(uint32_t qspi_mmap_addr, uint32_t sample_count, uint8_t format);
+bool DAC8568_DMA_IsQspiDetached(void);
+/*
+ * Load / edit the procedural waveform of one source id (see dac8568_synth.h),
+ * e.g. DAC8568_Synth_DefaultParams(&p, DAC8568_SYNTH_BUS_GROUND, 102400, 524280),
+ * then p.u.bus_ground.sag_us = 8000. A source that is playing keeps its
+ * position and picks the new parameters up at the next refill. Task context
+ * (Configure uses exp()); returns 0, -3 bad id (>= DAC8568_SYNTH_SOURCE_MAX),
+ * -7 invalid parameters.
+ */
+int32_t DAC8568_DMA_LoadSynth(uint8_t source_id, const DAC8568_SynthParams_t *params);
+/*
+ * Blend used for every later source switch (RequestQspiWave and playlists):
+ * HARD (default) or LINEAR / RAISED_COSINE over duration_us, kept in step with
+ * the sample rate. LUT (built-in) output always switches hard.
+ */
+void DAC8568_DMA_SetTransition(DAC8568_Transition_t mode, uint32_t duration_us);
+/*
+ * Refill ring geometry (see dac8568_ring.h): slots = 2 keeps the half/full
+ * refills, 4..DAC8568_RING_SLOTS_MAX refills `lead` slots ahead of the DMA
+ * from a TIM7 interrupt once per slot. Restarts the stream if it is running.
+ * Returns 0, -1 for an invalid geometry, -2 when the service cannot keep up at
+ * the current sample rate (lead < 2 or more than DAC8568_RING_SERVICE_MAX_HZ
+ * slots per second; Start() also falls back to half/full refills in that case).
+ */
+int32_t DAC8568_DMA_ConfigureRing(uint32_t slots, uint32_t lead);
+/* TIM7 update (stm32h7xx_it.c): slot refill service; no-op in half/full mode. */
+void DAC8568_DMA_RingIRQHandler(void);
+/*
+ * Sample-accurate segment sequencing; durations are converted at the current
+ * sample rate. Steps are queued ahead by DAC8568_DMA_Service() (Main_Task).
+ * Returns 0 or, for the first offending step: -1 address neither QSPI nor
+ * SDRAM, -2 sample_count 0, -3 bad source id, -4 nothing playable (window
+ * too small, synth not loaded), -5 bad format, -8 QSPI address while detached;
+ * -6 bad list (empty, too long, duration out of range).
+ */
+int32_t DAC8568_DMA_StartPlaylist(const DAC8568_PlaylistStep_t *steps, uint32_t count);
+void DAC8568_DMA_StopPlaylist(void);
+bool DAC8568_DMA_IsPlaylistActive(void);
+void DAC8568_DMA_GetRefillStats(DAC8568_RefillStats_t *stats);
+void DAC8568_DMA_GetTiming(DAC8568_RefillTiming_t *timing);
+/*
+ * Closed-loop output check (dac8568_adc.h, built with DAC8568_VERIFY_ENABLE):
+ * ADC1 scans the probes every cfg->decim samples and DAC8568_DMA_Service()
+ * compares them with the codes the refill queued. Takes effect at the next
+ * DAC8568_DMA_Start(); DAC8568_DMA_Retime() pauses it until then. NULL turns
+ * it off. Returns 0, -1 bad cfg, -2 ADC did not come up, -3 not built in.
+ */
+int32_t DAC8568_DMA_EnableVerify(const DAC8568_VerifyConfig_t *cfg);
+/* Refit the probe models (applied by the next DAC8568_DMA_Service()); output must be known good. */
+void DAC8568_DMA_VerifyCalibrate(void);
+/* Stats and current model (after calibration); false while the check is off or paused. */
+bool DAC8568_DMA_GetVerify(DAC8568_VerifyStats_t *stats, DAC8568_VerifyConfig_t *cfg);
+/* Oldest unread switch event; one consumer task. Returns false when empty. */
+bool DAC8568_DMA_PollSwitchEvent(DAC8568_SwitchEvent_t *event);
+/* Microseconds since reset from the HAL timebase (HAL_GetTick() ms + TIM17 count). */
+uint64_t DAC8568_DMA_GetTimeUs(void);
+/* TIM17_IRQHandler, before HAL_TIM_IRQHandler(); no-op unless DAC8568_MARKER_ENABLE. */
+void DAC8568_DMA_MarkerIRQHandler(void);
 uint8_t DAC8568_DMA_GetActiveQspiSource(void);
 void DAC8568_DMA_UseBuiltInWave(void);
 DAC8568_SourceMode_t DAC8568_DMA_GetSourceMode(void);
@@ -0,0 +1,164 @@
+#include "dac8568_mdma.h"
+
+#include "main.h"
+
+#include <stddef.h>
+
+#define DAC8568_MDMA_BYTES_PER_SAMPLE (DAC8568_WORDS_PER_SAMPLE * (uint32_t)sizeof(uint32_t))
+
+static MDMA_HandleTypeDef g_mdma;
+/* Nodes are fetched by the MDMA itself: keep them in D2 SRAM next to g_tx_buf and clean after patching. */
+__attribute__((section(".ram_d2"), aligned(32))) static MDMA_LinkNodeTypeDef g_mdma_nodes[DAC8568_MDMA_NODE_MAX];
+static DAC8568_MDMA_DoneCallback_t g_mdma_on_done = NULL;
+static volatile uint8_t g_mdma_busy = 0u;
+static uint8_t g_mdma_ready = 0u;
+
+static void dac8568_mdma_xfer_cplt(MDMA_HandleTypeDef *hmdma) {
+  (void)hmdma;
+  g_mdma_busy = 0u;
+  if (g_mdma_on_done != NULL) {
+    g_mdma_on_done(0u);
+  }
+}
+
+static void dac8568_mdma_xfer_error(MDMA_HandleTypeDef *hmdma) {
+  (void)hmdma;
+  g_mdma_busy = 0u;
+  if (g_mdma_on_done != NULL) {
+    g_mdma_on_done(1u);
+  }
+}
+
+void DAC8568_MDMA_Init(DAC8568_MDMA_DoneCallback_t on_done) {
+  MDMA_LinkNodeConfTypeDef node_conf = {0};
+
+  g_mdma_ready = 0u;
+  g_mdma_busy = 0u;
+  g_mdma_on_done = on_done;
+
+  __HAL_RCC_MDMA_CLK_ENABLE();
+
+  g_mdma.Instance = MDMA_Channel2;
+  g_mdma.Init.Request = MDMA_REQUEST_SW;
+  g_mdma.Init.TransferTriggerMode = MDMA_FULL_TRANSFER; /* run the whole list on one SW request */
+  g_mdma.Init.Priority = MDMA_PRIORITY_HIGH;
+  g_mdma.Init.Endianness = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+  g_mdma.Init.SourceInc = MDMA_SRC_INC_WORD;
+  g_mdma.Init.DestinationInc = MDMA_DEST_INC_WORD;
+  g_mdma.Init.SourceDataSize = MDMA_SRC_DATASIZE_WORD;
+  g_mdma.Init.DestDataSize = MDMA_DEST_DATASIZE_WORD;
+  g_mdma.Init.DataAlignment = MDMA_DATAALIGN_PACKENABLE;
+  g_mdma.Init.BufferTransferLength = 128;
+  g_mdma.Init.SourceBurst = MDMA_SOURCE_BURST_SINGLE;
+  g_mdma.Init.DestBurst = MDMA_DEST_BURST_SINGLE;
+  g_mdma.Init.SourceBlockAddressOffset = 0;
+  g_mdma.Init.DestBlockAddressOffset = 0;
+  if (HAL_MDMA_Init(&g_mdma) != HAL_OK) {
+    return;
+  }
+
+  /* Build the node pool once; StartCopy only patches addresses, length and link. */
+  node_conf.Init = g_mdma.Init;
+  node_conf.SrcAddress = 0x90000000u;
+  node_conf.DstAddress = (uint32_t)(uintptr_t)&g_mdma_nodes[0];
+  node_conf.BlockDataLength = DAC8568_MDMA_BYTES_PER_SAMPLE;
+  node_conf.BlockCount = 1u;
+  node_conf.PostRequestMaskAddress = 0u;
+  node_conf.PostRequestMaskData = 0u;
+  for (uint32_t i = 0u; i < DAC8568_MDMA_NODE_MAX; i++) {
+    if (HAL_MDMA_LinkedList_CreateNode(&g_mdma_nodes[i], &node_conf) != HAL_OK) {
+      return;
+    }
+  }
+
+  (void)HAL_MDMA_RegisterCallback(&g_mdma, HAL_MDMA_XFER_CPLT_CB_ID, dac8568_mdma_xfer_cplt);
+  (void)HAL_MDMA_RegisterCallback(&g_mdma, HAL_MDMA_XFER_ERROR_CB_ID, dac8568_mdma_xfer_error);
+  g_mdma_ready = 1u;
+}
+
+int32_t DAC8568_MDMA_StartCopy(void *dst, const DAC8568_StreamSpan_t *spans, uint32_t span_count,
+                               uint32_t sample_bytes) {
+  uint32_t first_src = 0u;
+  uint32_t first_len = 0u;
+  uint32_t node_count = 0u;
+  uint32_t total_bytes = 0u;
+  uintptr_t out = (uintptr_t)dst;
+
+  if (g_mdma_ready == 0u || dst == NULL || spans == NULL || span_count == 0u || (sample_bytes & 3u) != 0u) {
+    return -1;
+  }
+  if (g_mdma_busy != 0u) {
+    return -2;
+  }
+
+  /* Channel registers carry the first chunk; every further chunk (64KB split or wrap) is a node. */
+  for (uint32_t i = 0u; i < span_count; i++) {
+    uintptr_t src = (uintptr_t)spans[i].src;
+    uint32_t bytes = spans[i].samples * sample_bytes;
+
+    while (bytes > 0u) {
+      uint32_t chunk = (bytes > DAC8568_MDMA_NODE_MAX_BYTES) ? DAC8568_MDMA_NODE_MAX_BYTES : bytes;
+      if (first_len == 0u) {
+        first_src = (uint32_t)src;
+        first_len = chunk;
+      } else {
+        if (node_count >= DAC8568_MDMA_NODE_MAX) {
+          return -3;
+        }
+        MDMA_LinkNodeTypeDef *node = &g_mdma_nodes[node_count];
+        node->CSAR = (uint32_t)src;
+        node->CDAR = (uint32_t)out;
+        node->CBNDTR = (node->CBNDTR & ~(MDMA_CBNDTR_BNDT | MDMA_CBNDTR_BRC)) | (chunk & MDMA_CBNDTR_BNDT);
+        node->CLAR = 0u;
+        if (node_count > 0u) {
+          g_mdma_nodes[node_count - 1u].CLAR = (uint32_t)(uintptr_t)node;
+        }
+        node_count++;
+      }
+      src += chunk;
+      out += chunk;
+      bytes -= chunk;
+      total_bytes += chunk;
+    }
+  }
+
+  SCB_CleanDCache_by_Addr((uint32_t *)(uintptr_t)g_mdma_nodes, (int32_t)sizeof(g_mdma_nodes));
+
+  /*
+   * The MDMA writes behind the D-cache. A TX half was cleaned after its last CPU
+   * fill and the staging buffer is only ever read by the CPU, so dropping their
+   * lines here loses nothing; the line shared with the other half at the
+   * 16-byte-aligned boundary is clean for the same reason.
+   */
+  {
+    uintptr_t inv_start = (uintptr_t)dst & ~(uintptr_t)31u;
+    uintptr_t inv_end = ((uintptr_t)dst + total_bytes + 31u) & ~(uintptr_t)31u;
+    SCB_InvalidateDCache_by_Addr((uint32_t *)inv_start, (int32_t)(inv_end - inv_start));
+  }
+
+  g_mdma.Instance->CLAR = (node_count > 0u) ? (uint32_t)(uintptr_t)&g_mdma_nodes[0] : 0u;
+  g_mdma_busy = 1u;
+  if (HAL_MDMA_Start_IT(&g_mdma, first_src, (uint32_t)(uintptr_t)dst, first_len, 1u) != HAL_OK) {
+    g_mdma_busy = 0u;
+    return -4;
+  }
+  return 0;
+}
+
+uint8_t DAC8568_MDMA_IsBusy(void) {
+  return g_mdma_busy;
+}
+
+void DAC8568_MDMA_Abort(void) {
+  if (g_mdma_ready == 0u || g_mdma_busy == 0u) {
+    return;
+  }
+  (void)HAL_MDMA_Abort(&g_mdma);
+  g_mdma_busy = 0u;
+}
+
+void DAC8568_MDMA_IRQHandler(void) {
+  if (g_mdma_ready != 0u) {
+    HAL_MDMA_IRQHandler(&g_mdma);
+  }
+}
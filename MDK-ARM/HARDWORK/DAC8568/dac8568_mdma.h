@@ -0,0 +1,39 @@
+#ifndef DAC8568_MDMA_H
+#define DAC8568_MDMA_H
+
+#include <stdint.h>
+
+#include "dac8568_stream.h"
+
+/*
+ * MDMA refill engine: copies the planned spans out of memory-mapped QSPI with
+ * a linked list (one node per <=64KB chunk, extra nodes for source
+ * wrap-around), so the SPI half/full callbacks no longer stall on QSPI cache
+ * misses. FRAME32 spans go straight into the free part of g_tx_buf; CODE16x4
+ * spans go to an SRAM staging buffer that the completion packs into frames.
+ *
+ * MDMA_Channel0 = SDMMC1, MDMA_Channel1 = QUADSPI FIFO (indirect mode);
+ * the DAC refill uses MDMA_Channel2.
+ */
+#ifndef DAC8568_REFILL_MDMA
+#define DAC8568_REFILL_MDMA 1
+#endif
+
+/* BNDT is 17 bits: one block may move at most 64KB = 4096 FRAME32 / 8192 CODE16x4 samples (4 channels). */
+#define DAC8568_MDMA_NODE_MAX_BYTES 0x10000u
+#define DAC8568_MDMA_NODE_MAX 8u
+
+typedef void (*DAC8568_MDMA_DoneCallback_t)(uint8_t error);
+
+void DAC8568_MDMA_Init(DAC8568_MDMA_DoneCallback_t on_done);
+/*
+ * Copy the spans (sample_bytes each sample) back to back to dst. 0: transfer
+ * started, <0: busy / too many nodes / HAL error (caller copies with the CPU).
+ */
+int32_t DAC8568_MDMA_StartCopy(void *dst, const DAC8568_StreamSpan_t *spans, uint32_t span_count,
+                               uint32_t sample_bytes);
+uint8_t DAC8568_MDMA_IsBusy(void);
+void DAC8568_MDMA_Abort(void);
+void DAC8568_MDMA_IRQHandler(void);
+
+#endif
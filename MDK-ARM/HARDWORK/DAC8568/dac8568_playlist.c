@@ -0,0 +1,106 @@
+#include "dac8568_playlist.h"
+
+#include <stddef.h>
+#include <string.h>
+
+void DAC8568_Playlist_Init(DAC8568_Playlist_t *pl) {
+  if (pl == NULL) {
+    return;
+  }
+  memset(pl, 0, sizeof(*pl));
+}
+
+int32_t DAC8568_Playlist_Load(DAC8568_Playlist_t *pl, const DAC8568_PlaylistSegment_t *segments,
+                              uint32_t count) {
+  if (pl == NULL || segments == NULL || count == 0u || count > DAC8568_PLAYLIST_MAX) {
+    return -1;
+  }
+  for (uint32_t i = 0u; i < count; i++) {
+    const DAC8568_PlaylistSegment_t *seg = &segments[i];
+    if (seg->source_id >= DAC8568_QSPI_SOURCE_MAX || seg->data == NULL || seg->samples == 0u ||
+        seg->duration_samples > DAC8568_PLAYLIST_DURATION_MAX) {
+      return -2;
+    }
+    /* Only the last segment may hold, anything after it would never play. */
+    if (seg->duration_samples == 0u && (i + 1u) != count) {
+      return -2;
+    }
+  }
+
+  DAC8568_Playlist_Init(pl);
+  memcpy(pl->segments, segments, count * sizeof(segments[0]));
+  pl->count = (uint8_t)count;
+  return 0;
+}
+
+int32_t DAC8568_Playlist_Start(DAC8568_Playlist_t *pl, DAC8568_Stream_t *s) {
+  if (pl == NULL || s == NULL || pl->count == 0u) {
+    return -1;
+  }
+  DAC8568_Stream_FlushSwitches(s);
+  pl->cursor = 0u;
+  pl->repeat_done = 0u;
+  pl->hold = 0u;
+  pl->next_at = DAC8568_Stream_GetPosition(s);
+  pl->queuing = 1u;
+  pl->running = 1u;
+  (void)DAC8568_Playlist_Pump(pl, s);
+  return 0;
+}
+
+uint32_t DAC8568_Playlist_Pump(DAC8568_Playlist_t *pl, DAC8568_Stream_t *s) {
+  uint32_t queued = 0u;
+
+  if (pl == NULL || s == NULL) {
+    return 0u;
+  }
+  while (pl->queuing != 0u && DAC8568_Stream_SwitchQueueFree(s) > 0u) {
+    const DAC8568_PlaylistSegment_t *seg = &pl->segments[pl->cursor];
+    if (DAC8568_Stream_QueueSwitchAt(s, seg->source_id, seg->data, seg->samples, seg->format,
+                                     seg->reset_index, pl->next_at) != 0) {
+      break;
+    }
+    queued++;
+
+    if (seg->duration_samples == 0u) {
+      pl->queuing = 0u;
+      pl->hold = 1u;
+      break;
+    }
+    pl->next_at += seg->duration_samples;
+
+    const uint16_t repeat = (seg->repeat == 0u) ? 1u : seg->repeat;
+    pl->repeat_done++;
+    if (pl->repeat_done >= repeat) {
+      pl->repeat_done = 0u;
+      pl->cursor++;
+      if (pl->cursor >= pl->count) {
+        /* Last source keeps playing after next_at; IsActive() reports the end. */
+        pl->queuing = 0u;
+      }
+    }
+  }
+  return queued;
+}
+
+void DAC8568_Playlist_Stop(DAC8568_Playlist_t *pl, DAC8568_Stream_t *s) {
+  if (pl == NULL) {
+    return;
+  }
+  pl->running = 0u;
+  pl->queuing = 0u;
+  pl->hold = 0u;
+  if (s != NULL) {
+    DAC8568_Stream_FlushSwitches(s);
+  }
+}
+
+uint8_t DAC8568_Playlist_IsActive(const DAC8568_Playlist_t *pl, const DAC8568_Stream_t *s) {
+  if (pl == NULL || s == NULL || pl->running == 0u) {
+    return 0u;
+  }
+  if (pl->queuing != 0u || pl->hold != 0u) {
+    return 1u;
+  }
+  return ((int32_t)(pl->next_at - DAC8568_Stream_GetPosition(s)) > 0) ? 1u : 0u;
+}
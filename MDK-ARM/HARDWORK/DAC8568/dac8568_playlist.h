@@ -0,0 +1,62 @@
+#ifndef DAC8568_PLAYLIST_H
+#define DAC8568_PLAYLIST_H
+
+/*
+ * HAL-free playlist sequencer on top of the stream switch queue.
+ *
+ * A playlist is a list of segments (source, duration in samples, repeat count),
+ * e.g. normal 2 s -> bus_ground 150 ms x3 -> insulation 3 s -> normal (hold).
+ * Segment starts are laid out on an absolute sample grid and queued as timed
+ * switches, so every boundary lands on an exact sample index inside the refill;
+ * Pump() only has to keep the queue topped up from task context.
+ */
+
+#include <stdint.h>
+
+#include "dac8568_stream.h"
+
+#ifndef DAC8568_PLAYLIST_MAX
+#define DAC8568_PLAYLIST_MAX 16u
+#endif
+
+/* Durations are compared with signed 32-bit differences on the stream position. */
+#define DAC8568_PLAYLIST_DURATION_MAX 0x7FFFFFFFu
+
+typedef struct {
+  uint8_t source_id;
+  uint8_t format;
+  uint8_t reset_index;       /* restart the source at every (repeated) segment start */
+  uint16_t repeat;           /* 0 is treated as 1 */
+  const void *data;
+  uint32_t samples;
+  uint32_t duration_samples; /* 0: hold this segment until Stop / the next Start */
+} DAC8568_PlaylistSegment_t;
+
+typedef struct {
+  DAC8568_PlaylistSegment_t segments[DAC8568_PLAYLIST_MAX];
+  uint8_t count;
+  uint8_t cursor;            /* next segment to queue */
+  uint16_t repeat_done;
+  uint8_t running;           /* started and not stopped */
+  uint8_t queuing;           /* segment starts left to queue */
+  uint8_t hold;              /* ended on a hold segment */
+  uint32_t next_at;          /* stream position of the next segment start */
+} DAC8568_Playlist_t;
+
+void DAC8568_Playlist_Init(DAC8568_Playlist_t *pl);
+/* 0: ok, -1: bad args / too many segments, -2: invalid segment. */
+int32_t DAC8568_Playlist_Load(DAC8568_Playlist_t *pl, const DAC8568_PlaylistSegment_t *segments,
+                              uint32_t count);
+/*
+ * Drop queued switches and lay the first segment at the next refill start.
+ * If the refill overtakes the call, the first segment starts late (counted in
+ * switch_late) but every later boundary stays on the grid.
+ */
+int32_t DAC8568_Playlist_Start(DAC8568_Playlist_t *pl, DAC8568_Stream_t *s);
+/* Queue as many upcoming segment starts as fit; returns the number queued. */
+uint32_t DAC8568_Playlist_Pump(DAC8568_Playlist_t *pl, DAC8568_Stream_t *s);
+void DAC8568_Playlist_Stop(DAC8568_Playlist_t *pl, DAC8568_Stream_t *s);
+/* 1 while segments remain to be queued or played (a hold segment never ends). */
+uint8_t DAC8568_Playlist_IsActive(const DAC8568_Playlist_t *pl, const DAC8568_Stream_t *s);
+
+#endif
@@ -0,0 +1,61 @@
+#include "dac8568_ring.h"
+
+#include <stddef.h>
+
+int32_t DAC8568_Ring_Configure(DAC8568_Ring_t *r, uint32_t slots, uint32_t lead,
+                               uint32_t buf_samples) {
+  if (r == NULL) {
+    return -1;
+  }
+  if (slots == 2u) {
+    r->slot_samples = buf_samples / 2u;
+    lead = 1u;
+  } else {
+    if (slots < 4u || slots > DAC8568_RING_SLOTS_MAX || lead < 1u || lead > (slots - 2u)) {
+      return -1;
+    }
+    r->slot_samples = (buf_samples / slots) & ~1u;
+  }
+  if (r->slot_samples == 0u) {
+    return -1;
+  }
+  r->slots = slots;
+  r->lead = lead;
+  r->ring_samples = r->slot_samples * slots;
+  DAC8568_Ring_Reset(r, 0u);
+  return 0;
+}
+
+void DAC8568_Ring_Reset(DAC8568_Ring_t *r, uint32_t filled) {
+  if (r == NULL) {
+    return;
+  }
+  r->filled = filled;
+  r->late = 0u;
+}
+
+int32_t DAC8568_Ring_NextDue(DAC8568_Ring_t *r, uint32_t read_slot) {
+  /* 正在读或已读过的槽来不及再填：跳过并计入 late，保持后续槽的时序。 */
+  if ((int32_t)(r->filled - read_slot) <= 0) {
+    r->late += read_slot + 1u - r->filled;
+    r->filled = read_slot + 1u;
+  }
+  if ((int32_t)(r->filled - (read_slot + r->lead)) > 0) {
+    return -1;
+  }
+  return (int32_t)(r->filled % r->slots);
+}
+
+void DAC8568_Ring_Commit(DAC8568_Ring_t *r) {
+  r->filled++;
+}
+
+uint8_t DAC8568_Ring_FitsRate(const DAC8568_Ring_t *r, uint32_t sample_rate_hz) {
+  if (r->slots == 2u) {
+    return 1u;
+  }
+  if (r->lead < 2u) {
+    return 0u;
+  }
+  return ((uint64_t)r->slot_samples * DAC8568_RING_SERVICE_MAX_HZ >= sample_rate_hz) ? 1u : 0u;
+}
@@ -0,0 +1,74 @@
+#ifndef DAC8568_RING_H
+#define DAC8568_RING_H
+
+/*
+ * HAL-free refill ring bookkeeping.
+ *
+ * The TX buffer is split into `slots` equal slots. slots = 2 is the original
+ * half/full scheme (refilled from the SPI DMA callbacks). With more slots the
+ * ring is refilled `lead` slots ahead of the slot the DMA is reading, from a
+ * timer interrupt once per slot; a source switch then reaches the output after about
+ * lead..lead+1 slots instead of one or two half buffers, while the buffer
+ * itself (and the circular DMA over it) stays the same.
+ *
+ * All positions are absolute slot counts (slot k lives at ring index k % slots).
+ */
+
+#include <stdint.h>
+
+
+#ifndef DAC8568_RING_SLOTS_MAX
+#define DAC8568_RING_SLOTS_MAX 512u
+#endif
+
+/*
+ * Build defaults for DAC8568_DMA_ConfigureRing(). 2 keeps the half/full refills
+ * in the SPI DMA callbacks; more slots (e.g. 256, lead 2) move them to the slot
+ * service interrupt (DAC8568_DMA_RingIRQHandler()).
+ */
+#ifndef DAC8568_RING_SLOTS
+#define DAC8568_RING_SLOTS 2u
+#endif
+#ifndef DAC8568_RING_LEAD
+#define DAC8568_RING_LEAD 2u
+#endif
+/* The slot service runs once per slot; cap its rate so tiny slots at high sample rates cannot flood the CPU. */
+#ifndef DAC8568_RING_SERVICE_MAX_HZ
+#define DAC8568_RING_SERVICE_MAX_HZ 10000u
+#endif
+
+typedef struct {
+  uint32_t slots;
+  uint32_t slot_samples;
+  uint32_t ring_samples; /* slots * slot_samples (<= the TX buffer) */
+  uint32_t lead;         /* slots kept filled ahead of the one being read */
+  uint32_t filled;       /* absolute slots written so far */
+  uint32_t late;         /* slots the DMA reached before they were refilled */
+} DAC8568_Ring_t;
+
+/*
+ * slots = 2: halves of `buf_samples`, lead forced to 1.
+ * slots = 4..DAC8568_RING_SLOTS_MAX: even slot size (32-byte aligned slots, so
+ * an MDMA write and a CPU clean never share a cache line), 1 <= lead <= slots - 2.
+ * Returns 0 or -1 for an invalid geometry.
+ */
+int32_t DAC8568_Ring_Configure(DAC8568_Ring_t *r, uint32_t slots, uint32_t lead,
+                               uint32_t buf_samples);
+/* After prefilling slots 0..filled-1. */
+void DAC8568_Ring_Reset(DAC8568_Ring_t *r, uint32_t filled);
+/*
+ * Ring index of the next slot to refill while the DMA reads absolute slot
+ * `read_slot`, or -1 when the ring is far enough ahead. Slots the DMA already
+ * reached are skipped and counted in `late`.
+ */
+int32_t DAC8568_Ring_NextDue(DAC8568_Ring_t *r, uint32_t read_slot);
+void DAC8568_Ring_Commit(DAC8568_Ring_t *r);
+/*
+ * 1 when the service can keep up at this sample rate: `lead` slots outlast one
+ * service period (one slot, so lead >= 2 whatever the service phase) and the slot
+ * rate stays within DAC8568_RING_SERVICE_MAX_HZ (always 1 for 2 slots, refilled
+ * from the DMA callbacks).
+ */
+uint8_t DAC8568_Ring_FitsRate(const DAC8568_Ring_t *r, uint32_t sample_rate_hz);
+
+#endif
@@ -0,0 +1,1115 @@
+#include "dac8568_stream.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * DAC8568IDPW(0~5V) + 运放移位放大：
+ * Vout = 4 * (Vi - 2.5V)
+ * 这里按“对外输出 ±5V”生成波形。
+ */
+#define DAC8568_MAX_VOLTAGE 5.0f
+#define DAC8568_MIN_VOLTAGE -5.0f
+#define DAC8568_VREF_MV 2500.0f
+
+#define LUT_BITS 10u
+#define LUT_SIZE (1u << LUT_BITS)
+#define LUT_PHASE_SHIFT (32u - LUT_BITS)
+
+#define WAVE_FREQ_A_HZ 12000.0
+#define WAVE_FREQ_B_HZ 6000.0
+#define WAVE_FREQ_C_HZ 3000.0
+#define WAVE_FREQ_D_HZ 1000.0
+
+#define DAC8568_SWITCH_MASK ((uint8_t)(DAC8568_STREAM_SWITCH_QUEUE - 1u))
+
+static uint16_t g_lut_sine[LUT_SIZE];
+static uint16_t g_lut_triangle[LUT_SIZE];
+static uint16_t g_lut_saw[LUT_SIZE];
+static uint16_t g_lut_square[LUT_SIZE];
+
+/* Raised-cosine weight (1 - cos(pi x)) / 2 in Q15, x = i / FADE_LUT_SIZE, +1 entry for interpolation. */
+#define FADE_LUT_BITS 8u
+#define FADE_LUT_SIZE (1u << FADE_LUT_BITS)
+#define FADE_Q15_ONE 32768u
+static uint16_t g_lut_fade[FADE_LUT_SIZE + 1u];
+
+/*
+ * Catmull-Rom taps for x[-1], x[1], x[2] at t = phase / INTERP_PHASES, Q16.
+ * The x[0] tap is implied: y = x0 + sum(h * (x - x0)), so DC gain is exact.
+ */
+#define INTERP_PHASE_BITS 6u
+#define INTERP_PHASES (1u << INTERP_PHASE_BITS)
+static int32_t g_interp_taps[INTERP_PHASES + 1u][3];
+
+static const uint32_t g_frame_prefix[DAC8568_WORDS_PER_SAMPLE] = {DAC8568_FRAME_PREFIXES};
+
+uint16_t DAC8568_Stream_VoltageToCode(float voltage) {
+  float clamped = voltage;
+  if (clamped > DAC8568_MAX_VOLTAGE) {
+    clamped = DAC8568_MAX_VOLTAGE;
+  } else if (clamped < DAC8568_MIN_VOLTAGE) {
+    clamped = DAC8568_MIN_VOLTAGE;
+  }
+
+  /* Vi = Vout/4 + 2.5V（运放前 DAC 输出电压） */
+  float real_voltage = clamped / 4.0f + 2.5f;
+  float scaled = (real_voltage / 2.0f) * 1000.0f / DAC8568_VREF_MV;
+  int32_t code = (int32_t)(scaled * 65535.0f + 0.5f);
+  if (code < 0) {
+    code = 0;
+  } else if (code > 65535) {
+    code = 65535;
+  }
+  return (uint16_t)code;
+}
+
+void DAC8568_Stream_PrepareLut(void) {
+  for (uint32_t i = 0u; i < LUT_SIZE; ++i) {
+    float phase = (2.0f * 3.1415926535f * (float)i) / (float)LUT_SIZE;
+
+    /* Sine */
+    float v_sine = DAC8568_MAX_VOLTAGE * sinf(phase);
+    g_lut_sine[i] = DAC8568_Stream_VoltageToCode(v_sine);
+
+    /* Triangle: -1..+1 */
+    float x = (float)i / (float)LUT_SIZE; /* 0..1 */
+    float tri = (x < 0.5f) ? (4.0f * x - 1.0f) : (3.0f - 4.0f * x);
+    g_lut_triangle[i] = DAC8568_Stream_VoltageToCode(DAC8568_MAX_VOLTAGE * tri);
+
+    /* Saw: -1..+1 */
+    float saw = 2.0f * x - 1.0f;
+    g_lut_saw[i] = DAC8568_Stream_VoltageToCode(DAC8568_MAX_VOLTAGE * saw);
+
+    /* Square: -1 / +1 */
+    float sq = (x < 0.5f) ? 1.0f : -1.0f;
+    g_lut_square[i] = DAC8568_Stream_VoltageToCode(DAC8568_MAX_VOLTAGE * sq);
+  }
+
+  for (uint32_t i = 0u; i <= FADE_LUT_SIZE; ++i) {
+    float w = 0.5f - 0.5f * cosf(3.1415926535f * (float)i / (float)FADE_LUT_SIZE);
+    g_lut_fade[i] = (uint16_t)(w * (float)FADE_Q15_ONE + 0.5f);
+  }
+
+  for (uint32_t p = 0u; p <= INTERP_PHASES; ++p) {
+    const float t = (float)p / (float)INTERP_PHASES;
+    const float t2 = t * t;
+    const float t3 = t2 * t;
+    const float h[3] = {
+      0.5f * (-t3 + 2.0f * t2 - t),
+      0.5f * (-3.0f * t3 + 4.0f * t2 + t),
+      0.5f * (t3 - t2),
+    };
+    for (uint32_t k = 0u; k < 3u; ++k) {
+      const float q = h[k] * 65536.0f;
+      g_interp_taps[p][k] = (int32_t)((q < 0.0f) ? (q - 0.5f) : (q + 0.5f));
+    }
+  }
+
+  DAC8568_Synth_Prepare();
+}
+
+void DAC8568_Stream_SetSampleRate(DAC8568_Stream_t *s, uint32_t sample_rate_hz) {
+  if (s == NULL || sample_rate_hz == 0u) {
+    return;
+  }
+  s->phase_inc[0] = (uint32_t)((WAVE_FREQ_A_HZ * 4294967296.0) / (double)sample_rate_hz);
+  s->phase_inc[1] = (uint32_t)((WAVE_FREQ_B_HZ * 4294967296.0) / (double)sample_rate_hz);
+  s->phase_inc[2] = (uint32_t)((WAVE_FREQ_C_HZ * 4294967296.0) / (double)sample_rate_hz);
+  s->phase_inc[3] = (uint32_t)((WAVE_FREQ_D_HZ * 4294967296.0) / (double)sample_rate_hz);
+}
+
+void DAC8568_Stream_ClearSources(DAC8568_Stream_t *s) {
+  if (s == NULL) {
+    return;
+  }
+  for (uint32_t i = 0u; i < DAC8568_QSPI_SOURCE_MAX; i++) {
+    s->qspi[i].data = NULL;
+    s->qspi[i].samples = 0u;
+    s->qspi[i].index = 0u;
+    s->qspi[i].format = DAC8568_WAVE_FORMAT_CODE16x4;
+    s->qspi[i].interp = (uint8_t)DAC8568_INTERP_LINEAR;
+    s->qspi[i].frac = 0u;
+    s->qspi[i].speed_q16 = DAC8568_STREAM_SPEED_ONE;
+    s->qspi[i].loop_start = 0u;
+    s->qspi[i].loop_end = 0u;
+    s->qspi[i].loop_flags = 0u;
+    s->qspi[i].released = 0u;
+  }
+  s->active_source = 0u;
+  s->switch_head = 0u;
+  s->switch_tail = 0u;
+  s->switch_flush = 0u;
+  s->switch_flush_to = 0u;
+  s->switch_late = 0u;
+  s->fade_len = 0u;
+  s->fade_pos = 0u;
+  s->return_pending = 0u;
+  s->return_at = 0u;
+}
+
+void DAC8568_Stream_Init(DAC8568_Stream_t *s, uint32_t sample_rate_hz) {
+  if (s == NULL) {
+    return;
+  }
+  s->mode = DAC8568_SOURCE_LUT;
+  for (uint32_t ch = 0u; ch < 4u; ch++) {
+    s->phase[ch] = 0u;
+    s->phase_inc[ch] = 0u;
+  }
+  DAC8568_Stream_ClearSources(s);
+  s->position = 0u;
+  s->transition = (uint8_t)DAC8568_TRANSITION_HARD;
+  s->transition_samples = 0u;
+  DAC8568_Stream_ChannelMapIdentity(&s->map);
+  s->map_active = 0u;
+  s->on_switch = NULL;
+  DAC8568_Stream_SetSampleRate(s, sample_rate_hz);
+}
+
+uint32_t DAC8568_Stream_BytesPerSample(uint8_t format) {
+  if (format == DAC8568_WAVE_FORMAT_FRAME32) {
+    return DAC8568_WORDS_PER_SAMPLE * (uint32_t)sizeof(uint32_t);
+  }
+  return DAC8568_WORDS_PER_SAMPLE * (uint32_t)sizeof(uint16_t);
+}
+
+/* 合成源与压缩源没有可随机读取的码值，只能按索引整段渲染成帧。 */
+static inline uint8_t dac8568_source_rendered(const DAC8568_StreamSource_t *src) {
+  return (src->format == DAC8568_WAVE_FORMAT_SYNTH) || (src->format == DAC8568_WAVE_FORMAT_ZCODE16x4);
+}
+
+/* 循环标记只在落在源数据内时生效，否则整段循环（v1 波形头）。 */
+static inline uint8_t dac8568_source_marked(const DAC8568_StreamSource_t *src) {
+  return (src->loop_end != 0u) && (src->loop_end <= src->samples) && (src->loop_start < src->loop_end);
+}
+
+/* Index the playback jumps back to at the wrap point. */
+static inline uint32_t dac8568_source_restart(const DAC8568_StreamSource_t *src) {
+  return (dac8568_source_marked(src) != 0u) ? src->loop_start : 0u;
+}
+
+/* Wrap point: loop_end while sustaining, the end of the source once released. */
+static inline uint32_t dac8568_source_end(const DAC8568_StreamSource_t *src) {
+  return (src->released == 0u && dac8568_source_marked(src) != 0u) ? src->loop_end : src->samples;
+}
+
+/*
+ * 释放后的源线性播到末尾，不再回绕。回基线的时刻提前一个过渡长度，
+ * 让过渡正好混合尾段最后的样本；换算成输出样本数后挂在流位置上，
+ * 之后与定时切换一样切块，逐样本路径里没有额外判断。
+ */
+static void dac8568_stream_schedule_return(DAC8568_Stream_t *s, const DAC8568_StreamSource_t *src) {
+  const uint8_t stored_rate = (src->speed_q16 == DAC8568_STREAM_SPEED_ONE) || (dac8568_source_rendered(src) != 0u);
+  uint32_t tail = s->transition_samples;
+  uint32_t left = 0u;
+
+  if (stored_rate == 0u) {
+    tail = (uint32_t)(((uint64_t)tail * src->speed_q16) >> 16);
+  }
+  const uint32_t stop = (tail < src->samples) ? src->samples - tail : 0u;
+  if (src->index < stop) {
+    if (stored_rate != 0u) {
+      left = stop - src->index;
+    } else {
+      const uint64_t dist = ((uint64_t)(stop - src->index) << 16) - src->frac;
+      left = (uint32_t)((dist + src->speed_q16 - 1u) / src->speed_q16);
+    }
+  }
+  s->return_at = s->position + left;
+  s->return_pending = 1u;
+}
+
+/* Entering a source restarts its sustain loop; ONE_SHOT sources are released right away. */
+static void dac8568_stream_arm(DAC8568_Stream_t *s, uint8_t source_id) {
+  DAC8568_StreamSource_t *src = &s->qspi[source_id];
+  src->released = (uint8_t)((source_id != 0u) && ((src->loop_flags & DAC8568_LOOP_ONE_SHOT) != 0u));
+  s->return_pending = 0u;
+  if (src->released != 0u) {
+    dac8568_stream_schedule_return(s, src);
+  }
+}
+
+void DAC8568_Stream_SetSource(DAC8568_Stream_t *s, uint8_t source_id, const void *data,
+                              uint32_t samples, uint8_t format, uint8_t reset_index) {
+  if (s == NULL || source_id >= DAC8568_QSPI_SOURCE_MAX) {
+    return;
+  }
+  s->qspi[source_id].data = data;
+  s->qspi[source_id].samples = samples;
+  s->qspi[source_id].format = format;
+  if (reset_index != 0u) {
+    s->qspi[source_id].index = 0u;
+    s->qspi[source_id].frac = 0u;
+  }
+  dac8568_stream_arm(s, source_id);
+  s->active_source = source_id;
+  s->mode = DAC8568_SOURCE_QSPI;
+}
+
+int32_t DAC8568_Stream_SetSpeed(DAC8568_Stream_t *s, uint8_t source_id, uint32_t speed_q16,
+                                DAC8568_Interp_t interp) {
+  if (s == NULL || source_id >= DAC8568_QSPI_SOURCE_MAX || speed_q16 < DAC8568_STREAM_SPEED_MIN ||
+      speed_q16 > DAC8568_STREAM_SPEED_MAX) {
+    return -1;
+  }
+  s->qspi[source_id].interp = (uint8_t)interp;
+  s->qspi[source_id].speed_q16 = speed_q16;
+  return 0;
+}
+
+int32_t DAC8568_Stream_SetLoop(DAC8568_Stream_t *s, uint8_t source_id, uint32_t loop_start,
+                               uint32_t loop_end, uint8_t flags) {
+  if (s == NULL || source_id >= DAC8568_QSPI_SOURCE_MAX || (loop_end != 0u && loop_start >= loop_end)) {
+    return -1;
+  }
+  s->qspi[source_id].loop_start = (loop_end != 0u) ? loop_start : 0u;
+  s->qspi[source_id].loop_end = loop_end;
+  s->qspi[source_id].loop_flags = flags;
+  return 0;
+}
+
+static int32_t dac8568_stream_queue_switch(DAC8568_Stream_t *s, uint8_t source_id,
+                                           const void *data, uint32_t samples, uint8_t format,
+                                           uint8_t reset_index, uint8_t timed, uint32_t at_sample) {
+  if (s == NULL) {
+    return -1;
+  }
+  if (DAC8568_Stream_SwitchQueueFree(s) == 0u) {
+    return -1;
+  }
+  uint8_t head = s->switch_head;
+  DAC8568_StreamSwitch_t *e = &s->switch_queue[head & DAC8568_SWITCH_MASK];
+  e->source_id = source_id;
+  e->data = data;
+  e->samples = samples;
+  e->reset_index = reset_index;
+  e->format = format;
+  e->timed = timed;
+  e->at_sample = at_sample;
+  DAC8568_PUBLISH();
+  s->switch_head = (uint8_t)(head + 1u);
+  if (source_id != DAC8568_STREAM_SOURCE_RELEASE) {
+    s->mode = DAC8568_SOURCE_QSPI;
+  }
+  return 0;
+}
+
+int32_t DAC8568_Stream_PostSwitch(DAC8568_Stream_t *s, uint8_t source_id, const void *data,
+                                  uint32_t samples, uint8_t format, uint8_t reset_index) {
+  return dac8568_stream_queue_switch(s, source_id, data, samples, format, reset_index, 0u, 0u);
+}
+
+int32_t DAC8568_Stream_QueueSwitchAt(DAC8568_Stream_t *s, uint8_t source_id, const void *data,
+                                     uint32_t samples, uint8_t format, uint8_t reset_index,
+                                     uint32_t at_sample) {
+  return dac8568_stream_queue_switch(s, source_id, data, samples, format, reset_index, 1u, at_sample);
+}
+
+int32_t DAC8568_Stream_PostRelease(DAC8568_Stream_t *s) {
+  return dac8568_stream_queue_switch(s, DAC8568_STREAM_SOURCE_RELEASE, NULL, 0u, 0u, 0u, 0u, 0u);
+}
+
+uint32_t DAC8568_Stream_SwitchQueueFree(const DAC8568_Stream_t *s) {
+  if (s == NULL) {
+    return 0u;
+  }
+  /* A pending flush already owns everything before flush_to. */
+  uint8_t tail = (s->switch_flush != 0u) ? s->switch_flush_to : s->switch_tail;
+  uint8_t used = (uint8_t)(s->switch_head - tail);
+  return DAC8568_STREAM_SWITCH_QUEUE - (uint32_t)used;
+}
+
+void DAC8568_Stream_FlushSwitches(DAC8568_Stream_t *s) {
+  if (s == NULL) {
+    return;
+  }
+  s->switch_flush_to = s->switch_head;
+  DAC8568_PUBLISH();
+  s->switch_flush = 1u;
+}
+
+void DAC8568_Stream_SetSwitchHook(DAC8568_Stream_t *s, DAC8568_StreamSwitchHook_t hook) {
+  if (s != NULL) {
+    s->on_switch = hook;
+  }
+}
+
+uint32_t DAC8568_Stream_GetPosition(const DAC8568_Stream_t *s) {
+  return (s != NULL) ? s->position : 0u;
+}
+
+void DAC8568_Stream_SetTransition(DAC8568_Stream_t *s, DAC8568_Transition_t mode,
+                                  uint32_t samples) {
+  if (s == NULL) {
+    return;
+  }
+  if (samples > DAC8568_TRANSITION_MAX_SAMPLES) {
+    samples = DAC8568_TRANSITION_MAX_SAMPLES;
+  }
+  if (mode != DAC8568_TRANSITION_LINEAR && mode != DAC8568_TRANSITION_RAISED_COSINE) {
+    mode = DAC8568_TRANSITION_HARD;
+  }
+  s->transition_samples = (mode == DAC8568_TRANSITION_HARD) ? 0u : samples;
+  s->transition = (uint8_t)mode;
+}
+
+static uint8_t dac8568_stream_qspi_ready(const DAC8568_Stream_t *s, uint8_t active_source);
+
+/* Returns 1 when a source was armed (not for a release or an empty entry). */
+static uint8_t dac8568_stream_apply_switch(DAC8568_Stream_t *s, const DAC8568_StreamSwitch_t *e) {
+  uint8_t new_source = e->source_id;
+
+  if (new_source == DAC8568_STREAM_SOURCE_RELEASE) {
+    const uint8_t active = s->active_source;
+    if (active != 0u && dac8568_stream_qspi_ready(s, active) && s->qspi[active].released == 0u) {
+      s->qspi[active].released = 1u;
+      dac8568_stream_schedule_return(s, &s->qspi[active]);
+    }
+    return 0u;
+  }
+
+  if (new_source < DAC8568_QSPI_SOURCE_MAX && e->data != NULL && e->samples > 0u) {
+    /*
+     * 切换时保留旧源（含当前位置）继续播放 N 个样本并与新源混合；
+     * 内置 LUT 没有可续播的源，仍然硬切。
+     */
+    if (s->transition_samples > 0u && dac8568_stream_qspi_ready(s, s->active_source)) {
+      s->fade_from = s->qspi[s->active_source];
+      if (s->fade_from.index >= dac8568_source_end(&s->fade_from)) {
+        s->fade_from.index = dac8568_source_restart(&s->fade_from);
+      }
+      s->fade_mode = s->transition;
+      s->fade_pos = 0u;
+      s->fade_len = s->transition_samples;
+    }
+    s->qspi[new_source].data = e->data;
+    s->qspi[new_source].samples = e->samples;
+    s->qspi[new_source].format = e->format;
+    if (e->reset_index != 0u) {
+      s->qspi[new_source].index = 0u;
+      s->qspi[new_source].frac = 0u;
+    }
+    dac8568_stream_arm(s, new_source);
+    s->active_source = new_source;
+    s->mode = DAC8568_SOURCE_QSPI;
+    return 1u;
+  }
+  return 0u;
+}
+
+/* 尾段播完：切回基线（不重置相位，走配置的过渡），释放标记随之清除。 */
+static void dac8568_stream_return(DAC8568_Stream_t *s) {
+  const uint8_t from = s->active_source;
+
+  s->return_pending = 0u;
+  if (from >= DAC8568_QSPI_SOURCE_MAX) {
+    return;
+  }
+  if (dac8568_stream_qspi_ready(s, 0u)) {
+    const DAC8568_StreamSwitch_t back = {0u, 0u, s->qspi[0].format, 0u, s->qspi[0].data, s->qspi[0].samples, 0u};
+    if (dac8568_stream_apply_switch(s, &back) != 0u && s->on_switch != NULL) {
+      s->on_switch(from, 0u, s->position, 1u);
+    }
+  }
+  s->qspi[from].released = 0u;
+}
+
+void DAC8568_Stream_ChannelMapIdentity(DAC8568_ChannelMap_t *map) {
+  if (map == NULL) {
+    return;
+  }
+  for (uint32_t ch = 0u; ch < DAC8568_WORDS_PER_SAMPLE; ch++) {
+    map->gain_q15[ch] = DAC8568_GAIN_Q15_ONE;
+    map->offset[ch] = 0;
+    map->route[ch] = (uint8_t)ch;
+  }
+  map->mute_mask = 0u;
+}
+
+int32_t DAC8568_Stream_SetChannelMap(DAC8568_Stream_t *s, const DAC8568_ChannelMap_t *map) {
+  uint8_t active = 0u;
+
+  if (s == NULL) {
+    return -1;
+  }
+  if (map == NULL) {
+    s->map_active = 0u;
+    DAC8568_Stream_ChannelMapIdentity(&s->map);
+    return 0;
+  }
+  for (uint32_t ch = 0u; ch < DAC8568_WORDS_PER_SAMPLE; ch++) {
+    if (map->gain_q15[ch] > DAC8568_GAIN_Q15_MAX || map->gain_q15[ch] < -DAC8568_GAIN_Q15_MAX ||
+        map->offset[ch] > 65535 || map->offset[ch] < -65535 ||
+        map->route[ch] >= DAC8568_WORDS_PER_SAMPLE) {
+      return -1;
+    }
+    if (map->gain_q15[ch] != DAC8568_GAIN_Q15_ONE || map->offset[ch] != 0 || map->route[ch] != ch) {
+      active = 1u;
+    }
+  }
+  if ((map->mute_mask & DAC8568_CHANNEL_MASK) != 0u) {
+    active = 1u;
+  }
+
+  s->map_active = 0u;
+  s->map = *map;
+  s->map.mute_mask &= (uint8_t)DAC8568_CHANNEL_MASK;
+  s->map_active = active;
+  return 0;
+}
+
+/* Apply every queued switch that is due at the current stream position (refill context). */
+static void dac8568_stream_apply_due(DAC8568_Stream_t *s) {
+  if (s->switch_flush != 0u) {
+    s->switch_tail = s->switch_flush_to;
+    s->switch_flush = 0u;
+  }
+
+  uint8_t tail = s->switch_tail;
+  const uint8_t head = s->switch_head;
+  DAC8568_PUBLISH();
+  while (tail != head) {
+    const DAC8568_StreamSwitch_t *e = &s->switch_queue[tail & DAC8568_SWITCH_MASK];
+    if (e->timed != 0u) {
+      int32_t ahead = (int32_t)(e->at_sample - s->position);
+      if (ahead > 0) {
+        break;
+      }
+      if (ahead < 0) {
+        s->switch_late++;
+      }
+    }
+    const uint8_t from = s->active_source;
+    if (dac8568_stream_apply_switch(s, e) != 0u && s->on_switch != NULL) {
+      s->on_switch(from, e->source_id, s->position, 0u);
+    }
+    tail++;
+  }
+  s->switch_tail = tail;
+
+  if (s->return_pending != 0u && (int32_t)(s->return_at - s->position) <= 0) {
+    dac8568_stream_return(s);
+  }
+}
+
+/* Samples until the next queued timed switch or the return of a released source, capped at `sample_count`. */
+static uint32_t dac8568_stream_chunk_len(const DAC8568_Stream_t *s, uint32_t sample_count) {
+  if (s->switch_tail != s->switch_head) {
+    const DAC8568_StreamSwitch_t *e = &s->switch_queue[s->switch_tail & DAC8568_SWITCH_MASK];
+    uint32_t ahead = e->at_sample - s->position;
+    if (e->timed != 0u && ahead < sample_count) {
+      sample_count = ahead;
+    }
+  }
+  if (s->return_pending != 0u) {
+    uint32_t ahead = s->return_at - s->position;
+    if (ahead < sample_count) {
+      sample_count = ahead;
+    }
+  }
+  return sample_count;
+}
+
+/* Baseline phase should continue even during fault playback. */
+static void dac8568_stream_advance_baseline(DAC8568_Stream_t *s, uint8_t active_source,
+                                            uint32_t sample_count) {
+  if (active_source != 0u &&
+      s->qspi[0].data != NULL &&
+      s->qspi[0].samples > 0u &&
+      sample_count > 0u) {
+    DAC8568_StreamSource_t *base = &s->qspi[0];
+    const uint32_t restart = dac8568_source_restart(base);
+    const uint32_t end = dac8568_source_end(base);
+    uint32_t base_index = base->index;
+    if (base->speed_q16 == DAC8568_STREAM_SPEED_ONE) {
+      base_index += sample_count;
+    } else {
+      /* 变速基线按相位累加器推进，故障结束后从同一相位续播。 */
+      const uint64_t acc = (uint64_t)base->frac + (uint64_t)sample_count * base->speed_q16;
+      const uint64_t next = (uint64_t)base_index + (acc >> 16);
+      base_index = (next >= end) ? (uint32_t)(restart + (next - restart) % (end - restart)) : (uint32_t)next;
+      base->frac = (uint16_t)acc;
+    }
+    if (base_index >= end) {
+      base_index = restart + (base_index - restart) % (end - restart);
+    }
+    base->index = base_index;
+  }
+}
+
+/*
+ * 成对 32-bit 读取：小端下 w0 = B:A, w1 = D:C（8 通道再加 F:E, H:G）。
+ * DATA 字段跨半字边界（bit19..4），PKHBT/UXTB16 无法一步完成，
+ * 这里用移位+掩码（目标上编译为 LSL/UBFX + ORR）；4 通道每 4 个样本展开一次，
+ * 8 通道单样本已是 8 帧，逐样本展开。
+ */
+typedef uint32_t dac8568_word_alias_t __attribute__((may_alias));
+
+#define DAC8568_PACK_LO(w) (((w) << 4) & 0x000FFFF0u)
+#define DAC8568_PACK_HI(w) (((w) >> 12) & 0x000FFFF0u)
+
+void DAC8568_Stream_PackCodes(uint32_t *dst, const uint16_t *codes, uint32_t samples) {
+  const dac8568_word_alias_t *src = (const dac8568_word_alias_t *)(const void *)codes;
+#if DAC8568_CHANNELS == 8u
+  while (samples-- > 0u) {
+    uint32_t ab = src[0];
+    uint32_t cd = src[1];
+    uint32_t ef = src[2];
+    uint32_t gh = src[3];
+    src += 4;
+    dst[0] = DAC8568_FRAME_A_PREFIX | DAC8568_PACK_LO(ab);
+    dst[1] = DAC8568_FRAME_B_PREFIX | DAC8568_PACK_HI(ab);
+    dst[2] = DAC8568_FRAME_C_PREFIX | DAC8568_PACK_LO(cd);
+    dst[3] = DAC8568_FRAME_D_PREFIX | DAC8568_PACK_HI(cd);
+    dst[4] = DAC8568_FRAME_E_PREFIX | DAC8568_PACK_LO(ef);
+    dst[5] = DAC8568_FRAME_F_PREFIX | DAC8568_PACK_HI(ef);
+    dst[6] = DAC8568_FRAME_G_PREFIX | DAC8568_PACK_LO(gh);
+    dst[7] = DAC8568_FRAME_H_PREFIX | DAC8568_PACK_HI(gh);
+    dst += 8;
+  }
+#else
+  uint32_t blocks = samples >> 2;
+  uint32_t tail = samples & 3u;
+
+  while (blocks-- > 0u) {
+    uint32_t ab0 = src[0];
+    uint32_t cd0 = src[1];
+    uint32_t ab1 = src[2];
+    uint32_t cd1 = src[3];
+    uint32_t ab2 = src[4];
+    uint32_t cd2 = src[5];
+    uint32_t ab3 = src[6];
+    uint32_t cd3 = src[7];
+    src += 8;
+
+    dst[0] = DAC8568_FRAME_A_PREFIX | DAC8568_PACK_LO(ab0);
+    dst[1] = DAC8568_FRAME_B_PREFIX | DAC8568_PACK_HI(ab0);
+    dst[2] = DAC8568_FRAME_C_PREFIX | DAC8568_PACK_LO(cd0);
+    dst[3] = DAC8568_FRAME_D_PREFIX | DAC8568_PACK_HI(cd0);
+    dst[4] = DAC8568_FRAME_A_PREFIX | DAC8568_PACK_LO(ab1);
+    dst[5] = DAC8568_FRAME_B_PREFIX | DAC8568_PACK_HI(ab1);
+    dst[6] = DAC8568_FRAME_C_PREFIX | DAC8568_PACK_LO(cd1);
+    dst[7] = DAC8568_FRAME_D_PREFIX | DAC8568_PACK_HI(cd1);
+    dst[8] = DAC8568_FRAME_A_PREFIX | DAC8568_PACK_LO(ab2);
+    dst[9] = DAC8568_FRAME_B_PREFIX | DAC8568_PACK_HI(ab2);
+    dst[10] = DAC8568_FRAME_C_PREFIX | DAC8568_PACK_LO(cd2);
+    dst[11] = DAC8568_FRAME_D_PREFIX | DAC8568_PACK_HI(cd2);
+    dst[12] = DAC8568_FRAME_A_PREFIX | DAC8568_PACK_LO(ab3);
+    dst[13] = DAC8568_FRAME_B_PREFIX | DAC8568_PACK_HI(ab3);
+    dst[14] = DAC8568_FRAME_C_PREFIX | DAC8568_PACK_LO(cd3);
+    dst[15] = DAC8568_FRAME_D_PREFIX | DAC8568_PACK_HI(cd3);
+    dst += 16;
+  }
+
+  while (tail-- > 0u) {
+    uint32_t ab = src[0];
+    uint32_t cd = src[1];
+    src += 2;
+    dst[0] = DAC8568_FRAME_A_PREFIX | DAC8568_PACK_LO(ab);
+    dst[1] = DAC8568_FRAME_B_PREFIX | DAC8568_PACK_HI(ab);
+    dst[2] = DAC8568_FRAME_C_PREFIX | DAC8568_PACK_LO(cd);
+    dst[3] = DAC8568_FRAME_D_PREFIX | DAC8568_PACK_HI(cd);
+    dst += 4;
+  }
+#endif
+}
+
+static uint8_t dac8568_stream_qspi_ready(const DAC8568_Stream_t *s, uint8_t active_source) {
+  return (s->mode == DAC8568_SOURCE_QSPI) &&
+         (active_source < DAC8568_QSPI_SOURCE_MAX) &&
+         (s->qspi[active_source].data != NULL) &&
+         (s->qspi[active_source].samples > 0u);
+}
+
+/*
+ * 按源末尾切成无回绕的连续段，段内不再逐样本判断回绕。
+ * FRAME32 源已是成品 SPI 帧，段内直接 memcpy；CODE16x4 源走 PackCodes。
+ */
+static void dac8568_stream_fill_spans(DAC8568_Stream_t *s, uint8_t active_source, uint32_t *dst,
+                                      uint32_t sample_count) {
+  DAC8568_StreamSource_t *src = &s->qspi[active_source];
+  const uint32_t qspi_restart = dac8568_source_restart(src);
+  const uint32_t qspi_end = dac8568_source_end(src);
+  uint32_t qspi_index = src->index;
+  uint32_t remaining = sample_count;
+  if (qspi_index >= qspi_end) {
+    qspi_index = qspi_restart;
+  }
+
+  while (remaining > 0u) {
+    uint32_t span = qspi_end - qspi_index;
+    if (span > remaining) {
+      span = remaining;
+    }
+    if (src->format == DAC8568_WAVE_FORMAT_FRAME32) {
+      const uint32_t *frames = (const uint32_t *)src->data;
+      memcpy(dst, &frames[qspi_index * DAC8568_WORDS_PER_SAMPLE],
+             span * DAC8568_WORDS_PER_SAMPLE * sizeof(uint32_t));
+    } else {
+      const uint16_t *codes = (const uint16_t *)src->data;
+      DAC8568_Stream_PackCodes(dst, &codes[qspi_index * DAC8568_WORDS_PER_SAMPLE], span);
+    }
+    dst += span * DAC8568_WORDS_PER_SAMPLE;
+    remaining -= span;
+    qspi_index += span;
+    if (qspi_index >= qspi_end) {
+      qspi_index = qspi_restart;
+    }
+  }
+
+  src->index = qspi_index;
+  dac8568_stream_advance_baseline(s, active_source, sample_count);
+}
+
+/* SYNTH 源的 data 指向可变的合成器状态（渲染会推进它）；返回值不含循环标记。 */
+static uint32_t dac8568_source_render(const DAC8568_StreamSource_t *src, uint32_t *dst, uint32_t samples) {
+  if (src->format == DAC8568_WAVE_FORMAT_ZCODE16x4) {
+    return DAC8568_ZCode_Render((const uint32_t *)src->data, src->samples, src->index, dst, samples);
+  }
+  return DAC8568_Synth_Render((DAC8568_Synth_t *)(uintptr_t)src->data, src->index, dst, samples);
+}
+
+static void dac8568_stream_fill_rendered(DAC8568_Stream_t *s, uint8_t active_source, uint32_t *dst,
+                                         uint32_t sample_count) {
+  DAC8568_StreamSource_t *src = &s->qspi[active_source];
+  const uint32_t restart = dac8568_source_restart(src);
+  const uint32_t end = dac8568_source_end(src);
+  uint32_t remaining = sample_count;
+  if (src->index >= end) {
+    src->index = restart;
+  }
+
+  /* 渲染按循环段切开，回绕点之后从 restart 继续（seek 由渲染器自己处理）。 */
+  while (remaining > 0u) {
+    uint32_t span = end - src->index;
+    if (span > remaining) {
+      span = remaining;
+    }
+    (void)dac8568_source_render(src, dst, span);
+    dst += span * DAC8568_WORDS_PER_SAMPLE;
+    remaining -= span;
+    src->index += span;
+    if (src->index >= end) {
+      src->index = restart;
+    }
+  }
+  dac8568_stream_advance_baseline(s, active_source, sample_count);
+}
+
+static inline int32_t dac8568_source_code(const DAC8568_StreamSource_t *src, uint32_t index,
+                                          uint32_t ch) {
+  if (src->format == DAC8568_WAVE_FORMAT_FRAME32) {
+    const uint32_t *frames = (const uint32_t *)src->data;
+    return (int32_t)((frames[index * DAC8568_WORDS_PER_SAMPLE + ch] >> 4) & 0xFFFFu);
+  }
+  const uint16_t *codes = (const uint16_t *)src->data;
+  return (int32_t)codes[index * DAC8568_WORDS_PER_SAMPLE + ch];
+}
+
+/* Code of channel `ch` at index + frac / 65536 (neighbours wrap from `end` back to `restart`). */
+static int32_t dac8568_source_interp(const DAC8568_StreamSource_t *src, uint32_t index, uint32_t frac,
+                                     uint32_t ch, uint32_t restart, uint32_t end) {
+  const uint32_t i1 = (index + 1u < end) ? index + 1u : restart;
+  const int32_t c0 = dac8568_source_code(src, index, ch);
+  const int32_t c1 = dac8568_source_code(src, i1, ch);
+
+  if (src->interp != (uint8_t)DAC8568_INTERP_CUBIC) {
+    /* Q15 weight keeps (c1 - c0) * w inside int32. */
+    return c0 + (((c1 - c0) * (int32_t)(frac >> 1) + 16384) >> 15);
+  }
+
+  const uint32_t im1 = (index == restart) ? end - 1u : ((index != 0u) ? index - 1u : 0u);
+  const uint32_t i2 = (i1 + 1u < end) ? i1 + 1u : restart;
+  const int32_t *h = g_interp_taps[(frac + (1u << (15u - INTERP_PHASE_BITS))) >> (16u - INTERP_PHASE_BITS)];
+  /* 64-bit MAC (SMLAL on the M7): Q16 taps x 17-bit differences overflow int32. */
+  int64_t acc = (int64_t)h[0] * (dac8568_source_code(src, im1, ch) - c0) + (int64_t)h[1] * (c1 - c0) +
+                (int64_t)h[2] * (dac8568_source_code(src, i2, ch) - c0);
+  const int32_t y = c0 + (int32_t)((acc + 32768) >> 16);
+  if (y < 0) {
+    return 0;
+  }
+  return (y > 0xFFFF) ? 0xFFFF : y;
+}
+
+static inline void dac8568_source_step(const DAC8568_StreamSource_t *src, uint32_t *index,
+                                       uint32_t *frac, uint32_t restart, uint32_t end) {
+  const uint32_t acc = *frac + src->speed_q16;
+  uint32_t next = *index + (acc >> 16);
+  while (next >= end) {
+    next -= end - restart;
+  }
+  *index = next;
+  *frac = acc & 0xFFFFu;
+}
+
+/*
+ * 变速播放：Q16.16 相位累加器在存储样本间插值（每通道独立），
+ * FRAME32 源保留原帧头，只重写 DATA 字段。
+ */
+static void dac8568_stream_fill_resampled(DAC8568_Stream_t *s, uint8_t active_source, uint32_t *dst,
+                                          uint32_t sample_count) {
+  DAC8568_StreamSource_t *src = &s->qspi[active_source];
+  const uint32_t *frames = (const uint32_t *)src->data;
+  const uint8_t frame32 = (src->format == DAC8568_WAVE_FORMAT_FRAME32);
+  const uint32_t restart = dac8568_source_restart(src);
+  const uint32_t end = dac8568_source_end(src);
+  uint32_t index = (src->index >= end) ? restart : src->index;
+  uint32_t frac = src->frac;
+
+  for (uint32_t i = 0u; i < sample_count; i++) {
+    for (uint32_t ch = 0u; ch < DAC8568_WORDS_PER_SAMPLE; ch++) {
+      const uint32_t head = (frame32 != 0u) ? (frames[index * DAC8568_WORDS_PER_SAMPLE + ch] & ~0x000FFFF0u)
+                                            : g_frame_prefix[ch];
+      *dst++ = head | ((uint32_t)dac8568_source_interp(src, index, frac, ch, restart, end) << 4);
+    }
+    dac8568_source_step(src, &index, &frac, restart, end);
+  }
+
+  src->index = index;
+  src->frac = (uint16_t)frac;
+  dac8568_stream_advance_baseline(s, active_source, sample_count);
+}
+
+static uint32_t dac8568_stream_fade_weight(uint8_t mode, uint32_t t, uint32_t len) {
+  const uint32_t x = (t << 16) / len; /* Q16, t < len <= 65535 */
+  if (mode == DAC8568_TRANSITION_LINEAR) {
+    return x >> 1;
+  }
+  const uint32_t i = x >> (16u - FADE_LUT_BITS);
+  const uint32_t frac = x & ((1u << (16u - FADE_LUT_BITS)) - 1u);
+  const int32_t w0 = (int32_t)g_lut_fade[i];
+  const int32_t w1 = (int32_t)g_lut_fade[i + 1u];
+  const int32_t half = 1 << (16u - FADE_LUT_BITS - 1u);
+  return (uint32_t)(w0 + (((w1 - w0) * (int32_t)frac + half) >> (16u - FADE_LUT_BITS)));
+}
+
+static inline uint32_t dac8568_fade_word(uint32_t word, int32_t old_code, uint32_t w) {
+  const int32_t new_code = (int32_t)((word >> 4) & 0xFFFFu);
+  const int32_t code = old_code + (((new_code - old_code) * (int32_t)w + 16384) >> 15);
+  return (word & ~0x000FFFF0u) | ((uint32_t)code << 4);
+}
+
+/* 旧源是合成/压缩源时没有可随机读取的码值：按小块渲染到栈上再混合。 */
+#define DAC8568_FADE_RENDER_BLOCK 32u
+
+static void dac8568_stream_fade_rendered(DAC8568_Stream_t *s, uint32_t *dst, uint32_t n) {
+  DAC8568_StreamSource_t *from = &s->fade_from;
+  const uint32_t restart = dac8568_source_restart(from);
+  const uint32_t end = dac8568_source_end(from);
+  uint32_t old[DAC8568_FADE_RENDER_BLOCK * DAC8568_WORDS_PER_SAMPLE];
+
+  if (from->index >= end) {
+    from->index = restart;
+  }
+  for (uint32_t i = 0u; i < n;) {
+    uint32_t m = n - i;
+    if (m > DAC8568_FADE_RENDER_BLOCK) {
+      m = DAC8568_FADE_RENDER_BLOCK;
+    }
+    if (m > end - from->index) {
+      m = end - from->index;
+    }
+    (void)dac8568_source_render(from, old, m);
+    from->index += m;
+    if (from->index >= end) {
+      from->index = restart;
+    }
+    for (uint32_t j = 0u; j < m; j++) {
+      const uint32_t w = dac8568_stream_fade_weight(s->fade_mode, s->fade_pos + i + j, s->fade_len);
+      for (uint32_t ch = 0u; ch < DAC8568_WORDS_PER_SAMPLE; ch++) {
+        dst[ch] = dac8568_fade_word(dst[ch], (int32_t)((old[j * DAC8568_WORDS_PER_SAMPLE + ch] >> 4) & 0xFFFFu), w);
+      }
+      dst += DAC8568_WORDS_PER_SAMPLE;
+    }
+    i += m;
+  }
+}
+
+/*
+ * 过渡段叠加：dst 已由新源填好，这里逐样本取旧源码值，
+ * out = old + (new - old) * w(Q15)，只改 DATA 字段，帧头不动。
+ */
+static void dac8568_stream_fade_chunk(DAC8568_Stream_t *s, uint32_t *dst, uint32_t sample_count) {
+  DAC8568_StreamSource_t *from = &s->fade_from;
+  uint32_t n = s->fade_len - s->fade_pos;
+  if (n > sample_count) {
+    n = sample_count;
+  }
+
+  if (dac8568_source_rendered(from) != 0u) {
+    dac8568_stream_fade_rendered(s, dst, n);
+    s->fade_pos += n;
+    if (s->fade_pos >= s->fade_len) {
+      s->fade_len = 0u;
+    }
+    return;
+  }
+
+  const uint8_t resampled = (from->speed_q16 != DAC8568_STREAM_SPEED_ONE);
+  const uint32_t restart = dac8568_source_restart(from);
+  const uint32_t end = dac8568_source_end(from);
+  uint32_t index = from->index;
+  uint32_t frac = from->frac;
+  for (uint32_t i = 0u; i < n; i++) {
+    const uint32_t w = dac8568_stream_fade_weight(s->fade_mode, s->fade_pos + i, s->fade_len);
+    for (uint32_t ch = 0u; ch < DAC8568_WORDS_PER_SAMPLE; ch++) {
+      const int32_t old_code = (resampled != 0u) ? dac8568_source_interp(from, index, frac, ch, restart, end)
+                                                 : dac8568_source_code(from, index, ch);
+      dst[ch] = dac8568_fade_word(dst[ch], old_code, w);
+    }
+    dst += DAC8568_WORDS_PER_SAMPLE;
+    if (resampled != 0u) {
+      dac8568_source_step(from, &index, &frac, restart, end);
+    } else {
+      index++;
+      if (index >= end) {
+        index = restart;
+      }
+    }
+  }
+
+  from->index = index;
+  from->frac = (uint16_t)frac;
+  s->fade_pos += n;
+  if (s->fade_pos >= s->fade_len) {
+    s->fade_len = 0u;
+  }
+}
+
+/*
+ * 通道矩阵：先整样本读出全部通道码值（允许交换路由），再逐通道增益/偏置/饱和。
+ * 系数提到循环外，内层是 SUB/MUL/ASR/ADD + USAT 形式，M7 上每通道几条指令。
+ */
+static void dac8568_stream_map_chunk(const DAC8568_Stream_t *s, uint32_t *dst, uint32_t sample_count) {
+  const DAC8568_ChannelMap_t *m = &s->map;
+  int32_t gain[DAC8568_WORDS_PER_SAMPLE];
+  int32_t bias[DAC8568_WORDS_PER_SAMPLE];
+  uint32_t route[DAC8568_WORDS_PER_SAMPLE];
+
+  for (uint32_t ch = 0u; ch < DAC8568_WORDS_PER_SAMPLE; ch++) {
+    const uint8_t muted = (uint8_t)((m->mute_mask >> ch) & 1u);
+    gain[ch] = (muted != 0u) ? 0 : m->gain_q15[ch];
+    bias[ch] = DAC8568_CODE_MID + ((muted != 0u) ? 0 : m->offset[ch]);
+    route[ch] = m->route[ch];
+  }
+
+  for (uint32_t i = 0u; i < sample_count; i++) {
+    int32_t in[DAC8568_WORDS_PER_SAMPLE];
+    for (uint32_t ch = 0u; ch < DAC8568_WORDS_PER_SAMPLE; ch++) {
+      in[ch] = (int32_t)((dst[ch] >> 4) & 0xFFFFu) - DAC8568_CODE_MID;
+    }
+    for (uint32_t ch = 0u; ch < DAC8568_WORDS_PER_SAMPLE; ch++) {
+      int32_t code = ((in[route[ch]] * gain[ch] + 16384) >> 15) + bias[ch];
+      code = (code < 0) ? 0 : ((code > 0xFFFF) ? 0xFFFF : code);
+      dst[ch] = (dst[ch] & ~0x000FFFF0u) | ((uint32_t)code << 4);
+    }
+    dst += DAC8568_WORDS_PER_SAMPLE;
+  }
+}
+
+static uint32_t dac8568_stream_plan(DAC8568_Stream_t *s, uint32_t sample_count, DAC8568_StreamSpan_t *spans,
+                                    uint32_t max_spans, uint8_t format) {
+  dac8568_stream_apply_due(s);
+
+  const uint8_t active_source = s->active_source;
+  if (!dac8568_stream_qspi_ready(s, active_source) || s->qspi[active_source].format != format ||
+      s->qspi[active_source].speed_q16 != DAC8568_STREAM_SPEED_ONE || s->map_active != 0u) {
+    return 0u;
+  }
+  /* The packer reads codes as 32-bit pairs. */
+  if (format == DAC8568_WAVE_FORMAT_CODE16x4 && ((uintptr_t)s->qspi[active_source].data & 3u) != 0u) {
+    return 0u;
+  }
+  /* A switch inside this refill splits it and a transition rewrites it; leave both to the CPU fill. */
+  if (s->fade_len != 0u || dac8568_stream_chunk_len(s, sample_count) != sample_count) {
+    return 0u;
+  }
+
+  DAC8568_StreamSource_t *src = &s->qspi[active_source];
+  const uint8_t *base = (const uint8_t *)src->data;
+  const uint32_t sample_bytes = DAC8568_Stream_BytesPerSample(format);
+  const uint32_t restart = dac8568_source_restart(src);
+  const uint32_t end = dac8568_source_end(src);
+  uint32_t qspi_index = (src->index >= end) ? restart : src->index;
+  uint32_t remaining = sample_count;
+  uint32_t count = 0u;
+
+  while (remaining > 0u) {
+    uint32_t span = end - qspi_index;
+    if (span > remaining) {
+      span = remaining;
+    }
+    if (count >= max_spans) {
+      return 0u;
+    }
+    spans[count].src = &base[qspi_index * sample_bytes];
+    spans[count].samples = span;
+    count++;
+    remaining -= span;
+    qspi_index += span;
+    if (qspi_index >= end) {
+      qspi_index = restart;
+    }
+  }
+
+  src->index = qspi_index;
+  dac8568_stream_advance_baseline(s, active_source, sample_count);
+  s->position += sample_count;
+  return count;
+}
+
+uint32_t DAC8568_Stream_PlanCopy(DAC8568_Stream_t *s, uint32_t sample_count,
+                                 DAC8568_StreamSpan_t *spans, uint32_t max_spans) {
+  return dac8568_stream_plan(s, sample_count, spans, max_spans, DAC8568_WAVE_FORMAT_FRAME32);
+}
+
+uint32_t DAC8568_Stream_PlanStage(DAC8568_Stream_t *s, uint32_t sample_count,
+                                  DAC8568_StreamSpan_t *spans, uint32_t max_spans) {
+  return dac8568_stream_plan(s, sample_count, spans, max_spans, DAC8568_WAVE_FORMAT_CODE16x4);
+}
+
+static void dac8568_stream_fill_reference_chunk(DAC8568_Stream_t *s, uint32_t *dst,
+                                                uint32_t sample_count) {
+  uint32_t phase_a = s->phase[0];
+  uint32_t phase_b = s->phase[1];
+  uint32_t phase_c = s->phase[2];
+  uint32_t phase_d = s->phase[3];
+  uint32_t qspi_index = 0u;
+
+  const uint8_t active_source = s->active_source;
+  const uint32_t inc_a = s->phase_inc[0];
+  const uint32_t inc_b = s->phase_inc[1];
+  const uint32_t inc_c = s->phase_inc[2];
+  const uint32_t inc_d = s->phase_inc[3];
+  const uint8_t use_qspi = dac8568_stream_qspi_ready(s, active_source);
+  const uint16_t *qspi_data = use_qspi ? (const uint16_t *)s->qspi[active_source].data : NULL;
+  const uint32_t qspi_restart = use_qspi ? dac8568_source_restart(&s->qspi[active_source]) : 0u;
+  const uint32_t qspi_end = use_qspi ? dac8568_source_end(&s->qspi[active_source]) : 0u;
+
+  if (use_qspi != 0u && dac8568_source_rendered(&s->qspi[active_source]) != 0u) {
+    dac8568_stream_fill_rendered(s, active_source, dst, sample_count);
+    return;
+  }
+  if (use_qspi != 0u && s->qspi[active_source].speed_q16 != DAC8568_STREAM_SPEED_ONE) {
+    dac8568_stream_fill_resampled(s, active_source, dst, sample_count);
+    return;
+  }
+  if (use_qspi != 0u && s->qspi[active_source].format == DAC8568_WAVE_FORMAT_FRAME32) {
+    dac8568_stream_fill_spans(s, active_source, dst, sample_count);
+    return;
+  }
+
+  if (use_qspi != 0u) {
+    qspi_index = s->qspi[active_source].index;
+    if (qspi_index >= qspi_end) {
+      qspi_index = qspi_restart;
+    }
+  }
+
+  for (uint32_t i = 0u; i < sample_count; i++) {
+    uint16_t lut[4];
+    const uint16_t *sample = lut;
+    uint32_t lut_mask = 3u; /* LUT 只有 4 路：8 通道时 E..H 重复 A..D */
+
+    if (use_qspi != 0u) {
+      sample = &qspi_data[qspi_index * DAC8568_WORDS_PER_SAMPLE];
+      lut_mask = DAC8568_WORDS_PER_SAMPLE - 1u;
+      qspi_index++;
+      if (qspi_index >= qspi_end) {
+        qspi_index = qspi_restart;
+      }
+    } else {
+      lut[0] = g_lut_sine[phase_a >> LUT_PHASE_SHIFT];
+      phase_a += inc_a;
+      lut[1] = g_lut_triangle[phase_b >> LUT_PHASE_SHIFT];
+      phase_b += inc_b;
+      lut[2] = g_lut_saw[phase_c >> LUT_PHASE_SHIFT];
+      phase_c += inc_c;
+      lut[3] = g_lut_square[phase_d >> LUT_PHASE_SHIFT];
+      phase_d += inc_d;
+    }
+
+    for (uint32_t ch = 0u; ch < DAC8568_WORDS_PER_SAMPLE; ch++) {
+      *dst++ = g_frame_prefix[ch] | ((uint32_t)sample[ch & lut_mask] << 4);
+    }
+  }
+
+  if (use_qspi != 0u) {
+    s->qspi[active_source].index = qspi_index;
+
+    dac8568_stream_advance_baseline(s, active_source, sample_count);
+  } else {
+    s->phase[0] = phase_a;
+    s->phase[1] = phase_b;
+    s->phase[2] = phase_c;
+    s->phase[3] = phase_d;
+  }
+}
+
+static void dac8568_stream_fill_chunk(DAC8568_Stream_t *s, uint32_t *dst, uint32_t sample_count) {
+  const uint8_t active_source = s->active_source;
+  if (dac8568_stream_qspi_ready(s, active_source)) {
+    const DAC8568_StreamSource_t *src = &s->qspi[active_source];
+    if (dac8568_source_rendered(src) != 0u) {
+      dac8568_stream_fill_rendered(s, active_source, dst, sample_count);
+      return;
+    }
+    if (src->speed_q16 != DAC8568_STREAM_SPEED_ONE) {
+      dac8568_stream_fill_resampled(s, active_source, dst, sample_count);
+      return;
+    }
+#if DAC8568_STREAM_PACK_FAST
+    const uint8_t packable = (((uintptr_t)src->data & 3u) == 0u);
+#else
+    const uint8_t packable = 0u;
+#endif
+    if (src->format == DAC8568_WAVE_FORMAT_FRAME32 || packable != 0u) {
+      dac8568_stream_fill_spans(s, active_source, dst, sample_count);
+      return;
+    }
+  }
+
+  /* LUT 内置波形、非 4 字节对齐的 CODE16x4 源或 PACK_FAST=0 时走参考路径。 */
+  dac8568_stream_fill_reference_chunk(s, dst, sample_count);
+}
+
+/*
+ * 按队列中的定时切换把一次回填切成若干段：每段开头应用已到期的切换，
+ * 段长截到下一个定时切换的样本点，保证切换落在精确的样本索引上。
+ */
+void DAC8568_Stream_FillReference(DAC8568_Stream_t *s, uint32_t *dst, uint32_t sample_count) {
+  do {
+    dac8568_stream_apply_due(s);
+    uint32_t chunk = dac8568_stream_chunk_len(s, sample_count);
+    dac8568_stream_fill_reference_chunk(s, dst, chunk);
+    if (s->fade_len != 0u) {
+      dac8568_stream_fade_chunk(s, dst, chunk);
+    }
+    if (s->map_active != 0u) {
+      dac8568_stream_map_chunk(s, dst, chunk);
+    }
+    s->position += chunk;
+    dst += chunk * DAC8568_WORDS_PER_SAMPLE;
+    sample_count -= chunk;
+  } while (sample_count > 0u);
+}
+
+void DAC8568_Stream_Fill(DAC8568_Stream_t *s, uint32_t *dst, uint32_t sample_count) {
+  do {
+    dac8568_stream_apply_due(s);
+    uint32_t chunk = dac8568_stream_chunk_len(s, sample_count);
+    dac8568_stream_fill_chunk(s, dst, chunk);
+    if (s->fade_len != 0u) {
+      dac8568_stream_fade_chunk(s, dst, chunk);
+    }
+    if (s->map_active != 0u) {
+      dac8568_stream_map_chunk(s, dst, chunk);
+    }
+    s->position += chunk;
+    dst += chunk * DAC8568_WORDS_PER_SAMPLE;
+    sample_count -= chunk;
+  } while (sample_count > 0u);
+}
@@ -0,0 +1,375 @@
+#ifndef DAC8568_STREAM_H
+#define DAC8568_STREAM_H
+
+/*
+ * HAL-free DAC8568 streaming core.
+ *
+ * Owns source selection (LUT / QSPI partitions), deferred source switching and
+ * the 32-bit SPI frame packing used by the circular DMA refill. It only touches
+ * plain memory, so it builds both for the target (dac8568_dma.c glue) and on a
+ * Linux host (tools/dac8568_sim).
+ */
+
+#include <stdint.h>
+
+#include "dac8568_synth.h"
+#include "dac8568_zcode.h"
+
+/*
+ * Compiler barrier for the lock-free single-producer / single-consumer
+ * handovers of the HAL-free modules (switch queue, verify history, command
+ * rings): stores to an entry stay ahead of the index that publishes it.
+ * Same as CMSIS __COMPILER_BARRIER(), which these modules cannot include on
+ * the host; producer and consumer share one Cortex-M7 core, so no DMB.
+ */
+#define DAC8568_PUBLISH() __asm__ volatile("" ::: "memory")
+
+#define DAC8568_CMD_WRITE_INPUT 0x00u
+#define DAC8568_CMD_UPDATE_DAC 0x01u
+#define DAC8568_CMD_WRITE_UPDATE_ALL 0x02u
+#define DAC8568_CMD_WRITE_UPDATE_DAC 0x03u
+#define DAC8568_CMD_CLEAR_CODE 0x05u
+#define DAC8568_CMD_SOFTWARE_RESET 0x07u
+#define DAC8568_CMD_INTERNAL_REF 0x08u
+#define DAC8568_CMD_FLEXIBLE_REF 0x09u
+
+#define DAC8568_CHANNEL_A 0x00u
+#define DAC8568_CHANNEL_B 0x01u
+#define DAC8568_CHANNEL_C 0x02u
+#define DAC8568_CHANNEL_D 0x03u
+#define DAC8568_CHANNEL_E 0x04u
+#define DAC8568_CHANNEL_F 0x05u
+#define DAC8568_CHANNEL_G 0x06u
+#define DAC8568_CHANNEL_H 0x07u
+
+/*
+ * Channels streamed per sample (A.. in order), fixed at build time: 4 (A..D)
+ * or 8 (A..H). Every source payload and partition header carries the same
+ * count (channel_count / words_per_sample); partitions with another count are
+ * rejected at load. The last channel of a sample issues the write-update-all,
+ * so all outputs change together once per sample.
+ */
+#ifndef DAC8568_CHANNELS
+#define DAC8568_CHANNELS 4u
+#endif
+#if (DAC8568_CHANNELS != 4u) && (DAC8568_CHANNELS != 8u)
+#error "DAC8568_CHANNELS must be 4 or 8"
+#endif
+
+/*
+ * DAC8568 (TI) 32-bit frame (MSB-first):
+ *   [ 4'b0000 | CMD(4) | ADDR(4) | DATA(16) | 4'b0000 ]
+ * This is consistent with the original project implementation under
+ * `DAC8568_H750_Hardware_SPI_10V/.../User/dac8568`.
+ */
+#define DAC8568_FRAME_PREFIX(cmd, channel) (((uint32_t)(cmd) << 24) | ((uint32_t)(channel) << 20))
+#define DAC8568_FRAME_CH_PREFIX(channel)                                                        \
+  DAC8568_FRAME_PREFIX(((uint32_t)(channel) == DAC8568_CHANNELS - 1u) ? DAC8568_CMD_WRITE_UPDATE_ALL \
+                                                                       : DAC8568_CMD_WRITE_INPUT,     \
+                       (channel))
+#define DAC8568_FRAME_A_PREFIX DAC8568_FRAME_CH_PREFIX(DAC8568_CHANNEL_A)
+#define DAC8568_FRAME_B_PREFIX DAC8568_FRAME_CH_PREFIX(DAC8568_CHANNEL_B)
+#define DAC8568_FRAME_C_PREFIX DAC8568_FRAME_CH_PREFIX(DAC8568_CHANNEL_C)
+#define DAC8568_FRAME_D_PREFIX DAC8568_FRAME_CH_PREFIX(DAC8568_CHANNEL_D)
+#define DAC8568_FRAME_E_PREFIX DAC8568_FRAME_CH_PREFIX(DAC8568_CHANNEL_E)
+#define DAC8568_FRAME_F_PREFIX DAC8568_FRAME_CH_PREFIX(DAC8568_CHANNEL_F)
+#define DAC8568_FRAME_G_PREFIX DAC8568_FRAME_CH_PREFIX(DAC8568_CHANNEL_G)
+#define DAC8568_FRAME_H_PREFIX DAC8568_FRAME_CH_PREFIX(DAC8568_CHANNEL_H)
+/* Initializer of a per-sample prefix table (DAC8568_WORDS_PER_SAMPLE entries, A first). */
+#if DAC8568_CHANNELS == 8u
+#define DAC8568_FRAME_PREFIXES                                                              \
+  DAC8568_FRAME_A_PREFIX, DAC8568_FRAME_B_PREFIX, DAC8568_FRAME_C_PREFIX, DAC8568_FRAME_D_PREFIX, \
+  DAC8568_FRAME_E_PREFIX, DAC8568_FRAME_F_PREFIX, DAC8568_FRAME_G_PREFIX, DAC8568_FRAME_H_PREFIX
+#else
+#define DAC8568_FRAME_PREFIXES \
+  DAC8568_FRAME_A_PREFIX, DAC8568_FRAME_B_PREFIX, DAC8568_FRAME_C_PREFIX, DAC8568_FRAME_D_PREFIX
+#endif
+
+/*
+ * One SPI frame per channel. The ring keeps its size in words whatever the
+ * channel count: 8191 samples x 4 or 4095 x 8, both x 2 halves just under the
+ * 65535-item HAL_SPI_Transmit_DMA / NDTR limit (256KB of D2 SRAM either way).
+ */
+#define DAC8568_WORDS_PER_SAMPLE DAC8568_CHANNELS
+#ifndef DAC8568_SAMPLES_PER_HALF
+#define DAC8568_SAMPLES_PER_HALF (65535u / (2u * DAC8568_WORDS_PER_SAMPLE))
+#endif
+#define DAC8568_TX_BUF_WORDS (DAC8568_SAMPLES_PER_HALF * DAC8568_WORDS_PER_SAMPLE * 2u)
+#define DAC8568_TX_HALF_WORDS (DAC8568_TX_BUF_WORDS / 2u)
+
+/*
+ * Refill packer selection:
+ * 1: wrap-free spans + paired 32-bit loads, unrolled by 4 (default).
+ * 0: original per-sample loop (branch + wrap check per sample), kept as reference.
+ */
+#ifndef DAC8568_STREAM_PACK_FAST
+#define DAC8568_STREAM_PACK_FAST 1
+#endif
+
+/*
+ * QSPI sources by id: 0=normal, 1..6=faults, further ids for other waves of
+ * the QSPI wave directory (sd_waveform.h). 40 bytes of stream state each.
+ */
+#ifndef DAC8568_QSPI_SOURCE_MAX
+#define DAC8568_QSPI_SOURCE_MAX 32u
+#endif
+
+/*
+ * QSPI source payload layout (values match DAC_WAVE_FORMAT_* in dac_wave_sync.h):
+ * FRAME32  : DAC8568_CHANNELS x uint32 ready-to-send SPI frames per sample, refill
+ *            is a plain copy.
+ * CODE16x4 : DAC8568_CHANNELS x uint16 codes (A,B,C,D[,E..H]) per sample, packed
+ *            into frames at refill (the name keeps the original 4-channel tag).
+ * SYNTH    : no payload; `data` is a configured DAC8568_Synth_t rendered at refill
+ *            and `samples` its loop length (speed_q16 is ignored).
+ * ZCODE16x4: CODE16x4 compressed in blocks (dac8568_zcode.h), decoded at refill
+ *            (speed_q16 is ignored).
+ */
+#define DAC8568_WAVE_FORMAT_FRAME32 1u
+#define DAC8568_WAVE_FORMAT_CODE16x4 2u
+#define DAC8568_WAVE_FORMAT_SYNTH 3u
+#define DAC8568_WAVE_FORMAT_ZCODE16x4 4u
+
+/*
+ * Source transition applied by the refill when a queued switch lands:
+ * the outgoing source keeps running for `transition_samples` and is blended
+ * into the incoming one with a Q15 weight (codes only, frame prefixes kept).
+ */
+typedef enum {
+  DAC8568_TRANSITION_HARD = 0,
+  DAC8568_TRANSITION_LINEAR = 1,
+  DAC8568_TRANSITION_RAISED_COSINE = 2
+} DAC8568_Transition_t;
+
+/* Weights are derived from (t << 16) / N, so N must fit in 16 bits. */
+#define DAC8568_TRANSITION_MAX_SAMPLES 65535u
+
+/* LUT: sine / triangle / saw / square on A..D; an 8-channel build repeats them on E..H. */
+typedef enum {
+  DAC8568_SOURCE_LUT = 0,
+  DAC8568_SOURCE_QSPI = 1
+} DAC8568_SourceMode_t;
+
+/*
+ * Per-source playback speed (Q16.16 ratio of stored samples per output sample).
+ * DAC8568_STREAM_SPEED_ONE plays the partition sample by sample (plain copy /
+ * pack, MDMA eligible); any other speed steps a phase accumulator through the
+ * stored samples and interpolates every channel between them.
+ */
+#define DAC8568_STREAM_SPEED_ONE 0x00010000u
+#define DAC8568_STREAM_SPEED_MIN 0x00000100u /* 1/256 x */
+#define DAC8568_STREAM_SPEED_MAX 0x00080000u /* 8 x */
+
+typedef enum {
+  DAC8568_INTERP_LINEAR = 0,
+  DAC8568_INTERP_CUBIC = 1 /* 4-tap Catmull-Rom, 64-phase polyphase table */
+} DAC8568_Interp_t;
+
+/*
+ * Loop markers of a source (wave header v2): [0, loop_start) plays once,
+ * [loop_start, loop_end) sustains, [loop_end, samples) is the release tail.
+ * loop_end = 0 (or markers that do not fit the source) loops the whole source.
+ * A release leaves the sustain loop at its next pass through loop_end, plays
+ * the tail once and returns to source 0 (baseline phase kept, configured
+ * transition blended over the last samples of the tail). ONE_SHOT sources are
+ * released as soon as they start: prefix -> loop once -> tail -> baseline.
+ */
+#define DAC8568_LOOP_ONE_SHOT 0x01u
+
+typedef struct {
+  const void *data; /* Layout selected by `format`. */
+  uint32_t samples;
+  uint32_t index;
+  uint8_t format;
+  uint8_t interp;   /* DAC8568_Interp_t, used when speed_q16 != SPEED_ONE */
+  uint16_t frac;    /* Q16 position between index and index + 1 */
+  uint32_t speed_q16;
+  uint32_t loop_start;
+  uint32_t loop_end; /* 0: no markers */
+  uint8_t loop_flags; /* DAC8568_LOOP_* */
+  uint8_t released;   /* sustain loop left, runs to `samples` */
+} DAC8568_StreamSource_t;
+
+/*
+ * Source switch request. Untimed entries apply at the start of the next refill
+ * (the original pending-switch behaviour); timed entries apply exactly when the
+ * stream position reaches `at_sample`, splitting the refill at that sample.
+ */
+typedef struct {
+  uint8_t source_id;
+  uint8_t reset_index;
+  uint8_t format;
+  uint8_t timed;
+  const void *data;
+  uint32_t samples;
+  uint32_t at_sample;
+} DAC8568_StreamSwitch_t;
+
+/*
+ * Called from the refill each time a source is armed: a queued (or timed)
+ * switch, or the return to source 0 at the end of a release tail
+ * (`returned` = 1). `position` is the stream position of the first sample of
+ * the new source (see GetPosition); switches to the source that is already
+ * active (playlist repeats) are reported too.
+ */
+typedef void (*DAC8568_StreamSwitchHook_t)(uint8_t from_source, uint8_t to_source, uint32_t position,
+                                           uint8_t returned);
+
+/* source_id of a queued release of the active source (see DAC8568_Stream_PostRelease). */
+#define DAC8568_STREAM_SOURCE_RELEASE 0xFFu
+
+#if (DAC8568_QSPI_SOURCE_MAX == 0u) || (DAC8568_QSPI_SOURCE_MAX > DAC8568_STREAM_SOURCE_RELEASE)
+#error "DAC8568_QSPI_SOURCE_MAX must be 1..255 (source ids are uint8_t, 0xFF is the release entry)"
+#endif
+
+/* Single-producer (task) / single-consumer (refill) switch queue; power of two, <= 128. */
+#ifndef DAC8568_STREAM_SWITCH_QUEUE
+#define DAC8568_STREAM_SWITCH_QUEUE 16u
+#endif
+
+#if ((DAC8568_STREAM_SWITCH_QUEUE & (DAC8568_STREAM_SWITCH_QUEUE - 1u)) != 0u) || \
+    (DAC8568_STREAM_SWITCH_QUEUE > 128u)
+#error "DAC8568_STREAM_SWITCH_QUEUE must be a power of two <= 128"
+#endif
+
+/*
+ * Per-channel output map applied to every refilled sample (after source fill
+ * and transition blend): output channel `ch` takes the code of input channel
+ * route[ch], scaled about mid-scale (0 V) and shifted:
+ *   code = sat16(32768 + ((in - 32768) * gain_q15[ch] >> 15) + offset[ch])
+ * Muted channels output DAC8568_CODE_MID. Frame headers stay those of the
+ * output channel, so routing never changes which DAC register is written.
+ */
+#define DAC8568_CODE_MID 32768
+#define DAC8568_GAIN_Q15_ONE 32768
+#define DAC8568_GAIN_Q15_MAX 65535 /* |gain| < 2.0 keeps the product inside int32 */
+#define DAC8568_CHANNEL_MASK ((1u << DAC8568_CHANNELS) - 1u) /* mute_mask bits in use */
+
+typedef struct {
+  int32_t gain_q15[DAC8568_WORDS_PER_SAMPLE]; /* -GAIN_Q15_MAX..GAIN_Q15_MAX (negative inverts) */
+  int32_t offset[DAC8568_WORDS_PER_SAMPLE];   /* DAC codes, -65535..65535 */
+  uint8_t route[DAC8568_WORDS_PER_SAMPLE];    /* input channel 0..DAC8568_CHANNELS-1 */
+  uint8_t mute_mask;                          /* bit ch: hold channel ch at mid-scale */
+} DAC8568_ChannelMap_t;
+
+/* One contiguous, wrap-free run of source samples (FRAME32 frames or CODE16x4 codes, MDMA refill). */
+typedef struct {
+  const void *src;
+  uint32_t samples;
+} DAC8568_StreamSpan_t;
+
+#ifndef DAC8568_STREAM_MAX_SPANS
+#define DAC8568_STREAM_MAX_SPANS 4u
+#endif
+
+typedef struct {
+  volatile DAC8568_SourceMode_t mode;
+  volatile uint8_t active_source;
+  DAC8568_StreamSource_t qspi[DAC8568_QSPI_SOURCE_MAX];
+  DAC8568_StreamSwitch_t switch_queue[DAC8568_STREAM_SWITCH_QUEUE];
+  volatile uint8_t switch_head;     /* written by the producer only */
+  volatile uint8_t switch_tail;     /* written by the refill only */
+  volatile uint8_t switch_flush;    /* producer asks the refill to drop entries before flush_to */
+  volatile uint8_t switch_flush_to;
+  volatile uint32_t switch_late;    /* timed entries applied after their sample index */
+  volatile uint32_t position;       /* samples produced since Init (wraps) */
+  uint32_t phase[4];
+  uint32_t phase_inc[4];
+  uint8_t transition;               /* DAC8568_Transition_t, used for the next switch */
+  uint32_t transition_samples;
+  DAC8568_StreamSource_t fade_from; /* outgoing source while a transition runs */
+  uint8_t fade_mode;
+  uint32_t fade_pos;                /* samples already blended */
+  uint32_t fade_len;                /* 0: no transition in progress */
+  DAC8568_ChannelMap_t map;
+  uint8_t map_active;               /* 0: identity map, refill output untouched */
+  uint8_t return_pending;           /* released source returns to source 0 at return_at */
+  uint32_t return_at;
+  DAC8568_StreamSwitchHook_t on_switch; /* NULL: none */
+} DAC8568_Stream_t;
+
+void DAC8568_Stream_PrepareLut(void);
+uint16_t DAC8568_Stream_VoltageToCode(float voltage);
+
+void DAC8568_Stream_Init(DAC8568_Stream_t *s, uint32_t sample_rate_hz);
+void DAC8568_Stream_SetSampleRate(DAC8568_Stream_t *s, uint32_t sample_rate_hz);
+void DAC8568_Stream_ClearSources(DAC8568_Stream_t *s);
+uint32_t DAC8568_Stream_BytesPerSample(uint8_t format);
+void DAC8568_Stream_SetSource(DAC8568_Stream_t *s, uint8_t source_id, const void *data,
+                              uint32_t samples, uint8_t format, uint8_t reset_index);
+/*
+ * Switch queue producer side (one producer context, e.g. Main_Task).
+ * PostSwitch applies at the next refill; QueueSwitchAt applies when the stream
+ * position reaches `at_sample` (see GetPosition). Both return -1 when full.
+ */
+int32_t DAC8568_Stream_PostSwitch(DAC8568_Stream_t *s, uint8_t source_id, const void *data,
+                                  uint32_t samples, uint8_t format, uint8_t reset_index);
+int32_t DAC8568_Stream_QueueSwitchAt(DAC8568_Stream_t *s, uint8_t source_id, const void *data,
+                                     uint32_t samples, uint8_t format, uint8_t reset_index,
+                                     uint32_t at_sample);
+uint32_t DAC8568_Stream_SwitchQueueFree(const DAC8568_Stream_t *s);
+/* Drop every queued switch; the refill honours it before applying anything else. */
+void DAC8568_Stream_FlushSwitches(DAC8568_Stream_t *s);
+/* Install the switch hook (NULL removes it); set while no refill can run. */
+void DAC8568_Stream_SetSwitchHook(DAC8568_Stream_t *s, DAC8568_StreamSwitchHook_t hook);
+/* Sample index the next refill starts at (samples written to the ring so far). */
+uint32_t DAC8568_Stream_GetPosition(const DAC8568_Stream_t *s);
+/*
+ * Playback speed of one source (kept across switches to it). The fractional
+ * position restarts whenever the index is reset. Returns 0 or -1 for a bad
+ * id / speed outside DAC8568_STREAM_SPEED_MIN..MAX.
+ */
+int32_t DAC8568_Stream_SetSpeed(DAC8568_Stream_t *s, uint8_t source_id, uint32_t speed_q16,
+                                DAC8568_Interp_t interp);
+/*
+ * Loop markers of one source (kept across switches to it, see
+ * DAC8568_LOOP_ONE_SHOT). loop_end = 0 clears them; markers that do not fit
+ * the source data play the whole source. Returns 0 or -1 for a bad id /
+ * loop_start >= loop_end.
+ */
+int32_t DAC8568_Stream_SetLoop(DAC8568_Stream_t *s, uint8_t source_id, uint32_t loop_start,
+                               uint32_t loop_end, uint8_t flags);
+/*
+ * Queue a release of whatever source is active when it lands (ignored for
+ * source 0): the sustain loop ends, the tail plays and the stream returns to
+ * source 0 by itself. Ordered with the switch queue; -1 when full.
+ */
+int32_t DAC8568_Stream_PostRelease(DAC8568_Stream_t *s);
+/* Identity map: unity gain, no offset, straight routing, nothing muted. */
+void DAC8568_Stream_ChannelMapIdentity(DAC8568_ChannelMap_t *map);
+/*
+ * Install the output map used from the next refill chunk on (NULL = identity).
+ * Returns 0 or -1 for an out-of-range gain / offset / route.
+ */
+int32_t DAC8568_Stream_SetChannelMap(DAC8568_Stream_t *s, const DAC8568_ChannelMap_t *map);
+/* Transition for subsequent switches; HARD or 0 samples restores the plain cut. */
+void DAC8568_Stream_SetTransition(DAC8568_Stream_t *s, DAC8568_Transition_t mode,
+                                  uint32_t samples);
+void DAC8568_Stream_Fill(DAC8568_Stream_t *s, uint32_t *dst, uint32_t sample_count);
+/* Original per-sample refill loop; always built so host benchmarks can compare against it. */
+void DAC8568_Stream_FillReference(DAC8568_Stream_t *s, uint32_t *dst, uint32_t sample_count);
+
+/*
+ * Advance the stream by `sample_count` like Fill, but only describe the copy.
+ * Returns the number of spans written, or 0 when the refill cannot be a plain
+ * copy (LUT / CODE16x4 / synth / compressed / resampled source, a channel map
+ * is active, a timed switch falls inside it, a transition is being blended,
+ * or more than `max_spans` wraps); the stream is
+ * left untouched in that case (apart from applying due switches) and the
+ * caller should use DAC8568_Stream_Fill().
+ */
+uint32_t DAC8568_Stream_PlanCopy(DAC8568_Stream_t *s, uint32_t sample_count,
+                                 DAC8568_StreamSpan_t *spans, uint32_t max_spans);
+/*
+ * Same for a 4-byte aligned CODE16x4 source at its stored rate: the spans hold
+ * codes, which the caller stages contiguously in SRAM (MDMA) and then packs
+ * with DAC8568_Stream_PackCodes(), so the refill never waits on QSPI itself.
+ * Same conditions and return value as PlanCopy otherwise.
+ */
+uint32_t DAC8568_Stream_PlanStage(DAC8568_Stream_t *s, uint32_t sample_count,
+                                  DAC8568_StreamSpan_t *spans, uint32_t max_spans);
+
+/* Pack `samples` x 4 codes (A,B,C,D) into 4 frames each; codes must be 4-byte aligned. */
+void DAC8568_Stream_PackCodes(uint32_t *dst, const uint16_t *codes, uint32_t samples);
+
+#endif
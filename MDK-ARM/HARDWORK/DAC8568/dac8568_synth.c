@@ -0,0 +1,526 @@
+#include "dac8568_synth.h"
+
+#include "dac8568_stream.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Q30 sine, +1 entry so the interpolation never wraps. */
+#define SYNTH_SIN_BITS 10u
+#define SYNTH_SIN_SIZE (1u << SYNTH_SIN_BITS)
+/* Columns of M^(2^k) for the xorshift32 transition matrix M; covers 2^24 draws. */
+#define SYNTH_JUMP_LEVELS 24u
+
+#define SYNTH_Q30_ONE (1u << 30)
+/* 1 V external = 3276.75 codes = 838848 Q8 codes (voltage_to_code slope). */
+#define SYNTH_Q8_PER_VOLT 838848
+#define SYNTH_Q8_FULL (5 * SYNTH_Q8_PER_VOLT)
+
+enum {
+  TONE_LINE = 0,
+  TONE_RIPPLE,
+  TONE_RIPPLE2,
+  TONE_PWM,
+  TONE_PWM2,
+  TONE_MOD,
+  TONE_DRIFT1,
+  TONE_DRIFT2
+};
+
+/* st->lv[] slots: shared operating point, then per-kind levels. */
+enum {
+  LV_BUS = 0,
+  LV_BUS_RIPPLE,
+  LV_LOAD,
+  LV_LOAD_RIPPLE,
+  LV_LEAK,
+  LV_LEAK_NOISE,
+  LV_K0,
+  LV_K1,
+  LV_K2,
+  LV_K3,
+  LV_K4,
+  LV_K5,
+  LV_K6,
+  LV_K7
+};
+
+static int32_t g_synth_sin[SYNTH_SIN_SIZE + 1u];
+static uint32_t g_synth_jump[SYNTH_JUMP_LEVELS][32];
+static uint8_t g_synth_ready = 0u;
+
+static inline uint32_t synth_xorshift(uint32_t x) {
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+/* GF(2) matrix (32 columns) times vector. */
+static uint32_t synth_apply(const uint32_t *cols, uint32_t x) {
+  uint32_t y = 0u;
+  for (uint32_t j = 0u; x != 0u; j++, x >>= 1) {
+    if ((x & 1u) != 0u) {
+      y ^= cols[j];
+    }
+  }
+  return y;
+}
+
+static uint32_t synth_rng_jump(uint32_t x, uint32_t draws) {
+  for (uint32_t k = 0u; draws != 0u && k < SYNTH_JUMP_LEVELS; k++, draws >>= 1) {
+    if ((draws & 1u) != 0u) {
+      x = synth_apply(g_synth_jump[k], x);
+    }
+  }
+  return x;
+}
+
+void DAC8568_Synth_Prepare(void) {
+  for (uint32_t i = 0u; i <= SYNTH_SIN_SIZE; i++) {
+    const double s = sin((2.0 * 3.14159265358979323846 * (double)i) / (double)SYNTH_SIN_SIZE) * 1073741824.0;
+    g_synth_sin[i] = (int32_t)((s < 0.0) ? (s - 0.5) : (s + 0.5));
+  }
+  for (uint32_t j = 0u; j < 32u; j++) {
+    g_synth_jump[0][j] = synth_xorshift(1u << j);
+  }
+  for (uint32_t k = 1u; k < SYNTH_JUMP_LEVELS; k++) {
+    for (uint32_t j = 0u; j < 32u; j++) {
+      g_synth_jump[k][j] = synth_apply(g_synth_jump[k - 1u], g_synth_jump[k - 1u][j]);
+    }
+  }
+  g_synth_ready = 1u;
+}
+
+/* Python round() (half to even) of num / den. */
+static uint32_t synth_round_div(uint64_t num, uint64_t den) {
+  uint64_t q = num / den;
+  const uint64_t r2 = (num % den) * 2u;
+  if (r2 > den || (r2 == den && (q & 1u) != 0u)) {
+    q++;
+  }
+  return (q > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (uint32_t)q;
+}
+
+/* cycles_for_hz(): whole cycles per loop, at least 1 (0 Hz = silent). */
+static uint32_t synth_cycles(uint32_t hz, uint32_t rate, uint32_t loop) {
+  if (hz == 0u) {
+    return 0u;
+  }
+  const uint32_t c = synth_round_div((uint64_t)hz * loop, rate);
+  return (c == 0u) ? 1u : c;
+}
+
+static uint32_t synth_us_to_samples(uint32_t us, uint32_t rate) {
+  const uint32_t n = synth_round_div((uint64_t)us * rate, 1000000u);
+  return (n == 0u) ? 1u : n;
+}
+
+static int32_t synth_mv(int32_t mv) {
+  const int64_t q = (int64_t)mv * SYNTH_Q8_PER_VOLT;
+  return (int32_t)((q < 0) ? ((q - 500) / 1000) : ((q + 500) / 1000));
+}
+
+void DAC8568_Synth_DefaultParams(DAC8568_SynthParams_t *p, DAC8568_SynthKind_t kind,
+                                 uint32_t sample_rate_hz, uint32_t loop_samples) {
+  if (p == NULL) {
+    return;
+  }
+  *p = (DAC8568_SynthParams_t){0};
+  p->kind = (uint8_t)kind;
+  p->seed = DAC8568_SYNTH_SEED;
+  p->sample_rate_hz = sample_rate_hz;
+  p->loop_samples = loop_samples;
+  p->line_hz = 50u;
+  p->ripple_hz = 100u;
+  p->ripple2_hz = 120u;
+  p->pwm_hz = 8000u;
+  p->pwm2_hz = 12000u;
+  p->mod_hz = 10u;
+  p->bus_mv = 3000;
+  p->bus_ripple_mv = 30;
+  p->load_mv = 1500;
+  p->load_ripple_mv = 60;
+  p->leak_mv = 50;
+  p->leak_noise_mv = 5;
+
+  switch (kind) {
+    case DAC8568_SYNTH_AC_COUPLING:
+      p->leak_noise_mv = 10;
+      p->u.ac_coupling.cm_line_mv = 350;
+      p->u.ac_coupling.cm_ripple_mv = 180;
+      p->u.ac_coupling.hf_mv = 50;
+      p->u.ac_coupling.hf2_mv = 20;
+      p->u.ac_coupling.leak_line_mv = 50;
+      break;
+    case DAC8568_SYNTH_BUS_GROUND:
+      p->u.bus_ground.period_us = 100000u;
+      p->u.bus_ground.sag_us = 5000u;
+      p->u.bus_ground.surge_us = 1000u;
+      p->u.bus_ground.tau_us = 2000u;
+      p->u.bus_ground.sag_bus_mv = 500;
+      p->u.bus_ground.sag_neg_shift_mv = 1300;
+      p->u.bus_ground.surge_load_mv = 3000;
+      p->u.bus_ground.sag_load_mv = 200;
+      p->u.bus_ground.sag_leak_mv = 200;
+      p->u.bus_ground.leak_spike_mv = 1000;
+      break;
+    case DAC8568_SYNTH_INSULATION:
+      p->leak_noise_mv = 20;
+      p->u.insulation.drift_mv = 200;
+      p->u.insulation.slow_mv = 80;
+      p->u.insulation.bus_noise_mv = 20;
+      p->u.insulation.load_noise_mv = 50;
+      p->u.insulation.leak_rise_mv = 450;
+      break;
+    case DAC8568_SYNTH_CAP_AGING:
+      p->bus_mv = 2400;
+      p->bus_ripple_mv = 1800;
+      p->load_ripple_mv = 800;
+      p->u.cap_aging.bus_ripple2_mv = 300;
+      p->u.cap_aging.load_ripple2_mv = 150;
+      break;
+    case DAC8568_SYNTH_PWM_ABNORMAL:
+      p->leak_noise_mv = 10;
+      p->u.pwm_abnormal.bus_pwm_mv = 100;
+      p->u.pwm_abnormal.bus_pwm2_mv = 50;
+      p->u.pwm_abnormal.load_pwm_mv = 500;
+      p->u.pwm_abnormal.load_pwm2_mv = 200;
+      p->u.pwm_abnormal.mod_permille = 200;
+      p->u.pwm_abnormal.load_noise_mv = 30;
+      p->u.pwm_abnormal.leak_pwm_mv = 30;
+      break;
+    case DAC8568_SYNTH_IGBT_FAULT:
+      p->u.igbt_fault.period_us = 20000u;
+      p->u.igbt_fault.w1_us = 1000u;
+      p->u.igbt_fault.w2_us = 1000u;
+      p->u.igbt_fault.tau_us = 1500u;
+      p->u.igbt_fault.drop1_mv = 1200;
+      p->u.igbt_fault.drop2_mv = 600;
+      p->u.igbt_fault.load1_mv = 0;
+      p->u.igbt_fault.load2_mv = 400;
+      p->u.igbt_fault.spike1_mv = 500;
+      p->u.igbt_fault.spike2_mv = 250;
+      break;
+    default:
+      break;
+  }
+}
+
+static void synth_set_decay(DAC8568_Synth_t *st, uint32_t tau_us, uint32_t rate) {
+  double tau = (double)rate * (double)tau_us / 1000000.0;
+  if (tau < 1.0) {
+    tau = 1.0;
+  }
+  st->tau = (float)tau;
+  st->decay_q30 = (uint32_t)(exp(-1.0 / tau) * (double)SYNTH_Q30_ONE + 0.5);
+}
+
+int32_t DAC8568_Synth_Configure(DAC8568_Synth_t *st, const DAC8568_SynthParams_t *p) {
+  if (st == NULL || p == NULL || p->kind >= (uint8_t)DAC8568_SYNTH_KIND_COUNT ||
+      p->sample_rate_hz == 0u || p->loop_samples == 0u || p->loop_samples > DAC8568_SYNTH_LOOP_MAX) {
+    return -1;
+  }
+  if (g_synth_ready == 0u) {
+    DAC8568_Synth_Prepare();
+  }
+
+  const uint32_t rate = p->sample_rate_hz;
+  const uint32_t loop = p->loop_samples;
+  const uint32_t hz[DAC8568_SYNTH_TONES] = {
+    p->line_hz, p->ripple_hz, p->ripple2_hz, p->pwm_hz, p->pwm2_hz, p->mod_hz, 0u, 0u,
+  };
+  DAC8568_Synth_t next = {0};
+
+  next.params = *p;
+  next.loop = loop;
+  for (uint32_t t = 0u; t < DAC8568_SYNTH_TONES; t++) {
+    uint32_t c = synth_cycles(hz[t], rate, loop);
+    if (t == TONE_DRIFT1 || t == TONE_DRIFT2) {
+      c = t - TONE_DRIFT1 + 1u;
+    }
+    c %= loop; /* whole loops alias to DC, exactly like sin(2 pi c i / N) */
+    const uint64_t full = (uint64_t)c << 32;
+    next.tone_cycles[t] = c;
+    next.tone_inc[t] = (uint32_t)(full / loop);
+    next.tone_rem[t] = (uint32_t)(full % loop);
+  }
+
+  next.lv[LV_BUS] = synth_mv(p->bus_mv);
+  next.lv[LV_BUS_RIPPLE] = synth_mv(p->bus_ripple_mv);
+  next.lv[LV_LOAD] = synth_mv(p->load_mv);
+  next.lv[LV_LOAD_RIPPLE] = synth_mv(p->load_ripple_mv);
+  next.lv[LV_LEAK] = synth_mv(p->leak_mv);
+  next.lv[LV_LEAK_NOISE] = synth_mv(p->leak_noise_mv);
+  next.noise_calls = 1u;
+  next.period = 1u;
+  next.decay_q30 = SYNTH_Q30_ONE;
+  next.tau = 1.0f;
+
+  switch ((DAC8568_SynthKind_t)p->kind) {
+    case DAC8568_SYNTH_AC_COUPLING:
+      next.lv[LV_K0] = synth_mv(p->u.ac_coupling.cm_line_mv);
+      next.lv[LV_K1] = synth_mv(p->u.ac_coupling.cm_ripple_mv);
+      next.lv[LV_K2] = synth_mv(p->u.ac_coupling.hf_mv);
+      next.lv[LV_K3] = synth_mv(p->u.ac_coupling.hf2_mv);
+      next.lv[LV_K4] = synth_mv(p->u.ac_coupling.leak_line_mv);
+      break;
+    case DAC8568_SYNTH_BUS_GROUND:
+      next.period = synth_us_to_samples(p->u.bus_ground.period_us, rate);
+      next.win1 = synth_us_to_samples(p->u.bus_ground.sag_us, rate);
+      next.win2 = synth_us_to_samples(p->u.bus_ground.surge_us, rate);
+      synth_set_decay(&next, p->u.bus_ground.tau_us, rate);
+      next.lv[LV_K0] = synth_mv(p->u.bus_ground.sag_bus_mv);
+      next.lv[LV_K1] = synth_mv(p->u.bus_ground.sag_neg_shift_mv);
+      next.lv[LV_K2] = synth_mv(p->u.bus_ground.surge_load_mv);
+      next.lv[LV_K3] = synth_mv(p->u.bus_ground.sag_load_mv);
+      next.lv[LV_K4] = synth_mv(p->u.bus_ground.sag_leak_mv);
+      next.lv[LV_K5] = synth_mv(p->u.bus_ground.leak_spike_mv);
+      break;
+    case DAC8568_SYNTH_INSULATION:
+      next.noise_calls = 4u;
+      next.lv[LV_K0] = synth_mv(p->u.insulation.drift_mv);
+      next.lv[LV_K1] = synth_mv(p->u.insulation.slow_mv);
+      next.lv[LV_K2] = synth_mv(p->u.insulation.bus_noise_mv);
+      next.lv[LV_K3] = synth_mv(p->u.insulation.load_noise_mv);
+      /* env = (1 + sin) / 2: DC and sine halves of the rise. */
+      next.lv[LV_K4] = synth_mv(p->u.insulation.leak_rise_mv) / 2;
+      break;
+    case DAC8568_SYNTH_CAP_AGING:
+      next.lv[LV_K0] = synth_mv(p->u.cap_aging.bus_ripple2_mv);
+      next.lv[LV_K1] = synth_mv(p->u.cap_aging.load_ripple2_mv);
+      break;
+    case DAC8568_SYNTH_PWM_ABNORMAL:
+      next.noise_calls = 2u;
+      next.lv[LV_K0] = synth_mv(p->u.pwm_abnormal.bus_pwm_mv);
+      next.lv[LV_K1] = synth_mv(p->u.pwm_abnormal.bus_pwm2_mv);
+      next.lv[LV_K2] = synth_mv(p->u.pwm_abnormal.load_pwm_mv);
+      next.lv[LV_K3] = synth_mv(p->u.pwm_abnormal.load_pwm2_mv);
+      next.lv[LV_K4] = (int32_t)(((int64_t)p->u.pwm_abnormal.mod_permille << 30) / 1000); /* Q30 */
+      next.lv[LV_K5] = synth_mv(p->u.pwm_abnormal.load_noise_mv);
+      next.lv[LV_K6] = synth_mv(p->u.pwm_abnormal.leak_pwm_mv);
+      if (p->u.pwm_abnormal.mod_permille > 1000 || p->u.pwm_abnormal.mod_permille < -1000) {
+        return -1;
+      }
+      break;
+    case DAC8568_SYNTH_IGBT_FAULT:
+      next.period = synth_us_to_samples(p->u.igbt_fault.period_us, rate);
+      next.win1 = synth_us_to_samples(p->u.igbt_fault.w1_us, rate);
+      next.win2 = next.win1 + synth_us_to_samples(p->u.igbt_fault.w2_us, rate);
+      synth_set_decay(&next, p->u.igbt_fault.tau_us, rate);
+      next.lv[LV_K0] = synth_mv(p->u.igbt_fault.drop1_mv);
+      next.lv[LV_K1] = synth_mv(p->u.igbt_fault.drop2_mv);
+      next.lv[LV_K2] = synth_mv(p->u.igbt_fault.load1_mv);
+      next.lv[LV_K3] = synth_mv(p->u.igbt_fault.load2_mv);
+      next.lv[LV_K4] = synth_mv(p->u.igbt_fault.spike1_mv);
+      next.lv[LV_K5] = synth_mv(p->u.igbt_fault.spike2_mv);
+      break;
+    default:
+      break;
+  }
+
+  /* Draws per loop must stay inside the jump table. */
+  if ((uint64_t)loop * next.noise_calls > (1ull << SYNTH_JUMP_LEVELS)) {
+    return -1;
+  }
+
+  next.pos = loop; /* forces a seek on the first Render() */
+  *st = next;
+  return 0;
+}
+
+uint32_t DAC8568_Synth_LoopSamples(const DAC8568_Synth_t *st) {
+  return (st != NULL) ? st->loop : 0u;
+}
+
+/* Put every generator at loop index `pos` (< loop) in O(log pos). */
+static void synth_seek(DAC8568_Synth_t *st, uint32_t pos) {
+  const uint32_t loop = st->loop;
+
+  st->pos = pos;
+  st->rng = synth_rng_jump(st->params.seed, pos * st->noise_calls);
+  for (uint32_t t = 0u; t < DAC8568_SYNTH_TONES; t++) {
+    /* phase * loop + err = (cycles * pos mod loop) << 32, same invariant the per-sample step keeps. */
+    const uint64_t m = ((uint64_t)st->tone_cycles[t] * pos) % loop;
+    st->phase[t] = (uint32_t)((m << 32) / loop);
+    st->err[t] = (uint32_t)((m << 32) % loop);
+  }
+  st->win = pos % st->period;
+  float k = (float)st->win;
+  if (st->params.kind == (uint8_t)DAC8568_SYNTH_IGBT_FAULT && st->win >= st->win1) {
+    k -= (float)st->win1;
+  }
+  st->env_q30 = (uint32_t)(expf(-k / st->tau) * (float)SYNTH_Q30_ONE + 0.5f);
+}
+
+static inline int32_t synth_sin(uint32_t phase) {
+  const uint32_t i = phase >> (32u - SYNTH_SIN_BITS);
+  const int32_t frac = (int32_t)((phase >> (16u - SYNTH_SIN_BITS)) & 0xFFFFu);
+  const int32_t y0 = g_synth_sin[i];
+  return y0 + (int32_t)(((int64_t)(g_synth_sin[i + 1u] - y0) * frac + 32768) >> 16);
+}
+
+/* Q8 level x Q30 sine / factor (SMULL + rounding). */
+static inline int32_t synth_mul(int32_t level, int32_t s_q30) {
+  return (int32_t)(((int64_t)level * s_q30 + (1 << 29)) >> 30);
+}
+
+static inline int32_t synth_decay(int32_t level, uint32_t env_q30) {
+  return (int32_t)(((int64_t)level * env_q30) >> 30);
+}
+
+/* rng.noise(amp): (u24 / 2^24 * 2 - 1) * amp. */
+static inline int32_t synth_noise(uint32_t *rng, int32_t amp) {
+  const uint32_t x = synth_xorshift(*rng);
+  *rng = x;
+  return (int32_t)(((int64_t)amp * ((int32_t)(x & 0xFFFFFFu) - 0x800000)) >> 23);
+}
+
+static inline uint32_t synth_code(int32_t v, int32_t lo) {
+  if (v < lo) {
+    v = lo;
+  } else if (v > SYNTH_Q8_FULL) {
+    v = SYNTH_Q8_FULL;
+  }
+  return (uint32_t)(((int32_t)DAC8568_CODE_MID * 256 + v) >> 8);
+}
+
+/* One sample of the current kind at st->pos, Q8 codes about mid-scale. */
+static void synth_sample(DAC8568_Synth_t *st, int32_t v[4]) {
+  const int32_t *lv = st->lv;
+  const int32_t s100 = synth_sin(st->phase[TONE_RIPPLE]);
+  const int32_t bus_rip = synth_mul(lv[LV_BUS_RIPPLE], s100);
+
+  v[0] = lv[LV_BUS] + bus_rip;
+  v[1] = -lv[LV_BUS] - bus_rip;
+  v[2] = lv[LV_LOAD] + synth_mul(lv[LV_LOAD_RIPPLE], s100);
+  v[3] = lv[LV_LEAK];
+
+  switch ((DAC8568_SynthKind_t)st->params.kind) {
+    case DAC8568_SYNTH_AC_COUPLING: {
+      const int32_t s50 = synth_sin(st->phase[TONE_LINE]);
+      const int32_t cm = synth_mul(lv[LV_K0], s50) + synth_mul(lv[LV_K1], s100);
+      const int32_t hf = synth_mul(lv[LV_K2], synth_sin(st->phase[TONE_PWM])) +
+                         synth_mul(lv[LV_K3], synth_sin(st->phase[TONE_PWM2]));
+      v[0] += cm + hf;
+      v[1] += cm + hf;
+      v[2] += cm;
+      v[3] += synth_mul(lv[LV_K4], (s50 < 0) ? -s50 : s50) + synth_noise(&st->rng, lv[LV_LEAK_NOISE]);
+      break;
+    }
+    case DAC8568_SYNTH_BUS_GROUND:
+      v[3] += synth_noise(&st->rng, lv[LV_LEAK_NOISE]);
+      if (st->win < st->win1) {
+        v[0] = lv[LV_K0];
+        v[1] += lv[LV_K1];
+        v[2] = (st->win < st->win2) ? lv[LV_K2] : lv[LV_K3];
+        v[3] = lv[LV_K4] + synth_decay(lv[LV_K5], st->env_q30);
+      }
+      break;
+    case DAC8568_SYNTH_INSULATION: {
+      const int32_t drift = synth_mul(lv[LV_K0], synth_sin(st->phase[TONE_DRIFT2]));
+      const int32_t s1 = synth_sin(st->phase[TONE_DRIFT1]);
+      v[0] += drift + synth_noise(&st->rng, lv[LV_K2]);
+      v[1] += drift + synth_noise(&st->rng, lv[LV_K2]);
+      v[2] += synth_mul(lv[LV_K1], s1) + synth_noise(&st->rng, lv[LV_K3]);
+      v[3] += lv[LV_K4] + synth_mul(lv[LV_K4], s1) + synth_noise(&st->rng, lv[LV_LEAK_NOISE]);
+      break;
+    }
+    case DAC8568_SYNTH_CAP_AGING: {
+      const int32_t s120 = synth_sin(st->phase[TONE_RIPPLE2]);
+      const int32_t bus_rip2 = synth_mul(lv[LV_K0], s120);
+      v[0] += bus_rip2;
+      v[1] -= bus_rip2;
+      v[2] += synth_mul(lv[LV_K1], s120);
+      v[3] += synth_noise(&st->rng, lv[LV_LEAK_NOISE]);
+      break;
+    }
+    case DAC8568_SYNTH_PWM_ABNORMAL: {
+      const int32_t s8k = synth_sin(st->phase[TONE_PWM]);
+      const int32_t s12k = synth_sin(st->phase[TONE_PWM2]);
+      const int32_t hf = synth_mul(lv[LV_K0], s8k) + synth_mul(lv[LV_K1], s12k);
+      const int32_t load_hf = synth_mul(lv[LV_K2], s8k) + synth_mul(lv[LV_K3], s12k);
+      /* (1 + depth * s10) * load_hf */
+      const int32_t mod = synth_mul(synth_mul(load_hf, synth_sin(st->phase[TONE_MOD])), lv[LV_K4]);
+      v[0] += hf;
+      v[1] += hf;
+      v[2] += load_hf + mod + synth_noise(&st->rng, lv[LV_K5]);
+      v[3] += synth_mul(lv[LV_K6], s8k) + synth_noise(&st->rng, lv[LV_LEAK_NOISE]);
+      break;
+    }
+    case DAC8568_SYNTH_IGBT_FAULT:
+      v[3] += synth_noise(&st->rng, lv[LV_LEAK_NOISE]);
+      if (st->win < st->win1) {
+        v[0] -= lv[LV_K0];
+        v[1] += lv[LV_K0];
+        v[2] = lv[LV_K2];
+        v[3] += synth_decay(lv[LV_K4], st->env_q30);
+      } else if (st->win < st->win2) {
+        v[0] -= lv[LV_K1];
+        v[1] += lv[LV_K1];
+        v[2] = lv[LV_K3];
+        v[3] += synth_decay(lv[LV_K5], st->env_q30);
+      }
+      break;
+    default:
+      v[3] += synth_noise(&st->rng, lv[LV_LEAK_NOISE]);
+      break;
+  }
+}
+
+/* Advance tones and windows by one sample; the loop end restarts everything. */
+static inline void synth_step(DAC8568_Synth_t *st) {
+  if (++st->pos >= st->loop) {
+    synth_seek(st, 0u);
+    return;
+  }
+  for (uint32_t t = 0u; t < DAC8568_SYNTH_TONES; t++) {
+    uint32_t err = st->err[t] + st->tone_rem[t];
+    uint32_t phase = st->phase[t] + st->tone_inc[t];
+    if (err >= st->loop) {
+      err -= st->loop;
+      phase++;
+    }
+    st->err[t] = err;
+    st->phase[t] = phase;
+  }
+  if (++st->win >= st->period) {
+    st->win = 0u;
+    st->env_q30 = SYNTH_Q30_ONE;
+  } else if (st->params.kind == (uint8_t)DAC8568_SYNTH_IGBT_FAULT && st->win == st->win1) {
+    st->env_q30 = SYNTH_Q30_ONE;
+  } else {
+    st->env_q30 = (uint32_t)(((uint64_t)st->env_q30 * st->decay_q30 + (SYNTH_Q30_ONE >> 1)) >> 30);
+  }
+}
+
+uint32_t DAC8568_Synth_Render(DAC8568_Synth_t *st, uint32_t index, uint32_t *dst, uint32_t samples) {
+  if (st->loop == 0u) {
+    return 0u;
+  }
+  if (index >= st->loop) {
+    index %= st->loop;
+  }
+  if (index != st->pos) {
+    synth_seek(st, index);
+  }
+
+  for (uint32_t i = 0u; i < samples; i++) {
+    int32_t v[4];
+    synth_sample(st, v);
+    dst[0] = DAC8568_FRAME_A_PREFIX | (synth_code(v[0], -SYNTH_Q8_FULL) << 4);
+    dst[1] = DAC8568_FRAME_B_PREFIX | (synth_code(v[1], -SYNTH_Q8_FULL) << 4);
+    dst[2] = DAC8568_FRAME_C_PREFIX | (synth_code(v[2], 0) << 4);
+    dst[3] = DAC8568_FRAME_D_PREFIX | (synth_code(v[3], 0) << 4);
+#if DAC8568_CHANNELS == 8u
+    dst[4] = DAC8568_FRAME_E_PREFIX | ((uint32_t)DAC8568_CODE_MID << 4);
+    dst[5] = DAC8568_FRAME_F_PREFIX | ((uint32_t)DAC8568_CODE_MID << 4);
+    dst[6] = DAC8568_FRAME_G_PREFIX | ((uint32_t)DAC8568_CODE_MID << 4);
+    dst[7] = DAC8568_FRAME_H_PREFIX | ((uint32_t)DAC8568_CODE_MID << 4);
+#endif
+    dst += DAC8568_WORDS_PER_SAMPLE;
+    synth_step(st);
+  }
+  return st->pos;
+}
@@ -0,0 +1,172 @@
+#ifndef DAC8568_SYNTH_H
+#define DAC8568_SYNTH_H
+
+/*
+ * HAL-free procedural fault synthesis.
+ *
+ * Renders the seven waveforms of tools/gen_dac_fault_suite.py (normal and the
+ * six faults) sample by sample instead of playing 4 MB pre-rendered QSPI
+ * partitions. The model is the generator's, in fixed point:
+ *   - tones are whole cycles per loop (cycles_for_hz) on Bresenham-exact
+ *     32-bit phase accumulators and a Q30 sine table,
+ *   - noise is the generator's xorshift32 stream (same seed, same call order),
+ *   - sag / IGBT windows are sample counters with an exponential decay,
+ *   - levels are summed in Q8 DAC codes and clamped like clamp_bipolar /
+ *     clamp_unipolar before voltage_to_code.
+ * Every loop_samples the tones, the noise and the windows restart, so a
+ * synthesized source loops exactly like the partition file it replaces; the
+ * output matches that file within 1 LSB (tools/dac8568_sim --synth-check).
+ *
+ * A synth source is a stream source of format DAC8568_WAVE_FORMAT_SYNTH whose
+ * `data` points to a DAC8568_Synth_t. Render() takes the stream index, so
+ * seeks (index resets, the baseline running on during a fault) cost one
+ * xorshift jump-ahead instead of replaying the noise.
+ */
+
+#include <stdint.h>
+
+/* Tone phases are exact up to 2^32 / loop; the noise jump-ahead table covers loop x 4 calls. */
+#define DAC8568_SYNTH_LOOP_MAX 0x00400000u
+#define DAC8568_SYNTH_SEED 0xA5A5A5A5u
+
+/* Values follow SD_DacWavePartition_t (partition 0 = normal, 1..6 = faults). */
+typedef enum {
+  DAC8568_SYNTH_NORMAL = 0,
+  DAC8568_SYNTH_AC_COUPLING = 1,
+  DAC8568_SYNTH_BUS_GROUND = 2,
+  DAC8568_SYNTH_INSULATION = 3,
+  DAC8568_SYNTH_CAP_AGING = 4,
+  DAC8568_SYNTH_PWM_ABNORMAL = 5,
+  DAC8568_SYNTH_IGBT_FAULT = 6,
+  DAC8568_SYNTH_KIND_COUNT = 7
+} DAC8568_SynthKind_t;
+
+/*
+ * Channels: A = +bus, B = -bus, C = load current, D = leakage current.
+ * Levels are mV of the external +/-5 V domain; windows are microseconds.
+ * DAC8568_Synth_DefaultParams() returns the generator's values per kind.
+ */
+typedef struct {
+  uint8_t kind;              /* DAC8568_SynthKind_t */
+  uint32_t seed;             /* xorshift32 seed, DAC8568_SYNTH_SEED */
+  uint32_t sample_rate_hz;   /* rate the loop is laid out for (Hz -> cycles, us -> samples) */
+  uint32_t loop_samples;     /* 1..DAC8568_SYNTH_LOOP_MAX, the partition sample_count */
+
+  /* Tones; each is rounded to whole cycles per loop (at least 1). */
+  uint32_t line_hz;          /* 50 */
+  uint32_t ripple_hz;        /* 100 */
+  uint32_t ripple2_hz;       /* 120 */
+  uint32_t pwm_hz;           /* 8000 */
+  uint32_t pwm2_hz;          /* 12000 */
+  uint32_t mod_hz;           /* 10 */
+
+  /* Healthy operating point shared by every kind. */
+  int32_t bus_mv;            /* A = +bus, B = -bus */
+  int32_t bus_ripple_mv;     /* ripple_hz on A, inverted on B */
+  int32_t load_mv;
+  int32_t load_ripple_mv;    /* ripple_hz on C */
+  int32_t leak_mv;
+  int32_t leak_noise_mv;
+
+  union {
+    struct {
+      int32_t cm_line_mv;    /* common mode on A/B/C at line_hz */
+      int32_t cm_ripple_mv;  /* common mode on A/B/C at ripple_hz */
+      int32_t hf_mv;         /* A/B at pwm_hz */
+      int32_t hf2_mv;        /* A/B at pwm2_hz */
+      int32_t leak_line_mv;  /* |line_hz| on D */
+    } ac_coupling;
+    struct {
+      uint32_t period_us;    /* sag repetition */
+      uint32_t sag_us;
+      uint32_t surge_us;     /* load surge at the start of each sag */
+      uint32_t tau_us;       /* leakage spike decay */
+      int32_t sag_bus_mv;    /* A during the sag */
+      int32_t sag_neg_shift_mv; /* added to B during the sag */
+      int32_t surge_load_mv;
+      int32_t sag_load_mv;
+      int32_t sag_leak_mv;
+      int32_t leak_spike_mv;
+    } bus_ground;
+    struct {
+      int32_t drift_mv;      /* A/B, 2 cycles per loop */
+      int32_t slow_mv;       /* C, 1 cycle per loop */
+      int32_t bus_noise_mv;
+      int32_t load_noise_mv;
+      int32_t leak_rise_mv;  /* D rises leak_mv .. leak_mv + leak_rise_mv once per loop */
+    } insulation;
+    struct {
+      int32_t bus_ripple2_mv;  /* ripple2_hz on A/B */
+      int32_t load_ripple2_mv; /* ripple2_hz on C */
+    } cap_aging;
+    struct {
+      int32_t bus_pwm_mv;    /* A/B at pwm_hz */
+      int32_t bus_pwm2_mv;   /* A/B at pwm2_hz */
+      int32_t load_pwm_mv;   /* C at pwm_hz, amplitude modulated at mod_hz */
+      int32_t load_pwm2_mv;  /* C at pwm2_hz, amplitude modulated at mod_hz */
+      int32_t mod_permille;  /* modulation depth */
+      int32_t load_noise_mv;
+      int32_t leak_pwm_mv;   /* D at pwm_hz */
+    } pwm_abnormal;
+    struct {
+      uint32_t period_us;    /* switching fault repetition */
+      uint32_t w1_us;        /* hard drop window */
+      uint32_t w2_us;        /* partial recovery window after w1 */
+      uint32_t tau_us;       /* leakage spike decay, restarted per window */
+      int32_t drop1_mv;      /* subtracted from A / added to B in w1 */
+      int32_t drop2_mv;
+      int32_t load1_mv;      /* C in w1 */
+      int32_t load2_mv;      /* C in w2 */
+      int32_t spike1_mv;     /* added to D at the start of w1 */
+      int32_t spike2_mv;
+    } igbt_fault;
+  } u;
+} DAC8568_SynthParams_t;
+
+#define DAC8568_SYNTH_TONES 8u
+
+/* Runtime state; fill with DAC8568_Synth_Configure(). */
+typedef struct {
+  DAC8568_SynthParams_t params;
+  uint32_t loop;
+  uint8_t noise_calls;                      /* xorshift draws per sample */
+  uint32_t tone_inc[DAC8568_SYNTH_TONES];   /* floor(cycles * 2^32 / loop) */
+  uint32_t tone_rem[DAC8568_SYNTH_TONES];   /* (cycles * 2^32) % loop */
+  uint32_t tone_cycles[DAC8568_SYNTH_TONES];
+  int32_t lv[16];                           /* kind-specific levels, Q8 DAC codes */
+  uint32_t period;                          /* window period / lengths, samples */
+  uint32_t win1;
+  uint32_t win2;
+  uint32_t decay_q30;                       /* exp(-1 / tau) */
+  float tau;                                /* samples, for seeks */
+
+  uint32_t pos;                             /* index of the next sample, loop = needs a seek */
+  uint32_t rng;
+  uint32_t phase[DAC8568_SYNTH_TONES];
+  uint32_t err[DAC8568_SYNTH_TONES];
+  uint32_t win;
+  uint32_t env_q30;
+} DAC8568_Synth_t;
+
+/* Sine table and xorshift jump-ahead table; call once before Configure (PrepareLut does). */
+void DAC8568_Synth_Prepare(void);
+/* Generator defaults for `kind` laid out for sample_rate_hz x loop_samples. */
+void DAC8568_Synth_DefaultParams(DAC8568_SynthParams_t *p, DAC8568_SynthKind_t kind,
+                                 uint32_t sample_rate_hz, uint32_t loop_samples);
+/*
+ * Derive the fixed-point state from `p` (task context: uses exp()).
+ * The next Render() seeks to whatever index it is given.
+ * Returns 0 or -1 for a bad kind / rate / loop / window layout.
+ */
+int32_t DAC8568_Synth_Configure(DAC8568_Synth_t *st, const DAC8568_SynthParams_t *p);
+/* Loop length in samples (0 before Configure). */
+uint32_t DAC8568_Synth_LoopSamples(const DAC8568_Synth_t *st);
+/*
+ * Write `samples` x DAC8568_WORDS_PER_SAMPLE SPI frames starting at loop index
+ * `index` (taken modulo the loop). The model has four outputs (A..D); an
+ * 8-channel build holds E..H at mid-scale. Returns the index following the
+ * last rendered sample.
+ */
+uint32_t DAC8568_Synth_Render(DAC8568_Synth_t *st, uint32_t index, uint32_t *dst, uint32_t samples);
+
+#endif
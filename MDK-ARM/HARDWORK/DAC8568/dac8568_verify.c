@@ -0,0 +1,278 @@
+#include "dac8568_verify.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define DAC8568_VERIFY_HISTORY_MASK (DAC8568_VERIFY_HISTORY - 1u)
+/* Calibration needs the codes to move at least this much on every probe within a window. */
+#define DAC8568_VERIFY_CAL_MIN_SPAN 1024
+
+static uint32_t dac8568_verify_abs(int32_t x) {
+  return (x < 0) ? (uint32_t)(-(int64_t)x) : (uint32_t)x;
+}
+
+static int32_t dac8568_verify_round(double x) {
+  return (int32_t)((x >= 0.0) ? (x + 0.5) : (x - 0.5));
+}
+
+static int32_t dac8568_verify_model(const DAC8568_VerifyProbe_t *p, uint16_t code) {
+  return p->offset + (int32_t)(((int64_t)p->gain_q16 * code + 0x8000) >> 16);
+}
+
+static void dac8568_verify_window_clear(DAC8568_Verify_t *v) {
+  v->win_n = 0u;
+  for (uint32_t p = 0u; p < DAC8568_VERIFY_PROBES_MAX; p++) {
+    v->win_err[p] = 0;
+    v->win_meas_min[p] = INT32_MAX;
+    v->win_meas_max[p] = INT32_MIN;
+    v->win_exp_min[p] = INT32_MAX;
+    v->win_exp_max[p] = INT32_MIN;
+    v->win_at_zero[p] = 0u;
+    v->win_exp_off[p] = 0u;
+    v->cal_sx[p] = 0;
+    v->cal_sy[p] = 0;
+    v->cal_sxx[p] = 0;
+    v->cal_sxy[p] = 0;
+  }
+}
+
+void DAC8568_Verify_DefaultConfig(DAC8568_VerifyConfig_t *cfg) {
+  if (cfg == NULL) {
+    return;
+  }
+  memset(cfg, 0, sizeof(*cfg));
+  cfg->probes = 1u;
+  cfg->probe[0].dac_channel = DAC8568_CHANNEL_A;
+  cfg->probe[0].gain_q16 = 0x10000;
+  cfg->decim = 32u;
+  cfg->settle_ns = 5000u;
+  cfg->window = 1024u;
+  cfg->tolerance = 512u;
+  cfg->drift_limit = 128u;
+  cfg->stuck_span = 2048u;
+  cfg->ref_band = 512u;
+}
+
+int32_t DAC8568_Verify_Configure(DAC8568_Verify_t *v, const DAC8568_VerifyConfig_t *cfg, uint32_t ring_samples) {
+  if (v == NULL || cfg == NULL || cfg->probes == 0u || cfg->probes > DAC8568_VERIFY_PROBES_MAX ||
+      cfg->window == 0u || cfg->decim == 0u || (cfg->decim & (cfg->decim - 1u)) != 0u) {
+    return -1;
+  }
+  for (uint32_t p = 0u; p < cfg->probes; p++) {
+    if (cfg->probe[p].dac_channel >= DAC8568_CHANNELS) {
+      return -1;
+    }
+  }
+  /* Expect() runs up to a ring ahead of the conversions Measure() is still reading. */
+  if (ring_samples / cfg->decim + DAC8568_VERIFY_HISTORY / 4u > DAC8568_VERIFY_HISTORY) {
+    return -1;
+  }
+
+  memset(v, 0, sizeof(*v));
+  v->cfg = *cfg;
+  DAC8568_Verify_Reset(v);
+  return 0;
+}
+
+void DAC8568_Verify_Reset(DAC8568_Verify_t *v) {
+  if (v == NULL) {
+    return;
+  }
+  for (uint32_t i = 0u; i < DAC8568_VERIFY_HISTORY; i++) {
+    v->hist_tag[i] = 0u;
+  }
+  v->next = 0u;
+  dac8568_verify_window_clear(v);
+}
+
+void DAC8568_Verify_Calibrate(DAC8568_Verify_t *v) {
+  if (v == NULL) {
+    return;
+  }
+  dac8568_verify_window_clear(v);
+  v->stats.calibrating = 1u;
+}
+
+/*
+ * Conversion indices count modulo 2^32 / decim, so they stay in step with the
+ * 32-bit TX sample counter when it wraps (decim is a power of two).
+ */
+static uint32_t dac8568_verify_index_mask(const DAC8568_Verify_t *v) {
+  return 0xFFFFFFFFu / v->cfg.decim;
+}
+
+void DAC8568_Verify_Expect(DAC8568_Verify_t *v, uint32_t tx_index, const uint32_t *frames, uint32_t samples) {
+  const uint32_t decim = v->cfg.decim;
+  const uint32_t probes = v->cfg.probes;
+  const uint32_t mask = dac8568_verify_index_mask(v);
+
+  for (uint32_t i = (decim - (tx_index & (decim - 1u))) & (decim - 1u); i < samples; i += decim) {
+    const uint32_t k = ((tx_index + i) / decim) & mask;
+    const uint32_t slot = k & DAC8568_VERIFY_HISTORY_MASK;
+    const uint32_t *f = &frames[i * DAC8568_WORDS_PER_SAMPLE];
+
+    v->hist_tag[slot] = 0u;
+    DAC8568_PUBLISH();
+    for (uint32_t p = 0u; p < probes; p++) {
+      v->hist_code[slot][p] = (uint16_t)(f[v->cfg.probe[p].dac_channel] >> 4);
+    }
+    DAC8568_PUBLISH();
+    v->hist_tag[slot] = k + 1u;
+  }
+}
+
+static void dac8568_verify_calibrate_window(DAC8568_Verify_t *v) {
+  const double n = (double)v->win_n;
+  int32_t gain[DAC8568_VERIFY_PROBES_MAX];
+  int32_t offset[DAC8568_VERIFY_PROBES_MAX];
+
+  for (uint32_t p = 0u; p < v->cfg.probes; p++) {
+    const double sx = (double)v->cal_sx[p];
+    const double sy = (double)v->cal_sy[p];
+    const double den = n * (double)v->cal_sxx[p] - sx * sx;
+    if (v->win_exp_max[p] - v->win_exp_min[p] < DAC8568_VERIFY_CAL_MIN_SPAN || den <= 0.0) {
+      return; /* codes too flat on this probe: keep collecting */
+    }
+    const double g = (n * (double)v->cal_sxy[p] - sx * sy) / den;
+    gain[p] = dac8568_verify_round(g * 65536.0);
+    offset[p] = dac8568_verify_round((sy - g * sx) / n);
+  }
+  for (uint32_t p = 0u; p < v->cfg.probes; p++) {
+    v->cfg.probe[p].gain_q16 = gain[p];
+    v->cfg.probe[p].offset = offset[p];
+  }
+  v->stats.calibrating = 0u;
+}
+
+static void dac8568_verify_judge_window(DAC8568_Verify_t *v) {
+  DAC8568_VerifyStats_t *st = &v->stats;
+  const uint32_t n = v->win_n;
+  uint8_t drift = 0u;
+  uint8_t stuck = 0u;
+  uint8_t ref_missed = 1u;
+
+  for (uint32_t p = 0u; p < v->cfg.probes; p++) {
+    const int32_t mean = (int32_t)(v->win_err[p] / (int64_t)n);
+    const int64_t exp_span = (int64_t)v->win_exp_max[p] - v->win_exp_min[p];
+    const int64_t meas_span = (int64_t)v->win_meas_max[p] - v->win_meas_min[p];
+
+    st->mean_error[p] = mean;
+    if (dac8568_verify_abs(mean) > v->cfg.drift_limit) {
+      drift |= (uint8_t)(1u << p);
+    }
+    if (exp_span >= (int64_t)v->cfg.stuck_span && meas_span * 4 < exp_span) {
+      stuck |= (uint8_t)(1u << p);
+    }
+    /* Reference lost: the probe sits at its code-0 level although most codes were well away from it. */
+    if (v->win_at_zero[p] != n || v->win_exp_off[p] * 2u <= n) {
+      ref_missed = 0u;
+    }
+  }
+  drift &= (uint8_t)~stuck; /* a flat probe is off on average too; report it as stuck only */
+  if (ref_missed != 0u) {
+    /* Every probe is flat and off for the same reason; report that once. */
+    drift = 0u;
+    stuck = 0u;
+    if (st->ref_missed == 0u) {
+      st->ref_missed_events++;
+    }
+  }
+  for (uint32_t p = 0u; p < v->cfg.probes; p++) {
+    const uint8_t bit = (uint8_t)(1u << p);
+    if ((drift & bit) != 0u && (st->drift_mask & bit) == 0u) {
+      st->drift_events++;
+    }
+    if ((stuck & bit) != 0u && (st->stuck_mask & bit) == 0u) {
+      st->stuck_events++;
+    }
+  }
+  st->drift_mask = drift;
+  st->stuck_mask = stuck;
+  st->ref_missed = ref_missed;
+  st->windows++;
+}
+
+void DAC8568_Verify_Measure(DAC8568_Verify_t *v, const uint16_t *words, uint32_t conversions) {
+  const uint32_t probes = v->cfg.probes;
+  const uint32_t mask = dac8568_verify_index_mask(v);
+  const int32_t band = (int32_t)v->cfg.ref_band;
+  uint16_t codes[DAC8568_VERIFY_PROBES_MAX];
+
+  for (uint32_t c = 0u; c < conversions; c++, words += probes) {
+    const uint32_t k = v->next;
+    const uint32_t slot = k & DAC8568_VERIFY_HISTORY_MASK;
+    v->next = (k + 1u) & mask;
+
+    if (v->hist_tag[slot] != k + 1u) {
+      v->stats.no_expect++;
+      continue;
+    }
+    DAC8568_PUBLISH();
+    for (uint32_t p = 0u; p < probes; p++) {
+      codes[p] = v->hist_code[slot][p];
+    }
+    DAC8568_PUBLISH();
+    if (v->hist_tag[slot] != k + 1u) {
+      v->stats.no_expect++; /* overwritten by the refill while copying */
+      continue;
+    }
+
+    for (uint32_t p = 0u; p < probes; p++) {
+      const int32_t meas = (int32_t)words[p];
+      if (v->stats.calibrating != 0u) {
+        const int64_t x = codes[p];
+        v->cal_sx[p] += x;
+        v->cal_sy[p] += meas;
+        v->cal_sxx[p] += x * x;
+        v->cal_sxy[p] += x * meas;
+        v->win_exp_min[p] = (codes[p] < v->win_exp_min[p]) ? codes[p] : v->win_exp_min[p];
+        v->win_exp_max[p] = (codes[p] > v->win_exp_max[p]) ? codes[p] : v->win_exp_max[p];
+        continue;
+      }
+
+      const DAC8568_VerifyProbe_t *probe = &v->cfg.probe[p];
+      const int32_t expect = dac8568_verify_model(probe, codes[p]);
+      const int32_t err = meas - expect;
+      const uint32_t abs_err = dac8568_verify_abs(err);
+      if (abs_err > v->cfg.tolerance) {
+        v->stats.mismatches++;
+      }
+      if ((int32_t)abs_err > v->stats.max_error[p]) {
+        v->stats.max_error[p] = (int32_t)abs_err;
+      }
+      v->win_err[p] += err;
+      v->win_meas_min[p] = (meas < v->win_meas_min[p]) ? meas : v->win_meas_min[p];
+      v->win_meas_max[p] = (meas > v->win_meas_max[p]) ? meas : v->win_meas_max[p];
+      v->win_exp_min[p] = (expect < v->win_exp_min[p]) ? expect : v->win_exp_min[p];
+      v->win_exp_max[p] = (expect > v->win_exp_max[p]) ? expect : v->win_exp_max[p];
+      if ((int32_t)dac8568_verify_abs(meas - probe->offset) <= band) {
+        v->win_at_zero[p]++;
+      }
+      if ((int32_t)dac8568_verify_abs(expect - probe->offset) > 2 * band) {
+        v->win_exp_off[p]++;
+      }
+    }
+    v->stats.conversions++;
+
+    if (++v->win_n >= v->cfg.window) {
+      if (v->stats.calibrating != 0u) {
+        dac8568_verify_calibrate_window(v);
+      } else {
+        dac8568_verify_judge_window(v);
+      }
+      dac8568_verify_window_clear(v);
+    }
+  }
+}
+
+void DAC8568_Verify_Skip(DAC8568_Verify_t *v, uint32_t conversions) {
+  v->stats.lost += conversions;
+  v->next = (v->next + conversions) & dac8568_verify_index_mask(v);
+}
+
+void DAC8568_Verify_GetStats(const DAC8568_Verify_t *v, DAC8568_VerifyStats_t *stats) {
+  if (v == NULL || stats == NULL) {
+    return;
+  }
+  *stats = v->stats;
+}
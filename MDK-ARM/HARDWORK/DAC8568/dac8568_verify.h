@@ -0,0 +1,136 @@
+#ifndef DAC8568_VERIFY_H
+#define DAC8568_VERIFY_H
+
+/*
+ * HAL-free closed-loop output check.
+ *
+ * An ADC converts a few DAC outputs (after the op-amp stage, divided into the
+ * ADC range) once every `decim` output samples, paced by a timer locked to
+ * TIM12: conversion k reads the output of TX sample k * decim. The refill
+ * records the codes it queued for those samples (Expect, refill context), the
+ * task side feeds the ADC words in order (Measure) and every reading is
+ * compared with the code through a per-probe linear model of the analog path:
+ *
+ *   adc = offset + code * gain_q16 / 65536
+ *
+ * Readings are judged one by one (mismatch) and per window of `window`
+ * conversions: drift (mean error), stuck (output flat while the codes moved)
+ * and missed reference (every probe at its code-0 level while the codes were
+ * not, i.e. the DAC8568 reference dropped out). Builds on the host like
+ * dac8568_stream.c (tools/dac8568_sim --verify).
+ */
+
+#include <stdint.h>
+
+#include "dac8568_stream.h"
+
+/* ADC inputs scanned per conversion. */
+#ifndef DAC8568_VERIFY_PROBES_MAX
+#define DAC8568_VERIFY_PROBES_MAX 4u
+#endif
+/*
+ * Recorded conversions (power of two). The refill runs up to one ring ahead of
+ * the DMA and the task reads the ADC a poll period behind it, so the history
+ * must cover ring_samples / decim plus the task lag (see Configure).
+ */
+#ifndef DAC8568_VERIFY_HISTORY
+#define DAC8568_VERIFY_HISTORY 1024u
+#endif
+
+#if ((DAC8568_VERIFY_HISTORY & (DAC8568_VERIFY_HISTORY - 1u)) != 0u)
+#error "DAC8568_VERIFY_HISTORY must be a power of two"
+#endif
+
+typedef struct {
+  uint8_t dac_channel;  /* output sensed, 0..DAC8568_CHANNELS-1 (A..) */
+  uint8_t adc_channel;  /* ADC1 input (INPx), target glue only */
+  int32_t gain_q16;     /* ADC LSB per DAC code, Q16.16; negative for an inverting stage */
+  int32_t offset;       /* ADC reading at DAC code 0 */
+} DAC8568_VerifyProbe_t;
+
+typedef struct {
+  uint8_t probes;       /* 1..DAC8568_VERIFY_PROBES_MAX, in ADC scan order */
+  DAC8568_VerifyProbe_t probe[DAC8568_VERIFY_PROBES_MAX];
+  uint32_t decim;       /* output samples per conversion */
+  uint32_t settle_ns;   /* ADC sampling point after the sample's TIM12 event, < 1 period (target glue) */
+  uint32_t window;      /* conversions per drift / stuck / reference window */
+  uint32_t tolerance;   /* |error| (ADC LSB) above which a reading is a mismatch */
+  uint32_t drift_limit; /* |mean error| over a window (ADC LSB) that counts as drift */
+  uint32_t stuck_span;  /* expected span over a window needed to call a flat probe stuck */
+  uint32_t ref_band;    /* readings this close to the code-0 level count as "no reference" */
+} DAC8568_VerifyConfig_t;
+
+typedef struct {
+  uint32_t conversions;   /* conversions compared (one reading per probe each) */
+  uint32_t no_expect;     /* conversions without a recorded code (late refill, history overrun) */
+  uint32_t lost;          /* conversions overwritten in the ADC buffer before the task read them */
+  uint32_t mismatches;    /* readings further than `tolerance` from the model */
+  uint32_t windows;
+  uint32_t drift_events;  /* probe entered drift */
+  uint32_t stuck_events;  /* probe entered stuck */
+  uint32_t ref_missed_events; /* all probes dropped to the code-0 level */
+  uint8_t drift_mask;     /* state after the last window, bit = probe */
+  uint8_t stuck_mask;
+  uint8_t ref_missed;
+  uint8_t calibrating;    /* Calibrate() fit still collecting */
+  int32_t mean_error[DAC8568_VERIFY_PROBES_MAX]; /* last window, ADC LSB */
+  int32_t max_error[DAC8568_VERIFY_PROBES_MAX];  /* largest |error| since Configure */
+} DAC8568_VerifyStats_t;
+
+typedef struct {
+  DAC8568_VerifyConfig_t cfg;
+  /* Expected codes by conversion index; tag = index + 1, 0 = empty. */
+  volatile uint32_t hist_tag[DAC8568_VERIFY_HISTORY];
+  uint16_t hist_code[DAC8568_VERIFY_HISTORY][DAC8568_VERIFY_PROBES_MAX];
+  uint32_t next;          /* conversion index of the next Measure word */
+  /* Current window. */
+  uint32_t win_n;
+  int64_t win_err[DAC8568_VERIFY_PROBES_MAX];
+  int32_t win_meas_min[DAC8568_VERIFY_PROBES_MAX];
+  int32_t win_meas_max[DAC8568_VERIFY_PROBES_MAX];
+  int32_t win_exp_min[DAC8568_VERIFY_PROBES_MAX];
+  int32_t win_exp_max[DAC8568_VERIFY_PROBES_MAX];
+  uint32_t win_at_zero[DAC8568_VERIFY_PROBES_MAX]; /* readings inside ref_band of the code-0 level */
+  uint32_t win_exp_off[DAC8568_VERIFY_PROBES_MAX]; /* expected levels outside 2 x ref_band of it */
+  /* Calibration sums (codes x readings). */
+  int64_t cal_sx[DAC8568_VERIFY_PROBES_MAX];
+  int64_t cal_sy[DAC8568_VERIFY_PROBES_MAX];
+  int64_t cal_sxx[DAC8568_VERIFY_PROBES_MAX];
+  int64_t cal_sxy[DAC8568_VERIFY_PROBES_MAX];
+  DAC8568_VerifyStats_t stats;
+} DAC8568_Verify_t;
+
+/*
+ * Probe A with a unity model (gain 1.0, offset 0), decim 32, 1024-conversion
+ * windows, 512 LSB tolerance, 128 LSB drift, 2048 LSB stuck span, 512 LSB
+ * reference band, 5 us settle (SPI frames + DAC settling). Calibrate() or
+ * board values replace the model.
+ */
+void DAC8568_Verify_DefaultConfig(DAC8568_VerifyConfig_t *cfg);
+/*
+ * Clears history, window and stats. Returns 0, or -1 for a bad probe count /
+ * channel, a zero window, or a `decim` so small that one ring of refills
+ * ahead (ring_samples / decim) plus a quarter history of task lag does not
+ * fit DAC8568_VERIFY_HISTORY.
+ */
+int32_t DAC8568_Verify_Configure(DAC8568_Verify_t *v, const DAC8568_VerifyConfig_t *cfg, uint32_t ring_samples);
+/* New stream (TX sample counter back to 0): drop history and window, keep stats and model. */
+void DAC8568_Verify_Reset(DAC8568_Verify_t *v);
+/*
+ * Fit gain / offset per probe (least squares) over the next windows in which
+ * the expected codes span at least 1024 codes, instead of judging them; the
+ * output must be known good meanwhile.
+ */
+void DAC8568_Verify_Calibrate(DAC8568_Verify_t *v);
+/*
+ * Refill side: `frames` holds `samples` TX samples starting at TX sample
+ * `tx_index`; the codes of every sample on the decim grid are recorded.
+ */
+void DAC8568_Verify_Expect(DAC8568_Verify_t *v, uint32_t tx_index, const uint32_t *frames, uint32_t samples);
+/* Task side: `conversions` ADC scans (probes words each, scan order) following the previous ones. */
+void DAC8568_Verify_Measure(DAC8568_Verify_t *v, const uint16_t *words, uint32_t conversions);
+/* Task side: conversions that were lost before they could be read. */
+void DAC8568_Verify_Skip(DAC8568_Verify_t *v, uint32_t conversions);
+void DAC8568_Verify_GetStats(const DAC8568_Verify_t *v, DAC8568_VerifyStats_t *stats);
+
+#endif
@@ -0,0 +1,91 @@
+#include "dac8568_zcode.h"
+
+#include "dac8568_stream.h"
+
+static const uint32_t g_zcode_prefix[DAC8568_WORDS_PER_SAMPLE] = {DAC8568_FRAME_PREFIXES};
+
+/*
+ * 残差 pos 起的低位：两个对齐字拼成 64-bit 窗口右移 (pos & 31)。
+ * (hi << 1) << (31 - sh) 避免 sh = 0 时移 32 位，整段无分支。
+ */
+static inline uint32_t dac8568_zcode_field(const uint32_t *bits, uint32_t pos) {
+  const uint32_t sh = pos & 31u;
+  const uint32_t *w = &bits[pos >> 5];
+  return (w[0] >> sh) | ((w[1] << 1) << (31u - sh));
+}
+
+/*
+ * Decode samples [first, end) of one block (`n` samples) straight into frames.
+ * DELTA channels run through the skipped head to rebuild the running code.
+ */
+static void dac8568_zcode_block(const uint32_t *blk, uint32_t n, uint32_t first, uint32_t end,
+                                uint32_t *dst) {
+  for (uint32_t ch = 0u; ch < DAC8568_WORDS_PER_SAMPLE; ch++) {
+    const uint32_t hdr = blk[0];
+    const uint32_t *bits = &blk[1];
+    const uint32_t prefix = g_zcode_prefix[ch];
+    uint32_t width = (hdr >> 16) & 0x1Fu;
+    if (width > DAC8568_ZCODE_MAX_WIDTH) {
+      width = DAC8568_ZCODE_MAX_WIDTH;
+    }
+    const uint32_t mask = (1u << width) - 1u;
+    uint32_t code = hdr & 0xFFFFu;
+    uint32_t *out = &dst[ch];
+
+    if (((hdr >> 24) & 1u) == DAC8568_ZCODE_MODE_DELTA) {
+      uint32_t pos = 0u;
+      for (uint32_t i = 0u; i < first; i++) {
+        const uint32_t r = dac8568_zcode_field(bits, pos) & mask;
+        code += (r >> 1) ^ (0u - (r & 1u));
+        pos += width;
+      }
+      for (uint32_t i = first; i < end; i++) {
+        const uint32_t r = dac8568_zcode_field(bits, pos) & mask;
+        code += (r >> 1) ^ (0u - (r & 1u));
+        *out = prefix | ((code & 0xFFFFu) << 4);
+        out += DAC8568_WORDS_PER_SAMPLE;
+        pos += width;
+      }
+    } else {
+      uint32_t pos = first * width;
+      for (uint32_t i = first; i < end; i++) {
+        *out = prefix | (((code + (dac8568_zcode_field(bits, pos) & mask)) & 0xFFFFu) << 4);
+        out += DAC8568_WORDS_PER_SAMPLE;
+        pos += width;
+      }
+    }
+    blk = &bits[(n * width + 31u) >> 5];
+  }
+}
+
+uint32_t DAC8568_ZCode_Render(const uint32_t *payload, uint32_t loop, uint32_t index, uint32_t *dst,
+                              uint32_t samples) {
+  if (loop == 0u) {
+    return 0u;
+  }
+  if (index >= loop) {
+    index %= loop;
+  }
+
+  while (samples > 0u) {
+    const uint32_t block = index >> DAC8568_ZCODE_BLOCK_SHIFT;
+    const uint32_t first = index & (DAC8568_ZCODE_BLOCK - 1u);
+    uint32_t n = loop - (block << DAC8568_ZCODE_BLOCK_SHIFT);
+    if (n > DAC8568_ZCODE_BLOCK) {
+      n = DAC8568_ZCODE_BLOCK;
+    }
+    uint32_t take = n - first;
+    if (take > samples) {
+      take = samples;
+    }
+
+    dac8568_zcode_block(&payload[payload[block]], n, first, first + take, dst);
+    dst += take * DAC8568_WORDS_PER_SAMPLE;
+    samples -= take;
+    index += take;
+    if (index >= loop) {
+      index = 0u;
+    }
+  }
+  return index;
+}
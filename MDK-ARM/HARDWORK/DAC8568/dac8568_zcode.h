@@ -0,0 +1,66 @@
+#ifndef DAC8568_ZCODE_H
+#define DAC8568_ZCODE_H
+
+/*
+ * HAL-free decoder for compressed CODE16x4 partitions ("D8CZ",
+ * DAC8568_WAVE_FORMAT_ZCODE16x4; encoder: tools/dac_wave_zcode.py).
+ *
+ * The loop is cut into DAC8568_ZCODE_BLOCK-sample blocks and every block codes
+ * each channel (A..D, A..H in an 8-channel build) on its own: one header word,
+ * then one fixed-width residual per sample packed LSB first into 32-bit words
+ * (padded to a word).
+ *   header = base(16) | width(5) << 16 | mode << 24
+ *   FOR   : code[i] = base + r[i]                    base = block minimum
+ *   DELTA : code[i] = code[i-1] + unzigzag(r[i])     code[-1] = base
+ * The encoder keeps the narrower mode; a near-constant bus with small ripple
+ * and noise needs a few bits per code instead of 16.
+ *
+ * Payload (`data` of the stream source, word aligned):
+ *   uint32 block_offset[block_count]  word offset of each block from the payload start
+ *   blocks
+ *   DAC8568_ZCODE_PAD_WORDS zero words (the residual window never reads past the end)
+ *
+ * Worst case: a residual is read through a two-word window (no bit-buffer
+ * refill branch) and the width is clamped to 16, so every code costs the same
+ * whatever its width or mode and a block never exceeds channels x 33 words
+ * (CODE16x4 needs channels x 32). A render decodes at most
+ * DAC8568_ZCODE_BLOCK - 1 samples it does not output (the head of its first
+ * block), so an 8191-sample refill decodes at most 8191 + 63 samples at
+ * DAC8568_ZCODE_CYCLES_PER_SAMPLE each.
+ */
+
+#include <stdint.h>
+
+#define DAC8568_ZCODE_BLOCK 64u
+#define DAC8568_ZCODE_BLOCK_SHIFT 6u
+#define DAC8568_ZCODE_MAX_WIDTH 16u
+#define DAC8568_ZCODE_PAD_WORDS 2u
+#define DAC8568_ZCODE_MODE_FOR 0u
+#define DAC8568_ZCODE_MODE_DELTA 1u
+
+/*
+ * Worst-case decode cost on the M7, instruction count per output sample:
+ * 4 channels x (window load x2, funnel shift x3, mask, zigzag x3 / base add,
+ * frame OR + store, loop) ~ 4 x 14, rounded up for the per-block header work.
+ * An 8-channel sample costs twice as much over half the refill samples.
+ * Memory stalls come on top but are bounded by the CODE16x4 path, which reads
+ * at least as many QSPI bytes for the same samples.
+ */
+#ifndef DAC8568_ZCODE_CYCLES_PER_SAMPLE
+#define DAC8568_ZCODE_CYCLES_PER_SAMPLE 64u
+#endif
+
+/* Words of a block_offset table for `samples` samples. */
+static inline uint32_t DAC8568_ZCode_BlockCount(uint32_t samples) {
+  return (samples + DAC8568_ZCODE_BLOCK - 1u) >> DAC8568_ZCODE_BLOCK_SHIFT;
+}
+
+/*
+ * Write `samples` x DAC8568_WORDS_PER_SAMPLE SPI frames starting at loop index
+ * `index` (taken modulo `loop`). Stateless: seeks cost at most one partial
+ * block. Returns the index following the last rendered sample.
+ */
+uint32_t DAC8568_ZCode_Render(const uint32_t *payload, uint32_t loop, uint32_t index, uint32_t *dst,
+                              uint32_t samples);
+
+#endif
@@ -2,6 +2,7 @@
 #include "fatfs.h"
 #include "gui_resource_map.h"
 #include "qspi_w25q256.h"
+#include "sd_read_pipe.h"
 #include "draw/lv_image_dsc.h"
 
 #include <stdbool.h>
@@ -272,9 +273,8 @@ static bool qspi_assets_complete(void)
 
 static FRESULT qspi_write_from_sd(const char * src, uint32_t dst_offset, uint32_t max_size, uint32_t * written_out)
 {
-    static uint8_t buf[4096];
     FIL fsrc;
-    UINT br = 0;
+    uint32_t size = 0;
     uint32_t total = 0;
     FRESULT res = FR_OK;
 
@@ -285,6 +285,19 @@ static FRESULT qspi_write_from_sd(const char * src, uint32_t dst_offset, uint32_
         printf("[QSPI_FS] open src fail: %s, res=%d\r\n", src, (int)res);
         return res;
     }
+    size = (uint32_t)f_size(&fsrc);
+    if (size > max_size) {
+        printf("[QSPI_FS] write overflow: %s, size=%lu max=%lu\r\n",
+               src, (unsigned long)size, (unsigned long)max_size);
+        (void)f_close(&fsrc);
+        return FR_INT_ERR;
+    }
+
+    /* 先启动 SD 预读：擦除忙等期间前几块已经读进缓冲区，之后编程第 N 块时读第 N+1 块 */
+    if (size > 0U && !SD_ReadPipe_Start(&fsrc, 0U, size)) {
+        (void)f_close(&fsrc);
+        return FR_DISK_ERR;
+    }
 
     for (uint32_t erase_addr = dst_offset;
          erase_addr < (dst_offset + max_size);
@@ -293,25 +306,18 @@ static FRESULT qspi_write_from_sd(const char * src, uint32_t dst_offset, uint32_
         if (erase_ret != QSPI_W25Qxx_OK) {
             printf("[QSPI_FS] erase 64K fail @0x%08lX, ret=%d\r\n", 
                    (unsigned long)erase_addr, (int)erase_ret);
+            SD_ReadPipe_Stop();
             (void)f_close(&fsrc);
             return FR_DISK_ERR;
         }
     }
 
-    do {
-        res = f_read(&fsrc, buf, sizeof(buf), &br);
-        if (res != FR_OK) {
-            printf("[QSPI_FS] read fail: %s, res=%d, off=%lu\r\n",
-                   src, (int)res, (unsigned long)total);
-            break;
-        }
-        if (br == 0U) {
-            break;
-        }
-        if ((total + br) > max_size) {
-            printf("[QSPI_FS] write overflow: %s, off=%lu size=%u max=%lu\r\n",
-                   src, (unsigned long)total, (unsigned)br, (unsigned long)max_size);
-            res = FR_INT_ERR;
+    while (total < size) {
+        uint8_t *buf = NULL;
+        uint32_t br = 0;
+        if (!SD_ReadPipe_Get(&buf, &br)) {
+            printf("[QSPI_FS] read fail: %s, off=%lu\r\n", src, (unsigned long)total);
+            res = FR_DISK_ERR;
             break;
         }
         if (QSPI_W25Qxx_WriteBuffer_Slow(buf, dst_offset + total, br) != QSPI_W25Qxx_OK) {
@@ -321,8 +327,9 @@ static FRESULT qspi_write_from_sd(const char * src, uint32_t dst_offset, uint32_
             break;
         }
         total += br;
-    } while (br > 0U);
+    }
 
+    SD_ReadPipe_Stop();
     (void)f_close(&fsrc);
     if (written_out) {
         *written_out = total;
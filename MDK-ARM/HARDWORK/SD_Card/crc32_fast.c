@@ -0,0 +1,406 @@
+#include "crc32_fast.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#if (CRC32_FAST_HW != 0)
+#include "main.h"
+#include "cmsis_os2.h"
+#include <stdio.h>
+#endif
+
+#define CRC32_FAST_POLY_REFLECTED 0xEDB88320u
+
+/* slice-by-8 表：t[k][b] = b 后面再跟 k 个零字节的 CRC，一次吃 8 字节。 */
+static uint32_t s_crc_table[8][256];
+static volatile uint8_t s_crc_table_ready = 0u;
+
+static void crc32_fast_table_init(void)
+{
+	for (uint32_t i = 0u; i < 256u; i++) {
+		uint32_t c = i;
+		for (uint32_t bit = 0u; bit < 8u; bit++) {
+			c = (c >> 1) ^ (CRC32_FAST_POLY_REFLECTED & (uint32_t)-(int32_t)(c & 1u));
+		}
+		s_crc_table[0][i] = c;
+	}
+	for (uint32_t i = 0u; i < 256u; i++) {
+		for (uint32_t k = 1u; k < 8u; k++) {
+			const uint32_t prev = s_crc_table[k - 1u][i];
+			s_crc_table[k][i] = (prev >> 8) ^ s_crc_table[0][prev & 0xFFu];
+		}
+	}
+	/* 两个任务同时首次调用时各自写一遍同样的值，无害 */
+	s_crc_table_ready = 1u;
+}
+
+uint32_t CRC32_Fast_UpdateBitwise(uint32_t crc, const void *data, uint32_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	crc = ~crc;
+	for (uint32_t i = 0u; i < len; i++) {
+		crc ^= (uint32_t)p[i];
+		for (uint32_t bit = 0u; bit < 8u; bit++) {
+			uint32_t mask = (uint32_t)-(int32_t)(crc & 1u);
+			crc = (crc >> 1) ^ (CRC32_FAST_POLY_REFLECTED & mask);
+		}
+	}
+	return ~crc;
+}
+
+/* 按小端读两个字（Cortex-M7 和主机都是小端），memcpy 兼顾不对齐的地址。 */
+uint32_t CRC32_Fast_UpdateSoft(uint32_t crc, const void *data, uint32_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	uint32_t c = ~crc;
+
+	if (p == NULL || len == 0u) {
+		return crc;
+	}
+	if (s_crc_table_ready == 0u) {
+		crc32_fast_table_init();
+	}
+	while (len != 0u && ((uintptr_t)p & 3u) != 0u) {
+		c = s_crc_table[0][(c ^ *p++) & 0xFFu] ^ (c >> 8);
+		len--;
+	}
+	while (len >= 8u) {
+		uint32_t lo;
+		uint32_t hi;
+		memcpy(&lo, p, sizeof(lo));
+		memcpy(&hi, p + 4, sizeof(hi));
+		lo ^= c;
+		c = s_crc_table[7][lo & 0xFFu] ^ s_crc_table[6][(lo >> 8) & 0xFFu] ^
+		    s_crc_table[5][(lo >> 16) & 0xFFu] ^ s_crc_table[4][lo >> 24] ^
+		    s_crc_table[3][hi & 0xFFu] ^ s_crc_table[2][(hi >> 8) & 0xFFu] ^
+		    s_crc_table[1][(hi >> 16) & 0xFFu] ^ s_crc_table[0][hi >> 24];
+		p += 8;
+		len -= 8u;
+	}
+	while (len != 0u) {
+		c = s_crc_table[0][(c ^ *p++) & 0xFFu] ^ (c >> 8);
+		len--;
+	}
+	return ~c;
+}
+
+#if (CRC32_FAST_HW != 0)
+
+/*
+ * CRC 外设按 MSB 先算非反射 CRC：输入按字位反转（REV_IN = 11）后，小端字的 b0 的 bit0 最先进，
+ * 正好是反射算法的顺序；REV_OUT 把结果翻回反射域。续算时的初值是 zlib 状态 ~crc 的位反转。
+ */
+#define CRC32_FAST_POLY 0x04C11DB7u
+#define CRC32_FAST_QSPI_BASE 0x90000000u
+#define CRC32_FAST_QSPI_END 0xA0000000u
+#define CRC32_FAST_MDMA_BLOCK 0x10000u		/* BNDT 上限 64KB */
+#define CRC32_FAST_MDMA_BLOCK_COUNT 4096u	/* BRC 上限，一次最多 256MB */
+#define CRC32_FAST_MDMA_TIMEOUT_MS(blocks) (100u + (blocks) * 20u)	/* 64KB 按 3 MB/s 的最慢情况留余量 */
+#define CRC32_FAST_BENCH_BITWISE_MAX 0x40000u
+
+static volatile uint8_t s_crc_hw_busy = 0u;
+static uint8_t s_crc_hw_ready = 0u;
+
+static MDMA_HandleTypeDef s_crc_mdma;
+static osSemaphoreId_t s_crc_mdma_sem = NULL;
+static volatile uint8_t s_crc_mdma_state = 0u;	/* 0 空闲，1 传输中，2 完成，3 出错 */
+static uint8_t s_crc_mdma_ready = 0u;
+static uint32_t s_crc_mdma_errors = 0u;
+
+static bool crc32_fast_hw_claim(void)
+{
+	bool ok = false;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (s_crc_hw_busy == 0u) {
+		s_crc_hw_busy = 1u;
+		ok = true;
+	}
+	if (primask == 0u) {
+		__enable_irq();
+	}
+	if (ok && s_crc_hw_ready == 0u) {
+		__HAL_RCC_CRC_CLK_ENABLE();
+		CRC->POL = CRC32_FAST_POLY;
+		s_crc_hw_ready = 1u;
+	}
+	return ok;
+}
+
+static void crc32_fast_hw_release(void)
+{
+	s_crc_hw_busy = 0u;
+}
+
+static void crc32_fast_hw_begin(uint32_t crc)
+{
+	CRC->INIT = __RBIT(~crc);
+	CRC->CR = CRC_CR_REV_OUT | CRC_CR_REV_IN | CRC_CR_RESET;	/* POLYSIZE = 00：32 位 */
+}
+
+static uint32_t crc32_fast_hw_value(void)
+{
+	return ~CRC->DR;
+}
+
+/* 首尾不足一个字的字节：8 位写 DR，输入改成按字节位反转。 */
+static void crc32_fast_hw_bytes(const uint8_t *p, uint32_t n)
+{
+	if (n == 0u) {
+		return;
+	}
+	MODIFY_REG(CRC->CR, CRC_CR_REV_IN, CRC_CR_REV_IN_0);
+	while (n-- != 0u) {
+		*(__IO uint8_t *)&CRC->DR = *p++;
+	}
+	MODIFY_REG(CRC->CR, CRC_CR_REV_IN, CRC_CR_REV_IN);
+}
+
+static void crc32_fast_hw_words(const uint32_t *w, uint32_t n)
+{
+	while (n >= 4u) {
+		CRC->DR = w[0];
+		CRC->DR = w[1];
+		CRC->DR = w[2];
+		CRC->DR = w[3];
+		w += 4;
+		n -= 4u;
+	}
+	while (n-- != 0u) {
+		CRC->DR = *w++;
+	}
+}
+
+static void crc32_fast_mdma_cplt(MDMA_HandleTypeDef *hmdma)
+{
+	(void)hmdma;
+	s_crc_mdma_state = 2u;
+	if (s_crc_mdma_sem != NULL) {
+		(void)osSemaphoreRelease(s_crc_mdma_sem);
+	}
+}
+
+static void crc32_fast_mdma_error(MDMA_HandleTypeDef *hmdma)
+{
+	(void)hmdma;
+	s_crc_mdma_state = 3u;
+	if (s_crc_mdma_sem != NULL) {
+		(void)osSemaphoreRelease(s_crc_mdma_sem);
+	}
+}
+
+/* MDMA Channel3：软件请求，源地址按字递增，目的固定在 CRC->DR，低优先级，不挤占 DAC 的 Channel2。 */
+static bool crc32_fast_mdma_init(void)
+{
+	if (s_crc_mdma_ready != 0u) {
+		return true;
+	}
+	__HAL_RCC_MDMA_CLK_ENABLE();
+	s_crc_mdma.Instance = MDMA_Channel3;
+	s_crc_mdma.Init.Request = MDMA_REQUEST_SW;
+	s_crc_mdma.Init.TransferTriggerMode = MDMA_FULL_TRANSFER;
+	s_crc_mdma.Init.Priority = MDMA_PRIORITY_LOW;
+	s_crc_mdma.Init.Endianness = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+	s_crc_mdma.Init.SourceInc = MDMA_SRC_INC_WORD;
+	s_crc_mdma.Init.DestinationInc = MDMA_DEST_INC_DISABLE;
+	s_crc_mdma.Init.SourceDataSize = MDMA_SRC_DATASIZE_WORD;
+	s_crc_mdma.Init.DestDataSize = MDMA_DEST_DATASIZE_WORD;
+	s_crc_mdma.Init.DataAlignment = MDMA_DATAALIGN_PACKENABLE;
+	s_crc_mdma.Init.BufferTransferLength = 128;
+	s_crc_mdma.Init.SourceBurst = MDMA_SOURCE_BURST_SINGLE;
+	s_crc_mdma.Init.DestBurst = MDMA_DEST_BURST_SINGLE;
+	s_crc_mdma.Init.SourceBlockAddressOffset = 0;	/* 块与块首尾相接 */
+	s_crc_mdma.Init.DestBlockAddressOffset = 0;
+	if (HAL_MDMA_Init(&s_crc_mdma) != HAL_OK) {
+		return false;
+	}
+	(void)HAL_MDMA_RegisterCallback(&s_crc_mdma, HAL_MDMA_XFER_CPLT_CB_ID, crc32_fast_mdma_cplt);
+	(void)HAL_MDMA_RegisterCallback(&s_crc_mdma, HAL_MDMA_XFER_ERROR_CB_ID, crc32_fast_mdma_error);
+	s_crc_mdma_ready = 1u;
+	return true;
+}
+
+/* `blocks` 个 `block_len` 字节的块（字对齐）送进 DR；调度器在跑时睡眠等完成，否则轮询。 */
+static bool crc32_fast_mdma_feed(uint32_t src, uint32_t block_len, uint32_t blocks)
+{
+	const uint32_t timeout = CRC32_FAST_MDMA_TIMEOUT_MS(blocks);
+	bool wait_rtos = (osKernelGetState() == osKernelRunning);
+
+	if (wait_rtos && s_crc_mdma_sem == NULL) {
+		s_crc_mdma_sem = osSemaphoreNew(1u, 0u, NULL);	/* 开机阶段（调度器启动前）只轮询 */
+	}
+	wait_rtos = wait_rtos && (s_crc_mdma_sem != NULL);
+
+	if (src < CRC32_FAST_QSPI_BASE || src >= CRC32_FAST_QSPI_END) {
+		const uintptr_t start = (uintptr_t)src & ~(uintptr_t)31u;
+		const uintptr_t end = ((uintptr_t)src + block_len * blocks + 31u) & ~(uintptr_t)31u;
+		SCB_CleanDCache_by_Addr((uint32_t *)start, (int32_t)(end - start));
+	}
+	if (wait_rtos) {
+		while (osSemaphoreAcquire(s_crc_mdma_sem, 0u) == osOK) {
+		}
+	}
+	s_crc_mdma_state = 1u;
+	if (HAL_MDMA_Start_IT(&s_crc_mdma, src, (uint32_t)(uintptr_t)&CRC->DR, block_len, blocks) != HAL_OK) {
+		s_crc_mdma_state = 0u;
+		return false;
+	}
+	if (wait_rtos) {
+		(void)osSemaphoreAcquire(s_crc_mdma_sem, timeout);
+	} else {
+		const uint32_t t0 = HAL_GetTick();
+		while (s_crc_mdma_state == 1u && (HAL_GetTick() - t0) < timeout) {
+		}
+	}
+	if (s_crc_mdma_state != 2u) {
+		(void)HAL_MDMA_Abort(&s_crc_mdma);
+		s_crc_mdma_state = 0u;
+		return false;
+	}
+	s_crc_mdma_state = 0u;
+	return true;
+}
+
+/* 调用者持有外设。MDMA 出错时从出错前的值用软件补上那一段，再接着用外设算。 */
+static uint32_t crc32_fast_hw_run(uint32_t crc, const uint8_t *p, uint32_t len, bool use_mdma)
+{
+	uint32_t head = (uint32_t)(-(uintptr_t)p & 3u);
+
+	if (head > len) {
+		head = len;
+	}
+	crc32_fast_hw_begin(crc);
+	crc32_fast_hw_bytes(p, head);
+	p += head;
+	len -= head;
+
+	if (use_mdma && len >= CRC32_FAST_MDMA_MIN && crc32_fast_mdma_init()) {
+		while (len >= CRC32_FAST_MDMA_MIN) {
+			const uint32_t words = len & ~3u;
+			const uint32_t block_len = (words < CRC32_FAST_MDMA_BLOCK) ? words : CRC32_FAST_MDMA_BLOCK;
+			uint32_t blocks = words / block_len;
+			if (blocks > CRC32_FAST_MDMA_BLOCK_COUNT) {
+				blocks = CRC32_FAST_MDMA_BLOCK_COUNT;
+			}
+			const uint32_t bytes = block_len * blocks;
+			const uint32_t before = crc32_fast_hw_value();
+
+			if (!crc32_fast_mdma_feed((uint32_t)(uintptr_t)p, block_len, blocks)) {
+				if (s_crc_mdma_errors++ == 0u) {
+					printf("[CRC] mdma feed failed @0x%08lX, software for this range\r\n",
+					       (unsigned long)(uintptr_t)p);
+				}
+				crc32_fast_hw_begin(CRC32_Fast_UpdateSoft(before, p, bytes));
+			}
+			p += bytes;
+			len -= bytes;
+		}
+	}
+
+	crc32_fast_hw_words((const uint32_t *)(const void *)p, len / 4u);
+	p += len & ~3u;
+	crc32_fast_hw_bytes(p, len & 3u);
+	return crc32_fast_hw_value();
+}
+
+uint32_t CRC32_Fast_Update(uint32_t crc, const void *data, uint32_t len)
+{
+	if (data == NULL || len == 0u) {
+		return crc;
+	}
+	if (len < 16u || !crc32_fast_hw_claim()) {
+		return CRC32_Fast_UpdateSoft(crc, data, len);
+	}
+	crc = crc32_fast_hw_run(crc, (const uint8_t *)data, len, true);
+	crc32_fast_hw_release();
+	return crc;
+}
+
+void CRC32_Fast_MDMA_IRQHandler(void)
+{
+	if (s_crc_mdma_ready != 0u) {
+		HAL_MDMA_IRQHandler(&s_crc_mdma);
+	}
+}
+
+static uint32_t crc32_fast_cycles(void)
+{
+	if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0U) {
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->LAR = 0xC5ACCE55;
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	}
+	return DWT->CYCCNT;
+}
+
+static void crc32_fast_bench_print(const char *name, uint32_t bytes, uint32_t cycles, uint32_t crc)
+{
+	const uint32_t mhz = SystemCoreClock / 1000000u;
+	const uint32_t us = (mhz != 0u) ? (cycles / mhz) : 0u;
+	/* bytes/us = MB/s（10^6） */
+	const uint32_t mbps_x100 = (us != 0u) ? (uint32_t)(((uint64_t)bytes * 100u) / us) : 0u;
+
+	printf("[CRC] %-9s %8lu bytes %8lu us %4lu.%02lu MB/s crc=0x%08lX\r\n", name, (unsigned long)bytes,
+	       (unsigned long)us, (unsigned long)(mbps_x100 / 100u), (unsigned long)(mbps_x100 % 100u),
+	       (unsigned long)crc);
+}
+
+int32_t CRC32_Fast_Bench(const void *data, uint32_t len)
+{
+	const uint32_t bit_len = (len < CRC32_FAST_BENCH_BITWISE_MAX) ? len : CRC32_FAST_BENCH_BITWISE_MAX;
+	uint32_t t0;
+	uint32_t ref;
+	uint32_t crc;
+	int32_t ret = 0;
+
+	if (data == NULL || len == 0u) {
+		return -1;
+	}
+	printf("[CRC] bench @0x%08lX len=%lu\r\n", (unsigned long)(uintptr_t)data, (unsigned long)len);
+
+	t0 = crc32_fast_cycles();
+	ref = CRC32_Fast_UpdateBitwise(0u, data, bit_len);
+	crc32_fast_bench_print("bitwise", bit_len, crc32_fast_cycles() - t0, ref);
+	if (CRC32_Fast_UpdateSoft(0u, data, bit_len) != ref) {
+		printf("[CRC] slice-by-8 mismatch over the first %lu bytes\r\n", (unsigned long)bit_len);
+		ret = -1;
+	}
+
+	t0 = crc32_fast_cycles();
+	ref = CRC32_Fast_UpdateSoft(0u, data, len);
+	crc32_fast_bench_print("slice8", len, crc32_fast_cycles() - t0, ref);
+
+	if (!crc32_fast_hw_claim()) {
+		printf("[CRC] peripheral busy, hardware runs skipped\r\n");
+		return ret;
+	}
+	t0 = crc32_fast_cycles();
+	crc = crc32_fast_hw_run(0u, (const uint8_t *)data, len, false);
+	crc32_fast_bench_print("hw cpu", len, crc32_fast_cycles() - t0, crc);
+	if (crc != ref) {
+		ret = -1;
+	}
+	t0 = crc32_fast_cycles();
+	crc = crc32_fast_hw_run(0u, (const uint8_t *)data, len, true);
+	crc32_fast_bench_print("hw mdma", len, crc32_fast_cycles() - t0, crc);
+	if (crc != ref) {
+		ret = -1;
+	}
+	crc32_fast_hw_release();
+	if (ret != 0) {
+		printf("[CRC] implementations disagree\r\n");
+	}
+	return ret;
+}
+
+#else
+
+uint32_t CRC32_Fast_Update(uint32_t crc, const void *data, uint32_t len)
+{
+	return CRC32_Fast_UpdateSoft(crc, data, len);
+}
+
+#endif /* CRC32_FAST_HW */
@@ -0,0 +1,49 @@
+#ifndef CRC32_FAST_H
+#define CRC32_FAST_H
+
+#include <stdint.h>
+
+/*
+ * CRC32（zlib / IEEE 802.3，反射多项式 0xEDB88320）公共模块，DACW / D8CZ 载荷、
+ * 波形目录和 64KB 块哈希都用它。
+ *
+ *   crc = CRC32_Fast_Update(0u, a, len_a);
+ *   crc = CRC32_Fast_Update(crc, b, len_b);         // 与一次算 a+b 相同，可以分段续算
+ *
+ * 目标板上走 STM32H7 CRC 外设：≥ CRC32_FAST_MDMA_MIN 的区间由 MDMA Channel3 把字
+ * 直接搬进 CRC->DR（调度器运行时调用者睡眠等完成，CPU 可以去跑别的任务），短区间和首尾
+ * 不对齐的字节由 CPU 写 DR。地址可以是内存映射的 QSPI（0x90000000）、SDRAM 或 AXI SRAM，
+ * 非 QSPI 的区间先按地址 clean D-cache。外设被另一个任务占用时退回软件 slice-by-8。
+ * 主机构建（CRC32_FAST_HW = 0）只有软件实现。
+ */
+
+#ifndef CRC32_FAST_HW
+#if defined(USE_HAL_DRIVER)
+#define CRC32_FAST_HW 1u
+#else
+#define CRC32_FAST_HW 0u
+#endif
+#endif
+
+/* 短于此长度的区间 CPU 写 DR 更快（MDMA 配置、cache clean、任务切换的固定开销）；SD 流水线的 4KB 块走 CPU。 */
+#ifndef CRC32_FAST_MDMA_MIN
+#define CRC32_FAST_MDMA_MIN 0x8000u
+#endif
+
+uint32_t CRC32_Fast_Update(uint32_t crc, const void *data, uint32_t len);
+/* 软件 slice-by-8（首次调用时在 RAM 里建 8KB 表）。 */
+uint32_t CRC32_Fast_UpdateSoft(uint32_t crc, const void *data, uint32_t len);
+/* 逐位参考实现，只给对比和基准用。 */
+uint32_t CRC32_Fast_UpdateBitwise(uint32_t crc, const void *data, uint32_t len);
+
+#if (CRC32_FAST_HW != 0)
+/*
+ * 各实现在 [data, data+len) 上的 MB/s（DWT 计时）并核对结果一致；逐位实现只跑前 256KB。
+ * Task 上下文；返回 0 或 -1（结果不一致）。
+ */
+int32_t CRC32_Fast_Bench(const void *data, uint32_t len);
+/* MDMA_IRQHandler 的 USER CODE 段调用。 */
+void CRC32_Fast_MDMA_IRQHandler(void);
+#endif
+
+#endif /* CRC32_FAST_H */
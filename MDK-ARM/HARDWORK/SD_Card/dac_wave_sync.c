@@ -1,7 +1,9 @@
 #include "dac_wave_sync.h"
 
 #include "SD.h"
+#include "crc32_fast.h"
 #include "qspi_w25q256.h"
+#include "sd_waveform.h"
 
 #include "ff.h"
 
@@ -14,13 +16,16 @@ extern int printf(const char *format, ...);
 #define DAC_WAVE_VERSION 1u
 #define DAC_WAVE_LEGACY_MAGIC 0x44384357u /* "D8CW" (legacy: 4x uint16 code) */
 #define DAC_WAVE_LEGACY_VERSION 1u
+/* Version 2 only adds loop markers (see sd_waveform.h); this window always loops the whole wave. */
+#define DAC_WAVE_LOOP_VERSION 2u
 
 /* Reserve a 1MB window near the end of W25Q256 for wave data. */
 #define DAC_WAVE_QSPI_BASE_OFF 0x01F00000u
 #define DAC_WAVE_QSPI_WINDOW_BYTES 0x00100000u
 #define DAC_WAVE_QSPI_DATA_OFF 0x40u
 
-#define DAC_WAVE_WORDS_PER_SAMPLE 4u
+/* Channels per sample of the build (DAC8568_CHANNELS); both header kinds must match it. */
+#define DAC_WAVE_WORDS_PER_SAMPLE SD_DAC_WAVE_CHANNELS
 
 typedef struct {
   uint32_t magic;
@@ -44,18 +49,6 @@ typedef struct {
   uint32_t checksum;
 } DAC_WaveLegacyHeader_t; /* 32 bytes */
 
-static uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t len) {
-  crc = ~crc;
-  for (uint32_t i = 0; i < len; i++) {
-    crc ^= (uint32_t)data[i];
-    for (uint32_t bit = 0; bit < 8u; bit++) {
-      uint32_t mask = (uint32_t)-(int32_t)(crc & 1u);
-      crc = (crc >> 1) ^ (0xEDB88320u & mask);
-    }
-  }
-  return ~crc;
-}
-
 static uint32_t fnv1a_legacy_update(uint32_t checksum, const uint8_t *data, uint32_t len) {
   uint32_t value = checksum;
   for (uint32_t i = 0u; i < len; ++i) {
@@ -109,7 +102,7 @@ bool DAC_Wave_SyncFromSDToW25Q(const char *path, DAC_WaveInfo_t *out_info) {
   uint32_t expected_crc = 0u;
 
   if (hdr.magic == DAC_WAVE_MAGIC &&
-      hdr.version == DAC_WAVE_VERSION &&
+      (hdr.version == DAC_WAVE_VERSION || hdr.version == DAC_WAVE_LOOP_VERSION) &&
       hdr.header_bytes == sizeof(hdr) &&
       hdr.words_per_sample == DAC_WAVE_WORDS_PER_SAMPLE &&
       hdr.sample_rate != 0u &&
@@ -122,12 +115,12 @@ bool DAC_Wave_SyncFromSDToW25Q(const char *path, DAC_WaveInfo_t *out_info) {
     expected_crc = hdr.crc32;
   } else {
     memcpy(&hdr_legacy, &hdr, sizeof(hdr_legacy));
-    uint32_t expect_bytes = hdr_legacy.sample_count * 4u * (uint32_t)sizeof(uint16_t);
+    uint32_t expect_bytes = hdr_legacy.sample_count * DAC_WAVE_WORDS_PER_SAMPLE * (uint32_t)sizeof(uint16_t);
     if (hdr_legacy.magic == DAC_WAVE_LEGACY_MAGIC &&
-        hdr_legacy.version == DAC_WAVE_LEGACY_VERSION &&
+        (hdr_legacy.version == DAC_WAVE_LEGACY_VERSION || hdr_legacy.version == DAC_WAVE_LOOP_VERSION) &&
         hdr_legacy.sample_rate_hz != 0u &&
         hdr_legacy.sample_count != 0u &&
-        hdr_legacy.channel_count == 4u &&
+        hdr_legacy.channel_count == DAC_WAVE_WORDS_PER_SAMPLE &&
         hdr_legacy.data_offset >= sizeof(hdr_legacy) &&
         hdr_legacy.data_bytes == expect_bytes) {
       wave_format = DAC_WAVE_FORMAT_CODE16x4;
@@ -250,7 +243,7 @@ bool DAC_Wave_SyncFromSDToW25Q(const char *path, DAC_WaveInfo_t *out_info) {
     if (wave_format == DAC_WAVE_FORMAT_CODE16x4) {
       crc = fnv1a_legacy_update(crc, io_buf, (uint32_t)chunk);
     } else {
-      crc = crc32_update(crc, io_buf, (uint32_t)chunk);
+      crc = CRC32_Fast_Update(crc, io_buf, (uint32_t)chunk);
     }
 
     qret = QSPI_W25Qxx_WriteBuffer(io_buf, flash_addr, (uint32_t)chunk);
@@ -0,0 +1,207 @@
+#include "sd_read_pipe.h"
+
+#include <stdio.h>
+
+#if (SD_READ_PIPE_ASYNC != 0)
+#include "cmsis_os2.h"
+#endif
+
+#define SD_READ_PIPE_END 0xFFu	/* 结束标记（读完 / 读错 / 取消），之后读任务回到空闲 */
+
+#if (SD_READ_PIPE_CHUNK > 0xFFFFu) || (SD_READ_PIPE_CHUNK % 32u) != 0u || (SD_READ_PIPE_DEPTH < 2u)
+#error "SD_READ_PIPE_CHUNK must be a multiple of 32 below 64KB, SD_READ_PIPE_DEPTH at least 2"
+#endif
+
+/* SDMMC1 IDMA 只能访问 D1 域（AXI SRAM），DTCM / D2 SRAM 都不行，见 STM32H750XBH6_d2.sct 的 .ram_d1 */
+__attribute__((section(".ram_d1"), aligned(32))) static uint8_t s_pipe_buf[SD_READ_PIPE_DEPTH][SD_READ_PIPE_CHUNK];
+
+static FIL *s_pipe_fil = NULL;
+static uint32_t s_pipe_pos = 0u;
+static uint32_t s_pipe_end = 0u;
+static bool s_pipe_active = false;	/* Start 之后、收到结束标记 / Stop 之前 */
+
+#if (SD_READ_PIPE_ASYNC != 0)
+typedef struct {
+	uint8_t index;	/* 缓冲区号，SD_READ_PIPE_END = 结束 */
+	uint8_t ok;
+	uint16_t len;
+} sd_read_pipe_item_t;
+
+static osThreadId_t s_pipe_thread = NULL;
+static osMessageQueueId_t s_pipe_free = NULL;	/* 空闲缓冲区号 */
+static osMessageQueueId_t s_pipe_full = NULL;	/* 读好的块，最后跟一个结束标记 */
+static osSemaphoreId_t s_pipe_job = NULL;
+static volatile uint8_t s_pipe_abort = 0u;
+static uint8_t s_pipe_held = SD_READ_PIPE_END;	/* 调用者手里的缓冲区 */
+static bool s_pipe_sync = false;	/* 读任务建不起来时退回同步读 */
+
+/* 高于 Main_Task（同步在那里跑），低于 LVGL，界面不受影响 */
+static const osThreadAttr_t s_pipe_thread_attr = {
+	.name = "SdRead",
+	.stack_size = 512 * 4,
+	.priority = (osPriority_t)osPriorityBelowNormal,
+};
+
+static void sd_read_pipe_task(void *argument)
+{
+	(void)argument;
+
+	for (;;) {
+		sd_read_pipe_item_t item;
+		uint32_t pos;
+
+		(void)osSemaphoreAcquire(s_pipe_job, osWaitForever);
+		pos = s_pipe_pos;
+		item.ok = (f_lseek(s_pipe_fil, pos) == FR_OK) ? 1u : 0u;
+		while (item.ok != 0u && pos < s_pipe_end && s_pipe_abort == 0u) {
+			uint8_t index = 0u;
+			UINT req = (UINT)(s_pipe_end - pos);
+			UINT br = 0u;
+
+			if (req > (UINT)SD_READ_PIPE_CHUNK) {
+				req = (UINT)SD_READ_PIPE_CHUNK;
+			}
+			(void)osMessageQueueGet(s_pipe_free, &index, NULL, osWaitForever);
+			if (s_pipe_abort != 0u) {
+				(void)osMessageQueuePut(s_pipe_free, &index, 0u, 0u);
+				break;
+			}
+			if (f_read(s_pipe_fil, s_pipe_buf[index], req, &br) != FR_OK || br != req) {
+				printf("[SD_PIPE] read failed @%lu\r\n", (unsigned long)pos);
+				(void)osMessageQueuePut(s_pipe_free, &index, 0u, 0u);
+				item.ok = 0u;
+				break;
+			}
+			item.index = index;
+			item.len = (uint16_t)req;
+			(void)osMessageQueuePut(s_pipe_full, &item, 0u, osWaitForever);
+			pos += req;
+		}
+		item.index = SD_READ_PIPE_END;
+		item.len = 0u;
+		(void)osMessageQueuePut(s_pipe_full, &item, 0u, osWaitForever);
+	}
+}
+
+static void sd_read_pipe_init(void)
+{
+	if (s_pipe_thread != NULL || s_pipe_sync) {
+		return;
+	}
+	s_pipe_free = osMessageQueueNew(SD_READ_PIPE_DEPTH, sizeof(uint8_t), NULL);
+	s_pipe_full = osMessageQueueNew(SD_READ_PIPE_DEPTH + 1u, sizeof(sd_read_pipe_item_t), NULL);
+	s_pipe_job = osSemaphoreNew(1u, 0u, NULL);
+	if (s_pipe_free == NULL || s_pipe_full == NULL || s_pipe_job == NULL) {
+		printf("[SD_PIPE] rtos objects failed, synchronous reads\r\n");
+		s_pipe_sync = true;
+		return;
+	}
+	for (uint8_t i = 0u; i < SD_READ_PIPE_DEPTH; i++) {
+		(void)osMessageQueuePut(s_pipe_free, &i, 0u, 0u);
+	}
+	s_pipe_thread = osThreadNew(sd_read_pipe_task, NULL, &s_pipe_thread_attr);
+	if (s_pipe_thread == NULL) {
+		printf("[SD_PIPE] reader task failed, synchronous reads\r\n");
+		s_pipe_sync = true;
+	}
+}
+
+static void sd_read_pipe_release(void)
+{
+	if (s_pipe_held != SD_READ_PIPE_END) {
+		(void)osMessageQueuePut(s_pipe_free, &s_pipe_held, 0u, 0u);
+		s_pipe_held = SD_READ_PIPE_END;
+	}
+}
+#endif /* SD_READ_PIPE_ASYNC */
+
+bool SD_ReadPipe_Start(FIL *fil, uint32_t offset, uint32_t length)
+{
+	if (fil == NULL || s_pipe_active) {
+		return false;
+	}
+	s_pipe_fil = fil;
+	s_pipe_pos = offset;
+	s_pipe_end = offset + length;
+	s_pipe_active = true;
+
+#if (SD_READ_PIPE_ASYNC != 0)
+	sd_read_pipe_init();
+	if (!s_pipe_sync) {
+		s_pipe_abort = 0u;
+		(void)osSemaphoreRelease(s_pipe_job);
+		return true;
+	}
+#endif
+	if (f_lseek(fil, offset) != FR_OK) {
+		s_pipe_active = false;
+		return false;
+	}
+	return true;
+}
+
+bool SD_ReadPipe_Get(uint8_t **data, uint32_t *len)
+{
+	if (!s_pipe_active || data == NULL || len == NULL) {
+		return false;
+	}
+
+#if (SD_READ_PIPE_ASYNC != 0)
+	if (!s_pipe_sync) {
+		sd_read_pipe_item_t item;
+
+		sd_read_pipe_release();
+		if (osMessageQueueGet(s_pipe_full, &item, NULL, osWaitForever) != osOK ||
+		    item.index == SD_READ_PIPE_END) {
+			s_pipe_active = false;
+			return false;
+		}
+		s_pipe_held = item.index;
+		*data = s_pipe_buf[item.index];
+		*len = item.len;
+		return true;
+	}
+#endif
+	{
+		UINT req = (UINT)(s_pipe_end - s_pipe_pos);
+		UINT br = 0u;
+
+		if (s_pipe_pos >= s_pipe_end) {
+			s_pipe_active = false;
+			return false;
+		}
+		if (req > (UINT)SD_READ_PIPE_CHUNK) {
+			req = (UINT)SD_READ_PIPE_CHUNK;
+		}
+		if (f_read(s_pipe_fil, s_pipe_buf[0], req, &br) != FR_OK || br != req) {
+			printf("[SD_PIPE] read failed @%lu\r\n", (unsigned long)s_pipe_pos);
+			s_pipe_active = false;
+			return false;
+		}
+		s_pipe_pos += req;
+		*data = s_pipe_buf[0];
+		*len = (uint32_t)req;
+		return true;
+	}
+}
+
+void SD_ReadPipe_Stop(void)
+{
+#if (SD_READ_PIPE_ASYNC != 0)
+	if (!s_pipe_sync) {
+		sd_read_pipe_release();
+		if (s_pipe_active) {
+			sd_read_pipe_item_t item;
+
+			/* 读任务可能正卡在取空闲缓冲区上：把读好的块还回去，直到它发出结束标记 */
+			s_pipe_abort = 1u;
+			while (osMessageQueueGet(s_pipe_full, &item, NULL, osWaitForever) == osOK &&
+			       item.index != SD_READ_PIPE_END) {
+				(void)osMessageQueuePut(s_pipe_free, &item.index, 0u, 0u);
+			}
+		}
+	}
+#endif
+	s_pipe_active = false;
+	s_pipe_fil = NULL;
+}
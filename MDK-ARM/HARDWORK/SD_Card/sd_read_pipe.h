@@ -0,0 +1,38 @@
+#ifndef SD_READ_PIPE_H
+#define SD_READ_PIPE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ff.h"
+
+/*
+ * SD 预读流水线（SD -> QSPI 同步用）。
+ *
+ * 专用读任务把文件的一段按 SD_READ_PIPE_CHUNK 读进 SD_READ_PIPE_DEPTH 个 32 字节对齐的缓冲区，
+ * 调用者在擦除 / 编程 QSPI（HAL 轮询忙等）的同时取用前一块。f_read 走 SDMMC1 IDMA + 中断，
+ * 读任务在等 DMA 完成时睡眠；它的优先级高于同步任务，DMA 一完成就抢占 QSPI 的忙等去发下一次读，
+ * 两个外设因此同时在忙。
+ *
+ *   SD_ReadPipe_Start(&fil, offset, length);      // 之后到 Stop 之前不要直接操作 fil
+ *   while (pos < end) {
+ *       if (!SD_ReadPipe_Get(&data, &len)) { ... }  // 读错 / 已读完
+ *       ...                                        // data 有效到下一次 Get / Stop
+ *   }
+ *   SD_ReadPipe_Stop();                            // 提前结束也要调用：回收缓冲区，fil 可以再用
+ *
+ * 块从 offset 起按 SD_READ_PIPE_CHUNK 切分，offset 按 64KB 对齐时块不会跨 QSPI 擦除块。
+ * 只有一条流水线，同一时刻只能有一个调用者（同步本来就是串行的）。
+ */
+
+#ifndef SD_READ_PIPE_ASYNC
+#define SD_READ_PIPE_ASYNC 1u	/* 0: 不建读任务，Get() 里同步 f_read（前后对比计时用） */
+#endif
+
+#define SD_READ_PIPE_DEPTH 3u
+#define SD_READ_PIPE_CHUNK 4096u
+
+bool SD_ReadPipe_Start(FIL *fil, uint32_t offset, uint32_t length);
+bool SD_ReadPipe_Get(uint8_t **data, uint32_t *len);
+void SD_ReadPipe_Stop(void);
+
+#endif /* SD_READ_PIPE_H */
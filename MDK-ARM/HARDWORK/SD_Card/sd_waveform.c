@@ -1,32 +1,74 @@
 #include "sd_waveform.h"
 
 #include "SD.h"
+#include "crc32_fast.h"
+#include "sd_read_pipe.h"
+#include "cmsis_os2.h"
 #include "qspi_w25q256.h"
 #include "sd_time.h"
 
 #include "ff.h"
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
-#define SD_DAC_WAVE_CHANNELS 4u
-#define SD_DAC_WAVE_ERASE_UNIT 0x00010000u
 #define SD_DAC_WAVE_MMAP_BASE 0x90000000u
-#define SD_DAC_WAVE_IO_CHUNK 4096u
+#define SD_DAC_ZWAVE_PAD_WORDS 2u
+/* Block header + 16-bit residuals (padded) per channel, the largest block the encoder emits. */
+#define SD_DAC_ZWAVE_BLOCK_MAX_WORDS(channels) ((channels) * (1u + SD_DAC_ZWAVE_BLOCK_SAMPLES / 2u))
+
+/* Either partition header, read as the larger (64-byte) one. */
+typedef union {
+	SD_DacWaveHeader_t code16;
+	SD_DacWaveHeaderV2_t code16v2;
+	SD_DacFrameWaveHeader_t frame32;
+	SD_DacZWaveHeader_t zcode16;
+	uint8_t raw[sizeof(SD_DacFrameWaveHeader_t)];
+} sd_dac_wave_header_buf_t;
+
+/* Format-independent view of a validated partition header. */
+typedef struct {
+	uint32_t format;
+	uint32_t header_bytes;
+	uint32_t sample_rate_hz;
+	uint32_t sample_count;
+	uint32_t data_offset;
+	uint32_t data_bytes;
+	uint32_t checksum;
+	uint32_t loop_start;
+	uint32_t loop_end;
+	uint32_t loop_flags;
+	uint32_t channel_count;
+} sd_dac_wave_layout_t;
+
+/* The directory is committed as one erase sector. */
+typedef char sd_dac_dir_size_check_t[(sizeof(SD_DacWaveDir_t) == SD_DAC_DIR_SECTOR_SIZE) ? 1 : -1];
+
+/* RAM copy of the current directory; `slot` is the copy it was read from / last written to. */
+static SD_DacWaveDir_t s_dac_dir;
+static SD_DacWaveDir_t s_dac_dir_check; /* the other copy at load, readback at commit */
+static bool s_dac_dir_loaded = false;
+static uint32_t s_dac_dir_slot = 1u;    /* first commit goes to copy A */
+static uint32_t s_dac_sync_hash[SD_DAC_QSPI_BLOCK_COUNT]; /* block hashes of the SD file being synced */
+
+/* Background payload check of one directory entry (SD_Wave_VerifyStep). */
+typedef struct {
+	uint32_t index;
+	uint32_t key;   /* entry key of the running job, 0 = none */
+	uint32_t pos;   /* payload bytes hashed so far */
+	uint32_t value;
+	sd_dac_wave_layout_t layout;
+} sd_dac_verify_job_t;
+
+static sd_dac_verify_job_t s_dac_verify;
+static uint32_t s_dac_verified_key[SD_DAC_DIR_ENTRY_MAX]; /* key of the entry contents that last passed */
 
 static bool sd_dac_wave_partition_valid(SD_DacWavePartition_t partition)
 {
 	return ((uint32_t)partition < SD_DAC_QSPI_PARTITION_COUNT);
 }
 
-uint32_t SD_Wave_GetPartitionBaseOffset(SD_DacWavePartition_t partition)
-{
-	if (!sd_dac_wave_partition_valid(partition)) {
-		return SD_DAC_QSPI_BASE_OFFSET;
-	}
-	return SD_DAC_QSPI_BASE_OFFSET + ((uint32_t)partition * SD_DAC_QSPI_PARTITION_SIZE);
-}
-
 const char *SD_Wave_GetPartitionName(SD_DacWavePartition_t partition)
 {
 	switch (partition) {
@@ -54,33 +96,177 @@ static uint32_t sd_dac_wave_checksum_update(uint32_t checksum, const uint8_t *da
 	return value;
 }
 
-static bool sd_dac_wave_header_valid(const SD_DacWaveHeader_t *hdr, uint32_t max_region_bytes)
+/* D8CW 用 FNV 风格校验，DACW / D8CZ 用 CRC32（与 dac_wave_sync.c 一致）。 */
+static uint32_t sd_dac_wave_hash_init(const sd_dac_wave_layout_t *layout)
 {
-	uint64_t total_bytes = 0u;
+	return (layout->format == SD_DAC_WAVE_FORMAT_CODE16x4) ? 2166136261u : 0u;
+}
+
+static uint32_t sd_dac_wave_hash_update(const sd_dac_wave_layout_t *layout, uint32_t value,
+                                        const uint8_t *data, uint32_t len)
+{
+	if (layout->format == SD_DAC_WAVE_FORMAT_CODE16x4) {
+		return sd_dac_wave_checksum_update(value, data, len);
+	}
+	return CRC32_Fast_Update(value, data, len);
+}
+
+/* Version 1 / no markers: the whole partition loops. Markers outside the data reject the header. */
+static bool sd_dac_wave_loop_parse(uint32_t version, const SD_DacWaveLoop_t *loop, sd_dac_wave_layout_t *layout)
+{
+	layout->loop_start = 0u;
+	layout->loop_end = layout->sample_count;
+	layout->loop_flags = 0u;
+	if (version < SD_DAC_WAVE_VERSION_LOOP || loop->loop_end == 0u) {
+		return true;
+	}
+	if (loop->loop_end > layout->sample_count || loop->loop_start >= loop->loop_end) {
+		return false;
+	}
+	layout->loop_start = loop->loop_start;
+	layout->loop_end = loop->loop_end;
+	layout->loop_flags = loop->loop_flags;
+	return true;
+}
+
+static bool sd_dac_wave_version_ok(uint32_t version, uint32_t v1)
+{
+	return (version == v1) || (version == SD_DAC_WAVE_VERSION_LOOP);
+}
+
+/* A well-formed header may carry either count; whether this build plays it is checked at sync / load. */
+static bool sd_dac_wave_channels_ok(uint32_t channels)
+{
+	return (channels == 4u) || (channels == SD_DAC_WAVE_CHANNELS_MAX);
+}
+
+static bool sd_dac_wave_code16_header_parse(const sd_dac_wave_header_buf_t *buf, uint32_t header_len,
+                                            sd_dac_wave_layout_t *layout)
+{
+	const SD_DacWaveHeader_t *hdr = &buf->code16;
+	uint32_t header_bytes = sizeof(SD_DacWaveHeader_t);
 	uint32_t expected_data_bytes = 0u;
 
-	if (!hdr) {
+	if (hdr->magic != SD_DAC_WAVE_MAGIC || !sd_dac_wave_version_ok(hdr->version, SD_DAC_WAVE_VERSION)) {
 		return false;
 	}
-	if (hdr->magic != SD_DAC_WAVE_MAGIC || hdr->version != SD_DAC_WAVE_VERSION) {
+	if (hdr->version == SD_DAC_WAVE_VERSION_LOOP) {
+		header_bytes = sizeof(SD_DacWaveHeaderV2_t);
+	}
+	if (header_len < header_bytes) {
 		return false;
 	}
-	if (hdr->channel_count != SD_DAC_WAVE_CHANNELS) {
+	if (!sd_dac_wave_channels_ok(hdr->channel_count)) {
 		return false;
 	}
 	if (hdr->sample_rate_hz == 0u || hdr->sample_count == 0u) {
 		return false;
 	}
-	if (hdr->data_offset < sizeof(SD_DacWaveHeader_t)) {
+	if (hdr->data_offset < header_bytes) {
 		return false;
 	}
 
-	expected_data_bytes = hdr->sample_count * SD_DAC_WAVE_CHANNELS * (uint32_t)sizeof(uint16_t);
+	expected_data_bytes = hdr->sample_count * hdr->channel_count * (uint32_t)sizeof(uint16_t);
 	if (hdr->data_bytes != expected_data_bytes) {
 		return false;
 	}
 
-	total_bytes = (uint64_t)hdr->data_offset + (uint64_t)hdr->data_bytes;
+	layout->format = SD_DAC_WAVE_FORMAT_CODE16x4;
+	layout->header_bytes = header_bytes;
+	layout->sample_rate_hz = hdr->sample_rate_hz;
+	layout->sample_count = hdr->sample_count;
+	layout->data_offset = hdr->data_offset;
+	layout->data_bytes = hdr->data_bytes;
+	layout->checksum = hdr->checksum;
+	layout->channel_count = hdr->channel_count;
+	return sd_dac_wave_loop_parse(hdr->version, &buf->code16v2.loop, layout);
+}
+
+static bool sd_dac_wave_frame32_header_parse(const SD_DacFrameWaveHeader_t *hdr, sd_dac_wave_layout_t *layout)
+{
+	if (hdr->magic != SD_DAC_FRAME_WAVE_MAGIC || !sd_dac_wave_version_ok(hdr->version, SD_DAC_FRAME_WAVE_VERSION)) {
+		return false;
+	}
+	if (hdr->header_bytes != sizeof(SD_DacFrameWaveHeader_t) || !sd_dac_wave_channels_ok(hdr->words_per_sample)) {
+		return false;
+	}
+	if (hdr->sample_rate == 0u || hdr->sample_count == 0u) {
+		return false;
+	}
+	/* One 4-byte word per channel; reject counts that overflow 32-bit byte length. */
+	if (hdr->sample_count > (0xFFFFFFFFu / (hdr->words_per_sample * (uint32_t)sizeof(uint32_t)))) {
+		return false;
+	}
+
+	layout->format = SD_DAC_WAVE_FORMAT_FRAME32;
+	layout->header_bytes = hdr->header_bytes;
+	layout->sample_rate_hz = hdr->sample_rate;
+	layout->sample_count = hdr->sample_count;
+	layout->data_offset = hdr->header_bytes;
+	layout->data_bytes = hdr->sample_count * hdr->words_per_sample * (uint32_t)sizeof(uint32_t);
+	layout->checksum = hdr->crc32;
+	layout->channel_count = hdr->words_per_sample;
+	return sd_dac_wave_loop_parse(hdr->version, &hdr->loop, layout);
+}
+
+static bool sd_dac_wave_zcode16_header_parse(const SD_DacZWaveHeader_t *hdr, sd_dac_wave_layout_t *layout)
+{
+	const uint32_t channels = (hdr->channel_count == 0u) ? 4u : hdr->channel_count;
+	uint32_t blocks = 0u;
+
+	if (hdr->magic != SD_DAC_ZWAVE_MAGIC || !sd_dac_wave_version_ok(hdr->version, SD_DAC_ZWAVE_VERSION)) {
+		return false;
+	}
+	if (hdr->header_bytes != sizeof(SD_DacZWaveHeader_t) || hdr->block_samples != SD_DAC_ZWAVE_BLOCK_SAMPLES) {
+		return false;
+	}
+	if (hdr->sample_rate == 0u || hdr->sample_count == 0u || (hdr->data_bytes & 3u) != 0u ||
+	    !sd_dac_wave_channels_ok(channels)) {
+		return false;
+	}
+	/* 偏移表 + 填充字是下限，每块最大字数是上限；超出任一侧都不是编码器的输出。 */
+	blocks = (hdr->sample_count + SD_DAC_ZWAVE_BLOCK_SAMPLES - 1u) / SD_DAC_ZWAVE_BLOCK_SAMPLES;
+	if ((uint64_t)hdr->data_bytes < ((uint64_t)blocks + SD_DAC_ZWAVE_PAD_WORDS) * sizeof(uint32_t) ||
+	    (uint64_t)hdr->data_bytes >
+	        ((uint64_t)blocks * (1u + SD_DAC_ZWAVE_BLOCK_MAX_WORDS(channels)) + SD_DAC_ZWAVE_PAD_WORDS) *
+	            sizeof(uint32_t)) {
+		return false;
+	}
+
+	layout->format = SD_DAC_WAVE_FORMAT_ZCODE16x4;
+	layout->header_bytes = hdr->header_bytes;
+	layout->sample_rate_hz = hdr->sample_rate;
+	layout->sample_count = hdr->sample_count;
+	layout->data_offset = hdr->header_bytes;
+	layout->data_bytes = hdr->data_bytes;
+	layout->checksum = hdr->crc32;
+	layout->channel_count = channels;
+	return sd_dac_wave_loop_parse(hdr->version, &hdr->loop, layout);
+}
+
+static bool sd_dac_wave_header_valid(const sd_dac_wave_header_buf_t *hdr, uint32_t header_len,
+                                     uint32_t max_region_bytes, sd_dac_wave_layout_t *layout)
+{
+	uint64_t total_bytes = 0u;
+	bool ok = false;
+
+	if (!hdr || !layout) {
+		return false;
+	}
+	memset(layout, 0, sizeof(*layout));
+
+	if (header_len >= sizeof(SD_DacFrameWaveHeader_t) && hdr->frame32.magic == SD_DAC_FRAME_WAVE_MAGIC) {
+		ok = sd_dac_wave_frame32_header_parse(&hdr->frame32, layout);
+	} else if (header_len >= sizeof(SD_DacZWaveHeader_t) && hdr->zcode16.magic == SD_DAC_ZWAVE_MAGIC) {
+		ok = sd_dac_wave_zcode16_header_parse(&hdr->zcode16, layout);
+	} else if (header_len >= sizeof(SD_DacWaveHeader_t)) {
+		ok = sd_dac_wave_code16_header_parse(hdr, header_len, layout);
+	}
+	if (!ok) {
+		return false;
+	}
+
+	total_bytes = (uint64_t)layout->data_offset + (uint64_t)layout->data_bytes;
 	if (total_bytes > max_region_bytes) {
 		return false;
 	}
@@ -88,20 +274,388 @@ static bool sd_dac_wave_header_valid(const SD_DacWaveHeader_t *hdr, uint32_t max
 	return true;
 }
 
-static void sd_dac_wave_info_from_header(const SD_DacWaveHeader_t *hdr,
+static void sd_dac_wave_info_from_header(const sd_dac_wave_layout_t *layout,
                                          uint32_t partition_base,
-                                         SD_DacWavePartition_t partition,
+                                         uint32_t index,
                                          SD_DacWaveInfo_t *info)
 {
-	if (!hdr || !info) {
+	if (!layout || !info) {
+		return;
+	}
+
+	info->sample_rate_hz = layout->sample_rate_hz;
+	info->sample_count = layout->sample_count;
+	info->qspi_data_offset = partition_base + layout->data_offset;
+	info->qspi_mmap_addr = SD_DAC_WAVE_MMAP_BASE + info->qspi_data_offset;
+	info->partition_id = index;
+	info->format = layout->format;
+	info->loop_start = layout->loop_start;
+	info->loop_end = layout->loop_end;
+	info->loop_flags = layout->loop_flags;
+	info->data_bytes = layout->data_bytes;
+	info->channel_count = layout->channel_count;
+}
+
+static uint32_t sd_dac_extent_bytes(const sd_dac_wave_layout_t *layout)
+{
+	return (layout->data_offset + layout->data_bytes + (SD_DAC_QSPI_EXTENT_ALIGN - 1u)) &
+	       ~(SD_DAC_QSPI_EXTENT_ALIGN - 1u);
+}
+
+static uint32_t sd_dac_dir_crc(const SD_DacWaveDir_t *dir)
+{
+	static const uint8_t zero[sizeof(uint32_t)] = {0u};
+	const uint8_t *raw = (const uint8_t *)dir;
+	const uint32_t at = (uint32_t)offsetof(SD_DacWaveDir_t, crc32);
+	uint32_t crc = CRC32_Fast_Update(0u, raw, at);
+
+	crc = CRC32_Fast_Update(crc, zero, sizeof(zero));
+	return CRC32_Fast_Update(crc, raw + at + sizeof(zero), (uint32_t)sizeof(*dir) - at - sizeof(zero));
+}
+
+static bool sd_dac_dir_entry_valid(const SD_DacWaveDirEntry_t *e)
+{
+	const uint32_t end = SD_DAC_QSPI_BASE_OFFSET + SD_DAC_QSPI_REGION_SIZE;
+
+	if (e->name[0] == '\0' || e->name[SD_DAC_DIR_NAME_LEN - 1u] != '\0') {
+		return false;
+	}
+	if ((e->offset & (SD_DAC_QSPI_EXTENT_ALIGN - 1u)) != 0u || (e->length & (SD_DAC_QSPI_EXTENT_ALIGN - 1u)) != 0u ||
+	    e->length == 0u || e->offset < SD_DAC_QSPI_BASE_OFFSET || e->offset >= end || e->length > end - e->offset) {
+		return false;
+	}
+	if (e->format != 0u && (uint64_t)e->data_offset + e->data_bytes > e->length) {
+		return false;
+	}
+	return true;
+}
+
+static bool sd_dac_dir_valid(const SD_DacWaveDir_t *dir)
+{
+	if (dir->magic != SD_DAC_DIR_MAGIC || dir->version != SD_DAC_DIR_VERSION ||
+	    dir->entry_count > SD_DAC_DIR_ENTRY_MAX || dir->crc32 != sd_dac_dir_crc(dir)) {
+		return false;
+	}
+	for (uint32_t i = 0u; i < dir->entry_count; i++) {
+		if (!sd_dac_dir_entry_valid(&dir->entry[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static uint32_t sd_dac_dir_offset(uint32_t slot)
+{
+	return (slot == 0u) ? SD_DAC_DIR_OFFSET_A : SD_DAC_DIR_OFFSET_B;
+}
+
+static void sd_dac_dir_reset(SD_DacWaveDir_t *dir)
+{
+	memset(dir, 0xFF, sizeof(*dir)); /* unused space stays erased-flash 0xFF */
+	dir->magic = SD_DAC_DIR_MAGIC;
+	dir->version = SD_DAC_DIR_VERSION;
+	dir->sequence = 0u;
+	dir->entry_count = 0u;
+	memset(dir->reserved, 0, sizeof(dir->reserved));
+	memset(dir->block_hash, 0, sizeof(dir->block_hash)); /* SD_DAC_DIR_HASH_UNKNOWN */
+}
+
+static void sd_dac_dir_entry_fill(SD_DacWaveDirEntry_t *e, const char *name, uint32_t offset, uint32_t length,
+                                  const sd_dac_wave_layout_t *layout)
+{
+	memset(e, 0, sizeof(*e));
+	(void)strncpy(e->name, name, SD_DAC_DIR_NAME_LEN - 1u);
+	e->offset = offset;
+	e->length = length;
+	e->format = layout->format;
+	e->sample_rate = layout->sample_rate_hz;
+	e->sample_count = layout->sample_count;
+	e->data_offset = layout->data_offset;
+	e->data_bytes = layout->data_bytes;
+	e->checksum = layout->checksum;
+	e->loop.loop_start = layout->loop_start;
+	e->loop.loop_end = layout->loop_end;
+	e->loop.loop_flags = layout->loop_flags;
+	e->channel_count = layout->channel_count;
+}
+
+static int32_t sd_dac_dir_find(const char *name)
+{
+	for (uint32_t i = 0u; i < s_dac_dir.entry_count; i++) {
+		if (strncmp(s_dac_dir.entry[i].name, name, SD_DAC_DIR_NAME_LEN) == 0) {
+			return (int32_t)i;
+		}
+	}
+	return -1;
+}
+
+/* First fit of `bytes` among the extents of every entry but `skip`; 0 when the region is full. */
+static uint32_t sd_dac_dir_alloc(uint32_t bytes, int32_t skip)
+{
+	const uint32_t end = SD_DAC_QSPI_BASE_OFFSET + SD_DAC_QSPI_REGION_SIZE;
+	uint32_t at = SD_DAC_QSPI_BASE_OFFSET;
+	bool moved = true;
+
+	while (moved) {
+		moved = false;
+		if (bytes > end - at) {
+			return 0u;
+		}
+		for (uint32_t i = 0u; i < s_dac_dir.entry_count; i++) {
+			const SD_DacWaveDirEntry_t *e = &s_dac_dir.entry[i];
+			if ((int32_t)i == skip || e->offset >= at + bytes || e->offset + e->length <= at) {
+				continue;
+			}
+			at = e->offset + e->length;
+			moved = true;
+			if (at >= end) {
+				return 0u;
+			}
+		}
+	}
+	return at;
+}
+
+/* Write the RAM directory to the other copy (QSPI in indirect mode). */
+static bool sd_dac_dir_commit(void)
+{
+	const uint32_t slot = s_dac_dir_slot ^ 1u;
+	const uint32_t addr = sd_dac_dir_offset(slot);
+
+	s_dac_dir.sequence++;
+	s_dac_dir.crc32 = sd_dac_dir_crc(&s_dac_dir);
+	if (QSPI_W25Qxx_SectorErase(addr) != QSPI_W25Qxx_OK ||
+	    QSPI_W25Qxx_WriteBuffer_Slow((uint8_t *)&s_dac_dir, addr, sizeof(s_dac_dir)) != QSPI_W25Qxx_OK ||
+	    QSPI_W25Qxx_ReadBuffer_Slow((uint8_t *)&s_dac_dir_check, addr, sizeof(s_dac_dir_check)) != QSPI_W25Qxx_OK ||
+	    memcmp(&s_dac_dir_check, &s_dac_dir, sizeof(s_dac_dir)) != 0) {
+		printf("[WAVE] dir commit failed @0x%08lX\r\n", (unsigned long)addr);
+		s_dac_dir_loaded = false; /* RAM copy is ahead of flash; reread both copies next time */
+		return false;
+	}
+	s_dac_dir_slot = slot;
+	return true;
+}
+
+/* No directory yet: adopt the headers of the fixed 7 x 4MB layout where they are. */
+static void sd_dac_dir_adopt_legacy(void)
+{
+	sd_dac_wave_header_buf_t hdr;
+	sd_dac_wave_layout_t layout;
+
+	sd_dac_dir_reset(&s_dac_dir);
+	for (uint32_t i = 0u; i < SD_DAC_QSPI_PARTITION_COUNT; i++) {
+		const uint32_t base = SD_DAC_QSPI_BASE_OFFSET + i * SD_DAC_QSPI_LEGACY_PARTITION_SIZE;
+		if (QSPI_W25Qxx_ReadBuffer_Slow(hdr.raw, base, sizeof(hdr)) != QSPI_W25Qxx_OK ||
+		    !sd_dac_wave_header_valid(&hdr, sizeof(hdr), SD_DAC_QSPI_LEGACY_PARTITION_SIZE, &layout)) {
+			continue;
+		}
+		sd_dac_dir_entry_fill(&s_dac_dir.entry[s_dac_dir.entry_count++],
+		                      SD_Wave_GetPartitionName((SD_DacWavePartition_t)i), base,
+		                      sd_dac_extent_bytes(&layout), &layout);
+	}
+	if (s_dac_dir.entry_count != 0u) {
+		printf("[WAVE] dir: adopting %lu legacy partitions\r\n", (unsigned long)s_dac_dir.entry_count);
+		(void)sd_dac_dir_commit();
+	}
+}
+
+/* QSPI in indirect mode. Reads both copies once per boot, later calls use the RAM copy. */
+static void sd_dac_dir_load_locked(void)
+{
+	bool valid_a = false;
+	bool valid_b = false;
+
+	if (s_dac_dir_loaded) {
 		return;
 	}
+	valid_a = (QSPI_W25Qxx_ReadBuffer_Slow((uint8_t *)&s_dac_dir, SD_DAC_DIR_OFFSET_A, sizeof(s_dac_dir)) ==
+	           QSPI_W25Qxx_OK) && sd_dac_dir_valid(&s_dac_dir);
+	valid_b = (QSPI_W25Qxx_ReadBuffer_Slow((uint8_t *)&s_dac_dir_check, SD_DAC_DIR_OFFSET_B,
+	                                       sizeof(s_dac_dir_check)) == QSPI_W25Qxx_OK) &&
+	          sd_dac_dir_valid(&s_dac_dir_check);
+
+	if (valid_b && (!valid_a || (int32_t)(s_dac_dir_check.sequence - s_dac_dir.sequence) > 0)) {
+		memcpy(&s_dac_dir, &s_dac_dir_check, sizeof(s_dac_dir));
+		s_dac_dir_slot = 1u;
+	} else if (valid_a) {
+		s_dac_dir_slot = 0u;
+	} else if (s_dac_dir.magic == SD_DAC_DIR_MAGIC || s_dac_dir_check.magic == SD_DAC_DIR_MAGIC) {
+		/* Unreadable / other-version directory: the old 4MB slots may be overwritten, start empty. */
+		printf("[WAVE] dir: no valid copy, starting empty\r\n");
+		s_dac_dir_slot = 1u;
+		sd_dac_dir_reset(&s_dac_dir);
+	} else {
+		s_dac_dir_slot = 1u;
+		sd_dac_dir_adopt_legacy();
+	}
+	/* Entries committed before the channel count was recorded are 4-channel waves. */
+	for (uint32_t i = 0u; i < s_dac_dir.entry_count; i++) {
+		if (s_dac_dir.entry[i].channel_count == 0u) {
+			s_dac_dir.entry[i].channel_count = 4u;
+		}
+	}
+	s_dac_dir_loaded = true;
+}
+
+static bool sd_dac_dir_entry_info(uint32_t index, SD_DacWaveInfo_t *info)
+{
+	const SD_DacWaveDirEntry_t *e = NULL;
 
-	info->sample_rate_hz = hdr->sample_rate_hz;
-	info->sample_count = hdr->sample_count;
-	info->qspi_data_offset = partition_base + hdr->data_offset;
+	if (index >= s_dac_dir.entry_count || s_dac_dir.entry[index].format == 0u) {
+		return false;
+	}
+	e = &s_dac_dir.entry[index];
+	if (e->channel_count != SD_DAC_WAVE_CHANNELS) {
+		printf("[WAVE] %s: %lu channels, this build streams %lu\r\n", e->name, (unsigned long)e->channel_count,
+		       (unsigned long)SD_DAC_WAVE_CHANNELS);
+		return false;
+	}
+	info->sample_rate_hz = e->sample_rate;
+	info->sample_count = e->sample_count;
+	info->qspi_data_offset = e->offset + e->data_offset;
 	info->qspi_mmap_addr = SD_DAC_WAVE_MMAP_BASE + info->qspi_data_offset;
-	info->partition_id = (uint32_t)partition;
+	info->partition_id = index;
+	info->format = e->format;
+	info->loop_start = e->loop.loop_start;
+	info->loop_end = e->loop.loop_end;
+	info->loop_flags = e->loop.loop_flags;
+	info->data_bytes = e->data_bytes;
+	info->channel_count = e->channel_count;
+	return true;
+}
+
+/* Directory access from task context: leave memory-mapped mode, load, re-enter. */
+static bool sd_dac_dir_ensure(void)
+{
+	if (s_dac_dir_loaded) {
+		return true;
+	}
+	(void)QSPI_W25Qxx_ExitMemoryMapped();
+	if (QSPI_W25Qxx_Init() != QSPI_W25Qxx_OK) {
+		return false;
+	}
+	(void)QSPI_W25Qxx_ExitMemoryMapped();
+	sd_dac_dir_load_locked();
+	return (QSPI_W25Qxx_EnterMemoryMapped() == QSPI_W25Qxx_OK);
+}
+
+bool SD_Wave_DirLoad(void)
+{
+	if (!sd_dac_dir_ensure()) {
+		return false;
+	}
+	printf("[WAVE] dir: seq=%lu entries=%lu copy=%c\r\n", (unsigned long)s_dac_dir.sequence,
+	       (unsigned long)s_dac_dir.entry_count, (s_dac_dir_slot == 0u) ? 'A' : 'B');
+	return true;
+}
+
+uint32_t SD_Wave_DirCount(void)
+{
+	return sd_dac_dir_ensure() ? s_dac_dir.entry_count : 0u;
+}
+
+bool SD_Wave_DirEntryInfo(uint32_t index, SD_DacWaveInfo_t *info, const char **name)
+{
+	if (!info || !sd_dac_dir_ensure() || index >= s_dac_dir.entry_count) {
+		return false;
+	}
+	memset(info, 0, sizeof(*info));
+	if (name) {
+		*name = s_dac_dir.entry[index].name;
+	}
+	return sd_dac_dir_entry_info(index, info);
+}
+
+bool SD_Wave_LoadDacInfoByName(const char *name, SD_DacWaveInfo_t *info)
+{
+	int32_t index = -1;
+
+	if (!name || !info || !sd_dac_dir_ensure()) {
+		return false;
+	}
+	memset(info, 0, sizeof(*info));
+	index = sd_dac_dir_find(name);
+	return (index >= 0) && sd_dac_dir_entry_info((uint32_t)index, info);
+}
+
+uint32_t SD_Wave_GetPartitionBaseOffset(SD_DacWavePartition_t partition)
+{
+	int32_t index = -1;
+
+	if (!sd_dac_wave_partition_valid(partition) || !sd_dac_dir_ensure()) {
+		return 0u;
+	}
+	index = sd_dac_dir_find(SD_Wave_GetPartitionName(partition));
+	return (index >= 0) ? s_dac_dir.entry[index].offset : 0u;
+}
+
+/* Entry contents (extent, header fields, checksum) as one non-zero key. */
+static uint32_t sd_dac_verify_key(const SD_DacWaveDirEntry_t *e)
+{
+	const uint32_t key = CRC32_Fast_Update(0u, e, sizeof(*e));
+	return (key != 0u) ? key : 1u;
+}
+
+/*
+ * 后台校验：首次调用先核对 flash 里的分区头与目录条目一致，之后每次最多哈希 budget 字节的载荷
+ * （映射读 QSPI，CRC32 走 CRC 外设），算完与头里的校验值比较。
+ */
+SD_WaveVerify_t SD_Wave_VerifyStep(uint32_t index, uint32_t budget_bytes)
+{
+	const SD_DacWaveDirEntry_t *e = NULL;
+	const uint8_t *base = NULL;
+	uint32_t key = 0u;
+	uint32_t len = 0u;
+
+	if (!s_dac_dir_loaded || index >= s_dac_dir.entry_count || s_dac_dir.entry[index].format == 0u) {
+		return SD_WAVE_VERIFY_BAD;
+	}
+	e = &s_dac_dir.entry[index];
+	key = sd_dac_verify_key(e);
+	if (s_dac_verified_key[index] == key) {
+		return SD_WAVE_VERIFY_OK;
+	}
+	base = (const uint8_t *)(uintptr_t)(SD_DAC_WAVE_MMAP_BASE + e->offset);
+
+	if (s_dac_verify.key != key || s_dac_verify.index != index) {
+		sd_dac_wave_header_buf_t hdr;
+		SD_DacWaveDirEntry_t want;
+
+		memset(&s_dac_verify, 0, sizeof(s_dac_verify));
+		memcpy(hdr.raw, base, sizeof(hdr));
+		if (!sd_dac_wave_header_valid(&hdr, sizeof(hdr), e->length, &s_dac_verify.layout)) {
+			printf("[WAVE] verify %s: no valid header in flash\r\n", e->name);
+			return SD_WAVE_VERIFY_BAD;
+		}
+		sd_dac_dir_entry_fill(&want, e->name, e->offset, e->length, &s_dac_verify.layout);
+		if (memcmp(&want, e, sizeof(want)) != 0) {
+			printf("[WAVE] verify %s: flash header differs from the directory\r\n", e->name);
+			return SD_WAVE_VERIFY_BAD;
+		}
+		s_dac_verify.index = index;
+		s_dac_verify.key = key;
+		s_dac_verify.value = sd_dac_wave_hash_init(&s_dac_verify.layout);
+	}
+
+	len = e->data_bytes - s_dac_verify.pos;
+	if (budget_bytes != 0u && len > budget_bytes) {
+		len = budget_bytes;
+	}
+	s_dac_verify.value = sd_dac_wave_hash_update(&s_dac_verify.layout, s_dac_verify.value,
+	                                             base + e->data_offset + s_dac_verify.pos, len);
+	s_dac_verify.pos += len;
+	if (s_dac_verify.pos < e->data_bytes) {
+		return SD_WAVE_VERIFY_BUSY;
+	}
+
+	s_dac_verify.key = 0u;
+	if (s_dac_verify.value != e->checksum) {
+		printf("[WAVE] verify %s: payload checksum exp=0x%08lX got=0x%08lX\r\n", e->name,
+		       (unsigned long)e->checksum, (unsigned long)s_dac_verify.value);
+		return SD_WAVE_VERIFY_BAD;
+	}
+	s_dac_verified_key[index] = key;
+	return SD_WAVE_VERIFY_OK;
 }
 
 static bool sd_make_parent_dir(const char *path)
@@ -269,33 +823,190 @@ bool SD_Wave_AutoSave(uint8_t channel, const float *data, uint32_t len, bool csv
 	return SD_Wave_SaveBinEx(file, data, len, &meta);
 }
 
-bool SD_Wave_SyncDacToQspiPartition(const char *sd_path, SD_DacWavePartition_t partition, SD_DacWaveInfo_t *info)
+static uint32_t sd_dac_block_index(uint32_t offset)
+{
+	return (offset - SD_DAC_QSPI_BASE_OFFSET) / SD_DAC_QSPI_EXTENT_ALIGN;
+}
+
+/* Every block of the extent has a known hash (nothing left half-written by an interrupted sync). */
+static bool sd_dac_dir_blocks_known(uint32_t offset, uint32_t length)
+{
+	const uint32_t first = sd_dac_block_index(offset);
+
+	for (uint32_t b = 0u; b < length / SD_DAC_QSPI_EXTENT_ALIGN; b++) {
+		if (s_dac_dir.block_hash[first + b] == SD_DAC_DIR_HASH_UNKNOWN) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* CRC32 continued over `n` erased (0xFF) bytes: the tail of the last block past the file image. */
+static uint32_t sd_dac_crc32_erased(uint32_t crc, uint32_t n)
+{
+	static uint8_t ff[256];
+
+	if (ff[0] != 0xFFu) {
+		memset(ff, 0xFF, sizeof(ff));
+	}
+	while (n != 0u) {
+		const uint32_t len = (n < sizeof(ff)) ? n : (uint32_t)sizeof(ff);
+		crc = CRC32_Fast_Update(crc, ff, len);
+		n -= len;
+	}
+	return crc;
+}
+
+/*
+ * Read the whole file image once through the read-ahead pipe: CRC32 of each 64KB block
+ * as it will sit in flash (tail padded with erased 0xFF) into s_dac_sync_hash, and the
+ * payload checksum of the header, hashed while the next chunk is already being read.
+ * Nothing is written to QSPI.
+ */
+static bool sd_dac_sync_hash_file(FIL *fil, const sd_dac_wave_layout_t *layout, uint32_t blocks)
+{
+	const uint32_t total = layout->data_offset + layout->data_bytes;
+	uint32_t checksum = sd_dac_wave_hash_init(layout);
+	uint32_t pos = 0u;
+	bool ok = SD_ReadPipe_Start(fil, 0u, total);
+
+	for (uint32_t b = 0u; ok && b < blocks; b++) {
+		const uint32_t block_end = (b + 1u) * SD_DAC_QSPI_EXTENT_ALIGN;
+		uint32_t crc = 0u;
+
+		while (pos < block_end && pos < total) {
+			uint8_t *data = NULL;
+			uint32_t len = 0u;
+			if (!SD_ReadPipe_Get(&data, &len)) {
+				printf("[WAVE] read data failed @%lu\r\n", (unsigned long)pos);
+				ok = false;
+				break;
+			}
+			if (pos + len > layout->data_offset) {
+				const uint32_t skip = (pos < layout->data_offset) ? (layout->data_offset - pos) : 0u;
+				checksum = sd_dac_wave_hash_update(layout, checksum, data + skip, len - skip);
+			}
+			crc = CRC32_Fast_Update(crc, data, len);
+			pos += len;
+		}
+		if (pos < block_end) {
+			crc = sd_dac_crc32_erased(crc, block_end - pos);
+			pos = block_end;
+		}
+		s_dac_sync_hash[b] = (crc == SD_DAC_DIR_HASH_UNKNOWN) ? 1u : crc;
+	}
+	SD_ReadPipe_Stop();
+	if (!ok) {
+		return false;
+	}
+	if (checksum != layout->checksum) {
+		printf("[WAVE] checksum mismatch exp=0x%08lX got=0x%08lX\r\n",
+		       (unsigned long)layout->checksum, (unsigned long)checksum);
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Erase block `b` of the extent at `base` and program the file bytes that fall into it.
+ * The read-ahead pipe is started before the erase, so the first chunks are in RAM when
+ * the erase finishes and chunk N+1 is read while chunk N is programmed; the bytes are
+ * hashed again on the way and must match s_dac_sync_hash[b] (file unchanged since pass 1).
+ * Quad page program with memory-mapped verify (the driver rewrites mismatching pages 1-1-1);
+ * a page that still reads back wrong has bits cleared that should not be, so the block is
+ * erased once more and written 1-1-1 only.
+ */
+static bool sd_dac_sync_program_block(FIL *fil, uint32_t total, uint32_t base, uint32_t b, uint32_t *programmed)
+{
+	const uint32_t start = b * SD_DAC_QSPI_EXTENT_ALIGN;
+	const uint32_t block_end = (total < start + SD_DAC_QSPI_EXTENT_ALIGN) ? total : (start + SD_DAC_QSPI_EXTENT_ALIGN);
+
+	for (uint32_t attempt = 0u; attempt < 2u; attempt++) {
+		const bool quad = (attempt == 0u);
+		uint32_t pos = start;
+		uint32_t crc = 0u;
+		int8_t ret = QSPI_W25Qxx_OK;
+
+		if (!SD_ReadPipe_Start(fil, start, block_end - start)) {
+			printf("[WAVE] seek data failed @%lu\r\n", (unsigned long)pos);
+			return false;
+		}
+		if (QSPI_W25Qxx_BlockErase_64K(base + pos) != QSPI_W25Qxx_OK) {
+			SD_ReadPipe_Stop();
+			printf("[WAVE] erase failed @0x%08lX\r\n", (unsigned long)(base + pos));
+			return false;
+		}
+		while (pos < block_end) {
+			uint8_t *data = NULL;
+			uint32_t len = 0u;
+			if (!SD_ReadPipe_Get(&data, &len)) {
+				SD_ReadPipe_Stop();
+				printf("[WAVE] read data failed @%lu\r\n", (unsigned long)pos);
+				return false;
+			}
+			ret = quad ? QSPI_W25Qxx_WriteBuffer_Verify(data, base + pos, len)
+			           : QSPI_W25Qxx_WriteBuffer_Slow(data, base + pos, len);
+			if (ret != QSPI_W25Qxx_OK) {
+				break;
+			}
+			crc = CRC32_Fast_Update(crc, data, len);
+			pos += len;
+		}
+		SD_ReadPipe_Stop();
+		if (ret == QSPI_W25Qxx_OK) {
+			crc = sd_dac_crc32_erased(crc, start + SD_DAC_QSPI_EXTENT_ALIGN - block_end);
+			if (((crc == SD_DAC_DIR_HASH_UNKNOWN) ? 1u : crc) != s_dac_sync_hash[b]) {
+				printf("[WAVE] file changed during sync @%lu\r\n", (unsigned long)start);
+				return false;
+			}
+			*programmed += block_end - start;
+			return true;
+		}
+		if (!quad || ret != W25Qxx_ERROR_Verify) {
+			printf("[WAVE] write data failed @%lu (%d)\r\n", (unsigned long)pos, (int)ret);
+			return false;
+		}
+		printf("[WAVE] quad verify failed @%lu, rewriting block 1-1-1\r\n", (unsigned long)pos);
+	}
+	return false;
+}
+
+/* bytes per us == MB/s */
+static double sd_dac_sync_mbps(uint32_t bytes, uint32_t us)
+{
+	return (us != 0u) ? ((double)bytes / (double)us) : 0.0;
+}
+
+bool SD_Wave_SyncDacToQspiNamed(const char *sd_path, const char *name, SD_DacWaveInfo_t *info)
 {
 	FIL fil;
 	FRESULT fres;
 	FRESULT sd_res;
 	UINT br = 0u;
-	SD_DacWaveHeader_t hdr = {0};
-	uint32_t checksum = 2166136261u;
-	uint32_t written = 0u;
-	uint32_t flash_total = 0u;
-	uint32_t erase_end = 0u;
+	sd_dac_wave_header_buf_t hdr;
+	sd_dac_wave_layout_t layout;
+	SD_DacWaveDirEntry_t want;
+	uint32_t total = 0u;
+	uint32_t extent_bytes = 0u;
+	uint32_t blocks = 0u;
+	uint32_t first_block = 0u;
 	uint32_t partition_base = 0u;
-	static uint8_t io_buf[SD_DAC_WAVE_IO_CHUNK];
+	uint32_t changed = 0u;
+	uint32_t programmed = 0u;
+	uint32_t t0 = 0u;
+	int32_t index = -1;
+	SD_DacWaveDirEntry_t *entry = NULL;
 
-	if (!sd_path || !info) {
+	if (!sd_path || !name || !info) {
 		return false;
 	}
-	if (!sd_dac_wave_partition_valid(partition)) {
-		printf("[WAVE] invalid partition: %lu\r\n", (unsigned long)partition);
+	if (name[0] == '\0' || strlen(name) >= SD_DAC_DIR_NAME_LEN) {
+		printf("[WAVE] invalid wave name\r\n");
 		return false;
 	}
 	memset(info, 0, sizeof(*info));
-	partition_base = SD_Wave_GetPartitionBaseOffset(partition);
-	printf("[WAVE] sync start: part=%s(%lu) path=%s\r\n",
-	       SD_Wave_GetPartitionName(partition),
-	       (unsigned long)partition,
-	       sd_path);
+	printf("[WAVE] sync start: name=%s path=%s\r\n", name, sd_path);
+	t0 = osKernelGetTickCount();
 
 	sd_res = SD_Init();
 	if (sd_res != FR_OK) {
@@ -310,15 +1021,22 @@ bool SD_Wave_SyncDacToQspiPartition(const char *sd_path, SD_DacWavePartition_t p
 		return false;
 	}
 
+	memset(&hdr, 0, sizeof(hdr));
 	fres = f_read(&fil, &hdr, sizeof(hdr), &br);
-	if (fres != FR_OK || br != sizeof(hdr) || !sd_dac_wave_header_valid(&hdr, SD_DAC_QSPI_PARTITION_SIZE)) {
+	if (fres != FR_OK || !sd_dac_wave_header_valid(&hdr, (uint32_t)br, SD_DAC_QSPI_REGION_SIZE, &layout)) {
 		(void)f_close(&fil);
 		printf("[WAVE] header invalid\r\n");
 		return false;
 	}
-
-	flash_total = hdr.data_offset + hdr.data_bytes;
-	erase_end = partition_base + ((flash_total + (SD_DAC_WAVE_ERASE_UNIT - 1u)) & ~(SD_DAC_WAVE_ERASE_UNIT - 1u));
+	if (layout.channel_count != SD_DAC_WAVE_CHANNELS) {
+		(void)f_close(&fil);
+		printf("[WAVE] %lu-channel wave, this build streams %lu\r\n", (unsigned long)layout.channel_count,
+		       (unsigned long)SD_DAC_WAVE_CHANNELS);
+		return false;
+	}
+	total = layout.data_offset + layout.data_bytes;
+	extent_bytes = sd_dac_extent_bytes(&layout);
+	blocks = extent_bytes / SD_DAC_QSPI_EXTENT_ALIGN;
 
 	/* Ensure QSPI is not left in memory-mapped mode from previous partition. */
 	(void)QSPI_W25Qxx_ExitMemoryMapped();
@@ -328,117 +1046,162 @@ bool SD_Wave_SyncDacToQspiPartition(const char *sd_path, SD_DacWavePartition_t p
 		return false;
 	}
 	(void)QSPI_W25Qxx_ExitMemoryMapped();
+	QSPI_W25Qxx_IoStatReset();
+	sd_dac_dir_load_locked();
 
-	for (uint32_t addr = partition_base; addr < erase_end; addr += SD_DAC_WAVE_ERASE_UNIT) {
-		if (QSPI_W25Qxx_BlockErase_64K(addr) != QSPI_W25Qxx_OK) {
-			(void)f_close(&fil);
-			printf("[WAVE] erase failed @0x%08lX\r\n", (unsigned long)addr);
-			return false;
+	/*
+	 * 区段大小不变就原地增量更新（哈希相同的块不擦不写）；大小变了就首次适配一个新区段，
+	 * 旧区段在新条目提交前一直有效，波形因此逐步向区域起点压紧；都放不下时才允许覆盖自己的旧区段。
+	 */
+	index = sd_dac_dir_find(name);
+	if (index >= 0 && s_dac_dir.entry[index].length == extent_bytes) {
+		partition_base = s_dac_dir.entry[index].offset;
+	} else {
+		partition_base = sd_dac_dir_alloc(extent_bytes, -1);
+		if (partition_base == 0u && index >= 0) {
+			partition_base = sd_dac_dir_alloc(extent_bytes, index);
 		}
 	}
-
-	if (QSPI_W25Qxx_WriteBuffer_Slow((uint8_t *)&hdr, partition_base, sizeof(hdr)) != QSPI_W25Qxx_OK) {
+	if (partition_base == 0u || (index < 0 && s_dac_dir.entry_count >= SD_DAC_DIR_ENTRY_MAX)) {
 		(void)f_close(&fil);
-		printf("[WAVE] write header failed\r\n");
+		printf("[WAVE] no QSPI space for %lu bytes (entries=%lu)\r\n", (unsigned long)extent_bytes,
+		       (unsigned long)s_dac_dir.entry_count);
 		return false;
 	}
+	first_block = sd_dac_block_index(partition_base);
+	sd_dac_dir_entry_fill(&want, name, partition_base, extent_bytes, &layout);
 
-	fres = f_lseek(&fil, hdr.data_offset);
-	if (fres != FR_OK) {
+	/* Same header, same extent, every block hash known: the flash copy is this file. */
+	if (index >= 0 && memcmp(&want, &s_dac_dir.entry[index], sizeof(want)) == 0 &&
+	    sd_dac_dir_blocks_known(partition_base, extent_bytes)) {
+		sd_dac_wave_header_buf_t check_hdr;
+		if (QSPI_W25Qxx_ReadBuffer_Slow(check_hdr.raw, partition_base, layout.header_bytes) == QSPI_W25Qxx_OK &&
+		    memcmp(check_hdr.raw, hdr.raw, layout.header_bytes) == 0) {
+			(void)f_close(&fil);
+			if (QSPI_W25Qxx_EnterMemoryMapped() != QSPI_W25Qxx_OK) {
+				printf("[WAVE] enter memory-mapped failed\r\n");
+				return false;
+			}
+			sd_dac_wave_info_from_header(&layout, partition_base, (uint32_t)index, info);
+			printf("[WAVE] sync skip: name=%s(%ld) header + block hashes match, %lu ms\r\n",
+			       name, (long)index, (unsigned long)(osKernelGetTickCount() - t0));
+			return true;
+		}
+	}
+
+	if (!sd_dac_sync_hash_file(&fil, &layout, blocks)) {
 		(void)f_close(&fil);
-		printf("[WAVE] seek data failed (%d)\r\n", (int)fres);
 		return false;
 	}
-
-	while (written < hdr.data_bytes) {
-		UINT req = (UINT)(hdr.data_bytes - written);
-		if (req > (UINT)sizeof(io_buf)) {
-			req = (UINT)sizeof(io_buf);
+	for (uint32_t b = 0u; b < blocks; b++) {
+		if (s_dac_dir.block_hash[first_block + b] != s_dac_sync_hash[b]) {
+			s_dac_dir.block_hash[first_block + b] = SD_DAC_DIR_HASH_UNKNOWN;
+			changed++;
 		}
+	}
 
-		fres = f_read(&fil, io_buf, req, &br);
-		if (fres != FR_OK || br == 0u) {
-			(void)f_close(&fil);
-			printf("[WAVE] read data failed (%d)\r\n", (int)fres);
-			return false;
+	if (changed != 0u) {
+		if (index >= 0) {
+			entry = &s_dac_dir.entry[index];
+			if (partition_base < entry->offset + entry->length && entry->offset < partition_base + extent_bytes) {
+				/* The blocks about to change hold the current data. */
+				entry->format = 0u;
+			}
 		}
-
-		if (QSPI_W25Qxx_WriteBuffer_Slow(io_buf, partition_base + hdr.data_offset + written, br) != QSPI_W25Qxx_OK) {
+		if (!sd_dac_dir_commit()) {
 			(void)f_close(&fil);
-			printf("[WAVE] write data failed @%lu\r\n", (unsigned long)written);
 			return false;
 		}
-
-		checksum = sd_dac_wave_checksum_update(checksum, io_buf, br);
-		written += br;
+		for (uint32_t b = 0u; b < blocks; b++) {
+			if (s_dac_dir.block_hash[first_block + b] != SD_DAC_DIR_HASH_UNKNOWN) {
+				continue;
+			}
+			if (!sd_dac_sync_program_block(&fil, total, partition_base, b, &programmed)) {
+				(void)f_close(&fil);
+				return false;
+			}
+			s_dac_dir.block_hash[first_block + b] = s_dac_sync_hash[b];
+		}
 	}
 	(void)f_close(&fil);
 
-	if (written != hdr.data_bytes || checksum != hdr.checksum) {
-		printf("[WAVE] checksum mismatch exp=0x%08lX got=0x%08lX\r\n",
-		       (unsigned long)hdr.checksum, (unsigned long)checksum);
-		return false;
-	}
-
 	{
-		SD_DacWaveHeader_t check_hdr = {0};
-		if (QSPI_W25Qxx_ReadBuffer_Slow((uint8_t *)&check_hdr, partition_base, sizeof(check_hdr)) != QSPI_W25Qxx_OK) {
+		sd_dac_wave_header_buf_t check_hdr;
+		if (QSPI_W25Qxx_ReadBuffer_Slow(check_hdr.raw, partition_base, layout.header_bytes) != QSPI_W25Qxx_OK) {
 			printf("[WAVE] readback header failed\r\n");
 			return false;
 		}
-		if (memcmp(&check_hdr, &hdr, sizeof(hdr)) != 0) {
+		if (memcmp(check_hdr.raw, hdr.raw, layout.header_bytes) != 0) {
 			printf("[WAVE] readback header mismatch\r\n");
 			return false;
 		}
 	}
 
+	if (index < 0) {
+		index = (int32_t)s_dac_dir.entry_count++;
+	}
+	if (changed != 0u || memcmp(&want, &s_dac_dir.entry[index], sizeof(want)) != 0) {
+		s_dac_dir.entry[index] = want;
+		if (!sd_dac_dir_commit()) {
+			return false;
+		}
+	}
+
 	if (QSPI_W25Qxx_EnterMemoryMapped() != QSPI_W25Qxx_OK) {
 		printf("[WAVE] enter memory-mapped failed\r\n");
 		return false;
 	}
+	if (changed != 0u) {
+		/* 校验窗口（及此前的播放）可能在 D-cache 里留下了重写前的行，切到新数据前丢掉 */
+		SCB_InvalidateDCache_by_Addr((uint32_t *)(uintptr_t)(SD_DAC_WAVE_MMAP_BASE + partition_base), (int32_t)extent_bytes);
+	}
 
-	sd_dac_wave_info_from_header(&hdr, partition_base, partition, info);
-	printf("[WAVE] sync ok: part=%s(%lu) sps=%lu count=%lu addr=0x%08lX\r\n",
-	       SD_Wave_GetPartitionName(partition),
-	       (unsigned long)partition,
+	sd_dac_wave_info_from_header(&layout, partition_base, (uint32_t)index, info);
+	printf("[WAVE] sync ok: name=%s(%ld) fmt=%lu sps=%lu count=%lu loop=%lu..%lu/%lu addr=0x%08lX extent=%luKB\r\n",
+	       name,
+	       (long)index,
+	       (unsigned long)info->format,
 	       (unsigned long)info->sample_rate_hz,
 	       (unsigned long)info->sample_count,
-	       (unsigned long)info->qspi_mmap_addr);
+	       (unsigned long)info->loop_start,
+	       (unsigned long)info->loop_end,
+	       (unsigned long)info->loop_flags,
+	       (unsigned long)info->qspi_mmap_addr,
+	       (unsigned long)(extent_bytes / 1024u));
+	printf("[WAVE] sync io: blocks changed=%lu/%lu programmed=%luKB of %luKB, %lu ms\r\n",
+	       (unsigned long)changed,
+	       (unsigned long)blocks,
+	       (unsigned long)(programmed / 1024u),
+	       (unsigned long)(total / 1024u),
+	       (unsigned long)(osKernelGetTickCount() - t0));
+	if (changed != 0u) {
+		QSPI_W25Qxx_IoStat_t io;
+		QSPI_W25Qxx_IoStatGet(&io);
+		printf("[WAVE] sync rate: erase %luKB %.2fMB/s, program %luKB %.2fMB/s, verify %luKB %.2fMB/s, "
+		       "1-1-1 fallback pages=%lu\r\n",
+		       (unsigned long)(io.erase_bytes / 1024u), sd_dac_sync_mbps(io.erase_bytes, io.erase_us),
+		       (unsigned long)(io.program_bytes / 1024u), sd_dac_sync_mbps(io.program_bytes, io.program_us),
+		       (unsigned long)(io.verify_bytes / 1024u), sd_dac_sync_mbps(io.verify_bytes, io.verify_us),
+		       (unsigned long)io.fallback_pages);
+	}
 	return true;
 }
 
-bool SD_Wave_LoadDacInfoFromQspiPartition(SD_DacWavePartition_t partition, SD_DacWaveInfo_t *info)
+bool SD_Wave_SyncDacToQspiPartition(const char *sd_path, SD_DacWavePartition_t partition, SD_DacWaveInfo_t *info)
 {
-	SD_DacWaveHeader_t hdr = {0};
-	uint32_t partition_base = 0u;
-
-	if (!info) {
-		return false;
-	}
 	if (!sd_dac_wave_partition_valid(partition)) {
+		printf("[WAVE] invalid partition: %lu\r\n", (unsigned long)partition);
 		return false;
 	}
-	memset(info, 0, sizeof(*info));
-	partition_base = SD_Wave_GetPartitionBaseOffset(partition);
-
-	(void)QSPI_W25Qxx_ExitMemoryMapped();
-	if (QSPI_W25Qxx_Init() != QSPI_W25Qxx_OK) {
-		return false;
-	}
-	(void)QSPI_W25Qxx_ExitMemoryMapped();
+	return SD_Wave_SyncDacToQspiNamed(sd_path, SD_Wave_GetPartitionName(partition), info);
+}
 
-	if (QSPI_W25Qxx_ReadBuffer_Slow((uint8_t *)&hdr, partition_base, sizeof(hdr)) != QSPI_W25Qxx_OK) {
-		return false;
-	}
-	if (!sd_dac_wave_header_valid(&hdr, SD_DAC_QSPI_PARTITION_SIZE)) {
-		return false;
-	}
-	if (QSPI_W25Qxx_EnterMemoryMapped() != QSPI_W25Qxx_OK) {
+bool SD_Wave_LoadDacInfoFromQspiPartition(SD_DacWavePartition_t partition, SD_DacWaveInfo_t *info)
+{
+	if (!sd_dac_wave_partition_valid(partition)) {
 		return false;
 	}
-
-	sd_dac_wave_info_from_header(&hdr, partition_base, partition, info);
-	return true;
+	return SD_Wave_LoadDacInfoByName(SD_Wave_GetPartitionName(partition), info);
 }
 
 bool SD_Wave_SyncDacToQspi(const char *sd_path, SD_DacWaveInfo_t *info)
@@ -7,28 +7,75 @@
 #define SD_WAVE_MAGIC 0x57415645u /* "WAVE" */
 #define SD_DAC_WAVE_MAGIC 0x44384357u /* "D8CW" */
 #define SD_DAC_WAVE_VERSION 1u
+#define SD_DAC_FRAME_WAVE_MAGIC 0x44414357u /* "DACW" */
+#define SD_DAC_FRAME_WAVE_VERSION 1u
+#define SD_DAC_ZWAVE_MAGIC 0x4438435Au /* "D8CZ" */
+#define SD_DAC_ZWAVE_VERSION 1u
+/* Version 2 of any of the three headers adds loop markers (tools/dac_wave_markers.py). */
+#define SD_DAC_WAVE_VERSION_LOOP 2u
+#define SD_DAC_WAVE_LOOP_ONE_SHOT 0x01u /* DAC8568_LOOP_ONE_SHOT */
+#define SD_DAC_ZWAVE_BLOCK_SAMPLES 64u /* DAC8568_ZCODE_BLOCK */
+
+/*
+ * Channels per sample (channel_count / words_per_sample in every header): 4 or
+ * 8. The build streams DAC8568_CHANNELS (dac8568_stream.h); a partition with
+ * another count stays in flash but is neither synced nor loaded.
+ */
+#ifndef DAC8568_CHANNELS
+#define DAC8568_CHANNELS 4u
+#endif
+#define SD_DAC_WAVE_CHANNELS DAC8568_CHANNELS
+#define SD_DAC_WAVE_CHANNELS_MAX 8u
+
+/* Partition payload layout; values match DAC_WAVE_FORMAT_* / DAC8568_WAVE_FORMAT_*. */
+#define SD_DAC_WAVE_FORMAT_FRAME32 1u  /* "DACW": channels x uint32 SPI frames per sample */
+#define SD_DAC_WAVE_FORMAT_CODE16x4 2u /* "D8CW": channels x uint16 codes per sample */
+#define SD_DAC_WAVE_FORMAT_ZCODE16x4 4u /* "D8CZ": codes compressed in blocks (dac8568_zcode.h) */
 
 /*
  * Reserved QSPI region for DAC waveform direct-read playback.
  *
  * W25Q256 total size: 32MB (0x02000000).
  * Partition:
- *  - 0x00000000 ~ 0x003FFFFF (4MB): reserved for future use
- *  - 0x00400000 ~ 0x01FFFFFF (28MB): DAC waveform storage (7 x 4MB)
+ *  - 0x00000000 ~ 0x003FDFFF: reserved for future use
+ *  - 0x003FE000 ~ 0x003FFFFF (2 x 4KB): wave directory, copies A / B
+ *  - 0x00400000 ~ 0x01FFFFFF (28MB): DAC waveform extents, allocated by the directory
  *
- * UI assets sync to QSPI is disabled in this project; the reserved 4MB stays free.
+ * UI assets sync to QSPI is disabled in this project; the reserved area stays free.
  */
 #define SD_DAC_QSPI_BASE_OFFSET 0x00400000u
 #define SD_DAC_QSPI_REGION_SIZE 0x01C00000u
+#define SD_DAC_QSPI_EXTENT_ALIGN 0x00010000u /* one 64KB erase block */
+
+/*
+ * Wave directory: one 4KB sector listing every wave in the region by name.
+ * Each commit writes the other copy with sequence + 1; boot keeps the valid
+ * copy with the newest sequence, so a power cut during a commit leaves the
+ * previous directory in place. An entry with format 0 reserves its extent
+ * while the extent is being rewritten and is not loadable.
+ *
+ * block_hash[i] is the CRC32 of the whole 64KB block i of the region as it
+ * sits in flash, or SD_DAC_DIR_HASH_UNKNOWN. Blocks are set to UNKNOWN in a
+ * commit before they are erased, so a sync only erases / programs the blocks
+ * whose hash differs from the SD file (unused bytes hashed as erased 0xFF).
+ *
+ * Flash written by the fixed 7 x 4MB layout (no directory yet) is adopted on
+ * first boot: each valid legacy header at SD_DAC_QSPI_BASE_OFFSET + i * 4MB
+ * becomes the entry named SD_Wave_GetPartitionName(i), data left in place.
+ */
+#define SD_DAC_DIR_MAGIC 0x44385054u /* "D8PT" */
+#define SD_DAC_DIR_VERSION 2u
+#define SD_DAC_DIR_SECTOR_SIZE 0x1000u
+#define SD_DAC_DIR_OFFSET_A (SD_DAC_QSPI_BASE_OFFSET - 2u * SD_DAC_DIR_SECTOR_SIZE)
+#define SD_DAC_DIR_OFFSET_B (SD_DAC_QSPI_BASE_OFFSET - SD_DAC_DIR_SECTOR_SIZE)
+#define SD_DAC_DIR_NAME_LEN 16u /* including the terminating NUL */
+#define SD_DAC_DIR_ENTRY_MAX 32u
+#define SD_DAC_DIR_HASH_UNKNOWN 0u
+#define SD_DAC_QSPI_BLOCK_COUNT (SD_DAC_QSPI_REGION_SIZE / SD_DAC_QSPI_EXTENT_ALIGN) /* 448 */
+
+/* Named waves synced from SD at boot (SD_DacWavePartition_t); more may live in the directory. */
 #define SD_DAC_QSPI_PARTITION_COUNT 7u
-#define SD_DAC_QSPI_PARTITION_SIZE  0x00400000u
-#define SD_DAC_QSPI_PART0_OFFSET (SD_DAC_QSPI_BASE_OFFSET + 0x000000u) /* normal */
-#define SD_DAC_QSPI_PART1_OFFSET (SD_DAC_QSPI_BASE_OFFSET + 0x400000u) /* ac coupling */
-#define SD_DAC_QSPI_PART2_OFFSET (SD_DAC_QSPI_BASE_OFFSET + 0x800000u) /* bus ground */
-#define SD_DAC_QSPI_PART3_OFFSET (SD_DAC_QSPI_BASE_OFFSET + 0xC00000u) /* insulation */
-#define SD_DAC_QSPI_PART4_OFFSET (SD_DAC_QSPI_BASE_OFFSET + 0x1000000u) /* cap aging */
-#define SD_DAC_QSPI_PART5_OFFSET (SD_DAC_QSPI_BASE_OFFSET + 0x1400000u) /* pwm abnormal */
-#define SD_DAC_QSPI_PART6_OFFSET (SD_DAC_QSPI_BASE_OFFSET + 0x1800000u) /* igbt fault */
+#define SD_DAC_QSPI_LEGACY_PARTITION_SIZE 0x00400000u
 
 typedef enum {
 	SD_DAC_WAVE_PART_NORMAL = 0u,         /* 正常波形 */
@@ -51,12 +98,98 @@ typedef struct {
 	uint32_t checksum;
 } SD_DacWaveHeader_t;
 
+/*
+ * Loop markers (version 2, all formats), in samples:
+ *   [0, loop_start)            onset, played once
+ *   [loop_start, loop_end)     sustained while the fault lasts
+ *   [loop_end, sample_count)   release tail, played once before returning to normal
+ * loop_end = 0 loops the whole partition (same as version 1).
+ * loop_flags bit0 (SD_DAC_WAVE_LOOP_ONE_SHOT): play onset, loop and tail once
+ * and return without waiting for the fault to end.
+ * Markers are not covered by the data checksum.
+ */
+typedef struct {
+	uint32_t loop_start;
+	uint32_t loop_end;
+	uint32_t loop_flags;
+} SD_DacWaveLoop_t;
+
+/* "D8CW" version 2: the markers follow the version 1 header; data_offset >= 48. */
+typedef struct {
+	SD_DacWaveHeader_t v1;
+	SD_DacWaveLoop_t loop;
+	uint32_t reserved;
+} SD_DacWaveHeaderV2_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t header_bytes;
+	uint32_t sample_rate;
+	uint32_t sample_count;
+	uint32_t words_per_sample;
+	uint32_t crc32;
+	SD_DacWaveLoop_t loop; /* version 2, zero in version 1 */
+	uint32_t reserved[6];
+} SD_DacFrameWaveHeader_t; /* 64 bytes, same layout as DAC_WaveFileHeader_t */
+
+/*
+ * Compressed partition: the payload (block table + blocks + pad words) is
+ * played in place, so sample_count is no longer tied to the 4MB partition and
+ * only data_bytes are synced (tools/dac_wave_zcode.py).
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t header_bytes;
+	uint32_t sample_rate;
+	uint32_t sample_count;
+	uint32_t block_samples;
+	uint32_t data_bytes;
+	uint32_t crc32;
+	SD_DacWaveLoop_t loop; /* version 2, zero in version 1 */
+	uint32_t channel_count; /* 0 = 4 (written before 8-channel support) */
+	uint32_t reserved[4];
+} SD_DacZWaveHeader_t; /* 64 bytes */
+
+typedef struct {
+	char name[SD_DAC_DIR_NAME_LEN];
+	uint32_t offset;       /* QSPI offset of the extent, SD_DAC_QSPI_EXTENT_ALIGN aligned */
+	uint32_t length;       /* extent bytes, multiple of SD_DAC_QSPI_EXTENT_ALIGN */
+	uint32_t format;       /* SD_DAC_WAVE_FORMAT_*, 0 while the extent is rewritten */
+	uint32_t sample_rate;
+	uint32_t sample_count;
+	uint32_t data_offset;  /* payload offset inside the extent (= partition header bytes) */
+	uint32_t data_bytes;
+	uint32_t checksum;     /* payload checksum / CRC32 from the partition header */
+	SD_DacWaveLoop_t loop;
+	uint32_t channel_count; /* from the partition header; 0 in older directories = 4 */
+} SD_DacWaveDirEntry_t; /* 64 bytes */
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t sequence;
+	uint32_t entry_count;
+	uint32_t crc32;        /* CRC32 of the whole sector, computed with this field zero */
+	uint32_t reserved[11];
+	SD_DacWaveDirEntry_t entry[SD_DAC_DIR_ENTRY_MAX];
+	uint32_t block_hash[SD_DAC_QSPI_BLOCK_COUNT];
+	uint32_t reserved_tail[48];
+} SD_DacWaveDir_t; /* SD_DAC_DIR_SECTOR_SIZE bytes */
+
 typedef struct {
 	uint32_t sample_rate_hz;
 	uint32_t sample_count;
 	uint32_t qspi_data_offset;
 	uint32_t qspi_mmap_addr;
-	uint32_t partition_id;
+	uint32_t partition_id; /* directory entry index */
+	uint32_t format;
+	uint32_t loop_start; /* version 1 headers: 0 / sample_count / 0 */
+	uint32_t loop_end;
+	uint32_t loop_flags;
+	uint32_t data_bytes; /* payload bytes at qspi_mmap_addr (block table + blocks for D8CZ) */
+	uint32_t channel_count; /* always SD_DAC_WAVE_CHANNELS: other counts are not loaded */
 } SD_DacWaveInfo_t;
 
 typedef struct {
@@ -83,7 +216,39 @@ bool SD_Wave_SyncDacToQspi(const char *sd_path, SD_DacWaveInfo_t *info);
 bool SD_Wave_LoadDacInfoFromQspi(SD_DacWaveInfo_t *info);
 bool SD_Wave_SyncDacToQspiPartition(const char *sd_path, SD_DacWavePartition_t partition, SD_DacWaveInfo_t *info);
 bool SD_Wave_LoadDacInfoFromQspiPartition(SD_DacWavePartition_t partition, SD_DacWaveInfo_t *info);
+/* Extent offset of the named partition in the directory, 0 when it has none. */
 uint32_t SD_Wave_GetPartitionBaseOffset(SD_DacWavePartition_t partition);
 const char *SD_Wave_GetPartitionName(SD_DacWavePartition_t partition);
 
+/*
+ * Wave directory. DirLoad reads the directory once (adopting a legacy layout
+ * if there is none) and leaves QSPI memory-mapped; the other calls load it on
+ * first use. SyncDacToQspiNamed copies an SD wave file into the extent of
+ * `name` when its size is unchanged (only blocks whose hash changed are
+ * rewritten; nothing is read past the header when it and the block hashes
+ * match), else into a first-fit extent, committing the entry afterwards.
+ */
+bool SD_Wave_DirLoad(void);
+uint32_t SD_Wave_DirCount(void);
+bool SD_Wave_DirEntryInfo(uint32_t index, SD_DacWaveInfo_t *info, const char **name);
+bool SD_Wave_SyncDacToQspiNamed(const char *sd_path, const char *name, SD_DacWaveInfo_t *info);
+bool SD_Wave_LoadDacInfoByName(const char *name, SD_DacWaveInfo_t *info);
+
+/*
+ * Deferred check of directory entry `index` (SD_DacWaveInfo_t partition_id),
+ * task context with QSPI memory-mapped: the partition header in flash must
+ * match the entry and the payload checksum (CRC32, FNV for D8CW) the header.
+ * Each call hashes at most `budget_bytes` (0 = the rest) and returns BUSY
+ * until the entry is done; one job at a time, asking for another entry starts
+ * over. Passes are cached by entry contents: until a sync changes the entry,
+ * later calls return OK at once.
+ */
+typedef enum {
+	SD_WAVE_VERIFY_BAD = -1,
+	SD_WAVE_VERIFY_BUSY = 0,
+	SD_WAVE_VERIFY_OK = 1,
+} SD_WaveVerify_t;
+
+SD_WaveVerify_t SD_Wave_VerifyStep(uint32_t index, uint32_t budget_bytes);
+
 #endif /* SD_WAVEFORM_H */
@@ -53,6 +53,41 @@ uint32_t W25Qxx_TestAddr  =	0x1A20000	;							// 测试地址
 uint8_t  W25Qxx_WriteBuffer[W25Qxx_NumByteToTest];		//	写数据数组
 uint8_t  W25Qxx_ReadBuffer[W25Qxx_NumByteToTest];		//	读数据数组
 static uint8_t g_qspi_mmap_enabled = 0;
+static QSPI_W25Qxx_IoStat_t g_qspi_io_stat;				// 擦写统计
+static uint8_t  g_qspi_verify_page[W25Qxx_PageSize];		// 1-1-1 回退重写后的回读缓冲
+
+/* DWT 周期计数，首次调用时打开（擦除动辄上百 ms，编程/校验一个窗口只有几 ms，HAL_GetTick 分辨率不够） */
+static uint32_t QSPI_W25Qxx_Cycles(void)
+{
+	if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0U)
+	{
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->LAR = 0xC5ACCE55;							// Cortex-M7 需先解锁 DWT
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	}
+	return DWT->CYCCNT;
+}
+
+static void QSPI_W25Qxx_IoStatAdd(uint32_t *bytes, uint32_t *us, uint32_t NumByte, uint32_t t0)
+{
+	uint32_t mhz = SystemCoreClock / 1000000U;
+
+	*bytes += NumByte;
+	*us += (QSPI_W25Qxx_Cycles() - t0) / ((mhz != 0U) ? mhz : 1U);
+}
+
+void QSPI_W25Qxx_IoStatReset(void)
+{
+	memset(&g_qspi_io_stat, 0, sizeof(g_qspi_io_stat));
+}
+
+void QSPI_W25Qxx_IoStatGet(QSPI_W25Qxx_IoStat_t *stat)
+{
+	if (stat != NULL) {
+		*stat = g_qspi_io_stat;
+	}
+}
 
 static int8_t QSPI_W25Qxx_ReadStatus(uint8_t cmd, uint8_t *out)
 {
@@ -646,6 +681,7 @@ int8_t QSPI_W25Qxx_WriteEnable(void)
 int8_t QSPI_W25Qxx_SectorErase(uint32_t SectorAddress)	
 {
 	QSPI_CommandTypeDef s_command;	// QSPI传输配置
+	uint32_t t0 = QSPI_W25Qxx_Cycles();	// 擦写统计
 	
 	s_command.InstructionMode   	= QSPI_INSTRUCTION_1_LINE;    // 1线指令模式
 	s_command.AddressSize       	= QSPI_ADDRESS_32_BITS;     	// 32位地址
@@ -674,6 +710,7 @@ int8_t QSPI_W25Qxx_SectorErase(uint32_t SectorAddress)
 	{
 		return W25Qxx_ERROR_AUTOPOLLING;		// 轮询等待无响应
 	}
+	QSPI_W25Qxx_IoStatAdd(&g_qspi_io_stat.erase_bytes, &g_qspi_io_stat.erase_us, 4096U, t0);
 	return QSPI_W25Qxx_OK; // 擦除成功
 }
 
@@ -700,6 +737,7 @@ int8_t QSPI_W25Qxx_SectorErase(uint32_t SectorAddress)
 int8_t QSPI_W25Qxx_BlockErase_64K (uint32_t SectorAddress)	
 {
 	QSPI_CommandTypeDef s_command;	// QSPI传输配置
+	uint32_t t0 = QSPI_W25Qxx_Cycles();	// 擦写统计
 	
 	s_command.InstructionMode   	= QSPI_INSTRUCTION_1_LINE;    // 1线指令模式
 	s_command.AddressSize       	= QSPI_ADDRESS_32_BITS;     	 // 32位地址
@@ -728,6 +766,7 @@ int8_t QSPI_W25Qxx_BlockErase_64K (uint32_t SectorAddress)
 	{
 		return W25Qxx_ERROR_AUTOPOLLING;	// 轮询等待无响应
 	}
+	QSPI_W25Qxx_IoStatAdd(&g_qspi_io_stat.erase_bytes, &g_qspi_io_stat.erase_us, 0x10000U, t0);
 	return QSPI_W25Qxx_OK;		// 擦除成功
 }
 
@@ -1106,6 +1145,128 @@ int8_t QSPI_W25Qxx_WriteBuffer_Slow(uint8_t* pBuffer, uint32_t WriteAddr, uint32
 	return QSPI_W25Qxx_OK;
 }
 
+/**********************************************************************************************************
+*
+*	函 数 名: QSPI_W25Qxx_WriteBuffer_Verify
+*
+*	入口参数: pBuffer 		 - 要写入的数据
+*				 WriteAddr 		 - 要写入 W25Qxx 的地址
+*				 Size 			 - 数据长度，最大不能超过flash芯片的大小
+*
+*	返 回 值: QSPI_W25Qxx_OK 		     - 写入并校验成功
+*				 W25Qxx_ERROR_TRANSMIT	  - 传输失败
+*				 W25Qxx_ERROR_MemoryMapped - 进入内存映射模式失败
+*				 W25Qxx_ERROR_Verify		  - 1-1-1 重写后回读仍不一致
+*
+*	函数功能: 批量写入（波形同步、QSPI 文件系统），在数据写入之前，请务必完成擦除操作
+*
+*	说    明: 1.每 W25Qxx_VerifyWindow 字节为一个窗口：先用四线页编程(0x34)写完，再进入内存映射模式
+*				   (与播放时同一条 1-4-4 读路径)整窗比较，不一致时逐页定位
+*				 2.只有校验失败的页才退回 1-1-1 页编程(0x12)用同样的数据再写一遍，并用 1-1-1 读回确认；
+*				   NOR 只能把 1 写成 0，被错写成 0 的位补不回来，这时返回 W25Qxx_ERROR_Verify，
+*				   由调用者重新擦除后改用 QSPI_W25Qxx_WriteBuffer_Slow
+*				 3.返回时处于间接模式（非内存映射），与其它写函数一致
+*
+**********************************************************************************************************/
+
+int8_t QSPI_W25Qxx_WriteBuffer_Verify(uint8_t* pBuffer, uint32_t WriteAddr, uint32_t Size)
+{
+	const uint32_t end_addr = WriteAddr + Size;
+	uint32_t win_addr = WriteAddr;
+
+	if (pBuffer == NULL || Size == 0U) {
+		return W25Qxx_ERROR_TRANSMIT;
+	}
+	if (g_qspi_mmap_enabled) {
+		(void)QSPI_W25Qxx_ExitMemoryMapped();
+	}
+
+	while (win_addr < end_addr)
+	{
+		uint32_t win_end = (win_addr / W25Qxx_VerifyWindow + 1U) * W25Qxx_VerifyWindow;
+		uint32_t first_page = win_addr / W25Qxx_PageSize;
+		uint32_t bad_pages = 0;		// 窗口内校验失败页的位图（一个窗口最多 32 页）
+		uint32_t addr, len, t0;
+		uintptr_t mm_addr, inv_start, inv_end;
+
+		if (win_end > end_addr) {
+			win_end = end_addr;
+		}
+		len = win_end - win_addr;
+
+		// 四线页编程
+		t0 = QSPI_W25Qxx_Cycles();
+		for (addr = win_addr; addr < win_end; )
+		{
+			uint32_t n = W25Qxx_PageSize - (addr % W25Qxx_PageSize);
+			if (n > win_end - addr) {
+				n = win_end - addr;
+			}
+			if (QSPI_W25Qxx_WritePage(pBuffer + (addr - WriteAddr), addr, (uint16_t)n) != QSPI_W25Qxx_OK) {
+				return W25Qxx_ERROR_TRANSMIT;
+			}
+			addr += n;
+		}
+		QSPI_W25Qxx_IoStatAdd(&g_qspi_io_stat.program_bytes, &g_qspi_io_stat.program_us, len, t0);
+
+		// 内存映射回读校验
+		t0 = QSPI_W25Qxx_Cycles();
+		if (QSPI_W25Qxx_MemoryMappedMode() != QSPI_W25Qxx_OK) {
+			return W25Qxx_ERROR_MemoryMapped;
+		}
+		mm_addr = (uintptr_t)W25Qxx_Mem_Addr + win_addr;
+		inv_start = mm_addr & ~(uintptr_t)31u;
+		inv_end = (mm_addr + len + 31u) & ~(uintptr_t)31u;
+		SCB_InvalidateDCache_by_Addr((uint32_t *)inv_start, (int32_t)(inv_end - inv_start));
+		if (memcmp((const void *)mm_addr, pBuffer + (win_addr - WriteAddr), len) != 0)
+		{
+			for (addr = win_addr; addr < win_end; )
+			{
+				uint32_t n = W25Qxx_PageSize - (addr % W25Qxx_PageSize);
+				if (n > win_end - addr) {
+					n = win_end - addr;
+				}
+				if (memcmp((const void *)((uintptr_t)W25Qxx_Mem_Addr + addr), pBuffer + (addr - WriteAddr), n) != 0) {
+					bad_pages |= 1UL << (addr / W25Qxx_PageSize - first_page);
+				}
+				addr += n;
+			}
+		}
+		if (QSPI_W25Qxx_ExitMemoryMapped() != QSPI_W25Qxx_OK) {
+			return W25Qxx_ERROR_MemoryMapped;
+		}
+
+		// 校验失败的页退回 1-1-1 重写
+		for (addr = win_addr; bad_pages != 0U && addr < win_end; )
+		{
+			uint32_t n = W25Qxx_PageSize - (addr % W25Qxx_PageSize);
+			uint32_t bit = 1UL << (addr / W25Qxx_PageSize - first_page);
+			if (n > win_end - addr) {
+				n = win_end - addr;
+			}
+			if (bad_pages & bit)
+			{
+				bad_pages &= ~bit;
+				g_qspi_io_stat.fallback_pages++;
+				if (QSPI_W25Qxx_WritePage_Slow(pBuffer + (addr - WriteAddr), addr, (uint16_t)n) != QSPI_W25Qxx_OK ||
+				    QSPI_W25Qxx_ReadBuffer_Slow(g_qspi_verify_page, addr, n) != QSPI_W25Qxx_OK) {
+					return W25Qxx_ERROR_TRANSMIT;
+				}
+				if (memcmp(g_qspi_verify_page, pBuffer + (addr - WriteAddr), n) != 0) {
+					printf("[W25Q256] verify fail @0x%08lX after 1-1-1 rewrite\r\n", (unsigned long)addr);
+					return W25Qxx_ERROR_Verify;
+				}
+			}
+			addr += n;
+		}
+		QSPI_W25Qxx_IoStatAdd(&g_qspi_io_stat.verify_bytes, &g_qspi_io_stat.verify_us, len, t0);
+
+		win_addr = win_end;
+	}
+
+	return QSPI_W25Qxx_OK;
+}
+
 
 //	实验平台：反客STM32H750XBH6核心板 （型号：FK750M4-XBH6）
 
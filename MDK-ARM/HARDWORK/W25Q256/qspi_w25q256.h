@@ -13,6 +13,7 @@
 #define W25Qxx_ERROR_Erase         		-4		// 擦除错误
 #define W25Qxx_ERROR_TRANSMIT         	-5		// 传输错误
 #define W25Qxx_ERROR_MemoryMapped		-6    // 内存映射模式错误
+#define W25Qxx_ERROR_Verify				-7    // 回读校验错误（1-1-1 回退重写后仍不一致）
 
 #define W25Qxx_CMD_EnableReset  		0x66		// 使能复位
 #define W25Qxx_CMD_ResetDevice   	0x99		// 复位器件
@@ -40,6 +41,23 @@
 #define W25Qxx_FLASH_ID           			0Xef4019    // W25Q256 JEDEC ID
 #define W25Qxx_ChipErase_TIMEOUT_MAX		400000U		// 超时等待时间，W25Q256整片擦除所需最大时间是400S,
 #define W25Qxx_Mem_Addr							0x90000000 	// 内存映射模式的地址
+#define W25Qxx_VerifyWindow					8192			// 四线编程后每 8KB 切一次内存映射回读校验（32页，一个位图）
+
+
+/*----------------------------------------------- 擦写统计 ---------------------------------------------------*/
+
+/* 擦除 / 编程 / 校验的累计字节数与耗时（DWT 周期计数换算成 us，含等待 BUSY），
+   字节数 / us 即 MB/s。由 QSPI_W25Qxx_IoStatReset() 清零，不区分调用者。 */
+typedef struct
+{
+	uint32_t erase_bytes;		// 扇区 / 块擦除字节数
+	uint32_t erase_us;
+	uint32_t program_bytes;		// QSPI_W25Qxx_WriteBuffer_Verify 编程字节数（不含回退重写）
+	uint32_t program_us;
+	uint32_t verify_bytes;		// 内存映射回读比较字节数
+	uint32_t verify_us;			// 含进出内存映射模式与回退重写
+	uint32_t fallback_pages;	// 四线编程校验失败、改用 1-1-1 重写的页数
+} QSPI_W25Qxx_IoStat_t;
 
 
 
@@ -67,6 +85,10 @@ int8_t	QSPI_W25Qxx_WriteBuffer(uint8_t* pData, uint32_t WriteAddr, uint32_t Size
 int8_t 	QSPI_W25Qxx_ReadBuffer(uint8_t* pBuffer, uint32_t ReadAddr, uint32_t NumByteToRead);	// 读取数据，最大不能超过flash芯片的大小
 int8_t  QSPI_W25Qxx_ReadBuffer_Slow(uint8_t* pBuffer, uint32_t ReadAddr, uint32_t NumByteToRead); // 低速可靠读取（1-1-1）
 int8_t  QSPI_W25Qxx_WriteBuffer_Slow(uint8_t* pBuffer, uint32_t WriteAddr, uint32_t Size); // 低速可靠写入（1-1-1）
+int8_t  QSPI_W25Qxx_WriteBuffer_Verify(uint8_t* pBuffer, uint32_t WriteAddr, uint32_t Size); // 四线写入 + 内存映射回读校验，不一致的页按 1-1-1 重写
+
+void    QSPI_W25Qxx_IoStatReset(void);								// 擦写统计清零
+void    QSPI_W25Qxx_IoStatGet(QSPI_W25Qxx_IoStat_t *stat);			// 读取擦写统计
 
 
 
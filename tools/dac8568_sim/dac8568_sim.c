@@ -0,0 +1,1961 @@
+/*
+ * Host simulation harness for the DAC8568 streaming core (dac8568_stream.c).
+ *
+ * Models the firmware's circular SPI1 TX DMA ring: one sample (DAC8568_CHANNELS
+ * x 32-bit frames) is consumed per TIM12 update, half/full callbacks refill the
+ * half the DMA just left, exactly like HAL_SPI_TxHalfCpltCallback /
+ * HAL_SPI_TxCpltCallback.
+ *
+ * Every consumed frame is checked against an independent reference built from
+ * the QSPI payload codes, and every refill is timed against the budget it has
+ * on target (the DMA reaches the refilled half again SAMPLES_PER_HALF ticks
+ * later). A refill slower than that budget is reported as an underrun.
+ *
+ * Build/run (Linux):  make -C tools/dac8568_sim run
+ *   ./dac8568_sim [--rate HZ] [--seconds S] [--wave file.bin]
+ *                 [--switch-at HALF] [--cpu-scale K] [--frame32] [--mdma]
+ *                 [--playlist] [--fade MODE:N] [--speed X[:MODE]] [--map]
+ *                 [--slots N] [--lead L] [--zcode]
+ *                 [--bench HALVES] [--bench-ring S] [--synth-check ref.raw]
+ *                 [--bench-crc MB] [--verify] [--cmd-check N]
+ *
+ * --cpu-scale multiplies measured host refill time before the budget check,
+ * e.g. 8.0 to approximate a host that is ~8x faster than the 480 MHz M7.
+ *
+ * --wave accepts the partition formats ("D8CW" codes, "DACW" frames, "D8CZ"
+ * compressed codes, unpacked by an independent decoder for the reference);
+ * --frame32 converts the payload to pre-framed FRAME32 before streaming.
+ * --zcode streams every source as ZCODE16x4 (dac8568_zcode.c): a "D8CZ" file
+ * plays its own payload, other waves are compressed by the simulator's encoder
+ * (random synthetic codes: every block at the 16-bit worst case).
+ * --mdma refills FRAME32 halves through DAC8568_Stream_PlanCopy() and copies
+ * each span in <=64KB chunks, the way dac8568_mdma.c splits MDMA list nodes;
+ * CODE16x4 halves go through DAC8568_Stream_PlanStage() into a staging buffer
+ * and are packed from there, like the firmware's staged refill.
+ *
+ * --playlist replaces the single fault switch by a looping playlist driven
+ * through dac8568_playlist.c (Pump() every 5 ms like Main_Task); the reference
+ * applies the same segment grid sample by sample, so every boundary is checked
+ * at its exact sample index.
+ *
+ * Built with -DDAC8568_CHANNELS=8u (make run8) the core and every check run on
+ * 8-channel samples: the ring holds half as many samples, the reference frames
+ * issue the write-update-all on H, waves and "D8CZ" files must carry 8
+ * channels, and the synth model's A..D are checked with E..H at mid-scale.
+ *
+ * Every run also checks the stream switch hook (the source of the firmware's
+ * switch event log): each reported switch / return must name the source and
+ * the stream position at which the reference switches.
+ *
+ * --fade MODE:N (MODE = hard|linear|cosine) blends every switch over N
+ * samples via DAC8568_Stream_SetTransition(); the reference blends in double
+ * precision and codes inside a transition must match within SIM_FADE_TOL LSB.
+ *
+ * --speed X[:linear|cubic] plays every source at X times its stored rate
+ * (Q16.16 phase accumulator, DAC8568_Stream_SetSpeed()); the reference
+ * interpolates in double precision and resampled codes must match within
+ * SIM_RESAMPLE_TOL LSB.
+ *
+ * --map installs a fixed non-identity channel map (gain, inversion, offset with
+ * saturation, B/C swap, DAC8568_Stream_SetChannelMap()); the reference applies
+ * the same affine law to its expected codes.
+ *
+ * --slots N --lead L refills an N-slot ring (dac8568_ring.c) from a service at
+ * every slot boundary, like DAC8568_DMA_RingIRQHandler() on the TIM7 update,
+ * instead of the half/full callbacks (N = 2). Switch latency (post -> first sample of
+ * the new source at the DAC) is measured in samples.
+ *
+ * --bench-ring S runs S simulated seconds per slot count (2..512) with a switch
+ * posted every ~125-250 ms at random ticks and reports switch latency against
+ * refills/s and host refill time per second (x --cpu-scale), i.e. the CPU
+ * load / latency trade-off of DAC8568_DMA_ConfigureRing().
+ *
+ * --synth-check REF renders all seven procedural waveforms (dac8568_synth.c,
+ * generator defaults at --rate, loop = the reference length) and compares them
+ * with the Python generator's codes (gen_dac_fault_suite.py --format raw16):
+ * 1.5 loops sequentially in odd-sized refills (loop restart), random seeks, and
+ * a stream run that switches normal -> fault -> normal (index reset, baseline
+ * running on behind the fault, raised-cosine fade out of a synth source).
+ * Codes must match within SIM_SYNTH_TOL LSB.
+ *
+ * --verify runs the closed-loop output check (dac8568_verify.c) on an ADC
+ * model: probes A and C through an inverting divider (adc = 52000 - 0.6 code,
+ * +-8 LSB noise), one scan every SIM_VERIFY_DECIM samples, expected codes
+ * recorded at every refill and the scans judged from the 5 ms task loop. The
+ * check starts from a unity model and calibrates it; faults are injected in
+ * phases of the run: C stuck (40..50 %), A drifting by 300 LSB (60..70 %), the
+ * DAC reference dropped on both probes (80..90 %). The clean part must show
+ * no mismatch or event, and each fault must raise its event.
+ *
+ * --bench runs DAC8568_Stream_Fill (DAC8568_STREAM_PACK_FAST path) against
+ * DAC8568_Stream_FillReference (original per-sample loop) over HALVES refills,
+ * checks both produce identical frames and reports ns and TSC cycles per sample,
+ * plus the FRAME32 copy path for the same payload.
+ *
+ * --bench-crc MB times the shared CRC32 module (SD_Card/crc32_fast.c, software
+ * only on the host) over MB megabytes: bitwise reference vs slice-by-8, after
+ * checking the check value and random chained / misaligned splits against the
+ * reference. On target CRC32_Fast_Bench() adds the CRC unit (CPU / MDMA fed).
+ *
+ * --cmd-check N runs N random steps of the DAC control command rings
+ * (dac8568_cmd.c): three producers posting bursts, the dispatcher draining a
+ * random ring by a random amount. Every command must come out once, in order,
+ * with its seq and payload; a full ring must refuse the post and count it; the
+ * status read back must follow pending -> ok / rejected -> expired. One ring
+ * starts just below the 32-bit seq wrap (0 is never handed out).
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "dac8568_cmd.h"
+#include "dac8568_playlist.h"
+#include "dac8568_ring.h"
+#include "dac8568_stream.h"
+#include "dac8568_verify.h"
+#include "crc32_fast.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SIM_HAVE_TSC 1
+#else
+#define SIM_HAVE_TSC 0
+#endif
+
+#define SIM_D8CW_MAGIC 0x44384357u /* "D8CW" */
+#define SIM_D8CW_VERSION 1u
+#define SIM_DACW_MAGIC 0x44414357u /* "DACW" */
+#define SIM_DACW_VERSION 1u
+#define SIM_D8CZ_MAGIC 0x4438435Au /* "D8CZ" */
+#define SIM_D8CZ_VERSION 1u
+#define SIM_LOOP_VERSION 2u /* any of the three headers with loop markers */
+#define SIM_CHANNELS DAC8568_CHANNELS
+#define SIM_SYNTH_OUTPUTS 4u /* channels of gen_dac_fault_suite.py and the synth model (A..D) */
+#define SIM_SAMPLES_PER_BUF (DAC8568_SAMPLES_PER_HALF * 2u)
+#define SIM_MDMA_NODE_BYTES 0x10000u
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t sample_rate_hz;
+  uint32_t sample_count;
+  uint32_t channel_count;
+  uint32_t data_offset;
+  uint32_t data_bytes;
+  uint32_t checksum;
+} sim_wave_header_t; /* Same layout as SD_DacWaveHeader_t. */
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t header_bytes;
+  uint32_t sample_rate;
+  uint32_t sample_count;
+  uint32_t words_per_sample;
+  uint32_t crc32;
+  uint32_t loop[3];
+  uint32_t reserved[6];
+} sim_frame_header_t; /* Same layout as SD_DacFrameWaveHeader_t. */
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t header_bytes;
+  uint32_t sample_rate;
+  uint32_t sample_count;
+  uint32_t block_samples;
+  uint32_t data_bytes;
+  uint32_t crc32;
+  uint32_t loop[3];
+  uint32_t channel_count; /* 0 = 4 */
+  uint32_t reserved[4];
+} sim_zcode_header_t; /* Same layout as SD_DacZWaveHeader_t. */
+
+typedef struct {
+  uint16_t *codes;  /* NULL when loaded from a DACW file */
+  uint32_t *frames; /* always present: reference frames / FRAME32 payload */
+  uint32_t *zcode;  /* ZCODE16x4 payload, built on demand (--zcode) or loaded */
+  uint32_t zcode_words;
+  uint32_t samples;
+  uint32_t loop[3];  /* loop_start, loop_end (0: none), flags from a version 2 header */
+} sim_wave_t;
+
+#define SIM_REF_SCHED_MAX 64u
+/* Q15 weight (1 step = 2 LSB on a full-scale jump) + LUT interpolation + rounding. */
+#define SIM_FADE_TOL 4u
+#define SIM_PI 3.14159265358979323846
+/* Linear: Q15 weight; cubic: 64 polyphase phases + Q14 taps. */
+#define SIM_RESAMPLE_TOL 3u
+
+/* Fixed-point tones / decay vs double precision: the floor in voltage_to_code can flip by one. */
+#define SIM_SYNTH_TOL 1u
+
+/* One expected switch: at absolute ring sample `at`, play `source` (optionally from 0). */
+typedef struct {
+  uint64_t at;
+  uint8_t source;
+  uint8_t reset;
+} sim_ref_event_t;
+
+/* Independent reference of the source-selection rules (what the ring must contain). */
+typedef struct {
+  const uint32_t *data[DAC8568_QSPI_SOURCE_MAX];
+  uint32_t samples[DAC8568_QSPI_SOURCE_MAX];
+  uint32_t index[DAC8568_QSPI_SOURCE_MAX];
+  uint32_t frac[DAC8568_QSPI_SOURCE_MAX];
+  uint32_t loop_start[DAC8568_QSPI_SOURCE_MAX]; /* sustain loop, [0, samples) without markers */
+  uint32_t loop_end[DAC8568_QSPI_SOURCE_MAX];
+  uint8_t one_shot[DAC8568_QSPI_SOURCE_MAX];
+  uint8_t released[DAC8568_QSPI_SOURCE_MAX];
+  uint8_t returning;          /* released source hands back to 0 at return_at */
+  uint64_t return_at;
+  uint64_t returns;
+  uint32_t speed;             /* Q16.16, same for every source */
+  uint8_t interp;             /* DAC8568_Interp_t */
+  uint8_t active;
+  uint8_t pending;
+  uint8_t pending_id;
+  uint64_t position;
+  uint64_t pending_applied;   /* position where the last pending switch took effect */
+  uint8_t fade_mode;          /* DAC8568_Transition_t */
+  uint32_t fade_len;
+  const uint32_t *fade_data;  /* outgoing source while blending */
+  uint32_t fade_samples;
+  uint32_t fade_restart;
+  uint32_t fade_end;
+  uint32_t fade_index;
+  uint32_t fade_frac;
+  uint32_t fade_t;            /* == fade_len when idle */
+  sim_ref_event_t sched[SIM_REF_SCHED_MAX];
+  uint32_t sched_count;
+  uint32_t sched_next;
+} sim_ref_t;
+
+typedef struct {
+  uint32_t rate_hz;
+  double seconds;
+  const char *wave_path;
+  int64_t switch_at_half;
+  double cpu_scale;
+  uint32_t bench_halves;
+  int frame32;
+  int zcode;
+  int mdma;
+  int playlist;
+  uint8_t fade_mode;
+  uint32_t fade_len;
+  uint32_t speed_q16;
+  uint8_t interp;
+  int map;
+  uint32_t slots;
+  uint32_t lead;
+  uint32_t switch_period;     /* ticks; 0 = single switch at switch_at_half */
+  double bench_ring_seconds;
+  uint32_t bench_crc_mb;
+  uint32_t cmd_check_steps;
+  const char *synth_ref_path;
+  uint32_t loop[3];           /* --loop: markers of fault source 1 (loop[1] = 0: none) */
+  int verify;
+} sim_opts_t;
+
+typedef struct {
+  sim_wave_t base;
+  sim_wave_t fault;
+  sim_wave_t fault2;
+} sim_waves_t;
+
+typedef struct {
+  uint32_t slot_samples;
+  double budget_ns;
+  uint64_t refills;
+  uint64_t services;
+  uint64_t refill_sum_ns;
+  uint64_t refill_min_ns;
+  uint64_t refill_max_ns;
+  uint64_t underruns;
+  uint64_t frame_errors;
+  uint64_t switches;
+  uint64_t latency_sum;
+  uint64_t latency_max;
+  uint64_t playlist_runs;
+  uint32_t sched_count;
+  uint32_t switch_late;
+  uint32_t ring_late;
+  uint64_t returns;
+  uint8_t format;
+} sim_result_t;
+
+static uint32_t g_ring[DAC8568_TX_BUF_WORDS];
+static uint32_t g_expect[DAC8568_TX_BUF_WORDS];
+static uint8_t g_expect_tol[SIM_SAMPLES_PER_BUF]; /* per-sample code tolerance (transitions) */
+
+static uint64_t sim_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t sim_cycles(void) {
+#if SIM_HAVE_TSC
+  return (uint64_t)__rdtsc();
+#else
+  return 0u;
+#endif
+}
+
+static uint32_t sim_xorshift32(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/* Frame head of channel `ch` from the command table: the last channel of a sample updates all. */
+static uint32_t sim_frame_prefix(uint32_t ch) {
+  const uint32_t cmd = (ch == SIM_CHANNELS - 1u) ? DAC8568_CMD_WRITE_UPDATE_ALL : DAC8568_CMD_WRITE_INPUT;
+  return (cmd << 24) | (ch << 20);
+}
+
+/* Straightforward per-channel packing, kept independent from the streaming core. */
+static int sim_wave_build_frames(sim_wave_t *w) {
+  w->frames = (uint32_t *)malloc((size_t)w->samples * SIM_CHANNELS * sizeof(uint32_t));
+  if (w->frames == NULL) {
+    return -1;
+  }
+  for (uint32_t i = 0u; i < w->samples * SIM_CHANNELS; i++) {
+    w->frames[i] = sim_frame_prefix(i % SIM_CHANNELS) | ((uint32_t)w->codes[i] << 4);
+  }
+  return 0;
+}
+
+static void sim_wave_free(sim_wave_t *w) {
+  free(w->codes);
+  free(w->frames);
+  free(w->zcode);
+  w->codes = NULL;
+  w->frames = NULL;
+  w->zcode = NULL;
+}
+
+/*
+ * Block compression of the codes, written from the format description in
+ * dac8568_zcode.h (same choice as tools/dac_wave_zcode.py: narrower of FOR /
+ * zigzag delta per block and channel).
+ */
+static int sim_zcode_encode(sim_wave_t *w) {
+  const uint32_t blocks = DAC8568_ZCode_BlockCount(w->samples);
+  const uint32_t max_words = blocks * (1u + SIM_CHANNELS * (1u + DAC8568_ZCODE_BLOCK / 2u)) + DAC8568_ZCODE_PAD_WORDS;
+  uint32_t pos = blocks;
+
+  if (w->codes == NULL) {
+    w->codes = (uint16_t *)malloc((size_t)w->samples * SIM_CHANNELS * sizeof(uint16_t));
+    if (w->codes == NULL) {
+      return -1;
+    }
+    for (uint32_t i = 0u; i < w->samples * SIM_CHANNELS; i++) {
+      w->codes[i] = (uint16_t)(w->frames[i] >> 4);
+    }
+  }
+  w->zcode = (uint32_t *)calloc(max_words, sizeof(uint32_t));
+  if (w->zcode == NULL) {
+    return -1;
+  }
+  for (uint32_t b = 0u; b < blocks; b++) {
+    const uint32_t first = b * DAC8568_ZCODE_BLOCK;
+    const uint32_t n = (w->samples - first < DAC8568_ZCODE_BLOCK) ? w->samples - first : DAC8568_ZCODE_BLOCK;
+    w->zcode[b] = pos;
+    for (uint32_t ch = 0u; ch < SIM_CHANNELS; ch++) {
+      uint32_t res[DAC8568_ZCODE_BLOCK];
+      uint32_t lo = 0xFFFFu;
+      uint32_t hi = 0u;
+      uint32_t zmax = 0u;
+      int32_t prev = w->codes[(size_t)first * SIM_CHANNELS + ch];
+      for (uint32_t i = 0u; i < n; i++) {
+        const int32_t v = w->codes[(size_t)(first + i) * SIM_CHANNELS + ch];
+        const int32_t d = v - prev;
+        const uint32_t z = (d >= 0) ? ((uint32_t)d << 1) : (((uint32_t)-d << 1) - 1u);
+        lo = ((uint32_t)v < lo) ? (uint32_t)v : lo;
+        hi = ((uint32_t)v > hi) ? (uint32_t)v : hi;
+        zmax = (z > zmax) ? z : zmax;
+        res[i] = z;
+        prev = v;
+      }
+      uint32_t width_for = 0u;
+      uint32_t width_delta = 0u;
+      while ((hi - lo) >> width_for) {
+        width_for++;
+      }
+      while (zmax >> width_delta) {
+        width_delta++;
+      }
+      const uint32_t delta = (width_delta < width_for) ? 1u : 0u;
+      const uint32_t width = (delta != 0u) ? width_delta : width_for;
+      const uint32_t base = (delta != 0u) ? w->codes[(size_t)first * SIM_CHANNELS + ch] : lo;
+      w->zcode[pos++] = base | (width << 16) | (delta << 24);
+      for (uint32_t i = 0u; i < n && width != 0u; i++) {
+        const uint32_t r = (delta != 0u) ? res[i] : w->codes[(size_t)(first + i) * SIM_CHANNELS + ch] - lo;
+        const uint32_t bit = i * width;
+        w->zcode[pos + bit / 32u] |= r << (bit % 32u);
+        if ((bit % 32u) + width > 32u) {
+          w->zcode[pos + bit / 32u + 1u] |= r >> (32u - bit % 32u);
+        }
+      }
+      pos += (n * width + 31u) / 32u;
+    }
+  }
+  w->zcode_words = pos + DAC8568_ZCODE_PAD_WORDS;
+  return 0;
+}
+
+/* Bit-by-bit reference decoder (kept independent from dac8568_zcode.c). */
+static int sim_zcode_decode(const uint32_t *payload, uint32_t words, uint32_t samples, uint16_t *codes) {
+  const uint32_t blocks = DAC8568_ZCode_BlockCount(samples);
+  for (uint32_t b = 0u; b < blocks; b++) {
+    const uint32_t first = b * DAC8568_ZCODE_BLOCK;
+    const uint32_t n = (samples - first < DAC8568_ZCODE_BLOCK) ? samples - first : DAC8568_ZCODE_BLOCK;
+    uint32_t pos = payload[b];
+    for (uint32_t ch = 0u; ch < SIM_CHANNELS; ch++) {
+      if (pos >= words) {
+        return -1;
+      }
+      const uint32_t hdr = payload[pos++];
+      const uint32_t width = (hdr >> 16) & 0x1Fu;
+      const uint32_t delta = (hdr >> 24) & 1u;
+      uint32_t code = hdr & 0xFFFFu;
+      if (width > DAC8568_ZCODE_MAX_WIDTH || pos + (n * width + 31u) / 32u > words) {
+        return -1;
+      }
+      for (uint32_t i = 0u; i < n; i++) {
+        uint32_t r = 0u;
+        for (uint32_t k = 0u; k < width; k++) {
+          const uint32_t bit = i * width + k;
+          r |= ((payload[pos + bit / 32u] >> (bit % 32u)) & 1u) << k;
+        }
+        if (delta != 0u) {
+          code += (r & 1u) ? (uint32_t)-(int32_t)((r + 1u) >> 1) : (r >> 1);
+          codes[(size_t)(first + i) * SIM_CHANNELS + ch] = (uint16_t)code;
+        } else {
+          codes[(size_t)(first + i) * SIM_CHANNELS + ch] = (uint16_t)(code + r);
+        }
+      }
+      pos += (n * width + 31u) / 32u;
+    }
+  }
+  return 0;
+}
+
+static int sim_wave_synth(sim_wave_t *w, uint32_t samples, uint32_t seed) {
+  w->codes = (uint16_t *)malloc((size_t)samples * SIM_CHANNELS * sizeof(uint16_t));
+  if (w->codes == NULL) {
+    return -1;
+  }
+  w->samples = samples;
+  for (uint32_t i = 0u; i < samples * SIM_CHANNELS; i++) {
+    w->codes[i] = (uint16_t)sim_xorshift32(&seed);
+  }
+  return sim_wave_build_frames(w);
+}
+
+static int sim_wave_load_frame32(sim_wave_t *w, FILE *f, const sim_frame_header_t *hdr) {
+  const size_t bytes = (size_t)hdr->sample_count * SIM_CHANNELS * sizeof(uint32_t);
+  w->frames = (uint32_t *)malloc(bytes);
+  w->samples = hdr->sample_count;
+  if (w->frames == NULL || fseek(f, (long)hdr->header_bytes, SEEK_SET) != 0 ||
+      fread(w->frames, 1u, bytes, f) != bytes) {
+    return -1;
+  }
+  return 0;
+}
+
+static int sim_wave_load_zcode(sim_wave_t *w, FILE *f, const sim_zcode_header_t *hdr) {
+  w->samples = hdr->sample_count;
+  w->zcode_words = hdr->data_bytes / (uint32_t)sizeof(uint32_t);
+  w->zcode = (uint32_t *)malloc((size_t)w->zcode_words * sizeof(uint32_t));
+  w->codes = (uint16_t *)malloc((size_t)w->samples * SIM_CHANNELS * sizeof(uint16_t));
+  if (w->zcode == NULL || w->codes == NULL || fseek(f, (long)hdr->header_bytes, SEEK_SET) != 0 ||
+      fread(w->zcode, sizeof(uint32_t), w->zcode_words, f) != w->zcode_words ||
+      w->zcode_words < DAC8568_ZCode_BlockCount(w->samples) + DAC8568_ZCODE_PAD_WORDS ||
+      sim_zcode_decode(w->zcode, w->zcode_words - DAC8568_ZCODE_PAD_WORDS, w->samples, w->codes) != 0) {
+    return -1;
+  }
+  return sim_wave_build_frames(w);
+}
+
+static int sim_wave_load(sim_wave_t *w, const char *path, uint32_t *rate_hz) {
+  union {
+    sim_wave_header_t code16;
+    sim_frame_header_t frame32;
+    sim_zcode_header_t zcode16;
+    uint32_t raw[16];
+  } hdr;
+  const uint32_t *loop = NULL; /* markers of a version 2 header */
+  uint32_t file_rate = 0u;
+  int rc = -1;
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "[SIM] open failed: %s\n", path);
+    return -1;
+  }
+  memset(&hdr, 0, sizeof(hdr));
+  if (fread(&hdr, 1u, sizeof(hdr), f) < sizeof(hdr.code16)) {
+    fprintf(stderr, "[SIM] header read failed: %s\n", path);
+    fclose(f);
+    return -1;
+  }
+
+  if (hdr.frame32.magic == SIM_DACW_MAGIC) {
+    if ((hdr.frame32.version != SIM_DACW_VERSION && hdr.frame32.version != SIM_LOOP_VERSION) ||
+        hdr.frame32.header_bytes != sizeof(sim_frame_header_t) ||
+        hdr.frame32.words_per_sample != SIM_CHANNELS || hdr.frame32.sample_count == 0u) {
+      fprintf(stderr, "[SIM] header invalid: %s\n", path);
+      fclose(f);
+      return -1;
+    }
+    file_rate = hdr.frame32.sample_rate;
+    loop = (hdr.frame32.version == SIM_LOOP_VERSION) ? hdr.frame32.loop : NULL;
+    rc = sim_wave_load_frame32(w, f, &hdr.frame32);
+  } else if (hdr.zcode16.magic == SIM_D8CZ_MAGIC) {
+    if ((hdr.zcode16.version != SIM_D8CZ_VERSION && hdr.zcode16.version != SIM_LOOP_VERSION) ||
+        hdr.zcode16.header_bytes != sizeof(sim_zcode_header_t) ||
+        hdr.zcode16.block_samples != DAC8568_ZCODE_BLOCK || hdr.zcode16.sample_count == 0u ||
+        (hdr.zcode16.data_bytes & 3u) != 0u ||
+        ((hdr.zcode16.channel_count == 0u) ? 4u : hdr.zcode16.channel_count) != SIM_CHANNELS) {
+      fprintf(stderr, "[SIM] header invalid: %s\n", path);
+      fclose(f);
+      return -1;
+    }
+    file_rate = hdr.zcode16.sample_rate;
+    loop = (hdr.zcode16.version == SIM_LOOP_VERSION) ? hdr.zcode16.loop : NULL;
+    rc = sim_wave_load_zcode(w, f, &hdr.zcode16);
+  } else {
+    const sim_wave_header_t *h = &hdr.code16;
+    if (h->magic != SIM_D8CW_MAGIC || (h->version != SIM_D8CW_VERSION && h->version != SIM_LOOP_VERSION) ||
+        (h->version == SIM_LOOP_VERSION && h->data_offset < 48u) ||
+        h->channel_count != SIM_CHANNELS || h->sample_count == 0u ||
+        h->data_bytes != h->sample_count * SIM_CHANNELS * (uint32_t)sizeof(uint16_t)) {
+      fprintf(stderr, "[SIM] header invalid: %s\n", path);
+      fclose(f);
+      return -1;
+    }
+    file_rate = h->sample_rate_hz;
+    loop = (h->version == SIM_LOOP_VERSION) ? &hdr.raw[8] : NULL;
+    w->codes = (uint16_t *)malloc(h->data_bytes);
+    w->samples = h->sample_count;
+    if (w->codes != NULL && fseek(f, (long)h->data_offset, SEEK_SET) == 0 &&
+        fread(w->codes, 1u, h->data_bytes, f) == h->data_bytes) {
+      rc = sim_wave_build_frames(w);
+    }
+  }
+  fclose(f);
+  if (rc != 0) {
+    fprintf(stderr, "[SIM] payload read failed: %s\n", path);
+    return -1;
+  }
+  if (loop != NULL && loop[1] != 0u) {
+    if (loop[1] > w->samples || loop[0] >= loop[1]) {
+      fprintf(stderr, "[SIM] loop markers invalid: %s\n", path);
+      return -1;
+    }
+    memcpy(w->loop, loop, sizeof(w->loop));
+  }
+  if (rate_hz != NULL && file_rate != 0u) {
+    *rate_hz = file_rate;
+  }
+  return 0;
+}
+
+/* Hand a wave to the streaming core in the requested partition format. */
+static void sim_wave_source(const sim_wave_t *w, uint8_t want, const void **data, uint8_t *format) {
+  if (want == DAC8568_WAVE_FORMAT_ZCODE16x4 && w->zcode != NULL) {
+    *data = w->zcode;
+    *format = DAC8568_WAVE_FORMAT_ZCODE16x4;
+  } else if (want == DAC8568_WAVE_FORMAT_FRAME32 || w->codes == NULL) {
+    *data = w->frames;
+    *format = DAC8568_WAVE_FORMAT_FRAME32;
+  } else {
+    *data = w->codes;
+    *format = DAC8568_WAVE_FORMAT_CODE16x4;
+  }
+}
+
+/* Wrap point of a source: its loop end while sustaining, its last sample + 1 once released. */
+static uint32_t sim_ref_end(const sim_ref_t *r, uint8_t source) {
+  return (r->released[source] != 0u) ? r->samples[source] : r->loop_end[source];
+}
+
+/* Release: play on without wrapping; hand back to 0 one transition before the end. */
+static void sim_ref_release(sim_ref_t *r) {
+  const uint8_t src = r->active;
+  const uint32_t tail = (r->fade_mode != (uint8_t)DAC8568_TRANSITION_HARD) ? r->fade_len : 0u;
+  const uint32_t stop = (tail < r->samples[src]) ? r->samples[src] - tail : 0u;
+  r->released[src] = 1u;
+  r->returning = 1u;
+  r->return_at = r->position + ((r->index[src] < stop) ? stop - r->index[src] : 0u);
+}
+
+/* Switches reported by DAC8568_Stream_SetSwitchHook(), consumed in order by sim_ref_switch(). */
+#define SIM_HOOK_FIFO 64u
+typedef struct {
+  uint8_t to;
+  uint8_t returned;
+  uint32_t position;
+} sim_hook_event_t;
+
+static sim_hook_event_t g_hook_fifo[SIM_HOOK_FIFO];
+static uint32_t g_hook_head;
+static uint32_t g_hook_tail;
+static uint64_t g_hook_events;
+static uint64_t g_hook_errors;
+static uint8_t g_hook_return; /* set while the reference returns to source 0 */
+
+static void sim_switch_hook(uint8_t from_source, uint8_t to_source, uint32_t position, uint8_t returned) {
+  (void)from_source;
+  if (g_hook_head - g_hook_tail >= SIM_HOOK_FIFO) {
+    g_hook_errors++;
+    return;
+  }
+  g_hook_fifo[g_hook_head % SIM_HOOK_FIFO] = (sim_hook_event_t){to_source, returned, position};
+  g_hook_head++;
+  g_hook_events++;
+}
+
+static void sim_hook_expect(const sim_ref_t *r, uint8_t source) {
+  if (g_hook_tail == g_hook_head) {
+    g_hook_errors++;
+    return;
+  }
+  const sim_hook_event_t *e = &g_hook_fifo[g_hook_tail++ % SIM_HOOK_FIFO];
+  if (e->to != source || e->position != (uint32_t)r->position || e->returned != g_hook_return) {
+    if (g_hook_errors < 8u) {
+      fprintf(stderr, "[SIM] switch hook: got %u@%lu%s, reference %u@%lu\n", (unsigned)e->to,
+              (unsigned long)e->position, (e->returned != 0u) ? " (return)" : "", (unsigned)source,
+              (unsigned long)(uint32_t)r->position);
+    }
+    g_hook_errors++;
+  }
+}
+
+/* --verify: analog path of the probes and the injected faults. */
+#define SIM_VERIFY_DECIM 32u
+#define SIM_VERIFY_GAIN_Q16 (-39322) /* -0.6 ADC LSB per code */
+#define SIM_VERIFY_OFFSET 52000
+#define SIM_VERIFY_NOISE 8
+#define SIM_VERIFY_STUCK_LEVEL 30000
+#define SIM_VERIFY_DRIFT 300
+#define SIM_VERIFY_WORDS 4096u
+
+static DAC8568_Verify_t g_verify;
+static uint16_t g_verify_adc[SIM_VERIFY_WORDS];
+static uint32_t g_verify_words;
+static uint32_t g_verify_rng = 0x9E3779B9u;
+static DAC8568_VerifyStats_t g_verify_clean; /* taken at 35 %, before the first fault */
+static DAC8568_VerifyConfig_t g_verify_cal;  /* model after calibration */
+
+static int sim_verify_configure(uint32_t ring_samples) {
+  DAC8568_VerifyConfig_t cfg;
+  DAC8568_Verify_DefaultConfig(&cfg);
+  cfg.probes = 2u;
+  cfg.probe[0].dac_channel = DAC8568_CHANNEL_A;
+  cfg.probe[1].dac_channel = DAC8568_CHANNEL_C;
+  cfg.probe[1].gain_q16 = 0x10000;
+  cfg.decim = SIM_VERIFY_DECIM;
+  if (DAC8568_Verify_Configure(&g_verify, &cfg, ring_samples) != 0) {
+    return -1;
+  }
+  DAC8568_Verify_Calibrate(&g_verify);
+  memset(&g_verify_clean, 0, sizeof(g_verify_clean));
+  g_verify_words = 0u;
+  return 0;
+}
+
+/* One ADC scan of the sample the DMA sends at `phase` (fraction of the run, in %). */
+static void sim_verify_convert(const uint32_t *frames, uint32_t phase) {
+  for (uint32_t p = 0u; p < g_verify.cfg.probes; p++) {
+    const uint16_t code = (uint16_t)(frames[g_verify.cfg.probe[p].dac_channel] >> 4);
+    int32_t adc = SIM_VERIFY_OFFSET + (int32_t)(((int64_t)SIM_VERIFY_GAIN_Q16 * code + 0x8000) >> 16);
+    if (phase >= 40u && phase < 50u && p == 1u) {
+      adc = SIM_VERIFY_STUCK_LEVEL;
+    } else if (phase >= 60u && phase < 70u && p == 0u) {
+      adc += SIM_VERIFY_DRIFT;
+    } else if (phase >= 80u && phase < 90u) {
+      adc = SIM_VERIFY_OFFSET;
+    }
+    adc += (int32_t)(sim_xorshift32(&g_verify_rng) % (2u * SIM_VERIFY_NOISE + 1u)) - SIM_VERIFY_NOISE;
+    adc = (adc < 0) ? 0 : (adc > 65535) ? 65535 : adc;
+    if (g_verify_words < SIM_VERIFY_WORDS) {
+      g_verify_adc[g_verify_words++] = (uint16_t)adc;
+    }
+  }
+}
+
+static uint32_t sim_verify_close(int32_t got, int32_t want, int32_t tol) {
+  return (got >= want - tol && got <= want + tol) ? 1u : 0u;
+}
+
+/* Clean part: calibrated model close to the analog path, nothing flagged. Faults: each one seen. */
+static int sim_verify_report(void) {
+  DAC8568_VerifyStats_t st;
+  DAC8568_Verify_GetStats(&g_verify, &st);
+  printf("[SIM] verify: model A %ld/%ld C %ld/%ld (gain_q16/offset)  conversions=%lu mismatches=%lu "
+         "no_expect=%lu lost=%lu\n",
+         (long)g_verify_cal.probe[0].gain_q16, (long)g_verify_cal.probe[0].offset,
+         (long)g_verify_cal.probe[1].gain_q16, (long)g_verify_cal.probe[1].offset, (unsigned long)st.conversions,
+         (unsigned long)st.mismatches, (unsigned long)st.no_expect, (unsigned long)st.lost);
+  printf("[SIM] verify: clean windows=%lu mismatches=%lu events=%lu  faults: drift=%lu stuck=%lu ref_missed=%lu\n",
+         (unsigned long)g_verify_clean.windows, (unsigned long)g_verify_clean.mismatches,
+         (unsigned long)(g_verify_clean.drift_events + g_verify_clean.stuck_events +
+                         g_verify_clean.ref_missed_events),
+         (unsigned long)st.drift_events, (unsigned long)st.stuck_events, (unsigned long)st.ref_missed_events);
+
+  const uint32_t clean = (g_verify_clean.windows != 0u && g_verify_clean.calibrating == 0u &&
+                          g_verify_clean.mismatches == 0u && g_verify_clean.drift_events == 0u &&
+                          g_verify_clean.stuck_events == 0u && g_verify_clean.ref_missed_events == 0u)
+                             ? 1u
+                             : 0u;
+  uint32_t model = 1u;
+  for (uint32_t p = 0u; p < 2u; p++) {
+    model &= sim_verify_close(g_verify_cal.probe[p].gain_q16, SIM_VERIFY_GAIN_Q16, 200);
+    model &= sim_verify_close(g_verify_cal.probe[p].offset, SIM_VERIFY_OFFSET, 64);
+  }
+  const uint32_t faults = (st.drift_events != 0u && st.stuck_events != 0u && st.ref_missed_events == 1u) ? 1u : 0u;
+  return (clean != 0u && model != 0u && faults != 0u && st.no_expect == 0u && st.lost == 0u) ? 0 : 1;
+}
+
+static void sim_ref_switch(sim_ref_t *r, uint8_t source, uint8_t reset) {
+  sim_hook_expect(r, source);
+  if (r->fade_mode != (uint8_t)DAC8568_TRANSITION_HARD && r->fade_len > 0u) {
+    r->fade_data = r->data[r->active];
+    r->fade_samples = r->samples[r->active];
+    r->fade_restart = r->loop_start[r->active];
+    r->fade_end = sim_ref_end(r, r->active);
+    r->fade_index = (r->index[r->active] < r->fade_end) ? r->index[r->active] : r->fade_restart;
+    r->fade_frac = r->frac[r->active];
+    r->fade_t = 0u;
+  }
+  r->active = source;
+  if (reset != 0u) {
+    r->index[source] = 0u;
+    r->frac[source] = 0u;
+  }
+  r->returning = 0u;
+  r->released[source] = 0u;
+  if (source != 0u && r->one_shot[source] != 0u) {
+    sim_ref_release(r);
+  }
+}
+
+/* Code of channel `ch` at index + frac / 65536 of a looping source (double precision). */
+static double sim_ref_code(const sim_ref_t *r, const uint32_t *data, uint32_t samples, uint32_t index,
+                           uint32_t frac, uint32_t ch) {
+#define SIM_CODE(i) ((double)((data[(size_t)(i) * SIM_CHANNELS + ch] >> 4) & 0xFFFFu))
+  const uint32_t i1 = (index + 1u) % samples;
+  if (r->speed == DAC8568_STREAM_SPEED_ONE) {
+    return SIM_CODE(index);
+  }
+  if (r->interp != (uint8_t)DAC8568_INTERP_CUBIC) {
+    return SIM_CODE(index) + (SIM_CODE(i1) - SIM_CODE(index)) * (double)frac / 65536.0;
+  }
+  const double t = floor((double)frac / 1024.0 + 0.5) / 64.0; /* 64-phase table */
+  const double xm1 = SIM_CODE((index + samples - 1u) % samples);
+  const double x0 = SIM_CODE(index);
+  const double x1 = SIM_CODE(i1);
+  const double x2 = SIM_CODE((index + 2u) % samples);
+  const double v = x0 + 0.5 * t * (x1 - xm1 + t * (2.0 * xm1 - 5.0 * x0 + 4.0 * x1 - x2 +
+                                                    t * (3.0 * (x0 - x1) + x2 - xm1)));
+#undef SIM_CODE
+  return (v < 0.0) ? 0.0 : ((v > 65535.0) ? 65535.0 : v);
+}
+
+static void sim_ref_step(const sim_ref_t *r, uint32_t restart, uint32_t end, uint32_t *index, uint32_t *frac) {
+  const uint64_t acc = (uint64_t)*frac + ((r->speed == DAC8568_STREAM_SPEED_ONE) ? 65536u : r->speed);
+  const uint64_t next = *index + (acc >> 16);
+  *index = (next >= end) ? (uint32_t)(restart + (next - restart) % (end - restart)) : (uint32_t)next;
+  *frac = (uint32_t)(acc & 0xFFFFu);
+}
+
+static void sim_ref_fill(sim_ref_t *r, uint32_t *dst, uint8_t *tol, uint32_t sample_count) {
+  if (r->pending != 0u) {
+    r->pending = 0u;
+    r->pending_applied = r->position;
+    if (r->pending_id != DAC8568_STREAM_SOURCE_RELEASE) {
+      sim_ref_switch(r, r->pending_id, 1u);
+    } else if (r->active != 0u && r->released[r->active] == 0u) {
+      sim_ref_release(r);
+    }
+  }
+
+  for (uint32_t i = 0u; i < sample_count; i++) {
+    while (r->sched_next < r->sched_count && r->sched[r->sched_next].at == r->position) {
+      const sim_ref_event_t *ev = &r->sched[r->sched_next++];
+      sim_ref_switch(r, ev->source, ev->reset);
+    }
+    if (r->returning != 0u && r->position >= r->return_at) {
+      const uint8_t from = r->active;
+      g_hook_return = 1u;
+      sim_ref_switch(r, 0u, 0u);
+      g_hook_return = 0u;
+      r->released[from] = 0u;
+      r->returns++;
+    }
+
+    const uint8_t src = r->active;
+    const uint32_t *frames = &r->data[src][(size_t)r->index[src] * SIM_CHANNELS];
+    const uint8_t resampled = (r->speed != DAC8568_STREAM_SPEED_ONE);
+    if (r->fade_t < r->fade_len) {
+      const double x = (double)r->fade_t / (double)r->fade_len;
+      const double w = (r->fade_mode == (uint8_t)DAC8568_TRANSITION_LINEAR) ? x : 0.5 - 0.5 * cos(SIM_PI * x);
+      for (uint32_t ch = 0u; ch < SIM_CHANNELS; ch++) {
+        const double a = sim_ref_code(r, r->fade_data, r->fade_samples, r->fade_index, r->fade_frac, ch);
+        const double b = sim_ref_code(r, r->data[src], r->samples[src], r->index[src], r->frac[src], ch);
+        const uint32_t code = (uint32_t)lround(a + (b - a) * w);
+        *dst++ = (frames[ch] & ~0x000FFFF0u) | (code << 4);
+      }
+      sim_ref_step(r, r->fade_restart, r->fade_end, &r->fade_index, &r->fade_frac);
+      r->fade_t++;
+      *tol++ = resampled ? SIM_FADE_TOL + SIM_RESAMPLE_TOL : SIM_FADE_TOL;
+    } else if (resampled) {
+      for (uint32_t ch = 0u; ch < SIM_CHANNELS; ch++) {
+        const uint32_t code =
+            (uint32_t)lround(sim_ref_code(r, r->data[src], r->samples[src], r->index[src], r->frac[src], ch));
+        *dst++ = (frames[ch] & ~0x000FFFF0u) | (code << 4);
+      }
+      *tol++ = SIM_RESAMPLE_TOL;
+    } else {
+      for (uint32_t ch = 0u; ch < SIM_CHANNELS; ch++) {
+        *dst++ = frames[ch];
+      }
+      *tol++ = 0u;
+    }
+    sim_ref_step(r, r->loop_start[src], sim_ref_end(r, src), &r->index[src], &r->frac[src]);
+    if (src != 0u) {
+      sim_ref_step(r, r->loop_start[0], sim_ref_end(r, 0u), &r->index[0], &r->frac[0]);
+    }
+    r->position++;
+  }
+}
+
+/* Expected output after the channel map; tolerances grow with |gain|. */
+static void sim_ref_map(const DAC8568_ChannelMap_t *m, uint32_t *dst, uint8_t *tol, uint32_t sample_count) {
+  double max_gain = 0.0;
+  for (uint32_t ch = 0u; ch < SIM_CHANNELS; ch++) {
+    const double g = fabs((double)m->gain_q15[ch] / 32768.0);
+    max_gain = (g > max_gain) ? g : max_gain;
+  }
+  for (uint32_t i = 0u; i < sample_count; i++) {
+    double in[SIM_CHANNELS];
+    for (uint32_t ch = 0u; ch < SIM_CHANNELS; ch++) {
+      in[ch] = (double)((dst[ch] >> 4) & 0xFFFFu) - 32768.0;
+    }
+    for (uint32_t ch = 0u; ch < SIM_CHANNELS; ch++) {
+      double v = 32768.0;
+      if (((m->mute_mask >> ch) & 1u) == 0u) {
+        v += floor(in[m->route[ch]] * (double)m->gain_q15[ch] / 32768.0 + 0.5) + (double)m->offset[ch];
+      }
+      v = (v < 0.0) ? 0.0 : ((v > 65535.0) ? 65535.0 : v);
+      dst[ch] = (dst[ch] & ~0x000FFFF0u) | ((uint32_t)v << 4);
+    }
+    if (tol[i] != 0u) {
+      tol[i] = (uint8_t)ceil((double)tol[i] * max_gain + 1.0);
+    }
+    dst += SIM_CHANNELS;
+  }
+}
+
+static int sim_frame_match(uint32_t got, uint32_t exp, uint32_t tol) {
+  if (tol == 0u) {
+    return got == exp;
+  }
+  const int32_t d = (int32_t)((got >> 4) & 0xFFFFu) - (int32_t)((exp >> 4) & 0xFFFFu);
+  return ((got ^ exp) & ~0x000FFFF0u) == 0u && d <= (int32_t)tol && d >= -(int32_t)tol;
+}
+
+/* Expand a playlist into the reference grid starting at `at` (independent of dac8568_playlist.c). */
+static int sim_ref_schedule(sim_ref_t *r, const DAC8568_PlaylistSegment_t *segs, uint32_t count,
+                            uint64_t at) {
+  r->sched_count = 0u;
+  r->sched_next = 0u;
+  for (uint32_t i = 0u; i < count; i++) {
+    uint32_t repeat = (segs[i].repeat == 0u) ? 1u : segs[i].repeat;
+    for (uint32_t k = 0u; k < repeat; k++) {
+      if (r->sched_count >= SIM_REF_SCHED_MAX) {
+        return -1;
+      }
+      r->sched[r->sched_count].at = at;
+      r->sched[r->sched_count].source = segs[i].source_id;
+      r->sched[r->sched_count].reset = segs[i].reset_index;
+      r->sched_count++;
+      at += segs[i].duration_samples;
+    }
+  }
+  return 0;
+}
+
+static void sim_usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--rate HZ] [--seconds S] [--wave file.bin] [--switch-at HALF] [--cpu-scale K]\n"
+          "       [--frame32] [--mdma] [--playlist] [--fade hard|linear|cosine:N] [--speed X[:linear|cubic]]\n"
+          "       [--map] [--slots N] [--lead L] [--zcode] [--loop START:END[:oneshot]]\n"
+          "       [--bench HALVES] [--bench-ring S] [--synth-check ref.raw] [--bench-crc MB] [--verify]\n"
+          "       [--cmd-check N]\n",
+          argv0);
+}
+
+/* Stand-in for the MDMA list: spans from PlanCopy / PlanStage, split into <=64KB nodes. */
+static uint32_t g_mdma_nodes_max;
+static uint64_t g_mdma_refills;
+static uint64_t g_mdma_staged;
+static uint16_t g_mdma_stage[DAC8568_SAMPLES_PER_HALF * DAC8568_WORDS_PER_SAMPLE];
+
+static void sim_fill_mdma(DAC8568_Stream_t *s, uint32_t *dst, uint32_t sample_count) {
+  DAC8568_StreamSpan_t spans[DAC8568_STREAM_MAX_SPANS];
+  uint32_t n = DAC8568_Stream_PlanCopy(s, sample_count, spans, DAC8568_STREAM_MAX_SPANS);
+  uint8_t format = DAC8568_WAVE_FORMAT_FRAME32;
+  uint32_t nodes = 0u;
+  uint8_t *out = (uint8_t *)dst;
+
+  if (n == 0u && sample_count <= DAC8568_SAMPLES_PER_HALF) {
+    n = DAC8568_Stream_PlanStage(s, sample_count, spans, DAC8568_STREAM_MAX_SPANS);
+    format = DAC8568_WAVE_FORMAT_CODE16x4;
+    out = (uint8_t *)g_mdma_stage;
+  }
+  if (n == 0u) {
+    DAC8568_Stream_Fill(s, dst, sample_count);
+    return;
+  }
+  for (uint32_t i = 0u; i < n; i++) {
+    const uint8_t *src = (const uint8_t *)spans[i].src;
+    uint32_t bytes = spans[i].samples * DAC8568_Stream_BytesPerSample(format);
+    while (bytes > 0u) {
+      uint32_t chunk = (bytes > SIM_MDMA_NODE_BYTES) ? SIM_MDMA_NODE_BYTES : bytes;
+      memcpy(out, src, chunk);
+      out += chunk;
+      src += chunk;
+      bytes -= chunk;
+      nodes++;
+    }
+  }
+  if (format == DAC8568_WAVE_FORMAT_CODE16x4) {
+    DAC8568_Stream_PackCodes(dst, g_mdma_stage, sample_count);
+    g_mdma_staged++;
+  }
+  g_mdma_nodes_max = (nodes > g_mdma_nodes_max) ? nodes : g_mdma_nodes_max;
+  g_mdma_refills++;
+}
+
+typedef void (*sim_fill_fn_t)(DAC8568_Stream_t *s, uint32_t *dst, uint32_t sample_count);
+
+static void sim_bench_run(sim_fill_fn_t fill, const sim_wave_t *w, uint8_t want, uint32_t halves,
+                          uint32_t *dst, uint64_t *ns, uint64_t *cycles) {
+  DAC8568_Stream_t s;
+  const void *data;
+  uint8_t format;
+  sim_wave_source(w, want, &data, &format);
+  DAC8568_Stream_Init(&s, 102400u);
+  DAC8568_Stream_SetSource(&s, 0u, data, w->samples, format, 1u);
+
+  const uint64_t t0 = sim_now_ns();
+  const uint64_t c0 = sim_cycles();
+  for (uint32_t h = 0u; h < halves; h++) {
+    fill(&s, &dst[(h & 1u) * DAC8568_TX_HALF_WORDS], DAC8568_SAMPLES_PER_HALF);
+  }
+  *cycles = sim_cycles() - c0;
+  *ns = sim_now_ns() - t0;
+}
+
+/* Integrity CRC32: slice-by-8 vs bitwise reference over `mb` MB of noise. */
+static int sim_bench_crc(uint32_t mb) {
+  static const char check[] = "123456789";
+  const uint32_t len = mb << 20;
+  uint8_t *buf = (uint8_t *)malloc((size_t)len + 8u);
+  uint32_t seed = 0xC0FFEE11u;
+  int errors = 0;
+
+  if (buf == NULL || mb == 0u || mb > 1024u) {
+    free(buf);
+    fprintf(stderr, "--bench-crc: 1..1024 MB\n");
+    return 2;
+  }
+  for (uint32_t i = 0u; i < len + 8u; i++) {
+    buf[i] = (uint8_t)sim_xorshift32(&seed);
+  }
+
+  /* Check value, then chained updates over misaligned starts / odd splits. */
+  if (CRC32_Fast_UpdateBitwise(0u, check, 9u) != 0xCBF43926u || CRC32_Fast_Update(0u, check, 9u) != 0xCBF43926u) {
+    errors++;
+  }
+  for (uint32_t t = 0u; t < 2000u; t++) {
+    const uint32_t off = sim_xorshift32(&seed) & 7u;
+    const uint32_t n = sim_xorshift32(&seed) % 4097u;
+    const uint32_t cut = (n != 0u) ? sim_xorshift32(&seed) % n : 0u;
+    const uint32_t ref = CRC32_Fast_UpdateBitwise(0u, buf + off, n);
+    const uint32_t got = CRC32_Fast_Update(CRC32_Fast_Update(0u, buf + off, cut), buf + off + cut, n - cut);
+    if (got != ref) {
+      errors++;
+    }
+  }
+
+  (void)CRC32_Fast_UpdateSoft(0u, buf, 1u << 16); /* table + cache warm-up */
+  uint64_t t0 = sim_now_ns();
+  uint64_t c0 = sim_cycles();
+  const uint32_t crc_bit = CRC32_Fast_UpdateBitwise(0u, buf, len);
+  const uint64_t cyc_bit = sim_cycles() - c0;
+  const uint64_t ns_bit = sim_now_ns() - t0;
+  t0 = sim_now_ns();
+  c0 = sim_cycles();
+  const uint32_t crc_s8 = CRC32_Fast_UpdateSoft(0u, buf, len);
+  const uint64_t cyc_s8 = sim_cycles() - c0;
+  const uint64_t ns_s8 = sim_now_ns() - t0;
+  if (crc_s8 != crc_bit) {
+    errors++;
+  }
+  free(buf);
+
+  printf("[BENCH] crc32 %lu MB  hw=%u\n", (unsigned long)mb, (unsigned)CRC32_FAST_HW);
+  printf("[BENCH] bitwise  : %8.1f MB/s", (double)len * 1e3 / (double)ns_bit);
+  if (SIM_HAVE_TSC) {
+    printf("  %.2f cycles/byte", (double)cyc_bit / (double)len);
+  }
+  printf("\n[BENCH] slice-by-8: %7.1f MB/s", (double)len * 1e3 / (double)ns_s8);
+  if (SIM_HAVE_TSC) {
+    printf("  %.2f cycles/byte", (double)cyc_s8 / (double)len);
+  }
+  printf("\n[BENCH] speedup=%.2fx  crc=0x%08lX  %s\n", (ns_s8 != 0u) ? (double)ns_bit / (double)ns_s8 : 0.0,
+         (unsigned long)crc_s8, (errors == 0) ? "MATCH" : "MISMATCH");
+  return (errors == 0) ? 0 : 1;
+}
+
+/* Payload a producer derives from the seq it expects, so the dispatcher can check it. */
+static void sim_cmd_fill(DAC8568_Cmd_t *c, uint32_t seq) {
+  memset(c, 0, sizeof(*c));
+  c->type = (uint8_t)(DAC8568_CMD_FAULT_TRIGGER + seq % 3u);
+  c->id = (uint8_t)seq;
+  c->arg = seq * 2654435761u;
+  c->count = (uint16_t)(seq % (DAC8568_CMD_STEPS_MAX + 1u));
+  for (uint32_t i = 0u; i < c->count; i++) {
+    c->steps[i].partition = (uint8_t)(seq + i);
+    c->steps[i].repeat = (uint16_t)(seq >> 3);
+    c->steps[i].duration_ms = seq ^ i;
+  }
+}
+
+static uint32_t sim_cmd_seq_next(uint32_t seq) {
+  return (seq + 1u != 0u) ? seq + 1u : 1u;
+}
+
+/* Command rings: random producer bursts / dispatcher drains against a model of each ring. */
+static int sim_cmd_check(uint32_t steps) {
+  enum { RINGS = 3 };
+  static DAC8568_CmdRing_t ring[RINGS];
+  uint32_t post_seq[RINGS];               /* seq the next accepted post must get */
+  uint32_t pop_seq[RINGS];                /* seq the next pop must return */
+  uint32_t refused[RINGS];
+  uint8_t done[RINGS][DAC8568_CMD_QUEUE]; /* status of the last QUEUE completions, by seq */
+  uint32_t seed = 0x5EED0C0Du;
+  uint64_t posted = 0u;
+  uint64_t applied = 0u;
+  uint64_t rejected = 0u;
+  uint32_t max_pending = 0u;
+  int errors = 0;
+
+  memset(ring, 0, sizeof(ring)); /* rings 0 and 1 start zero-initialised, like the firmware's statics */
+  DAC8568_CmdRing_Init(&ring[2]);
+  ring[2].next_seq = 0xFFFFFFF0u;
+  ring[2].completed = 0xFFFFFFEFu;
+  for (uint32_t r = 0u; r < RINGS; r++) {
+    post_seq[r] = sim_cmd_seq_next(ring[r].next_seq - 1u);
+    pop_seq[r] = post_seq[r];
+    refused[r] = 0u;
+    memset(done[r], DAC8568_CMD_STATUS_EXPIRED, sizeof(done[r]));
+  }
+
+  for (uint32_t step = 0u; step <= steps; step++) {
+    const uint32_t r = sim_xorshift32(&seed) % RINGS;
+    DAC8568_CmdRing_t *q = &ring[r];
+    /* Last step: drain everything. Otherwise post slightly more often than drain so rings fill up. */
+    const int produce = (step < steps) && (sim_xorshift32(&seed) % 8u) < 5u;
+
+    if (produce) {
+      const uint32_t burst = 1u + sim_xorshift32(&seed) % 4u;
+      for (uint32_t b = 0u; b < burst; b++) {
+        DAC8568_Cmd_t c;
+        const uint32_t pending = DAC8568_CmdRing_Pending(q);
+        sim_cmd_fill(&c, post_seq[r]);
+        const uint32_t seq = DAC8568_CmdRing_Post(q, &c);
+        if (pending >= DAC8568_CMD_QUEUE) {
+          refused[r]++;
+          errors += (seq != 0u || q->full != refused[r]);
+          continue;
+        }
+        if (seq != post_seq[r] || DAC8568_CmdRing_Status(q, seq) != DAC8568_CMD_STATUS_PENDING) {
+          errors++;
+        }
+        post_seq[r] = sim_cmd_seq_next(post_seq[r]);
+        posted++;
+        max_pending = (pending + 1u > max_pending) ? pending + 1u : max_pending;
+      }
+      continue;
+    }
+
+    const uint32_t n = (step < steps) ? 1u + sim_xorshift32(&seed) % DAC8568_CMD_QUEUE : 0xFFFFFFFFu;
+    for (uint32_t k = 0u; k < n; k++) {
+      const uint32_t rr = (step < steps) ? r : k % RINGS;
+      DAC8568_CmdRing_t *d = &ring[rr];
+      DAC8568_Cmd_t got;
+      DAC8568_Cmd_t exp;
+
+      if (DAC8568_CmdRing_Pop(d, &got) == 0) {
+        if (step < steps || (DAC8568_CmdRing_Pending(&ring[0]) | DAC8568_CmdRing_Pending(&ring[1]) |
+                             DAC8568_CmdRing_Pending(&ring[2])) == 0u) {
+          break;
+        }
+        continue;
+      }
+      sim_cmd_fill(&exp, pop_seq[rr]);
+      exp.seq = pop_seq[rr];
+      if (memcmp(&got, &exp, sizeof(got)) != 0) {
+        errors++;
+      }
+      const DAC8568_CmdStatus_t st = (got.seq % 5u == 0u) ? DAC8568_CMD_STATUS_REJECTED : DAC8568_CMD_STATUS_OK;
+      DAC8568_CmdRing_Complete(d, got.seq, st);
+      done[rr][got.seq & (DAC8568_CMD_QUEUE - 1u)] = (uint8_t)st;
+      applied += (st == DAC8568_CMD_STATUS_OK);
+      rejected += (st == DAC8568_CMD_STATUS_REJECTED);
+
+      /* The last QUEUE results are held, the one before them has expired, the next one is pending. */
+      for (uint32_t back = 0u; back < DAC8568_CMD_QUEUE; back++) {
+        const uint32_t s = got.seq - back;
+        if (s != 0u && DAC8568_CmdRing_Status(d, s) != (DAC8568_CmdStatus_t)done[rr][s & (DAC8568_CMD_QUEUE - 1u)]) {
+          errors++;
+        }
+      }
+      if (got.seq - DAC8568_CMD_QUEUE != 0u &&
+          DAC8568_CmdRing_Status(d, got.seq - DAC8568_CMD_QUEUE) != DAC8568_CMD_STATUS_EXPIRED) {
+        errors++;
+      }
+      const uint32_t next = sim_cmd_seq_next(got.seq);
+      if (DAC8568_CmdRing_Status(d, next) !=
+          ((next != post_seq[rr]) ? DAC8568_CMD_STATUS_PENDING : DAC8568_CMD_STATUS_EXPIRED)) {
+        errors++;
+      }
+      pop_seq[rr] = next;
+    }
+  }
+
+  for (uint32_t r = 0u; r < RINGS; r++) {
+    errors += (pop_seq[r] != post_seq[r] || DAC8568_CmdRing_Pending(&ring[r]) != 0u || ring[r].full != refused[r]);
+  }
+  errors += (DAC8568_CmdRing_Status(&ring[0], 0u) != DAC8568_CMD_STATUS_EXPIRED);
+  printf("[CMD] steps=%lu rings=%u queue=%u  posted=%llu ok=%llu rejected=%llu  full=%lu/%lu/%lu  max_pending=%lu  %s\n",
+         (unsigned long)steps, (unsigned)RINGS, (unsigned)DAC8568_CMD_QUEUE, (unsigned long long)posted,
+         (unsigned long long)applied, (unsigned long long)rejected, (unsigned long)refused[0],
+         (unsigned long)refused[1], (unsigned long)refused[2], (unsigned long)max_pending,
+         (errors == 0) ? "PASS" : "FAIL");
+  return (errors == 0) ? 0 : 1;
+}
+
+/* Refill throughput: fast packer vs scalar reference, same source, same halves. */
+static int sim_bench(const sim_wave_t *w, uint32_t halves) {
+  static uint32_t ref_buf[DAC8568_TX_BUF_WORDS];
+  uint64_t ns_ref;
+  uint64_t ns_fast;
+  uint64_t cyc_ref;
+  uint64_t cyc_fast;
+  uint64_t ns_f32;
+  uint64_t cyc_f32;
+  uint64_t ns_z = 0u;
+  uint64_t cyc_z = 0u;
+
+  if (w->codes == NULL) {
+    return 0; /* DACW payload: nothing to pack */
+  }
+
+  /* Warm up caches/branch predictors, then measure. */
+  sim_bench_run(DAC8568_Stream_FillReference, w, DAC8568_WAVE_FORMAT_CODE16x4, 4u, ref_buf, &ns_ref, &cyc_ref);
+  sim_bench_run(DAC8568_Stream_Fill, w, DAC8568_WAVE_FORMAT_CODE16x4, 4u, g_ring, &ns_fast, &cyc_fast);
+  sim_bench_run(DAC8568_Stream_FillReference, w, DAC8568_WAVE_FORMAT_CODE16x4, halves, ref_buf, &ns_ref,
+                &cyc_ref);
+  sim_bench_run(DAC8568_Stream_Fill, w, DAC8568_WAVE_FORMAT_CODE16x4, halves, g_ring, &ns_fast, &cyc_fast);
+  int same = (memcmp(ref_buf, g_ring, sizeof(ref_buf)) == 0);
+  sim_bench_run(DAC8568_Stream_Fill, w, DAC8568_WAVE_FORMAT_FRAME32, 4u, g_ring, &ns_f32, &cyc_f32);
+  sim_bench_run(DAC8568_Stream_Fill, w, DAC8568_WAVE_FORMAT_FRAME32, halves, g_ring, &ns_f32, &cyc_f32);
+  same = same && (memcmp(ref_buf, g_ring, sizeof(ref_buf)) == 0);
+  if (w->zcode != NULL) {
+    sim_bench_run(DAC8568_Stream_Fill, w, DAC8568_WAVE_FORMAT_ZCODE16x4, 4u, g_ring, &ns_z, &cyc_z);
+    sim_bench_run(DAC8568_Stream_Fill, w, DAC8568_WAVE_FORMAT_ZCODE16x4, halves, g_ring, &ns_z, &cyc_z);
+    same = same && (memcmp(ref_buf, g_ring, sizeof(ref_buf)) == 0);
+  }
+  const double n = (double)halves * (double)DAC8568_SAMPLES_PER_HALF;
+  printf("[BENCH] source=%lu samples  halves=%lu  pack_fast=%u\n", (unsigned long)w->samples,
+         (unsigned long)halves, (unsigned)DAC8568_STREAM_PACK_FAST);
+  printf("[BENCH] reference: %.3f ns/sample", (double)ns_ref / n);
+  if (SIM_HAVE_TSC) {
+    printf("  %.2f cycles/sample", (double)cyc_ref / n);
+  }
+  printf("\n[BENCH] fast     : %.3f ns/sample", (double)ns_fast / n);
+  if (SIM_HAVE_TSC) {
+    printf("  %.2f cycles/sample", (double)cyc_fast / n);
+  }
+  printf("\n[BENCH] frame32  : %.3f ns/sample", (double)ns_f32 / n);
+  if (SIM_HAVE_TSC) {
+    printf("  %.2f cycles/sample", (double)cyc_f32 / n);
+  }
+  if (w->zcode != NULL) {
+    printf("\n[BENCH] zcode16  : %.3f ns/sample", (double)ns_z / n);
+    if (SIM_HAVE_TSC) {
+      printf("  %.2f cycles/sample", (double)cyc_z / n);
+    }
+    printf("  (%.2f bits/code)", (double)w->zcode_words * 32.0 / ((double)w->samples * SIM_CHANNELS));
+  }
+  printf("\n[BENCH] speedup=%.2fx  output %s\n", (ns_fast != 0u) ? (double)ns_ref / (double)ns_fast : 0.0,
+         same ? "identical" : "MISMATCH");
+  return same ? 0 : 1;
+}
+
+
+static int sim_parse(int argc, char **argv, sim_opts_t *o) {
+  o->rate_hz = 102400u;
+  o->seconds = 10.0;
+  o->wave_path = NULL;
+  o->switch_at_half = 8;
+  o->cpu_scale = 1.0;
+  o->bench_halves = 0u;
+  o->frame32 = 0;
+  o->zcode = 0;
+  o->mdma = 0;
+  o->playlist = 0;
+  o->fade_mode = (uint8_t)DAC8568_TRANSITION_HARD;
+  o->fade_len = 0u;
+  o->speed_q16 = DAC8568_STREAM_SPEED_ONE;
+  o->interp = (uint8_t)DAC8568_INTERP_LINEAR;
+  o->map = 0;
+  o->slots = 2u;
+  o->lead = 0u; /* DAC8568_RING_LEAD (1 for 2 slots) */
+  o->switch_period = 0u;
+  o->bench_ring_seconds = 0.0;
+  o->bench_crc_mb = 0u;
+  o->cmd_check_steps = 0u;
+  o->synth_ref_path = NULL;
+  memset(o->loop, 0, sizeof(o->loop));
+  o->verify = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+    if (strcmp(arg, "--frame32") == 0) {
+      o->frame32 = 1;
+      continue;
+    }
+    if (strcmp(arg, "--zcode") == 0) {
+      o->zcode = 1;
+      continue;
+    }
+    if (strcmp(arg, "--mdma") == 0) {
+      o->mdma = 1;
+      continue;
+    }
+    if (strcmp(arg, "--playlist") == 0) {
+      o->playlist = 1;
+      continue;
+    }
+    if (strcmp(arg, "--map") == 0) {
+      o->map = 1;
+      continue;
+    }
+    if (strcmp(arg, "--verify") == 0) {
+      o->verify = 1;
+      continue;
+    }
+    if (val == NULL) {
+      return -1;
+    }
+    if (strcmp(arg, "--rate") == 0) {
+      o->rate_hz = (uint32_t)strtoul(val, NULL, 0);
+    } else if (strcmp(arg, "--seconds") == 0) {
+      o->seconds = strtod(val, NULL);
+    } else if (strcmp(arg, "--wave") == 0) {
+      o->wave_path = val;
+    } else if (strcmp(arg, "--switch-at") == 0) {
+      o->switch_at_half = strtoll(val, NULL, 0);
+    } else if (strcmp(arg, "--cpu-scale") == 0) {
+      o->cpu_scale = strtod(val, NULL);
+    } else if (strcmp(arg, "--fade") == 0) {
+      const char *colon = strchr(val, ':');
+      if (strncmp(val, "linear", 6) == 0) {
+        o->fade_mode = (uint8_t)DAC8568_TRANSITION_LINEAR;
+      } else if (strncmp(val, "cosine", 6) == 0) {
+        o->fade_mode = (uint8_t)DAC8568_TRANSITION_RAISED_COSINE;
+      } else if (strncmp(val, "hard", 4) != 0) {
+        return -1;
+      }
+      o->fade_len = (colon != NULL) ? (uint32_t)strtoul(colon + 1, NULL, 0) : 0u;
+      if (o->fade_len > DAC8568_TRANSITION_MAX_SAMPLES) {
+        return -1;
+      }
+    } else if (strcmp(arg, "--speed") == 0) {
+      const char *colon = strchr(val, ':');
+      o->speed_q16 = (uint32_t)(strtod(val, NULL) * 65536.0 + 0.5);
+      if (colon != NULL && strcmp(colon + 1, "cubic") == 0) {
+        o->interp = (uint8_t)DAC8568_INTERP_CUBIC;
+      } else if (colon != NULL && strcmp(colon + 1, "linear") != 0) {
+        return -1;
+      }
+      if (o->speed_q16 < DAC8568_STREAM_SPEED_MIN || o->speed_q16 > DAC8568_STREAM_SPEED_MAX) {
+        return -1;
+      }
+    } else if (strcmp(arg, "--slots") == 0) {
+      o->slots = (uint32_t)strtoul(val, NULL, 0);
+    } else if (strcmp(arg, "--lead") == 0) {
+      o->lead = (uint32_t)strtoul(val, NULL, 0);
+    } else if (strcmp(arg, "--bench") == 0) {
+      o->bench_halves = (uint32_t)strtoul(val, NULL, 0);
+    } else if (strcmp(arg, "--bench-ring") == 0) {
+      o->bench_ring_seconds = strtod(val, NULL);
+    } else if (strcmp(arg, "--bench-crc") == 0) {
+      o->bench_crc_mb = (uint32_t)strtoul(val, NULL, 0);
+    } else if (strcmp(arg, "--cmd-check") == 0) {
+      o->cmd_check_steps = (uint32_t)strtoul(val, NULL, 0);
+    } else if (strcmp(arg, "--synth-check") == 0) {
+      o->synth_ref_path = val;
+    } else if (strcmp(arg, "--loop") == 0) {
+      char *end = NULL;
+      o->loop[0] = (uint32_t)strtoul(val, &end, 0);
+      o->loop[1] = (*end == ':') ? (uint32_t)strtoul(end + 1, &end, 0) : 0u;
+      if (strcmp(end, ":oneshot") == 0) {
+        o->loop[2] = DAC8568_LOOP_ONE_SHOT;
+      } else if (*end != '\0') {
+        return -1;
+      }
+      if (o->loop[1] <= o->loop[0]) {
+        return -1;
+      }
+    } else {
+      return -1;
+    }
+    i++;
+  }
+  /* Compressed sources are only played at their stored rate. */
+  if (o->zcode != 0 && (o->frame32 != 0 || o->speed_q16 != DAC8568_STREAM_SPEED_ONE)) {
+    return -1;
+  }
+  /* The reference interpolates across the whole loop; markers are checked at the stored rate. */
+  if (o->loop[1] != 0u && (o->speed_q16 != DAC8568_STREAM_SPEED_ONE || o->playlist != 0)) {
+    return -1;
+  }
+  return (o->rate_hz == 0u || o->seconds <= 0.0 || o->cpu_scale <= 0.0) ? -1 : 0;
+}
+
+/*
+ * One streaming run over the DMA ring. Refills are driven the way the firmware
+ * drives them: at the slot boundaries (half/full callbacks for 2 slots, the
+ * slot-rate timer service reading the DMA position otherwise). Returns 2 on setup errors, else 0.
+ */
+static int sim_stream_run(const sim_opts_t *opt, const sim_waves_t *wv, sim_result_t *res) {
+  DAC8568_Stream_t stream;
+  DAC8568_Playlist_t playlist;
+  DAC8568_Ring_t ring;
+  sim_ref_t ref;
+
+  memset(res, 0, sizeof(*res));
+  res->refill_min_ns = UINT64_MAX;
+  const uint32_t lead = (opt->lead != 0u) ? opt->lead : DAC8568_RING_LEAD;
+  if (DAC8568_Ring_Configure(&ring, opt->slots, lead, SIM_SAMPLES_PER_BUF) != 0) {
+    fprintf(stderr, "[SIM] invalid ring: slots=%u lead=%u\n", (unsigned)opt->slots, (unsigned)lead);
+    return 2;
+  }
+
+  DAC8568_Stream_Init(&stream, opt->rate_hz);
+  DAC8568_Stream_SetSwitchHook(&stream, sim_switch_hook);
+  g_hook_head = g_hook_tail = 0u;
+  g_hook_events = g_hook_errors = 0u;
+  const void *base_data;
+  const void *fault_data;
+  const void *fault2_data;
+  uint8_t base_format;
+  uint8_t fault_format;
+  uint8_t fault2_format;
+  const uint8_t want = (opt->frame32 != 0) ? DAC8568_WAVE_FORMAT_FRAME32
+                       : (opt->zcode != 0) ? DAC8568_WAVE_FORMAT_ZCODE16x4 : DAC8568_WAVE_FORMAT_CODE16x4;
+  sim_wave_source(&wv->base, want, &base_data, &base_format);
+  sim_wave_source(&wv->fault, want, &fault_data, &fault_format);
+  sim_wave_source(&wv->fault2, want, &fault2_data, &fault2_format);
+  DAC8568_Stream_SetSource(&stream, 0u, base_data, wv->base.samples, base_format, 1u);
+  res->format = base_format;
+
+  memset(&ref, 0, sizeof(ref));
+  ref.data[0] = wv->base.frames;
+  ref.samples[0] = wv->base.samples;
+  ref.data[1] = wv->fault.frames;
+  ref.samples[1] = wv->fault.samples;
+  ref.data[2] = wv->fault2.frames;
+  ref.samples[2] = wv->fault2.samples;
+  ref.fade_mode = opt->fade_mode;
+  ref.fade_len = (opt->fade_mode == (uint8_t)DAC8568_TRANSITION_HARD) ? 0u : opt->fade_len;
+  ref.fade_t = ref.fade_len;
+  ref.speed = opt->speed_q16;
+  ref.interp = opt->interp;
+  DAC8568_Stream_SetTransition(&stream, (DAC8568_Transition_t)opt->fade_mode, opt->fade_len);
+  for (uint8_t id = 0u; id < 3u; id++) {
+    (void)DAC8568_Stream_SetSpeed(&stream, id, opt->speed_q16, (DAC8568_Interp_t)opt->interp);
+  }
+
+  /* Loop markers: the baseline file's own (version 2 header), --loop for fault 1. */
+  const uint32_t *marks[3] = {wv->base.loop, opt->loop, NULL};
+  for (uint8_t id = 0u; id < 3u; id++) {
+    ref.loop_start[id] = 0u;
+    ref.loop_end[id] = ref.samples[id];
+    if (marks[id] == NULL || marks[id][1] == 0u) {
+      continue;
+    }
+    if (marks[id][1] > ref.samples[id] ||
+        DAC8568_Stream_SetLoop(&stream, id, marks[id][0], marks[id][1], (uint8_t)marks[id][2]) != 0) {
+      fprintf(stderr, "[SIM] invalid loop markers for source %u\n", (unsigned)id);
+      return 2;
+    }
+    ref.loop_start[id] = marks[id][0];
+    ref.loop_end[id] = marks[id][1];
+    ref.one_shot[id] = (uint8_t)((marks[id][2] & DAC8568_LOOP_ONE_SHOT) != 0u);
+  }
+
+  /* A: 75 % severity, B <- C inverted, C <- B, D: 1.5x with an offset that saturates. */
+  DAC8568_ChannelMap_t map;
+  DAC8568_Stream_ChannelMapIdentity(&map);
+  map.gain_q15[0] = 0x6000;
+  map.offset[0] = 300;
+  map.route[1] = 2u;
+  map.gain_q15[1] = -DAC8568_GAIN_Q15_ONE;
+  map.route[2] = 1u;
+  map.gain_q15[3] = 0xC000;
+  map.offset[3] = -2000;
+#if DAC8568_CHANNELS == 8u
+  /* E..H: F held at mid-scale, G <- A (the route crosses the A..D / E..H halves). */
+  map.mute_mask = 0x20u;
+  map.route[6] = 0u;
+#endif
+  if (opt->map != 0 && DAC8568_Stream_SetChannelMap(&stream, &map) != 0) {
+    return 2;
+  }
+
+  /*
+   * normal -> fault1 x3 -> fault2 -> normal, in samples; none of the lengths is
+   * a multiple of the half, so boundaries land mid-refill. Restarted whenever it
+   * ends to keep exercising boundaries for the whole run.
+   */
+  const DAC8568_PlaylistSegment_t segs[] = {
+    {0u, base_format, 0u, 1u, base_data, wv->base.samples, opt->rate_hz / 5u + 7u},
+    {1u, fault_format, 1u, 3u, fault_data, wv->fault.samples, opt->rate_hz * 3u / 200u + 1u},
+    {2u, fault2_format, 1u, 1u, fault2_data, wv->fault2.samples, opt->rate_hz / 3u},
+    {0u, base_format, 0u, 1u, base_data, wv->base.samples, 5000u},
+  };
+  const uint32_t seg_count = (uint32_t)(sizeof(segs) / sizeof(segs[0]));
+  const uint32_t pump_period = (opt->rate_hz / 200u != 0u) ? opt->rate_hz / 200u : 1u;
+  DAC8568_Playlist_Init(&playlist);
+  if (opt->playlist != 0 && DAC8568_Playlist_Load(&playlist, segs, seg_count) != 0) {
+    return 2;
+  }
+
+  const sim_fill_fn_t refill = (opt->mdma != 0) ? sim_fill_mdma : DAC8568_Stream_Fill;
+  const uint32_t slot_words = ring.slot_samples * DAC8568_WORDS_PER_SAMPLE;
+
+  /*
+   * Prefill as DAC8568_DMA_Start() does: slots 0..lead from the stream (both
+   * halves for 2 slots), the rest holds the last prefilled sample.
+   */
+  const uint32_t prefill = (ring.lead + 1u) * ring.slot_samples;
+  DAC8568_Stream_Fill(&stream, &g_ring[0], prefill);
+  sim_ref_fill(&ref, &g_expect[0], &g_expect_tol[0], prefill);
+  if (opt->map != 0) {
+    sim_ref_map(&map, &g_expect[0], &g_expect_tol[0], prefill);
+  }
+  for (uint32_t i = prefill; i < ring.ring_samples; i++) {
+    memcpy(&g_ring[i * DAC8568_WORDS_PER_SAMPLE], &g_ring[(prefill - 1u) * DAC8568_WORDS_PER_SAMPLE],
+           DAC8568_WORDS_PER_SAMPLE * sizeof(uint32_t));
+    memcpy(&g_expect[i * DAC8568_WORDS_PER_SAMPLE], &g_expect[(prefill - 1u) * DAC8568_WORDS_PER_SAMPLE],
+           DAC8568_WORDS_PER_SAMPLE * sizeof(uint32_t));
+    g_expect_tol[i] = g_expect_tol[prefill - 1u];
+  }
+  DAC8568_Ring_Reset(&ring, ring.lead + 1u);
+  if (opt->verify != 0) {
+    if (sim_verify_configure(ring.ring_samples) != 0) {
+      return 2;
+    }
+    DAC8568_Verify_Expect(&g_verify, 0u, g_ring, ring.ring_samples);
+  }
+
+  const uint64_t total_ticks = (uint64_t)(opt->seconds * (double)opt->rate_hz);
+  const uint64_t switch_tick = (uint64_t)(opt->switch_at_half + 1) * DAC8568_SAMPLES_PER_HALF - 1u;
+  uint64_t next_switch = switch_tick;
+  uint64_t next_release = UINT64_MAX;
+  uint64_t post_consumed = 0u;
+  uint8_t next_fault = 1u;
+  uint32_t rng = 0x2545F491u;
+  uint64_t cycles = 0u; /* completed ring passes (TC callbacks) */
+  uint32_t pos = 0u;    /* sample position inside the ring (DMA read pointer) */
+
+  res->slot_samples = ring.slot_samples;
+  res->budget_ns = (double)ring.slot_samples * (double)ring.lead * 1e9 / (double)opt->rate_hz;
+
+  for (uint64_t tick = 0u; tick < total_ticks; tick++) {
+    /* TIM12 update -> DMAMUX releases 4 SPI words. */
+    const uint32_t w = pos * DAC8568_WORDS_PER_SAMPLE;
+    for (uint32_t k = 0u; k < DAC8568_WORDS_PER_SAMPLE; k++) {
+      if (!sim_frame_match(g_ring[w + k], g_expect[w + k], g_expect_tol[pos])) {
+        if (res->frame_errors < 8u) {
+          fprintf(stderr, "[SIM] frame mismatch tick=%llu word=%u got=0x%08X exp=0x%08X\n",
+                  (unsigned long long)tick, (unsigned)(w + k), (unsigned)g_ring[w + k],
+                  (unsigned)g_expect[w + k]);
+        }
+        res->frame_errors++;
+      }
+    }
+    if (opt->verify != 0 && (tick % SIM_VERIFY_DECIM) == 0u) {
+      sim_verify_convert(&g_ring[w], (uint32_t)(tick * 100u / total_ticks));
+    }
+    pos++;
+    if (pos == ring.ring_samples) {
+      pos = 0u;
+      cycles++;
+    }
+
+    /* Main_Task: the verify service reads the new ADC scans every 5 ms. */
+    if (opt->verify != 0 && (tick % pump_period) == 0u) {
+      DAC8568_Verify_Measure(&g_verify, g_verify_adc, g_verify_words / g_verify.cfg.probes);
+      g_verify_words = 0u;
+      if (g_verify_clean.windows == 0u && tick * 100u >= total_ticks * 35u) {
+        DAC8568_Verify_GetStats(&g_verify, &g_verify_clean);
+        g_verify_cal = g_verify.cfg;
+      }
+    }
+
+    /* Main_Task: 5 ms service loop keeps the switch queue topped up. */
+    if (opt->playlist != 0 && (tick % pump_period) == 0u && tick >= switch_tick) {
+      if (!DAC8568_Playlist_IsActive(&playlist, &stream)) {
+        if (DAC8568_Stream_GetPosition(&stream) != (uint32_t)ref.position ||
+            sim_ref_schedule(&ref, segs, seg_count, ref.position) != 0) {
+          fprintf(stderr, "[SIM] playlist position mismatch\n");
+          return 2;
+        }
+        (void)DAC8568_Playlist_Start(&playlist, &stream);
+        res->playlist_runs++;
+      } else {
+        (void)DAC8568_Playlist_Pump(&playlist, &stream);
+      }
+    }
+
+    /* Main_Task posting a fault switch (once, or periodically for --bench-ring). */
+    if (opt->playlist == 0 && ref.pending == 0u && tick >= next_switch) {
+      const uint8_t id = next_fault;
+      if (id == 1u) {
+        DAC8568_Stream_PostSwitch(&stream, 1u, fault_data, wv->fault.samples, fault_format, 1u);
+      } else {
+        DAC8568_Stream_PostSwitch(&stream, 2u, fault2_data, wv->fault2.samples, fault2_format, 1u);
+      }
+      ref.pending = 1u;
+      ref.pending_id = id;
+      post_consumed = tick + 1u;
+      if (opt->loop[1] != 0u) {
+        /* Fault end after ~0.1 s, next trigger once the tail has had time to return. */
+        next_release = tick + opt->rate_hz / 10u;
+        next_switch = next_release + opt->rate_hz / 5u + sim_xorshift32(&rng) % 4096u;
+      } else if (opt->switch_period != 0u) {
+        next_fault = (uint8_t)(3u - id);
+        next_switch = tick + opt->switch_period + sim_xorshift32(&rng) % opt->switch_period;
+      } else {
+        next_switch = UINT64_MAX;
+      }
+    }
+
+    /* Main_Task at the fault end: release the sustain loop instead of switching back. */
+    if (ref.pending == 0u && tick >= next_release) {
+      if (DAC8568_Stream_PostRelease(&stream) != 0) {
+        return 2;
+      }
+      ref.pending = 1u;
+      ref.pending_id = DAC8568_STREAM_SOURCE_RELEASE;
+      post_consumed = tick + 1u;
+      next_release = UINT64_MAX;
+    }
+
+    /* Half/full callbacks (2 slots) or the slot-rate ring service. */
+    if ((pos % ring.slot_samples) != 0u) {
+      continue;
+    }
+    res->services++;
+
+    const uint32_t read_slot = (uint32_t)cycles * ring.slots + pos / ring.slot_samples;
+    for (uint32_t n = 0u; n <= ring.lead; n++) {
+      const int32_t idx = DAC8568_Ring_NextDue(&ring, read_slot);
+      if (idx < 0) {
+        break;
+      }
+      const uint8_t was_pending = ref.pending;
+      const uint64_t t0 = sim_now_ns();
+      refill(&stream, &g_ring[(uint32_t)idx * slot_words], ring.slot_samples);
+      const uint64_t dt = sim_now_ns() - t0;
+      if (opt->verify != 0) {
+        DAC8568_Verify_Expect(&g_verify, ring.filled * ring.slot_samples, &g_ring[(uint32_t)idx * slot_words],
+                              ring.slot_samples);
+      }
+      sim_ref_fill(&ref, &g_expect[(uint32_t)idx * slot_words], &g_expect_tol[(uint32_t)idx * ring.slot_samples],
+                   ring.slot_samples);
+      if (opt->map != 0) {
+        sim_ref_map(&map, &g_expect[(uint32_t)idx * slot_words], &g_expect_tol[(uint32_t)idx * ring.slot_samples],
+                    ring.slot_samples);
+      }
+      DAC8568_Ring_Commit(&ring);
+
+      if (was_pending != 0u && ref.pending == 0u) {
+        const uint64_t lat = ref.pending_applied - post_consumed;
+        res->switches++;
+        res->latency_sum += lat;
+        res->latency_max = (lat > res->latency_max) ? lat : res->latency_max;
+      }
+      res->refill_sum_ns += dt;
+      res->refill_min_ns = (dt < res->refill_min_ns) ? dt : res->refill_min_ns;
+      res->refill_max_ns = (dt > res->refill_max_ns) ? dt : res->refill_max_ns;
+      if ((double)dt * opt->cpu_scale >= res->budget_ns) {
+        res->underruns++;
+      }
+      res->refills++;
+    }
+  }
+
+  if (res->refills == 0u) {
+    res->refill_min_ns = 0u;
+  }
+  res->sched_count = ref.sched_count;
+  res->returns = ref.returns;
+  res->switch_late = stream.switch_late;
+  res->ring_late = ring.late;
+  return 0;
+}
+
+/* Switch latency vs refill load for every slot count the firmware accepts. */
+static int sim_bench_ring(const sim_opts_t *base_opt, const sim_waves_t *wv) {
+  static const uint32_t slot_counts[] = {2u, 4u, 8u, 16u, 32u, 64u, 128u, 256u, 512u};
+  int rc = 0;
+
+  printf("[RING] rate=%lu sps  %.1f s per config  buffer=%u samples  slot-rate service  x%.1f cpu scale\n",
+         (unsigned long)base_opt->rate_hz, base_opt->bench_ring_seconds, (unsigned)SIM_SAMPLES_PER_BUF,
+         base_opt->cpu_scale);
+  printf("[RING] slots lead  slot_ms  lat_mean_ms lat_max_ms  refills/s  refill_us/s  cpu%%  late\n");
+  for (uint32_t i = 0u; i < (uint32_t)(sizeof(slot_counts) / sizeof(slot_counts[0])); i++) {
+    sim_opts_t opt = *base_opt;
+    sim_result_t res;
+    opt.slots = slot_counts[i];
+    opt.lead = (opt.slots == 2u) ? 1u : ((base_opt->lead != 0u) ? base_opt->lead : DAC8568_RING_LEAD);
+    if (opt.slots > 2u && opt.lead > opt.slots - 2u) {
+      opt.lead = opt.slots - 2u;
+    }
+    opt.seconds = base_opt->bench_ring_seconds;
+    opt.playlist = 0;
+    opt.switch_at_half = 2;
+    opt.switch_period = opt.rate_hz / 8u;
+    if (sim_stream_run(&opt, wv, &res) != 0) {
+      return 2;
+    }
+    const double ms_per_sample = 1000.0 / (double)opt.rate_hz;
+    const double lat_mean = (res.switches != 0u) ? (double)res.latency_sum / (double)res.switches : 0.0;
+    const double us_per_s = (double)res.refill_sum_ns * opt.cpu_scale / 1000.0 / opt.seconds;
+    printf("[RING] %5u %4u  %7.2f  %11.2f %10.2f  %9.1f  %11.1f  %4.2f  %llu\n", (unsigned)opt.slots,
+           (unsigned)opt.lead, (double)res.slot_samples * ms_per_sample, lat_mean * ms_per_sample,
+           (double)res.latency_max * ms_per_sample, (double)res.refills / opt.seconds, us_per_s,
+           us_per_s / 1e4, (unsigned long long)res.ring_late);
+    if (res.frame_errors != 0u || res.ring_late != 0u || res.switches == 0u) {
+      fprintf(stderr, "[RING] slots=%u: frame_errors=%llu late=%lu switches=%llu\n", (unsigned)opt.slots,
+              (unsigned long long)res.frame_errors, (unsigned long)res.ring_late,
+              (unsigned long long)res.switches);
+      rc = 1;
+    }
+  }
+  return rc;
+}
+
+typedef struct {
+  uint64_t checked;
+  uint64_t off_by_one;
+  uint64_t errors;
+  uint32_t max_err;
+} sim_synth_stat_t;
+
+/* Generator code of output `ch`; an 8-channel build holds E..H at mid-scale. */
+static double sim_synth_ref(const uint16_t *sample, uint32_t ch) {
+  return (ch < SIM_SYNTH_OUTPUTS) ? (double)sample[ch] : 32768.0;
+}
+
+static void sim_synth_expect(sim_synth_stat_t *st, uint32_t frame, uint32_t ch, double expect, uint32_t tol) {
+  const double diff = fabs((double)((frame >> 4) & 0xFFFFu) - expect);
+  const uint32_t err = (uint32_t)(diff + 0.5);
+  st->checked++;
+  if (err > st->max_err) {
+    st->max_err = err;
+  }
+  if (err == 1u) {
+    st->off_by_one++;
+  }
+  if (diff > (double)tol + 0.5 || (frame & ~0x000FFFF0u) != sim_frame_prefix(ch)) {
+    st->errors++;
+  }
+}
+
+/* Procedural waveforms against the Python generator (see --synth-check). */
+static int sim_synth_check(const char *path, uint32_t rate_hz) {
+  static const char *const names[DAC8568_SYNTH_KIND_COUNT] = {
+    "normal", "ac_coupling", "bus_ground", "insulation", "cap_aging", "pwm_abnormal", "igbt_fault",
+  };
+  static DAC8568_Synth_t synth[DAC8568_SYNTH_KIND_COUNT];
+  static uint32_t buf[8192u * SIM_CHANNELS];
+  const uint32_t kinds = (uint32_t)DAC8568_SYNTH_KIND_COUNT;
+  sim_synth_stat_t total = {0};
+  uint16_t *ref;
+  long bytes;
+  FILE *f = fopen(path, "rb");
+
+  if (f == NULL || fseek(f, 0, SEEK_END) != 0 || (bytes = ftell(f)) <= 0 ||
+      (bytes % (long)(kinds * SIM_SYNTH_OUTPUTS * 2u)) != 0) {
+    fprintf(stderr, "[SYNTH] bad reference file %s\n", path);
+    if (f != NULL) {
+      fclose(f);
+    }
+    return 2;
+  }
+  const uint32_t loop = (uint32_t)(bytes / (long)(kinds * SIM_SYNTH_OUTPUTS * 2u));
+  ref = (uint16_t *)malloc((size_t)bytes);
+  rewind(f);
+  if (ref == NULL || fread(ref, 1u, (size_t)bytes, f) != (size_t)bytes) {
+    fclose(f);
+    free(ref);
+    return 2;
+  }
+  fclose(f);
+
+  printf("[SYNTH] reference=%s rate=%lu sps loop=%lu samples tol=%u LSB\n", path, (unsigned long)rate_hz,
+         (unsigned long)loop, (unsigned)SIM_SYNTH_TOL);
+  uint32_t rng = 0x5EED1234u;
+  int rc = 0;
+  for (uint32_t k = 0u; k < kinds; k++) {
+    DAC8568_SynthParams_t p;
+    sim_synth_stat_t st = {0};
+    const uint16_t *codes = &ref[(size_t)k * loop * SIM_SYNTH_OUTPUTS];
+    static const uint32_t chunks[] = {1u, 777u, 8192u, 33u};
+
+    DAC8568_Synth_DefaultParams(&p, (DAC8568_SynthKind_t)k, rate_hz, loop);
+    if (DAC8568_Synth_Configure(&synth[k], &p) != 0) {
+      fprintf(stderr, "[SYNTH] %s: configure failed\n", names[k]);
+      free(ref);
+      return 2;
+    }
+
+    /* 1.5 loops in refill-sized pieces: exercises the loop restart. */
+    uint32_t index = 0u;
+    uint64_t done = 0u;
+    uint64_t render_ns = 0u;
+    for (uint32_t c = 0u; done < (uint64_t)loop + loop / 2u; c++) {
+      const uint32_t n = chunks[c % (sizeof(chunks) / sizeof(chunks[0]))];
+      const uint32_t at = index;
+      const uint64_t t0 = sim_now_ns();
+      index = DAC8568_Synth_Render(&synth[k], index, buf, n);
+      render_ns += sim_now_ns() - t0;
+      for (uint32_t i = 0u; i < n; i++) {
+        const uint32_t j = (uint32_t)(((uint64_t)at + i) % loop);
+        for (uint32_t ch = 0u; ch < SIM_CHANNELS; ch++) {
+          sim_synth_expect(&st, buf[i * SIM_CHANNELS + ch], ch, sim_synth_ref(&codes[j * SIM_SYNTH_OUTPUTS], ch),
+                           SIM_SYNTH_TOL);
+        }
+      }
+      done += n;
+    }
+    /* Random seeks (index resets, baseline catch-up after a fault). */
+    for (uint32_t r = 0u; r < 64u; r++) {
+      const uint32_t at = sim_xorshift32(&rng) % loop;
+      const uint32_t n = 1u + sim_xorshift32(&rng) % 4096u;
+      (void)DAC8568_Synth_Render(&synth[k], at, buf, n);
+      for (uint32_t i = 0u; i < n; i++) {
+        const uint32_t j = (uint32_t)(((uint64_t)at + i) % loop);
+        for (uint32_t ch = 0u; ch < SIM_CHANNELS; ch++) {
+          sim_synth_expect(&st, buf[i * SIM_CHANNELS + ch], ch, sim_synth_ref(&codes[j * SIM_SYNTH_OUTPUTS], ch),
+                           SIM_SYNTH_TOL);
+        }
+      }
+    }
+    printf("[SYNTH] %-12s checked=%llu max_err=%u off_by_one=%.4f%% errors=%llu  %.1f ns/sample\n", names[k],
+           (unsigned long long)st.checked, (unsigned)st.max_err,
+           100.0 * (double)st.off_by_one / (double)st.checked, (unsigned long long)st.errors,
+           (double)render_ns / (double)done);
+    total.checked += st.checked;
+    total.errors += st.errors;
+    if (st.errors != 0u) {
+      rc = 1;
+    }
+  }
+
+  /*
+   * Stream: normal, fault 6 from index 0 at A, back to normal (no reset) at B,
+   * both switches blended; the baseline index runs on behind the fault.
+   */
+  {
+    DAC8568_Stream_t stream;
+    sim_synth_stat_t st = {0};
+    const uint32_t fade = 256u;
+    const uint32_t at_a = 20000u;
+    const uint32_t at_b = at_a + loop * 2u + 1234u;
+    const uint32_t total_samples = at_b + loop;
+    const uint16_t *normal = ref;
+    const uint16_t *fault = &ref[(size_t)DAC8568_SYNTH_IGBT_FAULT * loop * SIM_SYNTH_OUTPUTS];
+
+    DAC8568_Stream_Init(&stream, rate_hz);
+    DAC8568_Stream_SetTransition(&stream, DAC8568_TRANSITION_RAISED_COSINE, fade);
+    DAC8568_Stream_SetSource(&stream, 0u, &synth[0], loop, DAC8568_WAVE_FORMAT_SYNTH, 1u);
+    (void)DAC8568_Stream_QueueSwitchAt(&stream, (uint8_t)DAC8568_SYNTH_IGBT_FAULT,
+                                       &synth[DAC8568_SYNTH_IGBT_FAULT], loop, DAC8568_WAVE_FORMAT_SYNTH,
+                                       1u, at_a);
+    (void)DAC8568_Stream_QueueSwitchAt(&stream, 0u, &synth[0], loop, DAC8568_WAVE_FORMAT_SYNTH, 0u, at_b);
+    for (uint32_t pos = 0u; pos < total_samples;) {
+      const uint32_t n = 1000u + sim_xorshift32(&rng) % 7000u;
+      DAC8568_Stream_Fill(&stream, buf, n);
+      for (uint32_t i = 0u; i < n; i++, pos++) {
+        const uint32_t jn = pos % loop;
+        const uint32_t jf = (pos >= at_a) ? (pos - at_a) % loop : 0u;
+        const uint16_t *cur =
+            (pos < at_a || pos >= at_b) ? &normal[jn * SIM_SYNTH_OUTPUTS] : &fault[jf * SIM_SYNTH_OUTPUTS];
+        const uint16_t *old = NULL;
+        uint32_t t = 0u;
+        if (pos >= at_a && pos < at_a + fade) {
+          old = &normal[jn * SIM_SYNTH_OUTPUTS];
+          t = pos - at_a;
+        } else if (pos >= at_b && pos < at_b + fade) {
+          old = &fault[jf * SIM_SYNTH_OUTPUTS];
+          t = pos - at_b;
+        }
+        const double w = 0.5 - 0.5 * cos(SIM_PI * (double)t / (double)fade);
+        for (uint32_t ch = 0u; ch < SIM_CHANNELS; ch++) {
+          const double b = sim_synth_ref(cur, ch);
+          const double expect = (old != NULL) ? sim_synth_ref(old, ch) + (b - sim_synth_ref(old, ch)) * w : b;
+          sim_synth_expect(&st, buf[i * SIM_CHANNELS + ch], ch, expect,
+                           (old != NULL) ? SIM_FADE_TOL + SIM_SYNTH_TOL : SIM_SYNTH_TOL);
+        }
+      }
+    }
+    printf("[SYNTH] stream       checked=%llu max_err=%u errors=%llu switch_late=%lu\n",
+           (unsigned long long)st.checked, (unsigned)st.max_err, (unsigned long long)st.errors,
+           (unsigned long)stream.switch_late);
+    total.checked += st.checked;
+    total.errors += st.errors;
+    if (st.errors != 0u || stream.switch_late != 0u) {
+      rc = 1;
+    }
+  }
+
+  printf("[SYNTH] total checked=%llu errors=%llu -> %s\n", (unsigned long long)total.checked,
+         (unsigned long long)total.errors, (rc == 0) ? "PASS" : "FAIL");
+  free(ref);
+  return rc;
+}
+
+int main(int argc, char **argv) {
+  sim_opts_t opt;
+  sim_waves_t wv;
+  sim_result_t res;
+
+  memset(&wv, 0, sizeof(wv));
+  if (sim_parse(argc, argv, &opt) != 0) {
+    sim_usage(argv[0]);
+    return 2;
+  }
+
+  if (opt.wave_path != NULL) {
+    if (sim_wave_load(&wv.base, opt.wave_path, &opt.rate_hz) != 0) {
+      return 2;
+    }
+  } else if (sim_wave_synth(&wv.base, 524280u, 0xA5A5A5A5u) != 0) {
+    return 2;
+  }
+  /* Fault source length deliberately not a multiple of the half size to exercise wraps. */
+  if (sim_wave_synth(&wv.fault, 12345u, 0x12345678u) != 0 ||
+      sim_wave_synth(&wv.fault2, 3001u, 0x0BADF00Du) != 0) {
+    return 2;
+  }
+  if (opt.zcode != 0 || opt.bench_halves != 0u) {
+    sim_wave_t *all[3] = {&wv.base, &wv.fault, &wv.fault2};
+    for (uint32_t i = 0u; i < 3u; i++) {
+      if (all[i]->zcode == NULL && sim_zcode_encode(all[i]) != 0) {
+        return 2;
+      }
+    }
+  }
+
+  DAC8568_Stream_PrepareLut();
+  int rc;
+  if (opt.cmd_check_steps != 0u) {
+    rc = sim_cmd_check(opt.cmd_check_steps);
+  } else if (opt.bench_crc_mb != 0u) {
+    rc = sim_bench_crc(opt.bench_crc_mb);
+  } else if (opt.synth_ref_path != NULL) {
+    rc = sim_synth_check(opt.synth_ref_path, opt.rate_hz);
+  } else if (opt.bench_halves != 0u) {
+    rc = sim_bench(&wv.fault, opt.bench_halves);
+    rc |= sim_bench(&wv.base, opt.bench_halves);
+  } else if (opt.bench_ring_seconds > 0.0) {
+    rc = sim_bench_ring(&opt, &wv);
+  } else {
+    rc = sim_stream_run(&opt, &wv, &res);
+    if (rc == 0) {
+      const double mean_ns = (res.refills != 0u) ? (double)res.refill_sum_ns / (double)res.refills : 0.0;
+      printf("[SIM] rate=%lu sps  duration=%.2f s  slots=%u x %u samples  lead=%u  budget=%.1f us\n",
+             (unsigned long)opt.rate_hz, opt.seconds, (unsigned)opt.slots, (unsigned)res.slot_samples,
+             (unsigned)(res.budget_ns * (double)opt.rate_hz / 1e9 / (double)res.slot_samples + 0.5),
+             res.budget_ns / 1000.0);
+      printf("[SIM] payload=%s format=%s samples=%lu  fault switch at half %lld\n",
+             (opt.wave_path != NULL) ? opt.wave_path : "synthetic",
+             (res.format == DAC8568_WAVE_FORMAT_FRAME32)     ? "frame32"
+             : (res.format == DAC8568_WAVE_FORMAT_ZCODE16x4) ? "zcode16x4"
+                                                             : "code16x4",
+             (unsigned long)wv.base.samples, (long long)opt.switch_at_half);
+      printf("[SIM] refill: count=%llu min=%.1f us mean=%.1f us max=%.1f us (%.2f ns/sample, x%.1f scale)\n",
+             (unsigned long long)res.refills, (double)res.refill_min_ns / 1000.0, mean_ns / 1000.0,
+             (double)res.refill_max_ns / 1000.0, mean_ns / (double)res.slot_samples, opt.cpu_scale);
+      if (opt.playlist != 0) {
+        printf("[SIM] playlist: runs=%llu segments=%lu switch_late=%lu\n", (unsigned long long)res.playlist_runs,
+               (unsigned long)res.sched_count, (unsigned long)res.switch_late);
+      } else if (res.switches != 0u) {
+        printf("[SIM] switch latency=%llu samples (%.2f ms)\n", (unsigned long long)res.latency_max,
+               (double)res.latency_max * 1000.0 / (double)opt.rate_hz);
+      }
+      if (opt.loop[1] != 0u) {
+        printf("[SIM] loop %lu..%lu%s: tail returns to baseline=%llu\n", (unsigned long)opt.loop[0],
+               (unsigned long)opt.loop[1], (opt.loop[2] != 0u) ? " one-shot" : "",
+               (unsigned long long)res.returns);
+      }
+      if (opt.slots != 2u) {
+        printf("[SIM] ring: services=%llu late slots=%lu\n", (unsigned long long)res.services,
+               (unsigned long)res.ring_late);
+      }
+      if (opt.mdma != 0) {
+        printf("[SIM] mdma: refills=%llu staged=%llu max nodes/refill=%u\n",
+               (unsigned long long)g_mdma_refills, (unsigned long long)g_mdma_staged,
+               (unsigned)g_mdma_nodes_max);
+      }
+      printf("[SIM] switch hook: events=%llu errors=%llu\n", (unsigned long long)g_hook_events,
+             (unsigned long long)(g_hook_errors + (g_hook_head - g_hook_tail)));
+      printf("[SIM] worst headroom=%.1f%%  underruns=%llu  frame_errors=%llu\n",
+             100.0 * (1.0 - (double)res.refill_max_ns * opt.cpu_scale / res.budget_ns),
+             (unsigned long long)res.underruns, (unsigned long long)res.frame_errors);
+      rc = (res.frame_errors == 0u && res.underruns == 0u && res.switch_late == 0u && res.ring_late == 0u &&
+            (opt.loop[1] == 0u || res.returns != 0u) && g_hook_errors == 0u && g_hook_head == g_hook_tail) ? 0 : 1;
+      if (opt.verify != 0 && sim_verify_report() != 0) {
+        rc = 1;
+      }
+    }
+  }
+
+  sim_wave_free(&wv.base);
+  sim_wave_free(&wv.fault);
+  sim_wave_free(&wv.fault2);
+  return rc;
+}
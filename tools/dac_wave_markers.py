@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""
+Set / clear the loop markers of a DAC8568 wave partition (header version 2).
+
+  [0, loop_start)            onset, played once
+  [loop_start, loop_end)     sustained while the fault lasts
+  [loop_end, sample_count)   release tail, played once, then back to normal
+  --one-shot                 onset -> loop once -> tail -> normal, whatever the fault duration
+
+Layout (MDK-ARM/HARDWORK/SD_Card/sd_waveform.h, SD_DacWaveLoop_t):
+  "D8CW": loop_start, loop_end, loop_flags follow the 32-byte header (needs data_offset >= 48)
+  "DACW": words 7..9 of the 64-byte header (reserved in version 1)
+  "D8CZ": words 8..10 of the 64-byte header (reserved in version 1)
+The data checksum does not cover the markers, so only the header is rewritten.
+Version 1 firmware rejects version 2 files; --clear writes version 1 back.
+
+Usage:
+  python tools/dac_wave_markers.py wave/bus_ground.bin --loop-start 150ms --loop-end 2000ms
+  python tools/dac_wave_markers.py wave/igbt_fault.bin --loop-start 4096 --loop-end 8192 --one-shot
+  python tools/dac_wave_markers.py wave/bus_ground.bin --clear
+"""
+
+from __future__ import annotations
+
+import argparse
+import struct
+from typing import Tuple
+
+
+CODE16_MAGIC = 0x44384357  # "D8CW"
+FRAME32_MAGIC = 0x44414357  # "DACW"
+ZCODE_MAGIC = 0x4438435A  # "D8CZ"
+VERSION_PLAIN = 1
+VERSION_LOOP = 2
+LOOP_ONE_SHOT = 0x01
+CODE16_V2_HEADER_BYTES = 48
+
+
+def marker_offset(data: bytes) -> Tuple[int, int, int]:
+    """(byte offset of loop_start, sample_rate, sample_count) of a partition header."""
+    magic, version = struct.unpack_from("<2I", data, 0)
+    if version not in (VERSION_PLAIN, VERSION_LOOP):
+        raise ValueError(f"unsupported header version {version}")
+    if magic == CODE16_MAGIC:
+        _, _, rate, count, _, data_offset = struct.unpack_from("<6I", data, 0)
+        if data_offset < CODE16_V2_HEADER_BYTES:
+            raise ValueError(f"D8CW data_offset {data_offset} < {CODE16_V2_HEADER_BYTES}: regenerate the file")
+        return 32, rate, count
+    if magic == FRAME32_MAGIC:
+        _, _, _, rate, count = struct.unpack_from("<5I", data, 0)
+        return 28, rate, count
+    if magic == ZCODE_MAGIC:
+        _, _, _, rate, count = struct.unpack_from("<5I", data, 0)
+        return 32, rate, count
+    raise ValueError("not a D8CW / DACW / D8CZ partition")
+
+
+def parse_point(text: str, rate: int) -> int:
+    """Sample index, or milliseconds with an "ms" suffix."""
+    if text.endswith("ms"):
+        return int(round(float(text[:-2]) * rate / 1000.0))
+    return int(text, 0)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Set / clear DAC8568 wave loop markers (header version 2).")
+    parser.add_argument("path", help="D8CW / DACW / D8CZ partition file (rewritten in place)")
+    parser.add_argument("--loop-start", default="0", help="first sample of the sustain loop (or N ms)")
+    parser.add_argument("--loop-end", help="first sample of the release tail (or N ms); default: end of data")
+    parser.add_argument("--one-shot", action="store_true", help="play onset, loop and tail once")
+    parser.add_argument("--clear", action="store_true", help="drop the markers (version 1 header)")
+    args = parser.parse_args()
+
+    with open(args.path, "rb") as f:
+        header = bytearray(f.read(64))
+    offset, rate, count = marker_offset(bytes(header))
+
+    if args.clear:
+        struct.pack_into("<I", header, 4, VERSION_PLAIN)
+        struct.pack_into("<3I", header, offset, 0, 0, 0)
+        print(f"[markers] {args.path}: cleared")
+    else:
+        start = parse_point(args.loop_start, rate)
+        end = parse_point(args.loop_end, rate) if args.loop_end is not None else count
+        if not 0 <= start < end <= count:
+            raise ValueError(f"need 0 <= loop_start ({start}) < loop_end ({end}) <= sample_count ({count})")
+        flags = LOOP_ONE_SHOT if args.one_shot else 0
+        struct.pack_into("<I", header, 4, VERSION_LOOP)
+        struct.pack_into("<3I", header, offset, start, end, flags)
+        print(f"[markers] {args.path}: onset {start}, loop {start}..{end}, tail {count - end} samples"
+              f"{', one-shot' if flags else ''} @ {rate} sps")
+
+    with open(args.path, "r+b") as f:
+        f.write(header)
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""
+Compress DAC8568 wave partitions into the "D8CZ" block format.
+
+Layout (MDK-ARM/HARDWORK/DAC8568/dac8568_zcode.h, SD_DacZWaveHeader_t):
+  64-byte header: magic "D8CZ", version, header_bytes, sample_rate, sample_count,
+                  block_samples (64), data_bytes, crc32 (of the payload), loop markers,
+                  channel_count (4 or 8, taken from the input), reserved
+  payload:        uint32 block_offset[block_count] (word offset from the payload start)
+                  blocks: per channel (A..D or A..H) one header word
+                      base(16) | width(5) << 16 | mode << 24
+                  then `width`-bit residuals packed LSB first, padded to a word
+                      FOR   (mode 0): code = base + r,             base = block minimum
+                      DELTA (mode 1): code = prev + unzigzag(r),   prev starts at base
+                  2 zero pad words
+
+The narrower mode wins per block and channel, so a slowly moving bus with
+small ripple / noise costs a few bits per code instead of 16. Every block is
+decoded again right after it is encoded (round-trip check).
+
+Usage:
+  python tools/dac_wave_zcode.py wave/normal.bin [more.bin ...] --out-dir wave_z
+  (inputs: "D8CW" code16 or "DACW" frame32 partitions; outputs keep the file names)
+"""
+
+from __future__ import annotations
+
+import argparse
+import os
+import struct
+import zlib
+from typing import List, Sequence, Tuple
+
+
+MAGIC = 0x4438435A  # "D8CZ"
+VERSION = 1
+HEADER_BYTES = 64
+BLOCK = 64
+CHANNEL_COUNTS = (4, 8)  # DAC8568_CHANNELS builds; the header records which one
+PAD_WORDS = 2
+MODE_FOR = 0
+MODE_DELTA = 1
+
+CODE16_MAGIC = 0x44384357  # "D8CW"
+FRAME32_MAGIC = 0x44414357  # "DACW"
+
+
+def zigzag(d: int) -> int:
+    return (d << 1) if d >= 0 else ((-d) << 1) - 1
+
+
+def unzigzag(r: int) -> int:
+    return (r >> 1) ^ -(r & 1)
+
+
+def encode_channel(values: Sequence[int]) -> Tuple[int, int, int, List[int]]:
+    """Return (mode, base, width, residuals) of the narrower coding."""
+    lo = min(values)
+    w_for = (max(values) - lo).bit_length()
+    prev = values[0]
+    deltas = []
+    for v in values:
+        deltas.append(zigzag(v - prev))
+        prev = v
+    w_delta = max(deltas).bit_length()
+    if w_delta < w_for:
+        return MODE_DELTA, values[0], w_delta, deltas
+    return MODE_FOR, lo, w_for, [v - lo for v in values]
+
+
+def pack_bits(residuals: Sequence[int], width: int) -> List[int]:
+    words = (len(residuals) * width + 31) // 32
+    acc = 0
+    for i, r in enumerate(residuals):
+        acc |= r << (i * width)
+    return list(struct.unpack(f"<{words}I", acc.to_bytes(words * 4, "little"))) if words else []
+
+
+def decode_channel(words: Sequence[int], n: int) -> List[int]:
+    hdr = words[0]
+    base = hdr & 0xFFFF
+    width = (hdr >> 16) & 0x1F
+    mode = (hdr >> 24) & 1
+    acc = int.from_bytes(struct.pack(f"<{len(words) - 1}I", *words[1:]), "little") if len(words) > 1 else 0
+    mask = (1 << width) - 1
+    out = []
+    code = base
+    for i in range(n):
+        r = (acc >> (i * width)) & mask
+        if mode == MODE_DELTA:
+            code += unzigzag(r)
+            out.append(code)
+        else:
+            out.append(base + r)
+    return out
+
+
+def encode_codes(codes: Sequence[int], sample_count: int, channels: int) -> bytes:
+    """codes: interleaved A,B,... per sample. Returns the payload (table + blocks + pad)."""
+    blocks = (sample_count + BLOCK - 1) // BLOCK
+    table: List[int] = []
+    body: List[int] = []
+    for b in range(blocks):
+        first = b * BLOCK
+        n = min(BLOCK, sample_count - first)
+        table.append(blocks + len(body))
+        for ch in range(channels):
+            values = codes[first * channels + ch:(first + n) * channels:channels]
+            mode, base, width, residuals = encode_channel(values)
+            words = [base | (width << 16) | (mode << 24)] + pack_bits(residuals, width)
+            if decode_channel(words, n) != list(values):
+                raise RuntimeError(f"round-trip mismatch: block {b} channel {ch}")
+            body.extend(words)
+    words = table + body + [0] * PAD_WORDS
+    return struct.pack(f"<{len(words)}I", *words)
+
+
+def write_zcode(path: str, sample_rate: int, sample_count: int, codes: Sequence[int], channels: int = 4) -> int:
+    """Write a D8CZ partition file; returns its size in bytes."""
+    payload = encode_codes(codes, sample_count, channels)
+    header = struct.pack(
+        "<8I3I5I",
+        MAGIC,
+        VERSION,
+        HEADER_BYTES,
+        sample_rate,
+        sample_count,
+        BLOCK,
+        len(payload),
+        zlib.crc32(payload) & 0xFFFFFFFF,
+        0, 0, 0,
+        channels,
+        *([0] * 4),
+    )
+    d = os.path.dirname(path)
+    if d:
+        os.makedirs(d, exist_ok=True)
+    with open(path, "wb") as f:
+        f.write(header)
+        f.write(payload)
+    return len(header) + len(payload)
+
+
+def read_partition(path: str) -> Tuple[int, int, int, List[int]]:
+    """Read a D8CW / DACW partition: (sample_rate, sample_count, channels, interleaved codes)."""
+    with open(path, "rb") as f:
+        data = f.read()
+    magic = struct.unpack_from("<I", data, 0)[0]
+    if magic == FRAME32_MAGIC:
+        _, _, header_bytes, rate, count, words_per_sample = struct.unpack_from("<6I", data, 0)
+        if words_per_sample not in CHANNEL_COUNTS:
+            raise ValueError(f"{path}: words_per_sample {words_per_sample}")
+        frames = struct.unpack_from(f"<{count * words_per_sample}I", data, header_bytes)
+        return rate, count, words_per_sample, [(w >> 4) & 0xFFFF for w in frames]
+    if magic == CODE16_MAGIC:
+        _, _, rate, count, channels, data_offset, _, _ = struct.unpack_from("<8I", data, 0)
+        if channels not in CHANNEL_COUNTS:
+            raise ValueError(f"{path}: channel_count {channels}")
+        return rate, count, channels, list(struct.unpack_from(f"<{count * channels}H", data, data_offset))
+    raise ValueError(f"{path}: not a D8CW / DACW partition")
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Compress DAC8568 wave partitions (D8CW / DACW -> D8CZ).")
+    parser.add_argument("inputs", nargs="+", help="D8CW / DACW partition files")
+    parser.add_argument("--out-dir", required=True, help="Output directory (file names are kept)")
+    args = parser.parse_args()
+
+    for path in args.inputs:
+        rate, count, channels, codes = read_partition(path)
+        out_path = os.path.join(args.out_dir, os.path.basename(path))
+        size = write_zcode(out_path, rate, count, codes, channels)
+        raw = HEADER_BYTES + count * channels * 2
+        print(f"[zcode] {path} -> {out_path}: {count} samples x {channels} ch, {size} bytes "
+              f"({size * 8.0 / (count * channels):.2f} bits/code, {raw / size:.2f}x vs code16)")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
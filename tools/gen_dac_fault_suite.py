@@ -17,7 +17,16 @@ Target SD paths on MCU:
   0:/wave/pwm_abnormal.bin
   0:/wave/igbt_fault.bin
 
-Binary format matches MDK-ARM/HARDWORK/SD_Card/sd_waveform.h (SD_DacWaveHeader_t).
+Binary format matches MDK-ARM/HARDWORK/SD_Card/sd_waveform.h:
+  --format code16  (default) "D8CW" SD_DacWaveHeader_t + 4 x uint16 codes per sample
+  --format frame32           "DACW" SD_DacFrameWaveHeader_t + 4 x uint32 SPI frames per sample
+                             (refill is a plain copy on the MCU; half the samples per 4MB)
+  --format zcode16           "D8CZ" SD_DacZWaveHeader_t + block-compressed codes
+                             (tools/dac_wave_zcode.py, decoded at refill); any
+                             --sample-count whose payload fits the 4MB partition
+  --format raw16             headerless 4 x uint16 codes of all seven waves back to back in
+                             one file (--out-file), any --sample-count; reference for the
+                             on-device synthesis check (tools/dac8568_sim --synth-check)
 """
 
 from __future__ import annotations
@@ -26,9 +35,11 @@ import argparse
 import math
 import os
 import struct
+import zlib
 from dataclasses import dataclass
 from typing import Callable, Tuple
 
+import dac_wave_zcode
 
 MAGIC = 0x44384357  # "D8CW"
 VERSION = 1
@@ -43,6 +54,21 @@ VOUT_MIN = -5.0
 PARTITION_BYTES = 4 * 1024 * 1024
 FULL_SAMPLE_COUNT = (PARTITION_BYTES - DATA_OFFSET) // (CHANNELS * 2)  # 4ch x uint16
 
+FRAME32_MAGIC = 0x44414357  # "DACW"
+FRAME32_VERSION = 1
+FRAME32_HEADER_BYTES = 64
+FRAME32_SAMPLE_COUNT = (PARTITION_BYTES - FRAME32_HEADER_BYTES) // (CHANNELS * 4)  # 4ch x uint32
+
+# DAC8568 32-bit frame: [0000|CMD|ADDR|DATA16|0000]; D = write+update all (dac8568_stream.h).
+CMD_WRITE_INPUT = 0x0
+CMD_WRITE_UPDATE_ALL = 0x2
+FRAME_PREFIX = (
+    (CMD_WRITE_INPUT << 24) | (0 << 20),
+    (CMD_WRITE_INPUT << 24) | (1 << 20),
+    (CMD_WRITE_INPUT << 24) | (2 << 20),
+    (CMD_WRITE_UPDATE_ALL << 24) | (3 << 20),
+)
+
 
 def voltage_to_code(voltage: float) -> int:
     clamped = max(VOUT_MIN, min(VOUT_MAX, voltage))
@@ -393,39 +419,136 @@ def write_bin(path: str, sample_rate: int, sample_count: int, func: Callable[[in
         raise RuntimeError(f"unexpected output size: {size} bytes")
 
 
+def write_bin_frame32(path: str, sample_rate: int, sample_count: int, func: Callable[[int, XorShift32], Tuple[float, float, float, float]]) -> None:
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+
+    data_bytes = sample_count * CHANNELS * 4
+    if FRAME32_HEADER_BYTES + data_bytes > PARTITION_BYTES:
+        raise ValueError("size mismatch: header+data > 4MB partition")
+
+    rng = XorShift32(seed=0xA5A5A5A5)
+    crc = 0
+
+    with open(path, "wb") as f:
+        f.write(b"\x00" * FRAME32_HEADER_BYTES)
+
+        chunk_samples = 2048
+        for base in range(0, sample_count, chunk_samples):
+            n = min(chunk_samples, sample_count - base)
+            out = bytearray()
+            for j in range(n):
+                idx = base + j
+                codes = [voltage_to_code(v) for v in func(idx, rng)]
+                out.extend(struct.pack(
+                    "<4I",
+                    FRAME_PREFIX[0] | (codes[0] << 4),
+                    FRAME_PREFIX[1] | (codes[1] << 4),
+                    FRAME_PREFIX[2] | (codes[2] << 4),
+                    FRAME_PREFIX[3] | (codes[3] << 4),
+                ))
+            crc = zlib.crc32(out, crc)
+            f.write(out)
+
+        header = struct.pack(
+            "<7I9I",
+            FRAME32_MAGIC,
+            FRAME32_VERSION,
+            FRAME32_HEADER_BYTES,
+            sample_rate,
+            sample_count,
+            CHANNELS,
+            crc & 0xFFFFFFFF,
+            *([0] * 9),
+        )
+        f.seek(0)
+        f.write(header)
+
+
+def write_bin_zcode(path: str, sample_rate: int, sample_count: int, func: Callable[[int, XorShift32], Tuple[float, float, float, float]]) -> None:
+    rng = XorShift32(seed=0xA5A5A5A5)
+    codes = []
+    for idx in range(sample_count):
+        codes.extend(voltage_to_code(v) for v in func(idx, rng))
+    size = dac_wave_zcode.write_zcode(path, sample_rate, sample_count, codes)
+    if size > PARTITION_BYTES:
+        os.remove(path)
+        raise ValueError(f"compressed wave does not fit the 4MB partition: {size} bytes")
+    print(f"[gen]   {size} bytes, {size * 8.0 / (sample_count * CHANNELS):.2f} bits/code")
+
+
+def write_raw16(path: str, sample_count: int, suite: list) -> None:
+    d = os.path.dirname(path)
+    if d:
+        os.makedirs(d, exist_ok=True)
+    with open(path, "wb") as f:
+        for spec in suite:
+            rng = XorShift32(seed=0xA5A5A5A5)
+            out = bytearray()
+            for idx in range(sample_count):
+                out.extend(struct.pack("<4H", *[voltage_to_code(v) for v in spec.func(idx, rng)]))
+            f.write(out)
+
+
+def make_suite(ctx: WaveContext) -> list:
+    return [
+        WaveSpec("normal", "normal.bin", lambda i, r: wave_normal(i, r, ctx)),
+        WaveSpec("ac_coupling", "ac_coupling.bin", lambda i, r: wave_ac_coupling(i, r, ctx)),
+        WaveSpec("bus_ground", "bus_ground.bin", lambda i, r: wave_bus_ground(i, r, ctx)),
+        WaveSpec("insulation", "insulation.bin", lambda i, r: wave_insulation(i, r, ctx)),
+        WaveSpec("cap_aging", "cap_aging.bin", lambda i, r: wave_cap_aging(i, r, ctx)),
+        WaveSpec("pwm_abnormal", "pwm_abnormal.bin", lambda i, r: wave_pwm_abnormal(i, r, ctx)),
+        WaveSpec("igbt_fault", "igbt_fault.bin", lambda i, r: wave_igbt_fault(i, r, ctx)),
+    ]
+
+
 def main() -> int:
     parser = argparse.ArgumentParser(description="Generate full 7-partition DAC8568 fault suite (7 x 4MB).")
     parser.add_argument("--out-dir", default="sd_card_payload/copy_to_sd/wave", help="Output directory for wave/*.bin")
     parser.add_argument("--sample-rate", type=int, default=102400)
+    parser.add_argument("--format", choices=("code16", "frame32", "zcode16", "raw16"), default="code16",
+                        help="code16: D8CW 4 x uint16 codes; frame32: DACW pre-framed 32-bit SPI words; "
+                             "zcode16: D8CZ block-compressed codes; "
+                             "raw16: headerless codes of all waves in one file (host tests)")
+    parser.add_argument("--sample-count", type=int, default=0,
+                        help="zcode16 / raw16 only: samples per wave (default: the code16 partition count)")
+    parser.add_argument("--out-file", default="synth_ref.raw", help="raw16 only: output file")
     args = parser.parse_args()
 
     sample_rate = int(args.sample_rate)
     if sample_rate <= 0:
         raise ValueError("sample-rate must be positive")
 
-    sample_count = int(FULL_SAMPLE_COUNT)
+    if args.format == "raw16":
+        sample_count = int(args.sample_count) if args.sample_count > 0 else int(FULL_SAMPLE_COUNT)
+        write_raw16(args.out_file, sample_count, make_suite(make_context(sample_rate, sample_count)))
+        print(f"[gen] raw16 {sample_count} samples x 7 waves @ {sample_rate} sps -> {args.out_file}")
+        return 0
+    zcode16 = (args.format == "zcode16")
+    if args.sample_count != 0 and not zcode16:
+        raise ValueError("--sample-count only applies to --format zcode16 / raw16 (partitions are fixed at 4MB)")
+
+    frame32 = (args.format == "frame32")
+    sample_count = int(FRAME32_SAMPLE_COUNT if frame32 else FULL_SAMPLE_COUNT)
+    writer = write_bin_frame32 if frame32 else write_bin
+    if zcode16:
+        sample_count = int(args.sample_count) if args.sample_count > 0 else sample_count
+        writer = write_bin_zcode
     ctx = make_context(sample_rate, sample_count)
 
     out_dir = args.out_dir
-    suite = [
-        WaveSpec("normal", "normal.bin", lambda i, r: wave_normal(i, r, ctx)),
-        WaveSpec("ac_coupling", "ac_coupling.bin", lambda i, r: wave_ac_coupling(i, r, ctx)),
-        WaveSpec("bus_ground", "bus_ground.bin", lambda i, r: wave_bus_ground(i, r, ctx)),
-        WaveSpec("insulation", "insulation.bin", lambda i, r: wave_insulation(i, r, ctx)),
-        WaveSpec("cap_aging", "cap_aging.bin", lambda i, r: wave_cap_aging(i, r, ctx)),
-        WaveSpec("pwm_abnormal", "pwm_abnormal.bin", lambda i, r: wave_pwm_abnormal(i, r, ctx)),
-        WaveSpec("igbt_fault", "igbt_fault.bin", lambda i, r: wave_igbt_fault(i, r, ctx)),
-    ]
+    suite = make_suite(ctx)
 
     for spec in suite:
         out_path = os.path.join(out_dir, spec.filename)
         print(f"[gen] {spec.name} -> {out_path}")
-        write_bin(out_path, sample_rate, sample_count, spec.func)
+        writer(out_path, sample_rate, sample_count, spec.func)
 
     print("Done.")
+    print(f"Format: {args.format}")
     print(f"SampleRate: {sample_rate}")
     print(f"SampleCount: {sample_count}")
-    print(f"EachFileBytes: {PARTITION_BYTES}")
+    if not zcode16:
+        print(f"EachFileBytes: {PARTITION_BYTES}")
     return 0
 
 
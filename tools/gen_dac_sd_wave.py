@@ -6,7 +6,6 @@ import struct
 
 MAGIC = 0x44384357  # "D8CW"
 VERSION = 1
-CHANNELS = 4
 DATA_OFFSET = 64
 VREF_MV = 2500.0
 VOUT_MAX = 5.0
@@ -49,7 +48,8 @@ def square(phase: float) -> float:
     return 1.0 if (phase % 1.0) < 0.5 else -1.0
 
 
-def build_wave(sample_rate: int, sample_count: int, fa: float, fb: float, fc: float, fd: float) -> bytes:
+def build_wave(sample_rate: int, sample_count: int, fa: float, fb: float, fc: float, fd: float,
+               channels: int) -> bytes:
     words = []
     for index in range(sample_count):
         t = index / float(sample_rate)
@@ -57,14 +57,14 @@ def build_wave(sample_rate: int, sample_count: int, fa: float, fb: float, fc: fl
         vb = VOUT_MAX * triangle(fb * t)
         vc = VOUT_MAX * saw(fc * t)
         vd = VOUT_MAX * square(fd * t)
-        words.extend(
-            [
-                voltage_to_code(va),
-                voltage_to_code(vb),
-                voltage_to_code(vc),
-                voltage_to_code(vd),
-            ]
-        )
+        sample = [
+            voltage_to_code(va),
+            voltage_to_code(vb),
+            voltage_to_code(vc),
+            voltage_to_code(vd),
+        ]
+        # 8-channel builds (DAC8568_CHANNELS=8): E..H repeat A..D like the firmware LUT.
+        words.extend(sample * (channels // 4))
     return struct.pack("<{}H".format(len(words)), *words)
 
 
@@ -77,12 +77,14 @@ def main() -> int:
     parser.add_argument("--fb", type=float, default=6000.0)
     parser.add_argument("--fc", type=float, default=3000.0)
     parser.add_argument("--fd", type=float, default=1000.0)
+    parser.add_argument("--channels", type=int, choices=(4, 8), default=4,
+                        help="channels per sample, must match DAC8568_CHANNELS of the firmware")
     args = parser.parse_args()
 
     if args.sample_rate <= 0 or args.samples <= 0:
         raise ValueError("sample-rate and samples must be positive")
 
-    data = build_wave(args.sample_rate, args.samples, args.fa, args.fb, args.fc, args.fd)
+    data = build_wave(args.sample_rate, args.samples, args.fa, args.fb, args.fc, args.fd, args.channels)
     checksum = checksum_fnv1a(data)
     header = struct.pack(
         "<8I",
@@ -90,7 +92,7 @@ def main() -> int:
         VERSION,
         args.sample_rate,
         args.samples,
-        CHANNELS,
+        args.channels,
         DATA_OFFSET,
         len(data),
         checksum,
@@ -106,6 +108,7 @@ def main() -> int:
     print("Generated:", args.output)
     print("SampleRate:", args.sample_rate)
     print("Samples:", args.samples)
+    print("Channels:", args.channels)
     print("DataBytes:", len(data))
     print("Checksum: 0x{:08X}".format(checksum))
     return 0